@@ -905,6 +905,8 @@ static bool aiferry_findcargo(struct ai_type *ait, struct unit *pferry)
   struct pf_parameter parameter;
   int passengers = dai_plr_data_get(ait, unit_owner(pferry), NULL)->stats.passengers;
   struct player *pplayer;
+  struct tile_hash *cargo_tiles;
+  int cargo_left;
 
   if (passengers <= 0) {
     /* No passangers anywhere */
@@ -914,6 +916,19 @@ static bool aiferry_findcargo(struct ai_type *ait, struct unit *pferry)
   UNIT_LOG(LOGLEVEL_FERRY, pferry, "Ferryboat is looking for cargo.");
 
   pplayer = unit_owner(pferry);
+
+  /* Where the search can stop, see below. */
+  cargo_tiles = tile_hash_new();
+  unit_list_iterate(pplayer->units, aunit) {
+    struct unit_ai *unit_data = def_ai_unit_data(aunit, ait);
+
+    if (unit_data->ferryboat == FERRY_WANTED
+        || unit_data->ferryboat == pferry->id) {
+      tile_hash_replace(cargo_tiles, unit_tile(aunit), NULL);
+    }
+  } unit_list_iterate_end;
+  cargo_left = tile_hash_size(cargo_tiles);
+
   pft_fill_unit_overlap_param(&parameter, pferry);
   parameter.omniscience = !has_handicap(pplayer, H_MAP);
   /* If we have omniscience, we use it, since paths to some places
@@ -922,6 +937,15 @@ static bool aiferry_findcargo(struct ai_type *ait, struct unit *pferry)
   
   pfm = pf_map_new(&parameter);
   pf_map_tiles_iterate(pfm, ptile, TRUE) {
+    if (0 == cargo_left) {
+      /* Seen all the units that want a boat. */
+      break;
+    }
+    if (!tile_hash_remove(cargo_tiles, ptile)) {
+      continue;
+    }
+    cargo_left--;
+
     unit_list_iterate(ptile->units, aunit) {
       struct unit_ai *unit_data = def_ai_unit_data(aunit, ait);
 
@@ -936,6 +960,7 @@ static bool aiferry_findcargo(struct ai_type *ait, struct unit *pferry)
 	pferry->goto_tile = unit_tile(aunit);
         /* Exchange phone numbers */
         aiferry_psngr_meet_boat(ait, aunit, pferry);
+        tile_hash_destroy(cargo_tiles);
         pf_map_destroy(pfm);
         return TRUE;
       }
@@ -946,10 +971,23 @@ static bool aiferry_findcargo(struct ai_type *ait, struct unit *pferry)
    * because of an internal sea or enemy blocking the route */
   UNIT_LOG(LOGLEVEL_FERRY, pferry,
            "AI Passengers counting reported false positive %d", passengers);
+  tile_hash_destroy(cargo_tiles);
   pf_map_destroy(pfm);
   return FALSE;
 }
 
+/**********************************************************************//**
+  Does the city ask for a boat, or build one of its own?
+**************************************************************************/
+static bool aiferry_city_wants_boat(struct ai_type *ait,
+                                    const struct city *pcity)
+{
+  return (def_ai_city_data(pcity, ait)->choice.need_boat
+          || (VUT_UTYPE == pcity->production.kind
+              && utype_has_role(pcity->production.value.utype,
+                                L_FERRYBOAT)));
+}
+
 /**********************************************************************//**
   A helper for ai_manage_ferryboat.  Finds a city that wants a ferry.  It
   might signal for the ferry using pcity->server.ai.choice.need_boat field or
@@ -972,9 +1010,20 @@ static bool aiferry_find_interested_city(struct ai_type *ait,
   int turns_horizon = FC_INFINITY;
   /* Future return value */
   bool needed = FALSE;
+  /* Cities we have not reached yet that may want us */
+  int cities_left = 0;
 
   UNIT_LOG(LOGLEVEL_FERRY, pferry, "Ferry looking for a city that needs it");
 
+  city_list_iterate(unit_owner(pferry)->cities, pcity) {
+    if (aiferry_city_wants_boat(ait, pcity)) {
+      cities_left++;
+    }
+  } city_list_iterate_end;
+  if (0 == cities_left) {
+    return FALSE;
+  }
+
   pft_fill_unit_parameter(&parameter, pferry);
   /* We are looking for our own cities, no need to look into the unknown */
   parameter.get_TB = no_fights_or_unknown;
@@ -984,7 +1033,7 @@ static bool aiferry_find_interested_city(struct ai_type *ait,
   pf_map_positions_iterate(pfm, pos, TRUE) {
     struct city *pcity;
 
-    if (pos.turn >= turns_horizon) {
+    if (pos.turn >= turns_horizon || 0 == cities_left) {
       /* Won't be able to find anything better than what we have */
       break;
     }
@@ -992,13 +1041,12 @@ static bool aiferry_find_interested_city(struct ai_type *ait,
     pcity = tile_city(pos.tile);
     
     if (pcity && city_owner(pcity) == unit_owner(pferry)
-        && (def_ai_city_data(pcity, ait)->choice.need_boat 
-            || (VUT_UTYPE == pcity->production.kind
-		&& utype_has_role(pcity->production.value.utype,
-				  L_FERRYBOAT)))) {
+        && aiferry_city_wants_boat(ait, pcity)) {
       bool really_needed = TRUE;
       int turns = city_production_turns_to_build(pcity, TRUE);
 
+      cities_left--;
+
       UNIT_LOG(LOGLEVEL_FERRY, pferry, "%s (%d, %d) looks promising...", 
                city_name_get(pcity), TILE_XY(pcity->tile));
 
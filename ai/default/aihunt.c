@@ -414,6 +414,36 @@ static void dai_hunter_juiciness(struct player *pplayer, struct unit *punit,
   *stackthreat += *stackcost;
 }
 
+/**********************************************************************//**
+  Collect the tiles of all units that dai_hunter_manage() would look at
+  as targets for a hunter of pplayer, whatever the hunter. Returns the
+  number of tiles.
+**************************************************************************/
+static int dai_hunter_target_tiles(struct ai_type *ait,
+                                   struct player *pplayer,
+                                   struct tile_hash *tiles)
+{
+  players_iterate(aplayer) {
+    if (!adv_is_player_dangerous(pplayer, aplayer)) {
+      continue;
+    }
+
+    unit_list_iterate(aplayer->units, target) {
+      struct unit_ai *target_data = def_ai_unit_data(target, ait);
+
+      if (BV_ISSET(target_data->hunted, player_index(pplayer))
+          || (!utype_acts_hostile(unit_type_get(target))
+              && get_transporter_capacity(target) == 0
+              && !unit_has_type_flag(target, UTYF_GAMELOSS))) {
+        continue;
+      }
+      tile_hash_replace(tiles, unit_tile(target), NULL);
+    } unit_list_iterate_end;
+  } players_iterate_end;
+
+  return tile_hash_size(tiles);
+}
+
 /**********************************************************************//**
   Manage a (possibly virtual) hunter. Return the want for building a
   hunter like this. If we return 0, then we have nothing to do with
@@ -436,10 +466,23 @@ int dai_hunter_manage(struct ai_type *ait, struct player *pplayer,
   struct unit_ai *unit_data = def_ai_unit_data(punit, ait);
   struct unit *original_target = game_unit_by_number(unit_data->target);
   int original_threat = 0, original_cost = 0;
+  struct tile_hash *target_tiles;
+  int targets_left;
 
   fc_assert_ret_val(!is_barbarian(pplayer), 0);
   fc_assert_ret_val(pplayer->is_alive, 0);
 
+  /* Every city thinking about building a hunter gets here with a virtual
+   * one, so avoid the search when it cannot find anything, and end it
+   * when all possible targets have been looked at. */
+  target_tiles = tile_hash_new();
+  targets_left = dai_hunter_target_tiles(ait, pplayer, target_tiles);
+  if (0 == targets_left) {
+    UNIT_LOG(LOGLEVEL_HUNT, punit, "no hunt targets");
+    tile_hash_destroy(target_tiles);
+    return 0;
+  }
+
   pft_fill_unit_parameter(&parameter, punit);
   parameter.omniscience = !has_handicap(pplayer, H_MAP);
   pfm = pf_map_new(&parameter);
@@ -453,10 +496,20 @@ int dai_hunter_manage(struct ai_type *ait, struct player *pplayer,
     /* End faster if we have a target */
     if (move_cost > limit) {
       UNIT_LOG(LOGLEVEL_HUNT, punit, "gave up finding hunt target");
+      tile_hash_destroy(target_tiles);
       pf_map_destroy(pfm);
       return 0;
     }
 
+    if (0 == targets_left) {
+      break;
+    }
+    if (!tile_hash_remove(target_tiles, ptile)) {
+      /* Nothing to hunt there. */
+      continue;
+    }
+    targets_left--;
+
     if (tile_city(ptile)
         || !can_unit_attack_tile(punit, ptile)) {
       continue;
@@ -551,6 +604,7 @@ int dai_hunter_manage(struct ai_type *ait, struct player *pplayer,
       /* Ok, now we FINALLY have a target worth destroying! */
       unit_data->target = target->id;
       if (is_virtual) {
+        tile_hash_destroy(target_tiles);
         pf_map_destroy(pfm);
         return stackthreat;
       }
@@ -565,6 +619,7 @@ int dai_hunter_manage(struct ai_type *ait, struct player *pplayer,
       if (target != game_unit_by_number(sanity_target)) {
         UNIT_LOG(LOGLEVEL_HUNT, punit, "mission accomplished by cargo (pre)");
         dai_unit_new_task(ait, punit, AIUNIT_NONE, NULL);
+        tile_hash_destroy(target_tiles);
         pf_map_destroy(pfm);
         return -1; /* try again */
       }
@@ -573,6 +628,7 @@ int dai_hunter_manage(struct ai_type *ait, struct player *pplayer,
       path = pf_map_path(pfm, unit_tile(target));
       if (!adv_unit_execute_path(punit, path)) {
         pf_path_destroy(path);
+        tile_hash_destroy(target_tiles);
         pf_map_destroy(pfm);
         return 0;
       }
@@ -581,6 +637,7 @@ int dai_hunter_manage(struct ai_type *ait, struct player *pplayer,
       if (target != game_unit_by_number(sanity_target)) {
         UNIT_LOG(LOGLEVEL_HUNT, punit, "mission accomplished");
         dai_unit_new_task(ait, punit, AIUNIT_NONE, NULL);
+        tile_hash_destroy(target_tiles);
         pf_map_destroy(pfm);
         return -1; /* try again */
       }
@@ -590,10 +647,12 @@ int dai_hunter_manage(struct ai_type *ait, struct player *pplayer,
       if (target != game_unit_by_number(sanity_target)) {
         UNIT_LOG(LOGLEVEL_HUNT, punit, "mission accomplished by cargo (post)");
         dai_unit_new_task(ait, punit, AIUNIT_NONE, NULL);
+        tile_hash_destroy(target_tiles);
         pf_map_destroy(pfm);
         return -1; /* try again */
       }
 
+      tile_hash_destroy(target_tiles);
       pf_map_destroy(pfm);
       unit_data->done = TRUE;
       return stackthreat; /* still have work to do */
@@ -601,6 +660,7 @@ int dai_hunter_manage(struct ai_type *ait, struct player *pplayer,
   } pf_map_move_costs_iterate_end;
 
   UNIT_LOG(LOGLEVEL_HUNT, punit, "ran out of map finding hunt target");
+  tile_hash_destroy(target_tiles);
   pf_map_destroy(pfm);
   return 0; /* found nothing */
 }
@@ -32,6 +32,7 @@
 #include "movement.h"
 #include "packets.h"
 #include "player.h"
+#include "research.h"
 
 /* common/aicore */
 #include "pf_tools.h"
@@ -141,8 +142,44 @@ static void tile_data_cache_destroy(struct tile_data_cache *ptdc);
 #define SPECHASH_IDATA_FREE tile_data_cache_destroy
 #include "spechash.h"
 
+/* Result of cityresult_fill() for one city center, together with
+ * everything it was computed from that may change while the settler
+ * code runs. See cityresult_get(). */
+struct spot_cache {
+  struct cityresult *result;
+
+  /* Player wide inputs. */
+  int turn;
+  const struct government *govt;
+  const struct government *goal_govt;
+  int techs;
+  int cities;
+  int food_priority;
+  int shield_priority;
+  int science_priority;
+
+  /* Inputs at the city center. */
+  const struct terrain *terrain;
+  bv_extras extras;
+
+  /* Two entries per city map index: the reservation of the tile and
+   * whether it is worked or (with H_MAP) unknown. */
+  int radius_sq;
+  int *tiles;
+};
+
+static void spot_cache_destroy(struct spot_cache *pcache);
+
+/* struct spot_cache_hash. */
+#define SPECHASH_TAG spot_cache
+#define SPECHASH_INT_KEY_TYPE
+#define SPECHASH_IDATA_TYPE struct spot_cache *
+#define SPECHASH_IDATA_FREE spot_cache_destroy
+#include "spechash.h"
+
 struct ai_settler {
   struct tile_data_cache_hash *tdc_hash;
+  struct spot_cache_hash *spot_hash;
 
 #ifdef FREECIV_DEBUG
   struct {
@@ -151,6 +188,10 @@ struct ai_settler {
     int miss;
     int save;
   } cache;
+  struct {
+    int hit;
+    int miss;
+  } spots;
 #endif /* FREECIV_DEBUG */
 };
 
@@ -177,7 +218,9 @@ struct cityresult {
 
   int remaining;          /* value of all other tiles */
 
-  /* Save the result for print_citymap(). */
+  /* Save the result for print_citymap(). NULL in copies made by
+   * cityresult_copy(); then the two tile data caches above belong to
+   * the result itself. */
   struct tile_data_cache_hash *tdc_hash;
 
   int city_radius_sq;     /* current squared radius of the city */
@@ -190,17 +233,21 @@ static void tdc_plr_set(struct ai_type *ait, struct player *plr, int tindex,
                         const struct tile_data_cache *tdcache);
 
 static struct cityresult *cityresult_new(struct tile *ptile);
+static struct cityresult *cityresult_copy(const struct cityresult *result);
 static void cityresult_destroy(struct cityresult *result);
 
 static struct cityresult *cityresult_fill(struct ai_type *ait,
                                           struct player *pplayer,
                                           struct tile *center);
+static struct cityresult *cityresult_get(struct ai_type *ait,
+                                         struct player *pplayer,
+                                         struct tile *center);
 static bool food_starvation(const struct cityresult *result);
 static bool shield_starvation(const struct cityresult *result);
 static int result_defense_bonus(struct player *pplayer,
                                 const struct cityresult *result);
 static int naval_bonus(const struct cityresult *result);
-static void print_cityresult(struct player *pplayer,
+static void print_cityresult(struct ai_type *ait, struct player *pplayer,
                              const struct cityresult *cr);
 struct cityresult *city_desirability(struct ai_type *ait,
                                      struct player *pplayer,
@@ -249,6 +296,27 @@ static struct cityresult *cityresult_new(struct tile *ptile)
   return result;
 }
 
+/*************************************************************************//**
+  Make a copy of a city result. Only the city center and the best other
+  tile are copied from the tile data.
+*****************************************************************************/
+static struct cityresult *cityresult_copy(const struct cityresult *result)
+{
+  struct cityresult *copy;
+
+  fc_assert_ret_val(result != NULL, NULL);
+
+  copy = fc_malloc(sizeof(*copy));
+  *copy = *result;
+  copy->tdc_hash = NULL;
+  copy->city_center.tdc = tile_data_cache_copy(result->city_center.tdc);
+  if (result->best_other.tdc != NULL) {
+    copy->best_other.tdc = tile_data_cache_copy(result->best_other.tdc);
+  }
+
+  return copy;
+}
+
 /*************************************************************************//**
   Destroy a city result.
 *****************************************************************************/
@@ -257,6 +325,9 @@ static void cityresult_destroy(struct cityresult *result)
   if (result != NULL) {
     if (result->tdc_hash != NULL) {
       tile_data_cache_hash_destroy(result->tdc_hash);
+    } else {
+      tile_data_cache_destroy(result->city_center.tdc);
+      tile_data_cache_destroy(result->best_other.tdc);
     }
     free(result);
   }
@@ -551,6 +622,134 @@ static void tdc_plr_set(struct ai_type *ait, struct player *plr, int tindex,
   tile_data_cache_hash_replace(ai->settler->tdc_hash, tindex, ptdc);
 }
 
+/*************************************************************************//**
+  Free a spot cache entry.
+*****************************************************************************/
+static void spot_cache_destroy(struct spot_cache *pcache)
+{
+  if (pcache) {
+    cityresult_destroy(pcache->result);
+    free(pcache->tiles);
+    free(pcache);
+  }
+}
+
+/*************************************************************************//**
+  Fill in the inputs of cityresult_fill() for a city at 'center' into
+  'pcache'. pcache->result and pcache->tiles are left alone, apart from
+  writing the tile inputs into the latter.
+*****************************************************************************/
+static void spot_cache_inputs(struct spot_cache *pcache,
+                              struct player *pplayer, struct tile *center,
+                              int radius_sq)
+{
+  struct adv_data *adv = adv_data_get(pplayer, NULL);
+  bool handicap = has_handicap(pplayer, H_MAP);
+
+  pcache->turn = game.info.turn;
+  pcache->govt = government_of_player(pplayer);
+  pcache->goal_govt = adv->goal.govt.gov;
+  pcache->techs = research_get(pplayer)->techs_researched;
+  pcache->cities = city_list_size(pplayer->cities);
+  pcache->food_priority = adv->food_priority;
+  pcache->shield_priority = adv->shield_priority;
+  pcache->science_priority = adv->science_priority;
+
+  pcache->terrain = tile_terrain(center);
+  pcache->extras = *tile_extras(center);
+
+  pcache->radius_sq = radius_sq;
+  city_tile_iterate_index(radius_sq, center, ptile, cindex) {
+    pcache->tiles[2 * cindex] = citymap_read(ptile);
+    pcache->tiles[2 * cindex + 1] =
+      (NULL != tile_worked(ptile) ? 1 : 0)
+      | (handicap && !map_is_known(ptile, pplayer) ? 2 : 0);
+  } city_tile_iterate_index_end;
+}
+
+/*************************************************************************//**
+  Return the result of cityresult_fill() for a new city at 'center'.
+
+  The same spots get looked at over and over again within one run of the
+  settler code: by each settler and by each city thinking about building
+  one. So the results for empty spots are kept per player, and reused
+  as long as nothing they depend on has changed. The tile outputs of the
+  other tiles come from the tile data cache, which does not change for
+  a tile once set, so what remains are the reservations and workers in
+  the city radius, the center tile itself, and some player wide values.
+  The cache is emptied together with the tile data cache.
+*****************************************************************************/
+static struct cityresult *cityresult_get(struct ai_type *ait,
+                                         struct player *pplayer,
+                                         struct tile *center)
+{
+  struct ai_plr *ai = dai_plr_data_get(ait, pplayer, NULL);
+  struct spot_cache *pcache = NULL;
+  struct spot_cache current;
+  struct cityresult *result;
+  int tindex = tile_index(center);
+  int radius_sq;
+
+  fc_assert_ret_val(ai != NULL, NULL);
+  fc_assert_ret_val(ai->settler != NULL, NULL);
+
+  if (NULL != tile_city(center)) {
+    /* Depends on the state of the city; not worth tracking. */
+    return cityresult_fill(ait, pplayer, center);
+  }
+
+  if (spot_cache_hash_lookup(ai->settler->spot_hash, tindex, &pcache)) {
+    radius_sq = pcache->radius_sq;
+    current.tiles = fc_malloc(2 * city_map_tiles(radius_sq)
+                              * sizeof(*current.tiles));
+    /* Tiles off the map are not written; keep them equal. */
+    memcpy(current.tiles, pcache->tiles,
+           2 * city_map_tiles(radius_sq) * sizeof(*current.tiles));
+    spot_cache_inputs(&current, pplayer, center, radius_sq);
+
+    if (current.turn == pcache->turn
+        && current.govt == pcache->govt
+        && current.goal_govt == pcache->goal_govt
+        && current.techs == pcache->techs
+        && current.cities == pcache->cities
+        && current.food_priority == pcache->food_priority
+        && current.shield_priority == pcache->shield_priority
+        && current.science_priority == pcache->science_priority
+        && current.terrain == pcache->terrain
+        && BV_ARE_EQUAL(current.extras, pcache->extras)
+        && 0 == memcmp(current.tiles, pcache->tiles,
+                       2 * city_map_tiles(radius_sq)
+                       * sizeof(*current.tiles))) {
+      free(current.tiles);
+#ifdef FREECIV_DEBUG
+      ai->settler->spots.hit++;
+#endif /* FREECIV_DEBUG */
+      return cityresult_copy(pcache->result);
+    }
+    free(current.tiles);
+  }
+
+#ifdef FREECIV_DEBUG
+  ai->settler->spots.miss++;
+#endif /* FREECIV_DEBUG */
+
+  result = cityresult_fill(ait, pplayer, center);
+  if (result == NULL) {
+    return NULL;
+  }
+
+  /* The inputs are read after the fill; it does not change them. */
+  radius_sq = result->city_radius_sq;
+  pcache = fc_malloc(sizeof(*pcache));
+  pcache->tiles = fc_calloc(2 * city_map_tiles(radius_sq),
+                            sizeof(*pcache->tiles));
+  spot_cache_inputs(pcache, pplayer, center, radius_sq);
+  pcache->result = result;
+  spot_cache_hash_replace(ai->settler->spot_hash, tindex, pcache);
+
+  return cityresult_copy(result);
+}
+
 /*************************************************************************//**
   Check if a city on this location would starve.
 *****************************************************************************/
@@ -625,14 +824,26 @@ static int naval_bonus(const struct cityresult *result)
 /*************************************************************************//**
   For debugging, print the city result table.
 *****************************************************************************/
-static void print_cityresult(struct player *pplayer,
+static void print_cityresult(struct ai_type *ait, struct player *pplayer,
                              const struct cityresult *cr)
 {
   int *city_map_reserved, *city_map_food, *city_map_shield, *city_map_trade;
   int tiles = city_map_tiles(cr->city_radius_sq);
+  const struct tile_data_cache_hash *tdc_hash = cr->tdc_hash;
   struct tile_data_cache *ptdc;
 
-  fc_assert_ret(cr->tdc_hash != NULL);
+  if (tdc_hash == NULL) {
+    /* A copy; the tile data is kept in the spot cache. */
+    struct ai_plr *ai = dai_plr_data_get(ait, pplayer, NULL);
+    struct spot_cache *pcache;
+
+    if (spot_cache_hash_lookup(ai->settler->spot_hash,
+                               tile_index(cr->tile), &pcache)) {
+      tdc_hash = pcache->result->tdc_hash;
+    }
+  }
+
+  fc_assert_ret(tdc_hash != NULL);
   fc_assert_ret(tiles > 0);
 
   city_map_reserved = fc_calloc(tiles, sizeof(*city_map_reserved));
@@ -641,7 +852,7 @@ static void print_cityresult(struct player *pplayer,
   city_map_trade = fc_calloc(tiles, sizeof(*city_map_trade));
 
   city_map_iterate(cr->city_radius_sq, cindex, x, y) {
-    tile_data_cache_hash_lookup(cr->tdc_hash, cindex, &ptdc);
+    tile_data_cache_hash_lookup(tdc_hash, cindex, &ptdc);
     fc_assert_ret(ptdc);
     city_map_reserved[cindex] = ptdc->reserved;
     city_map_food[cindex] = ptdc->reserved;
@@ -740,7 +951,7 @@ struct cityresult *city_desirability(struct ai_type *ait, struct player *pplayer
     return NULL;
   }
 
-  cr = cityresult_fill(ait, pplayer, ptile); /* Burn CPU, burn! */
+  cr = cityresult_get(ait, pplayer, ptile); /* Burn CPU, burn! */
   if (!cr) {
     /* Failed to find a good spot */
     return NULL;
@@ -996,12 +1207,15 @@ void dai_auto_settler_init(struct ai_plr *ai)
 
   ai->settler = fc_calloc(1, sizeof(*ai->settler));
   ai->settler->tdc_hash = tile_data_cache_hash_new();
+  ai->settler->spot_hash = spot_cache_hash_new();
 
 #ifdef FREECIV_DEBUG
   ai->settler->cache.hit = 0;
   ai->settler->cache.old = 0;
   ai->settler->cache.miss = 0;
   ai->settler->cache.save = 0;
+  ai->settler->spots.hit = 0;
+  ai->settler->spots.miss = 0;
 #endif /* FREECIV_DEBUG */
 }
 
@@ -1117,7 +1331,7 @@ BUILD_CITY:
         UNIT_LOG(LOG_DEBUG, punit, "makes city at (%d, %d)", 
                  TILE_XY(result->tile));
         if (punit->server.debug) {
-          print_cityresult(pplayer, result);
+          print_cityresult(ait, pplayer, result);
         }
       }
       /* Go make a city! */
@@ -1198,14 +1412,20 @@ void dai_auto_settler_reset(struct ai_type *ait, struct player *pplayer)
             player_name(pplayer), ai->settler->cache.save,
             ai->settler->cache.miss, ai->settler->cache.old,
             ai->settler->cache.hit);
+  log_debug("[aisettler spots for %s] miss: %d, hit: %d",
+            player_name(pplayer), ai->settler->spots.miss,
+            ai->settler->spots.hit);
 
   ai->settler->cache.hit = 0;
   ai->settler->cache.old = 0;
   ai->settler->cache.miss = 0;
   ai->settler->cache.save = 0;
+  ai->settler->spots.hit = 0;
+  ai->settler->spots.miss = 0;
 #endif /* FREECIV_DEBUG */
 
   tile_data_cache_hash_clear(ai->settler->tdc_hash);
+  spot_cache_hash_clear(ai->settler->spot_hash);
 
   if (caller_closes) {
     dai_data_phase_finished(ait, pplayer);
@@ -1223,6 +1443,9 @@ void dai_auto_settler_free(struct ai_plr *ai)
     if (ai->settler->tdc_hash) {
       tile_data_cache_hash_destroy(ai->settler->tdc_hash);
     }
+    if (ai->settler->spot_hash) {
+      spot_cache_hash_destroy(ai->settler->spot_hash);
+    }
     free(ai->settler);
   }
   ai->settler = NULL;
@@ -323,15 +323,13 @@ struct tile *immediate_destination(struct unit *punit,
   if (!same_pos(unit_tile(punit), dest_tile)
       && utype_fuel(unit_type_get(punit))) {
     struct pf_parameter parameter;
-    struct pf_map *pfm;
     struct pf_path *path;
     size_t i;
     struct player *pplayer = unit_owner(punit);
 
     pft_fill_unit_parameter(&parameter, punit);
     parameter.omniscience = !has_handicap(pplayer, H_MAP);
-    pfm = pf_map_new(&parameter);
-    path = pf_map_path(pfm, punit->goto_tile);
+    path = pf_map_path(pf_map_cache_get(&parameter), punit->goto_tile);
 
     if (path) {
       for (i = 1; i < path->length; i++) {
@@ -340,17 +338,14 @@ struct tile *immediate_destination(struct unit *punit,
           struct tile *ptile = path->positions[i].tile;
 
           pf_path_destroy(path);
-          pf_map_destroy(pfm);
           return ptile;
         }
       }
       pf_path_destroy(path);
-      pf_map_destroy(pfm);
       /* Seems it's the immediate destination */
       return punit->goto_tile;
     }
 
-    pf_map_destroy(pfm);
     log_verbose("Did not find an air-route for "
                 "%s %s[%d] (%d,%d)->(%d,%d)",
                 nation_rule_name(nation_of_unit(punit)),
@@ -396,7 +391,6 @@ bool dai_unit_goto_constrained(struct ai_type *ait, struct unit *punit,
                                struct pf_parameter *parameter)
 {
   bool alive = TRUE;
-  struct pf_map *pfm;
   struct pf_path *path;
 
   UNIT_LOG(LOG_DEBUG, punit, "constrained goto to %d,%d", TILE_XY(ptile));
@@ -426,8 +420,7 @@ bool dai_unit_goto_constrained(struct ai_type *ait, struct unit *punit,
     return TRUE;
   }
 
-  pfm = pf_map_new(parameter);
-  path = pf_map_path(pfm, ptile);
+  path = pf_map_path(pf_map_cache_get(parameter), ptile);
 
   if (path) {
     dai_log_path(punit, path, parameter);
@@ -438,7 +431,6 @@ bool dai_unit_goto_constrained(struct ai_type *ait, struct unit *punit,
   }
 
   pf_path_destroy(path);
-  pf_map_destroy(pfm);
 
   return alive;
 }
@@ -456,15 +448,13 @@ bool goto_is_sane(struct unit *punit, struct tile *ptile)
     can_get_there = TRUE;
   } else {
     struct pf_parameter parameter;
-    struct pf_map *pfm;
 
     pft_fill_unit_attack_param(&parameter, punit);
-    pfm = pf_map_new(&parameter);
 
-    if (pf_map_move_cost(pfm, ptile) != PF_IMPOSSIBLE_MC) {
+    if (pf_map_move_cost(pf_map_cache_get(&parameter), ptile)
+        != PF_IMPOSSIBLE_MC) {
       can_get_there = TRUE;
     }
-    pf_map_destroy(pfm);
   }
   return can_get_there;
 }
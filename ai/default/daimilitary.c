@@ -71,7 +71,8 @@
 
 static unsigned int assess_danger(struct ai_type *ait, struct city *pcity,
                                   const struct civ_map *dmap,
-                                  player_unit_list_getter ul_cb);
+                                  player_unit_list_getter ul_cb,
+                                  struct pf_reverse_map **danger_maps);
 
 /**********************************************************************//**
   Choose the best unit the city can build to defend against attacker v.
@@ -406,20 +407,71 @@ static unsigned int assess_danger_unit(const struct city *pcity,
   return danger * 100 / MAX(mod, 1);
 }
 
+/**********************************************************************//**
+  How many turns ahead assess_danger() looks for the player.
+**************************************************************************/
+static int assess_danger_turns(const struct player *pplayer)
+{
+  if (player_is_cpuhog(pplayer)) {
+    return 6;
+  }
+
+#ifdef FREECIV_WEB
+  return has_handicap(pplayer, H_ASSESS_DANGER_LIMITED) ? 2 : 3;
+#else
+  return 3;
+#endif
+}
+
 /**********************************************************************//**
   Call assess_danger() for all cities owned by pplayer.
 
   This is necessary to initialize some ai data before some ai calculations.
+
+  Each dangerous player gets one reverse map for all the cities, so each
+  enemy unit is looked at once for the whole player instead of once per
+  city.
 **************************************************************************/
 void dai_assess_danger_player(struct ai_type *ait, struct player *pplayer,
                               const struct civ_map *dmap)
 {
+  struct pf_reverse_map **danger_maps;
+  struct tile **city_tiles;
+  int num_cities = city_list_size(pplayer->cities);
+  int assess_turns = assess_danger_turns(pplayer);
+  bool omnimap = !has_handicap(pplayer, H_MAP);
+  int i = 0;
+
   /* Do nothing if game is not running */
-  if (S_S_RUNNING == server_state()) {
-    city_list_iterate(pplayer->cities, pcity) {
-      (void) assess_danger(ait, pcity, dmap, NULL);
-    } city_list_iterate_end;
+  if (S_S_RUNNING != server_state() || 0 == num_cities) {
+    return;
   }
+
+  city_tiles = fc_malloc(num_cities * sizeof(*city_tiles));
+  city_list_iterate(pplayer->cities, pcity) {
+    city_tiles[i++] = city_tile(pcity);
+  } city_list_iterate_end;
+
+  danger_maps = fc_calloc(player_slot_count(), sizeof(*danger_maps));
+  players_iterate(aplayer) {
+    if (adv_is_player_dangerous(pplayer, aplayer)) {
+      danger_maps[player_index(aplayer)] =
+        pf_reverse_map_new_for_tiles(aplayer, city_tiles, num_cities,
+                                     assess_turns, omnimap, dmap);
+    }
+  } players_iterate_end;
+
+  city_list_iterate(pplayer->cities, pcity) {
+    (void) assess_danger(ait, pcity, dmap, NULL, danger_maps);
+  } city_list_iterate_end;
+
+  players_iterate(aplayer) {
+    if (NULL != danger_maps[player_index(aplayer)]) {
+      pf_reverse_map_destroy(danger_maps[player_index(aplayer)]);
+    }
+  } players_iterate_end;
+  free(danger_maps);
+  free(city_tiles);
 }
 
 /**********************************************************************//**
@@ -475,10 +527,15 @@ static void dai_reevaluate_building(struct city *pcity, adv_want *value,
   FIXME: Due to the nature of assess_distance, a city will only be
   afraid of a boat laden with enemies if it stands on the coast (i.e.
   is directly reachable by this boat).
+
+  'danger_maps', if not NULL, holds a reverse map covering the city for
+  each dangerous player, indexed by player index. Otherwise the maps
+  are made for this city only.
 **************************************************************************/
 static unsigned int assess_danger(struct ai_type *ait, struct city *pcity,
                                   const struct civ_map *dmap,
-                                  player_unit_list_getter ul_cb)
+                                  player_unit_list_getter ul_cb,
+                                  struct pf_reverse_map **danger_maps)
 {
   struct player *pplayer = city_owner(pcity);
   struct tile *ptile = city_tile(pcity);
@@ -540,15 +597,7 @@ static unsigned int assess_danger(struct ai_type *ait, struct city *pcity,
     }
   } unit_list_iterate_end;
 
-  if (player_is_cpuhog(pplayer)) {
-    assess_turns = 6;
-  } else {
-    assess_turns = 3;
-#ifdef FREECIV_WEB
-    assess_turns = has_handicap(pplayer, H_ASSESS_DANGER_LIMITED) ? 2 : 3;
-#endif
-  }
-
+  assess_turns = assess_danger_turns(pplayer);
   omnimap = !has_handicap(pplayer, H_MAP);
 
   /* Check. */
@@ -562,8 +611,18 @@ static unsigned int assess_danger(struct ai_type *ait, struct city *pcity,
     /* Note that we still consider the units of players we are not (yet)
      * at war with. */
 
-    pcity_map = pf_reverse_map_new_for_city(pcity, aplayer, assess_turns,
-                                            omnimap, dmap);
+    if (NULL != danger_maps) {
+      pcity_map = danger_maps[player_index(aplayer)];
+      if (NULL == pcity_map
+          || !pf_reverse_map_set_target(pcity_map, ptile)) {
+        fc_assert_msg(FALSE, "No danger map for %s against %s.",
+                      city_name_get(pcity), player_name(aplayer));
+        continue;
+      }
+    } else {
+      pcity_map = pf_reverse_map_new_for_city(pcity, aplayer, assess_turns,
+                                              omnimap, dmap);
+    }
 
     if (ul_cb != NULL) {
       units = ul_cb(aplayer);
@@ -648,7 +707,9 @@ static unsigned int assess_danger(struct ai_type *ait, struct city *pcity,
       total_danger += vulnerability;
     } unit_list_iterate_end;
 
-    pf_reverse_map_destroy(pcity_map);
+    if (NULL == danger_maps) {
+      pf_reverse_map_destroy(pcity_map);
+    }
 
   } players_iterate_end;
 
@@ -1439,7 +1500,7 @@ struct adv_choice *military_advisor_choose_build(struct ai_type *ait,
   struct adv_choice *choice = adv_new_choice();
   bool allow_gold_upkeep;
 
-  urgency = assess_danger(ait, pcity, mamap, ul_cb);
+  urgency = assess_danger(ait, pcity, mamap, ul_cb, NULL);
   /* Changing to quadratic to stop AI from building piles 
    * of small units -- Syela */
   /* It has to be AFTER assess_danger thanks to wallvalue. */
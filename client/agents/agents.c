@@ -355,6 +355,8 @@ void agents_free(void)
 
   /*simple_historian_done();*/
 
+  cma_free();
+
   for (;;) {
     struct call *pcall = remove_and_return_a_call();
     if (!pcall) {
@@ -815,6 +817,18 @@ bool agents_busy(void)
     if (agent->first_outstanding_request_id != 0) {
       return TRUE;
     }
+    if (agent->agent.busy != NULL && agent->agent.busy()) {
+      return TRUE;
+    }
   }
   return FALSE;
 }
+
+/************************************************************************//**
+  Returns TRUE iff calls to the agents are currently held back. Agents
+  doing deferred work should wait until this is FALSE again.
+****************************************************************************/
+bool agents_frozen(void)
+{
+  return initialized && frozen_level > 0;
+}
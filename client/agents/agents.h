@@ -45,12 +45,16 @@ struct agent {
   void (*city_callbacks[CB_LAST]) (int);
   void (*unit_callbacks[CB_LAST]) (int);
   void (*tile_callbacks[CB_LAST]) (struct tile *ptile);
+
+  /* Optional. Returns TRUE while the agent has deferred work left. */
+  bool (*busy) (void);
 };
 
 void agents_init(void);
 void agents_free(void);
 void register_agent(const struct agent *agent);
 bool agents_busy(void);
+bool agents_frozen(void);
 
 /* called from client/packhand.c */
 void agents_disconnect(void);
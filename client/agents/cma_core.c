@@ -25,7 +25,7 @@
 #include "fcintl.h"
 #include "log.h"
 #include "mem.h"
-#include "shared.h"             /* for MIN() */
+#include "shared.h"             /* for MIN(), MAX() */
 #include "specialist.h"
 #include "support.h"
 #include "timing.h"
@@ -33,11 +33,14 @@
 /* common */
 #include "city.h"
 #include "dataio.h"
+#include "effects.h"
 #include "events.h"
 #include "game.h"
 #include "government.h"
+#include "improvement.h"
 #include "packets.h"
 #include "specialist.h"
+#include "unitlist.h"
 
 /* client */
 #include "attribute.h"
@@ -49,6 +52,8 @@
 #include "chatline_g.h"
 #include "citydlg_g.h"
 #include "cityrep_g.h"
+#include "gui_main_g.h"
+#include "mapctrl_g.h"
 #include "messagewin_g.h"
 
 /* client/agents */
@@ -60,9 +65,15 @@
 /*
  * The CMA is an agent. The CMA will subscribe itself to all city
  * events. So if a city changes the callback function city_changed is
- * called. handle_city will be called from city_changed to update the
- * given city. handle_city will call cma_query_result and
- * apply_result_on_server to update the server city state.
+ * called. city_changed compares everything the city's arrangement
+ * depends on with the values recorded when the city was last settled,
+ * and queues the city if they differ. The queue is worked off from an
+ * idle callback, a few cities at a time; handle_city will call
+ * cma_query_result and apply_result_on_server to update the server
+ * city state. apply_result_on_server waits for the server, handling
+ * packets meanwhile, so the agents are kept frozen while a batch runs:
+ * the calls those packets cause are made once the batch is done, as
+ * they would be for an agent called from the agents code itself.
  */
 
 /****************************************************************************
@@ -80,12 +91,51 @@
 
 #define SAVED_PARAMETER_SIZE				29
 
+/* Number of queued cities handled per idle callback. */
+#define CITIES_PER_IDLE                                 8
+
+/* The values the arrangement of a city depends on, one after another. */
+struct cma_inputs {
+  int *values;
+  int count, size;
+};
+
+/* What the agent remembers about a city it manages. */
+struct cma_city {
+  struct cma_inputs inputs;     /* Inputs when the city was last settled */
+  bool settled;                 /* The inputs are valid */
+  bool pending;                 /* Queued for the next solve pass */
+};
+
+static void cma_city_destroy(struct cma_city *pcc);
+
+/* struct cma_city_hash. */
+#define SPECHASH_TAG cma_city
+#define SPECHASH_INT_KEY_TYPE
+#define SPECHASH_IDATA_TYPE struct cma_city *
+#define SPECHASH_IDATA_FREE cma_city_destroy
+#include "spechash.h"
+
+/*
+ * Cities waiting to be solved, in the order their changes came in.
+ * Entries [head, count) are still to be done.
+ */
+static struct {
+  struct cma_city_hash *cities;
+  int *queue;
+  int head, count, size;
+  struct cma_inputs scratch;    /* Current inputs of the city looked at */
+  bool scheduled;               /* An idle callback is on its way */
+  bool running;
+} batch;
+
 /*
  * Misc statistic to analyze performance.
  */
 static struct {
   struct timer *wall_timer;
   int apply_result_ignored, apply_result_applied, refresh_forced;
+  int city_unchanged, city_solved;
 } stats;
 
 
@@ -337,6 +387,8 @@ static void report_stats(void)
            per_mill / 10, per_mill % 10, stats.apply_result_ignored,
            (1000 - per_mill) / 10, (1000 - per_mill) % 10,
            stats.apply_result_applied, total);
+  log_test("CMA: cities: unchanged=%d solved=%d",
+           stats.city_unchanged, stats.city_solved);
 #endif /* SHOW_TIME_STATS */
 }
 
@@ -346,6 +398,155 @@ static void report_stats(void)
 static void release_city(int city_id)
 {
   attr_city_set(ATTR_CITY_CMA_PARAMETER, city_id, 0, NULL);
+  if (batch.cities != NULL) {
+    cma_city_hash_remove(batch.cities, city_id);
+  }
+}
+
+/************************************************************************//**
+  Free the data kept about a city.
+****************************************************************************/
+static void cma_city_destroy(struct cma_city *pcc)
+{
+  free(pcc->inputs.values);
+  free(pcc);
+}
+
+/************************************************************************//**
+  Append one value to the inputs.
+****************************************************************************/
+static inline void inputs_add(struct cma_inputs *pinputs, int value)
+{
+  if (pinputs->count == pinputs->size) {
+    pinputs->size = MAX(64, 2 * pinputs->size);
+    pinputs->values = fc_realloc(pinputs->values,
+                                 pinputs->size * sizeof(*pinputs->values));
+  }
+  pinputs->values[pinputs->count++] = value;
+}
+
+/************************************************************************//**
+  Fill 'pinputs' with the inputs the arrangement of the city depends on:
+  the parameter, the tiles the city could work with what they would
+  yield, the current arrangement and what the server reported for it,
+  the player wide settings that change city output, and the effects the
+  solver reads for arrangements other than the current one: specialist
+  outputs, output bonuses and the content and happy effects. An effect
+  change that alters none of these is not noticed.
+****************************************************************************/
+static void city_inputs(const struct city *pcity,
+                        const struct cm_parameter *parameter,
+                        struct cma_inputs *pinputs)
+{
+  const struct player *pplayer = city_owner(pcity);
+  int radius_sq = city_map_radius_sq_get(pcity);
+  int i;
+
+  pinputs->count = 0;
+
+  output_type_iterate(o) {
+    inputs_add(pinputs, parameter->minimal_surplus[o]);
+    inputs_add(pinputs, parameter->factor[o]);
+  } output_type_iterate_end;
+  inputs_add(pinputs, parameter->happy_factor);
+  inputs_add(pinputs, parameter->require_happy);
+  inputs_add(pinputs, parameter->allow_disorder);
+  inputs_add(pinputs, parameter->allow_specialists);
+
+  inputs_add(pinputs, government_number(government_of_player(pplayer)));
+  inputs_add(pinputs, pplayer->economic.tax);
+  inputs_add(pinputs, pplayer->economic.luxury);
+  inputs_add(pinputs, pplayer->economic.science);
+
+  inputs_add(pinputs, city_size_get(pcity));
+  inputs_add(pinputs, radius_sq);
+  inputs_add(pinputs, unit_list_size(pcity->units_supported));
+  inputs_add(pinputs, unit_list_size(city_tile(pcity)->units));
+
+  city_built_iterate(pcity, pimprove) {
+    inputs_add(pinputs, improvement_number(pimprove));
+  } city_built_iterate_end;
+  /* End of the list of buildings. */
+  inputs_add(pinputs, -1);
+
+  specialist_type_iterate(sp) {
+    inputs_add(pinputs, pcity->specialists[sp]);
+    output_type_iterate(o) {
+      inputs_add(pinputs, get_specialist_output(pcity, sp, o));
+    } output_type_iterate_end;
+  } specialist_type_iterate_end;
+
+  output_type_iterate(o) {
+    inputs_add(pinputs, get_city_output_bonus(pcity, get_output_type(o),
+                                              EFT_OUTPUT_BONUS));
+    inputs_add(pinputs, get_city_output_bonus(pcity, get_output_type(o),
+                                              EFT_OUTPUT_BONUS_2));
+  } output_type_iterate_end;
+  inputs_add(pinputs, get_city_bonus(pcity, EFT_MAKE_CONTENT));
+  inputs_add(pinputs, get_city_bonus(pcity, EFT_FORCE_CONTENT));
+  inputs_add(pinputs, get_city_bonus(pcity, EFT_MAKE_HAPPY));
+  inputs_add(pinputs, get_city_bonus(pcity, EFT_NO_UNHAPPY));
+
+  for (i = 0; i < CITIZEN_LAST; i++) {
+    inputs_add(pinputs, pcity->feel[i][FEELING_FINAL]);
+  }
+
+  output_type_iterate(o) {
+    inputs_add(pinputs, pcity->surplus[o]);
+    inputs_add(pinputs, pcity->prod[o]);
+    inputs_add(pinputs, pcity->waste[o]);
+    inputs_add(pinputs, pcity->usage[o]);
+  } output_type_iterate_end;
+
+  city_tile_iterate_index(radius_sq, city_tile(pcity), ptile, cindex) {
+    const struct city *worked = tile_worked(ptile);
+
+    inputs_add(pinputs, cindex);
+    inputs_add(pinputs, worked == NULL ? 0 : (worked == pcity ? 1 : 2));
+    inputs_add(pinputs, city_can_work_tile(pcity, ptile));
+    output_type_iterate(o) {
+      inputs_add(pinputs, city_tile_output_now(pcity, ptile, o));
+    } output_type_iterate_end;
+  } city_tile_iterate_index_end;
+}
+
+/************************************************************************//**
+  Returns TRUE iff the city was settled and none of its inputs changed
+  since.
+****************************************************************************/
+static bool city_unchanged(const struct cma_city *pcc,
+                           const struct city *pcity,
+                           const struct cm_parameter *parameter)
+{
+  if (!pcc->settled) {
+    return FALSE;
+  }
+
+  city_inputs(pcity, parameter, &batch.scratch);
+
+  return (batch.scratch.count == pcc->inputs.count
+          && 0 == memcmp(batch.scratch.values, pcc->inputs.values,
+                         pcc->inputs.count * sizeof(*pcc->inputs.values)));
+}
+
+/************************************************************************//**
+  Record the current inputs of the city as the ones it is settled with.
+****************************************************************************/
+static void city_settle(struct cma_city *pcc, const struct city *pcity,
+                        const struct cm_parameter *parameter)
+{
+  city_inputs(pcity, parameter, &batch.scratch);
+
+  if (pcc->inputs.size < batch.scratch.count) {
+    pcc->inputs.size = batch.scratch.count;
+    pcc->inputs.values = fc_realloc(pcc->inputs.values,
+                                    pcc->inputs.size
+                                    * sizeof(*pcc->inputs.values));
+  }
+  memcpy(pcc->inputs.values, batch.scratch.values,
+         batch.scratch.count * sizeof(*pcc->inputs.values));
+  pcc->inputs.count = batch.scratch.count;
+  pcc->settled = TRUE;
 }
 
 /****************************************************************************
@@ -430,17 +631,148 @@ static void handle_city(struct city *pcity)
   log_handle_city2("END handle city=(%d)", city_id);
 }
 
+static void batch_process(void *data);
+
 /************************************************************************//**
-  Callback for the agent interface.
+  Make sure the queued cities get handled when the client is idle.
 ****************************************************************************/
-static void city_changed(int city_id)
+static void batch_schedule(void)
 {
-  struct city *pcity = game_city_by_number(city_id);
+  if (!batch.scheduled && batch.head < batch.count) {
+    batch.scheduled = TRUE;
+    add_idle_callback(batch_process, NULL);
+  }
+}
+
+/************************************************************************//**
+  Handle the next few queued cities. Runs as idle callback, and asks to
+  be called again while there are cities left.
+****************************************************************************/
+static void batch_process(void *data)
+{
+  int done = 0;
+
+  batch.scheduled = FALSE;
+  if (batch.running || batch.cities == NULL) {
+    return;
+  }
+
+  if (C_S_RUNNING != client_state()) {
+    /* The next city_changed() picks the queue up again. */
+    return;
+  }
+
+  if (agents_frozen()) {
+    /* Packets are still coming in; the agents are called again once
+     * they are through. Queue the first waiting city as an ordinary
+     * agent call so that city_changed() restarts the pass then. */
+    while (batch.head < batch.count) {
+      struct city *pcity = game_city_by_number(batch.queue[batch.head]);
+
+      if (pcity != NULL) {
+        cause_a_city_changed_for_agent("CMA", pcity);
+        break;
+      }
+      batch.head++;
+    }
+    return;
+  }
+
+  /* handle_city() handles packets while it waits for the server. Hold
+   * the agent calls they cause, this one's included, until the batch is
+   * done instead of running them from inside it. */
+  agents_freeze_hint();
+  batch.running = TRUE;
+  while (batch.head < batch.count && done < CITIES_PER_IDLE) {
+    int city_id = batch.queue[batch.head++];
+    struct cm_parameter parameter;
+    struct cma_city *pcc;
+    struct city *pcity;
+
+    if (!cma_city_hash_lookup(batch.cities, city_id, &pcc)
+        || !pcc->pending) {
+      continue;
+    }
+    pcc->pending = FALSE;
+
+    pcity = check_city(city_id, &parameter);
+    if (pcity == NULL) {
+      continue;
+    }
+    if (city_unchanged(pcc, pcity, &parameter)) {
+      /* Changed back to how it was before it got its turn. */
+      stats.city_unchanged++;
+      continue;
+    }
 
-  if (pcity) {
     cm_clear_cache(pcity);
     handle_city(pcity);
+    stats.city_solved++;
+    done++;
+
+    /* handle_city() may have let go of the city. Otherwise remember the
+     * state it has been left in, as the server confirmed it. */
+    if (pcity == check_city(city_id, &parameter)
+        && cma_city_hash_lookup(batch.cities, city_id, &pcc)) {
+      city_settle(pcc, pcity, &parameter);
+    }
   }
+  batch.running = FALSE;
+  agents_thaw_hint();
+
+  if (batch.head < batch.count) {
+    batch_schedule();
+  } else {
+    batch.head = batch.count = 0;
+    /* agents_busy() may have changed */
+    update_turn_done_button_state();
+  }
+}
+
+/************************************************************************//**
+  Returns TRUE while there are queued cities. Callback for the agent
+  interface.
+****************************************************************************/
+static bool batch_busy(void)
+{
+  return batch.head < batch.count || batch.running;
+}
+
+/************************************************************************//**
+  Callback for the agent interface. Queues the city unless nothing it
+  depends on changed since it was last settled.
+****************************************************************************/
+static void city_changed(int city_id)
+{
+  struct cm_parameter parameter;
+  struct city *pcity = check_city(city_id, &parameter);
+  struct cma_city *pcc;
+
+  if (pcity == NULL || batch.cities == NULL) {
+    return;
+  }
+
+  if (!cma_city_hash_lookup(batch.cities, city_id, &pcc)) {
+    pcc = fc_calloc(1, sizeof(*pcc));
+    cma_city_hash_insert(batch.cities, city_id, pcc);
+  }
+
+  if (!pcc->pending) {
+    if (city_unchanged(pcc, pcity, &parameter)) {
+      stats.city_unchanged++;
+      return;
+    }
+
+    if (batch.count == batch.size) {
+      batch.size = MAX(16, 2 * batch.size);
+      batch.queue = fc_realloc(batch.queue,
+                               batch.size * sizeof(*batch.queue));
+    }
+    batch.queue[batch.count++] = city_id;
+    pcc->pending = TRUE;
+  }
+
+  batch_schedule();
 }
 
 /************************************************************************//**
@@ -481,6 +813,9 @@ void cma_init(void)
    * leaks. */
   stats.wall_timer = timer_renew(timer, TIMER_USER, TIMER_ACTIVE);
 
+  cma_free();
+  batch.cities = cma_city_hash_new();
+
   memset(&self, 0, sizeof(self));
   strcpy(self.name, "CMA");
   self.level = 1;
@@ -488,9 +823,27 @@ void cma_init(void)
   self.city_callbacks[CB_NEW] = city_changed;
   self.city_callbacks[CB_REMOVE] = city_remove;
   self.turn_start_notify = new_turn;
+  self.busy = batch_busy;
   register_agent(&self);
 }
 
+/************************************************************************//**
+  Free the data kept about the cities under governor control.
+****************************************************************************/
+void cma_free(void)
+{
+  if (batch.cities != NULL) {
+    cma_city_hash_destroy(batch.cities);
+    batch.cities = NULL;
+  }
+  free(batch.queue);
+  batch.queue = NULL;
+  batch.head = batch.count = batch.size = 0;
+  free(batch.scratch.values);
+  batch.scratch.values = NULL;
+  batch.scratch.count = batch.scratch.size = 0;
+}
+
 /************************************************************************//**
   Apply result on server if it's valid
 ****************************************************************************/
@@ -40,6 +40,7 @@ extern "C" {
  * Called once per client start.
  */
 void cma_init(void);
+void cma_free(void);
 
 /* Change the actual city setting. */
 bool cma_apply_result(struct city *pcity, const struct cm_result *result);
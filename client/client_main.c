@@ -44,6 +44,9 @@
 #include "support.h"
 #include "timing.h"
 
+/* common/aicore */
+#include "pf_clusters.h"
+
 /* common */
 #include "ai.h"
 #include "diptreaty.h"
@@ -342,6 +345,10 @@ int client_main(int argc, char *argv[])
 
   i_am_client(); /* Tell to libfreeciv that we are client */
 
+  game.callbacks.tile_changed = pf_clusters_tile_changed;
+  game.callbacks.unit_changed = pf_clusters_unit_changed;
+  game.callbacks.map_freed = pf_clusters_free;
+
   fc_interface_init_client();
 
   game.client.ruleset_init = FALSE;
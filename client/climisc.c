@@ -44,6 +44,9 @@
 #include "spaceship.h"
 #include "unitlist.h"
 
+/* common/aicore */
+#include "pf_clusters.h"
+
 /* client/include */
 #include "chatline_g.h"
 #include "citydlg_g.h"
@@ -139,6 +142,10 @@ void client_remove_city(struct city *pcity)
 
   log_debug("client_remove_city() %d, %s", pcity->id, city_name_get(pcity));
 
+  if (NULL != ptile) {
+    pf_clusters_tile_changed(ptile);
+  }
+
   /* Explicitly remove all improvements, to properly remove any global effects
      and to handle the preservation of "destroyed" effects. */
   effect_update = FALSE;
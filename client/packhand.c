@@ -32,6 +32,7 @@
 #include "actions.h"
 #include "capstr.h"
 #include "citizens.h"
+#include "effects.h"
 #include "events.h"
 #include "extras.h"
 #include "game.h"
@@ -55,6 +56,9 @@
 #include "unitlist.h"
 #include "worklist.h"
 
+/* common/aicore */
+#include "pf_clusters.h"
+
 /* client/include */
 #include "chatline_g.h"
 #include "citydlg_g.h"
@@ -914,6 +918,11 @@ static void city_packet_common(struct city *pcity, struct tile *pcenter,
                                struct tile_list *worked_tiles,
                                bool is_new, bool popup, bool investigate)
 {
+  if (is_new) {
+    /* The city may have been known as an invisible one until now. */
+    pf_clusters_tile_changed(pcenter);
+  }
+
   if (NULL != worked_tiles) {
     /* We need to transfer the worked infos because the server will assume
      * those infos are kept in our side and won't send to us again. */
@@ -1704,6 +1713,7 @@ static bool handle_unit_packet_common(struct unit *packet_unit)
       struct city *ccity = tile_city(unit_tile(punit));
 
       punit->utype = unit_type_get(packet_unit);
+      pf_clusters_unit_changed(punit);
       repaint_unit = TRUE;
       repaint_city = TRUE;
       if (ccity != NULL && (ccity->id != punit->homecity)) {
@@ -2900,6 +2910,7 @@ void handle_tile_info(const struct packet_tile_info *packet)
 
   if (!BV_ARE_EQUAL(ptile->extras, packet->extras)) {
     ptile->extras = packet->extras;
+    pf_clusters_tile_changed(ptile);
     tile_changed = TRUE;
   }
 
@@ -3281,6 +3292,9 @@ void handle_rulesets_ready(void)
   /* Setup road integrators caches */
   road_integrators_cache_init();
 
+  /* Compile the requirements of the effects received */
+  ruleset_cache_compile();
+
   /* Pre calculate action related data. */
   actions_rs_pre_san_gen();
 
@@ -719,6 +719,8 @@ void actions_free(void)
 
   action_iterate(act) {
     action_enabler_list_iterate(action_enablers_by_action[act], enabler) {
+      req_program_destroy(enabler->actor_prog);
+      req_program_destroy(enabler->target_prog);
       requirement_vector_free(&enabler->actor_reqs);
       requirement_vector_free(&enabler->target_reqs);
       free(enabler);
@@ -1330,6 +1332,8 @@ struct action_enabler *action_enabler_new(void)
   enabler->disabled = FALSE;
   requirement_vector_init(&enabler->actor_reqs);
   requirement_vector_init(&enabler->target_reqs);
+  enabler->actor_prog = NULL;
+  enabler->target_prog = NULL;
 
   /* Make sure that action doesn't end up as a random value that happens to
    * be a valid action id. */
@@ -1367,6 +1371,8 @@ void action_enabler_add(struct action_enabler *enabler)
   action_enabler_list_append(
         action_enablers_for_action(enabler->action),
         enabler);
+
+  action_enabler_reqs_changed(enabler);
 }
 
 /**********************************************************************//**
@@ -1386,6 +1392,19 @@ bool action_enabler_remove(struct action_enabler *enabler)
         enabler);
 }
 
+/**********************************************************************//**
+  Compile the requirements of the action enabler again. Must be called
+  when the requirements of an enabler that already has been added to the
+  ruleset change.
+**************************************************************************/
+void action_enabler_reqs_changed(struct action_enabler *enabler)
+{
+  req_program_destroy(enabler->actor_prog);
+  req_program_destroy(enabler->target_prog);
+  enabler->actor_prog = req_program_new(&enabler->actor_reqs);
+  enabler->target_prog = req_program_new(&enabler->target_reqs);
+}
+
 /**********************************************************************//**
   Get all enablers for an action in the current ruleset.
 **************************************************************************/
@@ -1490,6 +1509,11 @@ void action_enabler_obligatory_reqs_add(struct action_enabler *enabler)
   /* Sanity check: obligatory requirement insertion should have fixed the
    * action enabler. */
   fc_assert(action_enabler_obligatory_reqs_missing(enabler) == NULL);
+
+  if (enabler->actor_prog != NULL) {
+    /* Already added to the ruleset. */
+    action_enabler_reqs_changed(enabler);
+  }
 }
 
 /**********************************************************************//**
@@ -2759,16 +2783,32 @@ static bool is_enabler_active(const struct action_enabler *enabler,
 			      const struct output_type *target_output,
 			      const struct specialist *target_specialist)
 {
-  return are_reqs_active(actor_player, target_player, actor_city,
-                         actor_building, actor_tile,
-                         actor_unit, actor_unittype,
-                         actor_output, actor_specialist, NULL,
-                         &enabler->actor_reqs, RPT_CERTAIN)
-      && are_reqs_active(target_player, actor_player, target_city,
-                         target_building, target_tile,
-                         target_unit, target_unittype,
-                         target_output, target_specialist, NULL,
-                         &enabler->target_reqs, RPT_CERTAIN);
+  if (enabler->actor_prog == NULL) {
+    /* Not added to the ruleset. */
+    return are_reqs_active(actor_player, target_player, actor_city,
+                           actor_building, actor_tile,
+                           actor_unit, actor_unittype,
+                           actor_output, actor_specialist, NULL,
+                           &enabler->actor_reqs, RPT_CERTAIN)
+        && are_reqs_active(target_player, actor_player, target_city,
+                           target_building, target_tile,
+                           target_unit, target_unittype,
+                           target_output, target_specialist, NULL,
+                           &enabler->target_reqs, RPT_CERTAIN);
+  }
+
+  return req_program_active(enabler->actor_prog, actor_player,
+                            target_player, actor_city,
+                            actor_building, actor_tile,
+                            actor_unit, actor_unittype,
+                            actor_output, actor_specialist, NULL,
+                            RPT_CERTAIN)
+      && req_program_active(enabler->target_prog, target_player,
+                            actor_player, target_city,
+                            target_building, target_tile,
+                            target_unit, target_unittype,
+                            target_output, target_specialist, NULL,
+                            RPT_CERTAIN);
 }
 
 /**********************************************************************//**
@@ -290,6 +290,11 @@ struct action_enabler
   action_id action;
   struct requirement_vector actor_reqs;
   struct requirement_vector target_reqs;
+
+  /* The requirements compiled when the enabler is added to the ruleset.
+   * See action_enabler_reqs_changed(). */
+  struct req_program *actor_prog;
+  struct req_program *target_prog;
 };
 
 #define enabler_get_action(_enabler_) action_by_number(_enabler_->action)
@@ -507,6 +512,7 @@ struct action_enabler *
 action_enabler_copy(const struct action_enabler *original);
 void action_enabler_add(struct action_enabler *enabler);
 bool action_enabler_remove(struct action_enabler *enabler);
+void action_enabler_reqs_changed(struct action_enabler *enabler);
 
 const char *
 action_enabler_obligatory_reqs_missing(struct action_enabler *enabler);
@@ -315,7 +315,9 @@ void cm_init_citymap(void)
 ****************************************************************************/
 void cm_clear_cache(struct city *pcity)
 {
-  /* The B&B algorithm doesn't have city caches so there's nothing to do. */
+  /* Forget the last arrangement; the next query starts from scratch. */
+  cm_result_destroy(pcity->cm_last);
+  pcity->cm_last = NULL;
 }
 
 /************************************************************************//**
@@ -1945,6 +1947,163 @@ static void cm_state_free(struct cm_state *state)
 }
 
 
+/************************************************************************//**
+  Return the lattice index of the specialist type with the output of the
+  given specialist, or -1 if the city cannot use it.
+****************************************************************************/
+static int specialist_type_index(const struct cm_state *state,
+                                 Specialist_type_id spec)
+{
+  int i;
+
+  if (!city_can_use_specialist(state->pcity, spec)) {
+    return -1;
+  }
+
+  /* Specialists with the same output share a single type. */
+  for (i = 0; i < num_types(state); i++) {
+    const struct cm_tile_type *ptype = tile_type_get(state, i);
+    bool same = ptype->is_specialist;
+
+    output_type_iterate(stat_index) {
+      if (!same) {
+        break;
+      }
+      same = (ptype->production[stat_index]
+              == get_specialist_output(state->pcity, spec, stat_index));
+    } output_type_iterate_end;
+
+    if (same) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/************************************************************************//**
+  Fill the empty solution 'soln' with the last arrangement found for the
+  city, as far as it still fits the lattice.  Tiles that cannot be worked
+  any more are dropped; citizens left without a place become default
+  specialists, and if the city shrank the specialists and the last tiles
+  of the city map are left out.  Returns FALSE if this is not possible.
+****************************************************************************/
+static bool init_last_solution(struct cm_state *state,
+                               const struct cm_result *last,
+                               struct partial_solution *soln)
+{
+  int city_radius_sq = city_map_radius_sq_get(state->pcity);
+  int *tile_types;
+  int i;
+
+  if (last->city_radius_sq != city_radius_sq) {
+    return FALSE;
+  }
+
+  /* Find the type of each tile that can still be worked. */
+  tile_types = fc_malloc(city_map_tiles(city_radius_sq)
+                         * sizeof(*tile_types));
+  for (i = 0; i < city_map_tiles(city_radius_sq); i++) {
+    tile_types[i] = -1;
+  }
+  for (i = 0; i < num_types(state); i++) {
+    const struct cm_tile_type *ptype = tile_type_get(state, i);
+    int j;
+
+    if (ptype->is_specialist) {
+      continue;
+    }
+    for (j = 0; j < tile_type_num_tiles(ptype); j++) {
+      tile_types[tile_get(ptype, j)->index] = i;
+    }
+  }
+
+  /* Within a type all tiles are alike, so apply_solution() may place the
+   * workers on other tiles of the same type; the result is the same. */
+  city_map_iterate(city_radius_sq, cindex, x, y) {
+    if (soln->idle > 0 && last->worker_positions[cindex]
+        && !is_free_worked_index(cindex) && tile_types[cindex] >= 0) {
+      add_worker(soln, tile_types[cindex], state);
+    }
+  } city_map_iterate_end;
+  free(tile_types);
+
+  specialist_type_iterate(spec) {
+    int count = MIN(last->specialists[spec], soln->idle);
+    int itype = specialist_type_index(state, spec);
+
+    if (count > 0 && itype >= 0) {
+      add_workers(soln, itype, count, state);
+    }
+  } specialist_type_iterate_end;
+
+  if (soln->idle > 0) {
+    int itype = specialist_type_index(state, DEFAULT_SPECIALIST);
+
+    if (itype < 0) {
+      return FALSE;
+    }
+    add_workers(soln, itype, soln->idle, state);
+  }
+
+  return TRUE;
+}
+
+/************************************************************************//**
+  Use the last arrangement found for the city as the best known solution,
+  if it still meets the constraints.  After a small change to the city it
+  is often still the best one, or close to it, and the heuristic can then
+  prune most of the tree right away.
+****************************************************************************/
+static void begin_search_from_last(struct cm_state *state, bool negative_ok)
+{
+  struct partial_solution last;
+
+  if (state->pcity->cm_last == NULL) {
+    return;
+  }
+
+  init_partial_solution(&last, num_types(state),
+                        city_size_get(state->pcity), negative_ok);
+  if (init_last_solution(state, state->pcity->cm_last, &last)) {
+    struct cm_fitness value = evaluate_solution(state, &last);
+
+    if (value.sufficient) {
+      print_partial_solution(LOG_BETTER_LEAF, &last, state);
+      copy_partial_solution(&state->best, &last, state);
+      state->best_value = value;
+    }
+  }
+  destroy_partial_solution(&last);
+}
+
+/************************************************************************//**
+  Remember the arrangement of the result for the next query on the city.
+****************************************************************************/
+static void remember_result(struct city *pcity,
+                            const struct cm_result *result)
+{
+  if (!result->found_a_valid
+      || result->city_radius_sq != city_map_radius_sq_get(pcity)) {
+    cm_clear_cache(pcity);
+    return;
+  }
+
+  if (pcity->cm_last != NULL
+      && pcity->cm_last->city_radius_sq != result->city_radius_sq) {
+    cm_clear_cache(pcity);
+  }
+  if (pcity->cm_last == NULL) {
+    pcity->cm_last = cm_result_new(pcity);
+  }
+
+  memcpy(pcity->cm_last->worker_positions, result->worker_positions,
+         sizeof(*result->worker_positions)
+         * city_map_tiles(result->city_radius_sq));
+  memcpy(pcity->cm_last->specialists, result->specialists,
+         sizeof(result->specialists));
+}
+
 /************************************************************************//**
   Run B&B until we find the best solution.
 ****************************************************************************/
@@ -1971,6 +2130,8 @@ static void cm_find_best_solution(struct cm_state *state,
     max_count = CM_MAX_LOOP;
   }
 
+  begin_search_from_last(state, negative_ok);
+
   result->aborted = FALSE;
 
   /* search until we find a feasible solution */
@@ -1989,8 +2150,13 @@ static void cm_find_best_solution(struct cm_state *state,
   /* convert to the caller's format */
   convert_solution_to_result(state, &state->best, result);
 
+  /* The effect cache may have been allocated during the search. What it
+   * holds does not depend on what the search changed, so keep it. */
+  backup.effect_cache = state->pcity->effect_cache;
   memcpy(state->pcity, &backup, sizeof(backup));
 
+  remember_result(state->pcity, result);
+
   end_search(state);
 }
 
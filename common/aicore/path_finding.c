@@ -15,6 +15,8 @@
 #include <fc_config.h>
 #endif
 
+#include <string.h>
+
 /* utility */
 #include "bitvector.h"
 #include "log.h"
@@ -27,6 +29,7 @@
 #include "movement.h"
 
 /* common/aicore */
+#include "pf_clusters.h"
 #include "pf_tools.h"
 
 #include "path_finding.h"
@@ -197,6 +200,94 @@ static void pf_position_fill_start_tile(struct pf_position *pos,
                                         const struct pf_parameter *param);
 
 
+/* ========================== Memory recycling =========================== */
+
+/* Destroyed maps give their lattice and queues back here, and new maps
+ * take them instead of allocating new ones. A lattice has a node for
+ * every tile of the map, so this saves a lot of allocation and page fault
+ * work when the AI makes hundreds of maps in a turn. Path-finding is only
+ * done by the main thread, so no locking is needed. */
+#define PF_SPARE_LATTICES 4
+#define PF_SPARE_QUEUES 8
+
+struct pf_spare_lattice {
+  void *mem;
+  size_t size;
+};
+
+static struct pf_spare_lattice pf_spare_lattices[PF_SPARE_LATTICES];
+static int pf_spare_lattice_count = 0;
+static struct map_index_pq *pf_spare_queues[PF_SPARE_QUEUES];
+static int pf_spare_queue_count = 0;
+
+/************************************************************************//**
+  Returns a lattice of MAP_INDEX_SIZE nodes of the given size, with all
+  bytes cleared.
+****************************************************************************/
+static void *pf_lattice_new(size_t node_size)
+{
+  size_t size = MAP_INDEX_SIZE * node_size;
+  int i;
+
+  for (i = pf_spare_lattice_count - 1; i >= 0; i--) {
+    if (pf_spare_lattices[i].size == size) {
+      void *mem = pf_spare_lattices[i].mem;
+
+      pf_spare_lattice_count--;
+      pf_spare_lattices[i] = pf_spare_lattices[pf_spare_lattice_count];
+      memset(mem, 0, size);
+      return mem;
+    }
+  }
+
+  return fc_calloc(MAP_INDEX_SIZE, node_size);
+}
+
+/************************************************************************//**
+  Gives back a lattice made by pf_lattice_new() with the same node size.
+  Its nodes must not own any memory anymore.
+****************************************************************************/
+static void pf_lattice_destroy(void *mem, size_t node_size)
+{
+  if (PF_SPARE_LATTICES == pf_spare_lattice_count) {
+    /* Drop the oldest one. After a change of the map size, the old ones
+     * would never be used again. */
+    free(pf_spare_lattices[0].mem);
+    memmove(pf_spare_lattices, pf_spare_lattices + 1,
+            (PF_SPARE_LATTICES - 1) * sizeof(*pf_spare_lattices));
+    pf_spare_lattice_count--;
+  }
+  pf_spare_lattices[pf_spare_lattice_count].mem = mem;
+  pf_spare_lattices[pf_spare_lattice_count].size = MAP_INDEX_SIZE * node_size;
+  pf_spare_lattice_count++;
+}
+
+/************************************************************************//**
+  Returns an empty queue.
+****************************************************************************/
+static struct map_index_pq *pf_queue_new(void)
+{
+  if (0 < pf_spare_queue_count) {
+    return pf_spare_queues[--pf_spare_queue_count];
+  }
+
+  return map_index_pq_new(INITIAL_QUEUE_SIZE);
+}
+
+/************************************************************************//**
+  Gives back a queue made by pf_queue_new().
+****************************************************************************/
+static void pf_queue_destroy(struct map_index_pq *queue)
+{
+  if (PF_SPARE_QUEUES == pf_spare_queue_count) {
+    map_index_pq_destroy(queue);
+  } else {
+    map_index_pq_clear(queue);
+    pf_spare_queues[pf_spare_queue_count++] = queue;
+  }
+}
+
+
 /* ================ Specific pf_normal_* mode structures ================= */
 
 /* Normal path-finding maps are used for most of units with standard rules.
@@ -768,6 +859,13 @@ static inline bool pf_normal_map_iterate_until(struct pf_normal_map *pfnm,
     }
   } /* Else, this is a jumbo map, not dealing with normal nodes. */
 
+  if (NS_PROCESSED != node->status && NULL != pfm->tile
+      && !pf_clusters_may_reach(pf_map_parameter(pfm), ptile)) {
+    /* Sure to be out of reach, don't iterate the whole map to find it
+     * out. */
+    return FALSE;
+  }
+
   while (NS_PROCESSED != node->status) {
     if (!pf_map_iterate(pfm)) {
       /* All reachable destination have been iterated, 'ptile' is
@@ -845,8 +943,8 @@ static void pf_normal_map_destroy(struct pf_map *pfm)
 {
   struct pf_normal_map *pfnm = PF_NORMAL_MAP(pfm);
 
-  free(pfnm->lattice);
-  map_index_pq_destroy(pfnm->queue);
+  pf_lattice_destroy(pfnm->lattice, sizeof(*pfnm->lattice));
+  pf_queue_destroy(pfnm->queue);
   free(pfnm);
 }
 
@@ -869,8 +967,8 @@ static struct pf_map *pf_normal_map_new(const struct pf_parameter *parameter)
 #endif /* PF_DEBUG */
 
   /* Allocate the map. */
-  pfnm->lattice = fc_calloc(MAP_INDEX_SIZE, sizeof(struct pf_normal_node));
-  pfnm->queue = map_index_pq_new(INITIAL_QUEUE_SIZE);
+  pfnm->lattice = pf_lattice_new(sizeof(struct pf_normal_node));
+  pfnm->queue = pf_queue_new();
 
   if (NULL == parameter->get_costs) {
     /* 'get_MC' callback must be set. */
@@ -1766,6 +1864,14 @@ static inline bool pf_danger_map_iterate_until(struct pf_danger_map *pfdm,
     return FALSE;
   }
 
+  if (NS_PROCESSED != node->status
+      && NS_WAITING != node->status && NULL != pfm->tile
+      && !pf_clusters_may_reach(pf_map_parameter(pfm), ptile)) {
+    /* Sure to be out of reach, don't iterate the whole map to find it
+     * out. */
+    return FALSE;
+  }
+
   while (NS_PROCESSED != node->status && NS_WAITING != node->status) {
     if (!pf_map_iterate(pfm)) {
       /* All reachable destination have been iterated, 'ptile' is
@@ -1851,9 +1957,9 @@ static void pf_danger_map_destroy(struct pf_map *pfm)
       free(node->danger_segment);
     }
   }
-  free(pfdm->lattice);
-  map_index_pq_destroy(pfdm->queue);
-  map_index_pq_destroy(pfdm->danger_queue);
+  pf_lattice_destroy(pfdm->lattice, sizeof(*pfdm->lattice));
+  pf_queue_destroy(pfdm->queue);
+  pf_queue_destroy(pfdm->danger_queue);
   free(pfdm);
 }
 
@@ -1876,9 +1982,9 @@ static struct pf_map *pf_danger_map_new(const struct pf_parameter *parameter)
 #endif /* PF_DEBUG */
 
   /* Allocate the map. */
-  pfdm->lattice = fc_calloc(MAP_INDEX_SIZE, sizeof(struct pf_danger_node));
-  pfdm->queue = map_index_pq_new(INITIAL_QUEUE_SIZE);
-  pfdm->danger_queue = map_index_pq_new(INITIAL_QUEUE_SIZE);
+  pfdm->lattice = pf_lattice_new(sizeof(struct pf_danger_node));
+  pfdm->queue = pf_queue_new();
+  pfdm->danger_queue = pf_queue_new();
 
   /* 'get_MC' callback must be set. */
   fc_assert_ret_val(parameter->get_MC != NULL, NULL);
@@ -1984,6 +2090,18 @@ struct pf_fuel_pos {
   struct pf_fuel_pos *prev;
 };
 
+/* Positions are cut out of chunks, which are only freed by
+ * pf_free_spare_memory(). Unused positions are linked through 'prev'. */
+#define PF_FUEL_POS_CHUNK_SIZE 256
+
+struct pf_fuel_pos_chunk {
+  struct pf_fuel_pos_chunk *next;
+  struct pf_fuel_pos pos[PF_FUEL_POS_CHUNK_SIZE];
+};
+
+static struct pf_fuel_pos_chunk *pf_fuel_pos_chunks = NULL;
+static struct pf_fuel_pos *pf_fuel_pos_unused = NULL;
+
 /* Derived structure of struct pf_map. */
 struct pf_fuel_map {
   struct pf_map base_map;       /* Base structure, must be the first! */
@@ -2216,6 +2334,41 @@ static inline bool pf_fuel_node_dangerous(const struct pf_fuel_node *node)
               && PF_ACTION_NONE == node->action));
 }
 
+/************************************************************************//**
+  Returns an unused position. Its fields are not initialized.
+****************************************************************************/
+static inline struct pf_fuel_pos *pf_fuel_pos_alloc(void)
+{
+  struct pf_fuel_pos *pos;
+
+  if (NULL == pf_fuel_pos_unused) {
+    struct pf_fuel_pos_chunk *chunk = fc_malloc(sizeof(*chunk));
+    int i;
+
+    for (i = 0; i < PF_FUEL_POS_CHUNK_SIZE - 1; i++) {
+      chunk->pos[i].prev = &chunk->pos[i + 1];
+    }
+    chunk->pos[PF_FUEL_POS_CHUNK_SIZE - 1].prev = NULL;
+    chunk->next = pf_fuel_pos_chunks;
+    pf_fuel_pos_chunks = chunk;
+    pf_fuel_pos_unused = chunk->pos;
+  }
+
+  pos = pf_fuel_pos_unused;
+  pf_fuel_pos_unused = pos->prev;
+
+  return pos;
+}
+
+/************************************************************************//**
+  Puts back a position made by pf_fuel_pos_alloc().
+****************************************************************************/
+static inline void pf_fuel_pos_free(struct pf_fuel_pos *pos)
+{
+  pos->prev = pf_fuel_pos_unused;
+  pf_fuel_pos_unused = pos;
+}
+
 /************************************************************************//**
   Forget how we went to position. Maybe destroy the position, and previous
   ones.
@@ -2240,7 +2393,7 @@ static inline void pf_fuel_pos_unref(struct pf_fuel_pos *pos)
   while (NULL != pos && 0 == --pos->ref_count) {
     struct pf_fuel_pos *prev = pos->prev;
 
-    free(pos);
+    pf_fuel_pos_free(pos);
     pos = prev;
   }
 }
@@ -2253,11 +2406,11 @@ static inline struct pf_fuel_pos *
 pf_fuel_pos_replace(struct pf_fuel_pos *pos, const struct pf_fuel_node *node)
 {
   if (NULL == pos) {
-    pos = fc_malloc(sizeof(*pos));
+    pos = pf_fuel_pos_alloc();
     pos->ref_count = 1;
   } else if (1 < pos->ref_count) {
     pos->ref_count--;
-    pos = fc_malloc(sizeof(*pos));
+    pos = pf_fuel_pos_alloc();
     pos->ref_count = 1;
   } else {
 #ifdef PF_DEBUG
@@ -2970,6 +3123,13 @@ static inline bool pf_fuel_map_iterate_until(struct pf_fuel_map *pffm,
     return FALSE;
   }
 
+  if (NULL == node->segment && NULL != pfm->tile
+      && !pf_clusters_may_reach(pf_map_parameter(pfm), ptile)) {
+    /* Sure to be out of reach, don't iterate the whole map to find it
+     * out. */
+    return FALSE;
+  }
+
   while (NULL == node->segment) {
     if (!pf_map_iterate(pfm)) {
       /* All reachable destination have been iterated, 'ptile' is
@@ -3056,9 +3216,9 @@ static void pf_fuel_map_destroy(struct pf_map *pfm)
     pf_fuel_pos_unref(node->pos);
     pf_fuel_pos_unref(node->segment);
   }
-  free(pffm->lattice);
-  map_index_pq_destroy(pffm->queue);
-  map_index_pq_destroy(pffm->waited_queue);
+  pf_lattice_destroy(pffm->lattice, sizeof(*pffm->lattice));
+  pf_queue_destroy(pffm->queue);
+  pf_queue_destroy(pffm->waited_queue);
   free(pffm);
 }
 
@@ -3081,9 +3241,9 @@ static struct pf_map *pf_fuel_map_new(const struct pf_parameter *parameter)
 #endif /* PF_DEBUG */
 
   /* Allocate the map. */
-  pffm->lattice = fc_calloc(MAP_INDEX_SIZE, sizeof(struct pf_fuel_node));
-  pffm->queue = map_index_pq_new(INITIAL_QUEUE_SIZE);
-  pffm->waited_queue = map_index_pq_new(INITIAL_QUEUE_SIZE);
+  pffm->lattice = pf_lattice_new(sizeof(struct pf_fuel_node));
+  pffm->queue = pf_queue_new();
+  pffm->waited_queue = pf_queue_new();
 
   /* 'get_MC' callback must be set. */
   fc_assert_ret_val(parameter->get_MC != NULL, NULL);
@@ -3330,6 +3490,197 @@ const struct pf_parameter *pf_map_parameter(const struct pf_map *pfm)
 }
 
 
+/* ========================= pf_map cache ================================ */
+
+/* Maps kept for pf_map_cache_get(). A query for a parameter equal to the
+ * one of a cached map resumes the iteration of that map instead of
+ * starting over. */
+#define PF_MAP_CACHE_SIZE 8
+
+struct pf_map_cache_entry {
+  struct pf_map *pfm;           /* NULL if the entry is free. */
+  genhash_val_t hash;           /* Hash of the parameter. */
+  bool reusable;                /* FALSE if the parameter has user data. */
+  unsigned int last_use;        /* For replacing the least recently used. */
+};
+
+static struct pf_map_cache_entry pf_map_cache[PF_MAP_CACHE_SIZE];
+static unsigned int pf_map_cache_clock = 0;
+static int pf_map_cache_count = 0;      /* Entries in use. */
+
+/************************************************************************//**
+  Hash function for the parameters of cached maps.
+****************************************************************************/
+static genhash_val_t pf_parameter_hash_val(const struct pf_parameter *param)
+{
+  genhash_val_t result = tile_index(param->start_tile);
+
+  result = result * 31 + param->moves_left_initially;
+  result = result * 31 + param->fuel_left_initially;
+  result = result * 31 + param->move_rate;
+  result = result * 31 + param->cargo_depth;
+  result = result * 31 + (NULL != param->utype
+                          ? utype_index(param->utype) : -1);
+  result = result * 31 + (NULL != param->owner
+                          ? player_index(param->owner) : -1);
+  result = result * 31 + (param->omniscience ? 1 : 0);
+
+  return result;
+}
+
+/************************************************************************//**
+  Returns whether two parameters describe the same map. Every field is
+  compared, as the callbacks can use any of them.
+****************************************************************************/
+static bool pf_parameter_equal(const struct pf_parameter *param1,
+                               const struct pf_parameter *param2)
+{
+  return (param1->map == param2->map
+          && param1->start_tile == param2->start_tile
+          && param1->moves_left_initially == param2->moves_left_initially
+          && param1->fuel_left_initially == param2->fuel_left_initially
+          && (param1->transported_by_initially
+              == param2->transported_by_initially)
+          && param1->cargo_depth == param2->cargo_depth
+          && BV_ARE_EQUAL(param1->cargo_types, param2->cargo_types)
+          && param1->move_rate == param2->move_rate
+          && param1->fuel == param2->fuel
+          && param1->utype == param2->utype
+          && param1->owner == param2->owner
+          && param1->omniscience == param2->omniscience
+          && param1->get_MC == param2->get_MC
+          && param1->get_move_scope == param2->get_move_scope
+          && param1->ignore_none_scopes == param2->ignore_none_scopes
+          && param1->get_TB == param2->get_TB
+          && param1->get_EC == param2->get_EC
+          && param1->get_action == param2->get_action
+          && param1->actions == param2->actions
+          && param1->is_action_possible == param2->is_action_possible
+          && param1->get_zoc == param2->get_zoc
+          && param1->is_pos_dangerous == param2->is_pos_dangerous
+          && param1->get_moves_left_req == param2->get_moves_left_req
+          && param1->get_costs == param2->get_costs
+          && param1->data == param2->data);
+}
+
+/************************************************************************//**
+  Returns a map for the parameter, reusing a cached one when there is a
+  map for an equal parameter. Only the method A) functions may be used
+  on it, as the iteration of a reused map has already been started.
+
+  The map belongs to the cache: do not destroy it. It stays valid until
+  the next call to pf_map_cache_get() or pf_map_cache_invalidate().
+  Parameters with user data are never reused, as the data may change.
+****************************************************************************/
+struct pf_map *pf_map_cache_get(const struct pf_parameter *parameter)
+{
+  struct pf_map_cache_entry *victim = NULL;
+  bool reusable = (NULL == parameter->data);
+  genhash_val_t hash = 0;
+  int i;
+
+  pf_map_cache_clock++;
+
+  if (reusable) {
+    hash = pf_parameter_hash_val(parameter);
+
+    for (i = 0; i < PF_MAP_CACHE_SIZE; i++) {
+      struct pf_map_cache_entry *entry = &pf_map_cache[i];
+
+      if (NULL != entry->pfm && entry->reusable && entry->hash == hash
+          && pf_parameter_equal(&entry->pfm->params, parameter)) {
+        entry->last_use = pf_map_cache_clock;
+        return entry->pfm;
+      }
+    }
+  }
+
+  /* Prefer a free entry, then one that can't be reused anyway, then the
+   * least recently used one. */
+  for (i = 0; i < PF_MAP_CACHE_SIZE; i++) {
+    struct pf_map_cache_entry *entry = &pf_map_cache[i];
+
+    if (NULL == entry->pfm) {
+      victim = entry;
+      break;
+    }
+    if (NULL == victim
+        || (!entry->reusable && victim->reusable)
+        || (entry->reusable == victim->reusable
+            && entry->last_use < victim->last_use)) {
+      victim = entry;
+    }
+  }
+
+  if (NULL != victim->pfm) {
+    pf_map_destroy(victim->pfm);
+  } else {
+    pf_map_cache_count++;
+  }
+  victim->pfm = pf_map_new(parameter);
+  victim->hash = hash;
+  victim->reusable = reusable;
+  victim->last_use = pf_map_cache_clock;
+
+  return victim->pfm;
+}
+
+/************************************************************************//**
+  Forget all cached maps. Must be called whenever something the path
+  finding callbacks look at changes: units, cities, tiles, what players
+  know of the map, and diplomatic states.
+****************************************************************************/
+void pf_map_cache_invalidate(void)
+{
+  int i;
+
+  if (0 == pf_map_cache_count) {
+    /* Called very often; usually there is nothing to do. */
+    return;
+  }
+
+  for (i = 0; i < PF_MAP_CACHE_SIZE; i++) {
+    if (NULL != pf_map_cache[i].pfm) {
+      pf_map_destroy(pf_map_cache[i].pfm);
+      pf_map_cache[i].pfm = NULL;
+    }
+  }
+  pf_map_cache_count = 0;
+}
+
+/************************************************************************//**
+  Frees the memory kept for reuse by new maps, after dropping the cached
+  maps, and the cluster layer. No other map may exist at this point.
+****************************************************************************/
+void pf_free_spare_memory(void)
+{
+  int i;
+
+  pf_map_cache_invalidate();
+
+  for (i = 0; i < pf_spare_lattice_count; i++) {
+    free(pf_spare_lattices[i].mem);
+  }
+  pf_spare_lattice_count = 0;
+
+  for (i = 0; i < pf_spare_queue_count; i++) {
+    map_index_pq_destroy(pf_spare_queues[i]);
+  }
+  pf_spare_queue_count = 0;
+
+  while (NULL != pf_fuel_pos_chunks) {
+    struct pf_fuel_pos_chunk *chunk = pf_fuel_pos_chunks;
+
+    pf_fuel_pos_chunks = chunk->next;
+    free(chunk);
+  }
+  pf_fuel_pos_unused = NULL;
+
+  pf_clusters_free();
+}
+
+
+
 /* ====================== pf_path public functions ======================= */
 
 /************************************************************************//**
@@ -3525,7 +3876,14 @@ void pf_path_print_real(const struct pf_path *path, enum log_level level,
 
 /* The path-finding reverse maps are used check the move costs that the
  * units needs to reach the start tile. It stores a pf_map for every unit
- * type. */
+ * type.
+ *
+ * A reverse map may have several target tiles. Then one map per unit type
+ * and start tile is iterated without treating any of them as a target,
+ * and the cost of attacking each target is worked out afterwards from the
+ * neighbouring tiles. That gives the same result as iterating one map per
+ * target: a path passing through the target before attacking it cannot be
+ * cheaper than attacking it right away. */
 
 static genhash_val_t pf_pos_hash_val(const struct pf_parameter *parameter);
 static bool pf_pos_hash_cmp(const struct pf_parameter *parameter1,
@@ -3544,10 +3902,14 @@ static void pf_reverse_map_destroy_param(struct pf_parameter *param);
 
 /* The reverse map structure. */
 struct pf_reverse_map {
-  struct tile *target_tile;     /* Where we want to go. */
+  struct tile **targets;        /* Where we want to go. */
+  int num_targets;
+  int target;                   /* Index of the target queries are for. */
   int max_turns;                /* The maximum of turns. */
   struct pf_parameter template; /* Keep a parameter ready for usage. */
-  struct pf_pos_hash *hash;     /* A hash where pf_position are stored. */
+  struct pf_pos_hash *hash;     /* A hash where pf_position are stored,
+                                 * one per target. Unreachable targets
+                                 * have a NULL tile. */
 };
 
 /* Here goes all unit type flags which affect the move rules handled by
@@ -3641,22 +4003,33 @@ static void pf_reverse_map_destroy_param(struct pf_parameter *param)
 }
 
 /************************************************************************//**
-  'pf_reverse_map' constructor. If 'max_turns' is positive, then it won't
-  try to iterate the maps beyond this number of turns.
+  'pf_reverse_map' constructor for several target tiles. Queries are for
+  the first one until pf_reverse_map_set_target() is called. If
+  'max_turns' is positive, then it won't try to iterate the maps beyond
+  this number of turns.
 ****************************************************************************/
-struct pf_reverse_map *pf_reverse_map_new(const struct player *pplayer,
-                                          struct tile *target_tile,
-                                          int max_turns, bool omniscient,
-                                          const struct civ_map *map)
+struct pf_reverse_map *
+pf_reverse_map_new_for_tiles(const struct player *pplayer,
+                             struct tile *const *target_tiles,
+                             int num_targets, int max_turns,
+                             bool omniscient, const struct civ_map *map)
 {
-  struct pf_reverse_map *pfrm = fc_malloc(sizeof(struct pf_reverse_map));
-  struct pf_parameter *param = &pfrm->template;
+  struct pf_reverse_map *pfrm;
+  struct pf_parameter *param;
+
+  fc_assert_ret_val(0 < num_targets, NULL);
+
+  pfrm = fc_malloc(sizeof(struct pf_reverse_map));
+  param = &pfrm->template;
 
-  pfrm->target_tile = target_tile;
+  pfrm->targets = fc_malloc(num_targets * sizeof(*pfrm->targets));
+  memcpy(pfrm->targets, target_tiles, num_targets * sizeof(*pfrm->targets));
+  pfrm->num_targets = num_targets;
+  pfrm->target = 0;
   pfrm->max_turns = max_turns;
 
   /* Initialize the parameter. */
-  pft_fill_reverse_parameter(param, target_tile);
+  pft_fill_reverse_parameter(param, target_tiles[0]);
   param->owner = pplayer;
   param->omniscience = omniscient;
   param->map = map;
@@ -3667,6 +4040,19 @@ struct pf_reverse_map *pf_reverse_map_new(const struct player *pplayer,
   return pfrm;
 }
 
+/************************************************************************//**
+  'pf_reverse_map' constructor. If 'max_turns' is positive, then it won't
+  try to iterate the maps beyond this number of turns.
+****************************************************************************/
+struct pf_reverse_map *pf_reverse_map_new(const struct player *pplayer,
+                                          struct tile *target_tile,
+                                          int max_turns, bool omniscient,
+                                          const struct civ_map *map)
+{
+  return pf_reverse_map_new_for_tiles(pplayer, &target_tile, 1, max_turns,
+                                      omniscient, map);
+}
+
 /************************************************************************//**
   'pf_reverse_map' constructor for city. If 'max_turns' is positive, then
   it won't try to iterate the maps beyond this number of turns.
@@ -3688,18 +4074,127 @@ void pf_reverse_map_destroy(struct pf_reverse_map *pfrm)
   fc_assert_ret(NULL != pfrm);
 
   pf_pos_hash_destroy(pfrm->hash);
+  free(pfrm->targets);
   free(pfrm);
 }
 
 /************************************************************************//**
-  Returns the map for the unit type. Creates it if needed. Returns NULL if
-  'target_tile' is unreachable.
+  Make the following queries answer for 'ptile', which must be one of the
+  target tiles the map was created with. Returns FALSE if it is not.
+****************************************************************************/
+bool pf_reverse_map_set_target(struct pf_reverse_map *pfrm,
+                               const struct tile *ptile)
+{
+  int i;
+
+  for (i = 0; i < pfrm->num_targets; i++) {
+    if (pfrm->targets[i] == ptile) {
+      pfrm->target = i;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/************************************************************************//**
+  Fill the positions of all targets of a reverse map with several of them
+  from 'pfm', which has been iterated as far as needed without treating
+  any tile as a target. See the comment at the top of the pf_reverse_map
+  functions.
+****************************************************************************/
+static void pf_reverse_map_fill_targets(const struct pf_reverse_map *pfrm,
+                                        const struct pf_normal_map *pfnm,
+                                        int max_cost,
+                                        struct pf_position *positions)
+{
+  const struct pf_parameter *params = pf_map_parameter(PF_MAP(pfnm));
+  const struct pf_normal_node *lattice = pfnm->lattice;
+  int attack_cost;
+  int i;
+
+  if (utype_has_flag(params->utype, UTYF_ONEATTACK)
+      || utype_can_do_action(params->utype, ACTION_SUICIDE_ATTACK)) {
+    attack_cost = params->move_rate;
+  } else {
+    attack_cost = SINGLE_MOVE;
+  }
+
+  for (i = 0; i < pfrm->num_targets; i++) {
+    struct tile *target_tile = pfrm->targets[i];
+    const struct pf_normal_node *node = lattice + tile_index(target_tile);
+    struct pf_position *pos = positions + i;
+    int best_cost = PF_IMPOSSIBLE_MC;
+    enum direction8 best_dir = direction8_invalid();
+
+    pos->tile = NULL;
+
+    if (target_tile == params->start_tile
+        || (!params->omniscience
+            && TILE_UNKNOWN == tile_get_known(target_tile, params->owner))) {
+      /* No action is tried on these tiles, they are ordinary nodes. */
+      if (NS_PROCESSED == node->status
+          && (0 > max_cost || node->cost < max_cost)) {
+        pf_normal_map_fill_position(pfnm, target_tile, pos);
+      }
+      continue;
+    }
+
+    if (!utype_has_flag(params->utype, UTYF_CIVILIAN)
+        && !player_can_invade_tile(params->owner, target_tile)) {
+      continue;
+    }
+
+    adjc_dir_iterate(params->map, target_tile, tile1, dir) {
+      const struct pf_normal_node *node1 = lattice + tile_index(tile1);
+      int cost;
+
+      if (NS_PROCESSED != node1->status
+          || TB_DONT_LEAVE == node1->behavior
+          || PF_MS_NONE == node1->move_scope
+          || (0 >= params->move_rate && 0 <= node1->cost)) {
+        /* Not reached, or no exit from there. */
+        continue;
+      }
+
+      cost = node1->cost
+             + pf_normal_map_adjust_cost(attack_cost,
+                                         pf_moves_left(params, node1->cost));
+      if (PF_IMPOSSIBLE_MC == best_cost || cost < best_cost) {
+        best_cost = cost;
+        best_dir = DIR_REVERSE(dir);
+      }
+    } adjc_dir_iterate_end;
+
+    if (PF_IMPOSSIBLE_MC == best_cost
+        || (0 <= max_cost && best_cost >= max_cost)) {
+      continue;
+    }
+
+    pos->tile = target_tile;
+    pos->total_EC = 0;
+    pos->total_MC = (best_cost - pf_move_rate(params)
+                     + pf_moves_left_initially(params));
+    pos->turn = pf_turns(params, best_cost);
+    pos->moves_left = pf_moves_left(params, best_cost);
+    pos->fuel_left = 1;
+    pos->dir_to_here = best_dir;
+    pos->dir_to_next_pos = direction8_invalid();
+    if (best_cost > 0) {
+      pf_finalize_position(params, pos);
+    }
+  }
+}
+
+/************************************************************************//**
+  Returns the positions for the unit type, one per target. Creates them if
+  needed.
 ****************************************************************************/
 static const struct pf_position *
-pf_reverse_map_pos(struct pf_reverse_map *pfrm,
-                   const struct pf_parameter *param)
+pf_reverse_map_positions(struct pf_reverse_map *pfrm,
+                         const struct pf_parameter *param)
 {
-  struct pf_position *pos;
+  struct pf_position *positions;
   struct pf_map *pfm;
   struct pf_parameter *copy;
   struct tile *target_tile;
@@ -3707,53 +4202,67 @@ pf_reverse_map_pos(struct pf_reverse_map *pfrm,
   int max_cost;
 
   /* Check if we already processed something similar. */
-  if (pf_pos_hash_lookup(pfrm->hash, param, &pos)) {
-    return pos;
+  if (pf_pos_hash_lookup(pfrm->hash, param, &positions)) {
+    return positions;
   }
 
-  /* We didn't. Build map and iterate. */
-  pfm = pf_normal_map_new(param);
-  lattice = PF_NORMAL_MAP(pfm)->lattice;
-  target_tile = pfrm->target_tile;
-  if (pfrm->max_turns >= 0) {
-    max_cost = param->move_rate * (pfrm->max_turns + 1);
+  positions = fc_malloc(pfrm->num_targets * sizeof(*positions));
+  max_cost = (pfrm->max_turns >= 0
+              ? param->move_rate * (pfrm->max_turns + 1) : -1);
+
+  if (1 < pfrm->num_targets) {
+    struct pf_parameter neutral = *param;
+
+    /* Iterate once for all targets. */
+    neutral.get_action = NULL;
+    neutral.data = NULL;
+    pfm = pf_normal_map_new(&neutral);
+    lattice = PF_NORMAL_MAP(pfm)->lattice;
     do {
-      if (lattice[tile_index(pfm->tile)].cost >= max_cost) {
+      if (0 <= max_cost && lattice[tile_index(pfm->tile)].cost >= max_cost) {
         break;
-      } else if (pfm->tile == target_tile) {
-        /* Found our position. Insert in hash, destroy map, and return. */
-        pos = fc_malloc(sizeof(*pos));
-        pf_normal_map_fill_position(PF_NORMAL_MAP(pfm), target_tile, pos);
-        copy = fc_malloc(sizeof(*copy));
-        *copy = *param;
-        pf_pos_hash_insert(pfrm->hash, copy, pos);
-        pf_map_destroy(pfm);
-        return pos;
       }
     } while (pfm->iterate(pfm));
+    pf_reverse_map_fill_targets(pfrm, PF_NORMAL_MAP(pfm), max_cost,
+                                positions);
+    pf_map_destroy(pfm);
   } else {
-    /* No limit for iteration. */
+    /* Build map and iterate until we find the target. */
+    pfm = pf_normal_map_new(param);
+    lattice = PF_NORMAL_MAP(pfm)->lattice;
+    target_tile = pfrm->targets[0];
+    positions->tile = NULL;
     do {
-      if (pfm->tile == target_tile) {
-        /* Found our position. Insert in hash, destroy map, and return. */
-        pos = fc_malloc(sizeof(*pos));
-        pf_normal_map_fill_position(PF_NORMAL_MAP(pfm), target_tile, pos);
-        copy = fc_malloc(sizeof(*copy));
-        *copy = *param;
-        pf_pos_hash_insert(pfrm->hash, copy, pos);
-        pf_map_destroy(pfm);
-        return pos;
+      if (0 <= max_cost && lattice[tile_index(pfm->tile)].cost >= max_cost) {
+        break;
+      } else if (pfm->tile == target_tile) {
+        /* Found our position. */
+        pf_normal_map_fill_position(PF_NORMAL_MAP(pfm), target_tile,
+                                    positions);
+        break;
       }
     } while (pfm->iterate(pfm));
+    pf_map_destroy(pfm);
   }
-  pf_map_destroy(pfm);
 
-  /* Position not found. Let's insert NULL as position to avoid to iterate
-   * the map again. */
   copy = fc_malloc(sizeof(*copy));
   *copy = *param;
-  pf_pos_hash_insert(pfrm->hash, copy, NULL);
-  return NULL;
+  pf_pos_hash_insert(pfrm->hash, copy, positions);
+  return positions;
+}
+
+/************************************************************************//**
+  Returns the position of the current target for the unit type. Creates
+  it if needed. Returns NULL if the target is unreachable.
+****************************************************************************/
+static const struct pf_position *
+pf_reverse_map_pos(struct pf_reverse_map *pfrm,
+                   const struct pf_parameter *param)
+{
+  const struct pf_position *pos = pf_reverse_map_positions(pfrm, param)
+                                  + pfrm->target;
+
+  return (NULL != pos->tile ? pos : NULL);
 }
 
 /************************************************************************//**
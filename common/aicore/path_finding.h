@@ -495,6 +495,11 @@ void pf_map_iter_position(struct pf_map *pfm, struct pf_position *pos);
 /* Other related functions. */
 const struct pf_parameter *pf_map_parameter(const struct pf_map *pfm);
 
+/* Maps shared between queries, for method A) only. */
+struct pf_map *pf_map_cache_get(const struct pf_parameter *parameter);
+void pf_map_cache_invalidate(void);
+void pf_free_spare_memory(void);
+
 
 /* Paths functions. */
 void pf_path_destroy(struct pf_path *path);
@@ -522,7 +527,15 @@ struct pf_reverse_map *pf_reverse_map_new_for_city(const struct city *pcity,
                                                    int max_turns, bool omniscient,
                                                    const struct civ_map *map)
                        fc__warn_unused_result;
+struct pf_reverse_map *
+pf_reverse_map_new_for_tiles(const struct player *pplayer,
+                             struct tile *const *target_tiles,
+                             int num_targets, int max_turns,
+                             bool omniscient, const struct civ_map *map)
+                       fc__warn_unused_result;
 void pf_reverse_map_destroy(struct pf_reverse_map *prfm);
+bool pf_reverse_map_set_target(struct pf_reverse_map *pfrm,
+                               const struct tile *ptile);
 
 int pf_reverse_map_utype_move_cost(struct pf_reverse_map *pfrm,
                                    const struct unit_type *punittype,
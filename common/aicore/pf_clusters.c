@@ -0,0 +1,577 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <string.h>
+
+/* utility */
+#include "log.h"
+#include "mem.h"
+#include "support.h"
+
+/* common */
+#include "city.h"
+#include "game.h"
+#include "map.h"
+#include "movement.h"
+#include "player.h"
+#include "unit.h"
+#include "unitlist.h"
+#include "unittype.h"
+
+/* common/aicore */
+#include "pf_tools.h"
+
+#include "pf_clusters.h"
+
+/* For an explanation of what this is about, see "pf_clusters.h". */
+
+/* Blocks are PF_CLUSTER_SIZE x PF_CLUSTER_SIZE native positions. */
+#define PF_CLUSTER_SIZE 8
+#define PF_CLUSTER_TILES (PF_CLUSTER_SIZE * PF_CLUSTER_SIZE)
+
+/* Maximum number of regions in a block. Regions are separated by at
+ * least one tile, so there can't be more than half as many as tiles. */
+#define PF_CLUSTER_REGIONS (PF_CLUSTER_TILES / 2)
+
+#define PF_CLUSTER_NO_REGION (-1)
+
+/* A connection from a region of a block to a region of another one. */
+struct pf_cluster_link {
+  int region;                   /* Region in this block. */
+  int other;                    /* Global number of the other region. */
+};
+
+struct pf_cluster_block {
+  unsigned int version;         /* Version of the block it was done for. */
+  struct pf_cluster_link *links;
+  int num_links;
+  int avail_links;
+};
+
+/* The layer for one unit class. */
+struct pf_cluster_class {
+  bool transportable;           /* Some unit type can carry the class. */
+  /* Per player: whether one of their units able to carry the class is on
+   * a closed tile. Valid for the values of 'pf_clusters.changes' and
+   * 'pf_clusters.unit_changes' saved with it. */
+  bool transport_out[MAX_NUM_PLAYER_SLOTS];
+  unsigned int transport_changes;
+  unsigned int transport_unit_changes;
+  signed char *region;          /* Region of every tile, in its block. */
+  struct pf_cluster_block *blocks;
+  int *zone;                    /* Zone of every region, by global number
+                                 * (block * PF_CLUSTER_REGIONS + region). */
+  unsigned int changes;         /* Value of 'pf_clusters.changes' when the
+                                 * zones were made. */
+};
+
+static struct {
+  const struct tile *tiles;     /* Map the layer is made for. */
+  int xblocks, yblocks;
+  unsigned int *block_version;  /* Bumped when a tile of the block changes. */
+  unsigned int changes;         /* Bumped with any block version. */
+  unsigned int unit_changes;    /* Bumped when a unit moves or changes. */
+  struct pf_cluster_class *classes[UCL_LAST];
+} pf_clusters;
+
+/************************************************************************//**
+  Returns the block the tile of the given index is in.
+****************************************************************************/
+static inline int pf_cluster_block_of(int tindex)
+{
+  int nat_x, nat_y;
+
+  index_to_native_pos(&nat_x, &nat_y, tindex);
+
+  return ((nat_y / PF_CLUSTER_SIZE) * pf_clusters.xblocks
+          + nat_x / PF_CLUSTER_SIZE);
+}
+
+/************************************************************************//**
+  Returns whether units of the class could enter the tile in some path.
+****************************************************************************/
+static inline bool pf_cluster_tile_open(const struct unit_class *uclass,
+                                        const struct tile *ptile)
+{
+  /* Unknown terrain (in the client) is always assumed to be native. */
+  return (NULL == tile_terrain(ptile)
+          || NULL != tile_city(ptile)
+          || is_native_tile_to_class(uclass, ptile));
+}
+
+/************************************************************************//**
+  Frees the layer of a unit class.
+****************************************************************************/
+static void pf_cluster_class_destroy(struct pf_cluster_class *pcc)
+{
+  int i;
+
+  for (i = 0; i < pf_clusters.xblocks * pf_clusters.yblocks; i++) {
+    free(pcc->blocks[i].links);
+  }
+  free(pcc->blocks);
+  free(pcc->region);
+  free(pcc->zone);
+  free(pcc);
+}
+
+/************************************************************************//**
+  Frees the whole layer. It is made again when needed.
+****************************************************************************/
+void pf_clusters_free(void)
+{
+  int i;
+
+  /* Not unit_class_iterate(), the ruleset may already be gone. */
+  for (i = 0; i < UCL_LAST; i++) {
+    if (NULL != pf_clusters.classes[i]) {
+      pf_cluster_class_destroy(pf_clusters.classes[i]);
+      pf_clusters.classes[i] = NULL;
+    }
+  }
+
+  free(pf_clusters.block_version);
+  pf_clusters.block_version = NULL;
+  pf_clusters.tiles = NULL;
+}
+
+/************************************************************************//**
+  Notes that the terrain, the extras or the city of the tile changed.
+****************************************************************************/
+void pf_clusters_tile_changed(const struct tile *ptile)
+{
+  int tindex = tile_index(ptile);
+
+  if (NULL == pf_clusters.tiles
+      || pf_clusters.tiles != wld.map.tiles
+      || 0 > tindex || MAP_INDEX_SIZE <= tindex
+      || ptile != wld.map.tiles + tindex) {
+    /* Not made yet, or a virtual tile. */
+    return;
+  }
+
+  pf_clusters.block_version[pf_cluster_block_of(tindex)]++;
+  pf_clusters.changes++;
+}
+
+/************************************************************************//**
+  Notes that the unit was put on a tile or changed its type.
+****************************************************************************/
+void pf_clusters_unit_changed(const struct unit *punit)
+{
+  pf_clusters.unit_changes++;
+}
+
+/************************************************************************//**
+  Splits the open tiles of the block into regions.
+****************************************************************************/
+static void pf_cluster_block_label(struct pf_cluster_class *pcc,
+                                   const struct unit_class *uclass,
+                                   int block)
+{
+  const struct civ_map *nmap = &(wld.map);
+  struct tile *stack[PF_CLUSTER_TILES];
+  int x0 = (block % pf_clusters.xblocks) * PF_CLUSTER_SIZE;
+  int y0 = (block / pf_clusters.xblocks) * PF_CLUSTER_SIZE;
+  int x1 = MIN(x0 + PF_CLUSTER_SIZE, nmap->xsize);
+  int y1 = MIN(y0 + PF_CLUSTER_SIZE, nmap->ysize);
+  int regions = 0;
+  int nat_x, nat_y;
+
+  for (nat_y = y0; nat_y < y1; nat_y++) {
+    for (nat_x = x0; nat_x < x1; nat_x++) {
+      int tindex = native_pos_to_index(nat_x, nat_y);
+
+      pcc->region[tindex] = (pf_cluster_tile_open(uclass,
+                                                  nmap->tiles + tindex)
+                             ? PF_CLUSTER_REGIONS : PF_CLUSTER_NO_REGION);
+    }
+  }
+
+  for (nat_y = y0; nat_y < y1; nat_y++) {
+    for (nat_x = x0; nat_x < x1; nat_x++) {
+      int tindex = native_pos_to_index(nat_x, nat_y);
+      int depth = 0;
+
+      if (PF_CLUSTER_REGIONS != pcc->region[tindex]) {
+        /* Closed, or already in a region. */
+        continue;
+      }
+
+      fc_assert_ret(regions < PF_CLUSTER_REGIONS);
+      pcc->region[tindex] = regions;
+      stack[depth++] = nmap->tiles + tindex;
+
+      while (0 < depth) {
+        struct tile *ptile = stack[--depth];
+
+        adjc_iterate(nmap, ptile, padjc) {
+          int aindex = tile_index(padjc);
+
+          if (PF_CLUSTER_REGIONS == pcc->region[aindex]
+              && pf_cluster_block_of(aindex) == block) {
+            pcc->region[aindex] = regions;
+            stack[depth++] = padjc;
+          }
+        } adjc_iterate_end;
+      }
+      regions++;
+    }
+  }
+}
+
+/************************************************************************//**
+  Finds the connections of the regions of the block to the regions of
+  the other blocks.
+****************************************************************************/
+static void pf_cluster_block_link(struct pf_cluster_class *pcc, int block)
+{
+  const struct civ_map *nmap = &(wld.map);
+  struct pf_cluster_block *pblock = &pcc->blocks[block];
+  int x0 = (block % pf_clusters.xblocks) * PF_CLUSTER_SIZE;
+  int y0 = (block / pf_clusters.xblocks) * PF_CLUSTER_SIZE;
+  int x1 = MIN(x0 + PF_CLUSTER_SIZE, nmap->xsize);
+  int y1 = MIN(y0 + PF_CLUSTER_SIZE, nmap->ysize);
+  int nat_x, nat_y;
+
+  pblock->num_links = 0;
+
+  for (nat_y = y0; nat_y < y1; nat_y++) {
+    for (nat_x = x0; nat_x < x1; nat_x++) {
+      int tindex = native_pos_to_index(nat_x, nat_y);
+      int region = pcc->region[tindex];
+
+      if (PF_CLUSTER_NO_REGION == region) {
+        continue;
+      }
+
+      adjc_iterate(nmap, nmap->tiles + tindex, padjc) {
+        int aindex = tile_index(padjc);
+        int ablock = pf_cluster_block_of(aindex);
+        int other;
+        int i;
+
+        if (ablock == block
+            || PF_CLUSTER_NO_REGION == pcc->region[aindex]) {
+          continue;
+        }
+
+        other = ablock * PF_CLUSTER_REGIONS + pcc->region[aindex];
+        for (i = 0; i < pblock->num_links; i++) {
+          if (pblock->links[i].region == region
+              && pblock->links[i].other == other) {
+            break;
+          }
+        }
+        if (i < pblock->num_links) {
+          /* Already known. */
+          continue;
+        }
+
+        if (pblock->num_links == pblock->avail_links) {
+          pblock->avail_links = MAX(8, 2 * pblock->avail_links);
+          pblock->links = fc_realloc(pblock->links,
+                                     pblock->avail_links
+                                     * sizeof(*pblock->links));
+        }
+        pblock->links[pblock->num_links].region = region;
+        pblock->links[pblock->num_links].other = other;
+        pblock->num_links++;
+      } adjc_iterate_end;
+    }
+  }
+}
+
+/************************************************************************//**
+  Returns the representative of the set of the region, making the path to
+  it shorter on the way.
+****************************************************************************/
+static int pf_cluster_zone_find(int *zone, int region)
+{
+  while (zone[region] != region) {
+    zone[region] = zone[zone[region]];
+    region = zone[region];
+  }
+
+  return region;
+}
+
+/************************************************************************//**
+  Redoes the blocks that changed since the last time, and the zones.
+****************************************************************************/
+static void pf_cluster_class_update(struct pf_cluster_class *pcc,
+                                    const struct unit_class *uclass)
+{
+  const struct civ_map *nmap = &(wld.map);
+  int num_blocks = pf_clusters.xblocks * pf_clusters.yblocks;
+  bool *relink;
+  int block, i;
+
+  if (pcc->changes == pf_clusters.changes) {
+    return;
+  }
+
+  /* Links depend on the regions of both blocks, so they must be redone
+   * for the blocks around a changed one too. */
+  relink = fc_calloc(num_blocks, sizeof(*relink));
+  for (block = 0; block < num_blocks; block++) {
+    int x0, y0, x1, y1, nat_x, nat_y;
+
+    if (pcc->blocks[block].version == pf_clusters.block_version[block]) {
+      continue;
+    }
+
+    pf_cluster_block_label(pcc, uclass, block);
+    pcc->blocks[block].version = pf_clusters.block_version[block];
+    relink[block] = TRUE;
+
+    x0 = (block % pf_clusters.xblocks) * PF_CLUSTER_SIZE;
+    y0 = (block / pf_clusters.xblocks) * PF_CLUSTER_SIZE;
+    x1 = MIN(x0 + PF_CLUSTER_SIZE, nmap->xsize);
+    y1 = MIN(y0 + PF_CLUSTER_SIZE, nmap->ysize);
+    for (nat_y = y0; nat_y < y1; nat_y++) {
+      for (nat_x = x0; nat_x < x1; nat_x++) {
+        if (nat_x != x0 && nat_x != x1 - 1
+            && nat_y != y0 && nat_y != y1 - 1
+            && nat_x != x0 + 1 && nat_x != x1 - 2
+            && nat_y != y0 + 1 && nat_y != y1 - 2) {
+          /* Too far from the border to have neighbours in other blocks
+           * (on iso maps, adjacent tiles may be two rows apart). */
+          continue;
+        }
+        adjc_iterate(nmap, native_pos_to_tile(nmap, nat_x, nat_y), padjc) {
+          relink[pf_cluster_block_of(tile_index(padjc))] = TRUE;
+        } adjc_iterate_end;
+      }
+    }
+  }
+
+  for (block = 0; block < num_blocks; block++) {
+    if (relink[block]) {
+      pf_cluster_block_link(pcc, block);
+    }
+  }
+  free(relink);
+
+  /* The zones are cheap to remake from the links. */
+  for (i = 0; i < num_blocks * PF_CLUSTER_REGIONS; i++) {
+    pcc->zone[i] = i;
+  }
+  for (block = 0; block < num_blocks; block++) {
+    const struct pf_cluster_block *pblock = &pcc->blocks[block];
+
+    for (i = 0; i < pblock->num_links; i++) {
+      int zone1 = pf_cluster_zone_find(pcc->zone,
+                                       block * PF_CLUSTER_REGIONS
+                                       + pblock->links[i].region);
+      int zone2 = pf_cluster_zone_find(pcc->zone, pblock->links[i].other);
+
+      if (zone1 != zone2) {
+        pcc->zone[MAX(zone1, zone2)] = MIN(zone1, zone2);
+      }
+    }
+  }
+  for (i = 0; i < num_blocks * PF_CLUSTER_REGIONS; i++) {
+    pcc->zone[i] = pf_cluster_zone_find(pcc->zone, i);
+  }
+
+  pcc->changes = pf_clusters.changes;
+}
+
+/************************************************************************//**
+  Returns the up to date layer of the unit class.
+****************************************************************************/
+static struct pf_cluster_class *
+pf_cluster_class_get(const struct unit_class *uclass)
+{
+  struct pf_cluster_class *pcc;
+  int num_blocks;
+
+  if (pf_clusters.tiles != wld.map.tiles) {
+    /* New map. */
+    pf_clusters_free();
+    pf_clusters.tiles = wld.map.tiles;
+    pf_clusters.xblocks = ((wld.map.xsize + PF_CLUSTER_SIZE - 1)
+                           / PF_CLUSTER_SIZE);
+    pf_clusters.yblocks = ((wld.map.ysize + PF_CLUSTER_SIZE - 1)
+                           / PF_CLUSTER_SIZE);
+    pf_clusters.block_version =
+        fc_calloc(pf_clusters.xblocks * pf_clusters.yblocks,
+                  sizeof(*pf_clusters.block_version));
+    /* Forces the first update of the classes. */
+    pf_clusters.changes++;
+  }
+
+  num_blocks = pf_clusters.xblocks * pf_clusters.yblocks;
+  pcc = pf_clusters.classes[uclass_index(uclass)];
+  if (NULL == pcc) {
+    int i;
+
+    pcc = fc_calloc(1, sizeof(*pcc));
+    pcc->region = fc_malloc(MAP_INDEX_SIZE * sizeof(*pcc->region));
+    pcc->blocks = fc_calloc(num_blocks, sizeof(*pcc->blocks));
+    pcc->zone = fc_malloc(num_blocks * PF_CLUSTER_REGIONS
+                          * sizeof(*pcc->zone));
+    for (i = 0; i < num_blocks; i++) {
+      /* Different from any version, to label every block. */
+      pcc->blocks[i].version = pf_clusters.block_version[i] - 1;
+    }
+    pcc->changes = pf_clusters.changes - 1;
+    pcc->transport_changes = pcc->changes;
+
+    unit_type_iterate(utype) {
+      if (can_unit_type_transport(utype, uclass)) {
+        pcc->transportable = TRUE;
+        break;
+      }
+    } unit_type_iterate_end;
+
+    pf_clusters.classes[uclass_index(uclass)] = pcc;
+  }
+
+  pf_cluster_class_update(pcc, uclass);
+
+  return pcc;
+}
+
+/************************************************************************//**
+  Returns the zone of the tile, or -1 if it is closed.
+****************************************************************************/
+static inline int pf_cluster_zone(const struct pf_cluster_class *pcc,
+                                  const struct tile *ptile)
+{
+  int tindex = tile_index(ptile);
+  int region = pcc->region[tindex];
+
+  if (PF_CLUSTER_NO_REGION == region) {
+    return -1;
+  }
+
+  return pcc->zone[pf_cluster_block_of(tindex) * PF_CLUSTER_REGIONS
+                   + region];
+}
+
+/************************************************************************//**
+  Returns whether a unit able to carry units of the class, owned by
+  'pplayer' or one of their allies, is on a tile that is closed to the
+  class. Such a unit may join zones.
+
+  The units are only scanned again once units or tiles changed since the
+  last scan.
+****************************************************************************/
+static bool pf_cluster_transport_out(struct pf_cluster_class *pcc,
+                                     const struct unit_class *uclass,
+                                     const struct player *pplayer)
+{
+  if (pcc->transport_changes != pf_clusters.changes
+      || pcc->transport_unit_changes != pf_clusters.unit_changes) {
+    memset(pcc->transport_out, 0, sizeof(pcc->transport_out));
+    players_iterate(aplayer) {
+      unit_list_iterate(aplayer->units, punit) {
+        if (can_unit_type_transport(unit_type_get(punit), uclass)
+            && !pf_cluster_tile_open(uclass, unit_tile(punit))) {
+          pcc->transport_out[player_index(aplayer)] = TRUE;
+          break;
+        }
+      } unit_list_iterate_end;
+    } players_iterate_end;
+    pcc->transport_changes = pf_clusters.changes;
+    pcc->transport_unit_changes = pf_clusters.unit_changes;
+  }
+
+  players_iterate(aplayer) {
+    if (pcc->transport_out[player_index(aplayer)]
+        && (NULL == pplayer || pplayers_allied(pplayer, aplayer))) {
+      return TRUE;
+    }
+  } players_iterate_end;
+
+  return FALSE;
+}
+
+/************************************************************************//**
+  Returns FALSE if it is sure that no path for the parameter reaches the
+  tile. TRUE means it may be reachable.
+
+  The path-finding code only moves out of tiles that have a move scope,
+  which are open tiles, or tiles with a transport. So, apart from the
+  first step, a path goes through open tiles of one zone until the step
+  to its destination, which may be closed (attacks, one step into
+  non-native terrain for overlap maps).
+****************************************************************************/
+bool pf_clusters_may_reach(const struct pf_parameter *param,
+                           const struct tile *ptile)
+{
+  const struct tile *start = param->start_tile;
+  const struct unit_class *uclass;
+  struct pf_cluster_class *pcc;
+  int zones[9];
+  int num_zones = 0;
+  int zone, i;
+
+  if (start == ptile
+      || is_tiles_adjacent(start, ptile)
+      || param->map != &(wld.map)
+      || NULL == param->utype
+      || NULL != param->get_costs
+      || !pft_has_default_move_scope(param)
+      || (!param->omniscience && is_server())) {
+    /* Not the kind of map we know about. Note that the server has the
+     * real terrain of tiles the player does not know about, which the
+     * path-finding code treats as native. */
+    return TRUE;
+  }
+
+  uclass = utype_class(param->utype);
+  pcc = pf_cluster_class_get(uclass);
+
+  /* Zones of the first step. */
+  if (0 <= (zone = pf_cluster_zone(pcc, start))) {
+    zones[num_zones++] = zone;
+  }
+  adjc_iterate(param->map, start, padjc) {
+    if (0 <= (zone = pf_cluster_zone(pcc, padjc))) {
+      for (i = 0; i < num_zones && zones[i] != zone; i++) {
+        /* Nothing. */
+      }
+      if (i == num_zones) {
+        zones[num_zones++] = zone;
+      }
+    }
+  } adjc_iterate_end;
+
+  /* Zones of the last step. */
+  if (0 <= (zone = pf_cluster_zone(pcc, ptile))) {
+    for (i = 0; i < num_zones; i++) {
+      if (zones[i] == zone) {
+        return TRUE;
+      }
+    }
+  }
+  adjc_iterate(param->map, ptile, padjc) {
+    if (0 <= (zone = pf_cluster_zone(pcc, padjc))) {
+      for (i = 0; i < num_zones; i++) {
+        if (zones[i] == zone) {
+          return TRUE;
+        }
+      }
+    }
+  } adjc_iterate_end;
+
+  return (pcc->transportable
+          && pf_cluster_transport_out(pcc, uclass, param->owner));
+}
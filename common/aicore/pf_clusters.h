@@ -0,0 +1,53 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+#ifndef FC__PF_CLUSTERS_H
+#define FC__PF_CLUSTERS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* common/aicore */
+#include "path_finding.h"
+
+/*
+ * Coarse layer over the map, used by the path-finding code to give up
+ * early on destinations that cannot be reached.
+ *
+ * The map is cut into square blocks. For each unit class, the tiles of a
+ * block that the class could ever enter (native tiles, cities, and tiles
+ * the player does not know) are split into connected regions, and the
+ * regions of neighbouring blocks are linked into zones. A path can only
+ * run inside one zone, so when the start and the destination have no
+ * zone in common, the answer is known without iterating the whole map.
+ * Units, borders, ZOC and so on can only make paths impossible, never
+ * possible, so the answer is exact; transports at sea are the one thing
+ * that joins zones, and a query gives up on the layer when the owner of
+ * the parameter or one of their allies has any.
+ *
+ * Blocks are redone lazily for the class being asked about, after
+ * pf_clusters_tile_changed() was called for one of their tiles. Where the
+ * transports are is looked at again after pf_clusters_unit_changed().
+ */
+
+bool pf_clusters_may_reach(const struct pf_parameter *param,
+                           const struct tile *ptile);
+void pf_clusters_tile_changed(const struct tile *ptile);
+void pf_clusters_unit_changed(const struct unit *punit);
+void pf_clusters_free(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* FC__PF_CLUSTERS_H */
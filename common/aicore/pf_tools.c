@@ -1025,3 +1025,12 @@ void pft_fill_amphibious_parameter(struct pft_amphibious *parameter)
 
   parameter->combined.data = parameter;
 }
+
+/************************************************************************//**
+  Returns whether the parameter uses the standard rules of this module to
+  find out which tiles can be entered.
+****************************************************************************/
+bool pft_has_default_move_scope(const struct pf_parameter *parameter)
+{
+  return parameter->get_move_scope == pf_get_move_scope;
+}
@@ -3176,6 +3176,7 @@ void city_add_improvement(struct city *pcity,
 			  const struct impr_type *pimprove)
 {
   pcity->built[improvement_index(pimprove)].turn = game.info.turn; /*I_ACTIVE*/
+  effect_cache_city_changed(pcity);
 
   if (is_server() && is_wonder(pimprove)) {
     /* Client just read the info from the packets. */
@@ -3193,6 +3194,7 @@ void city_remove_improvement(struct city *pcity,
             improvement_rule_name(pimprove), pcity->name);
   
   pcity->built[improvement_index(pimprove)].turn = I_DESTROYED;
+  effect_cache_city_changed(pcity);
 
   if (is_server() && is_wonder(pimprove)) {
     /* Client just read the info from the packets. */
@@ -3335,6 +3337,8 @@ void destroy_city_virtual(struct city *pcity)
   if (pcity->tile_cache != NULL) {
     free(pcity->tile_cache);
   }
+  effect_cache_city_free(pcity);
+  cm_clear_cache(pcity);
 
   if (!is_server()) {
     unit_list_destroy(pcity->client.info_units_supported);
@@ -299,6 +299,8 @@ enum city_build_result {
 };
 
 struct tile_cache; /* defined and only used within city.c */
+struct effect_city_cache; /* defined and only used within effects.c */
+struct cm_result; /* defined in ./common/aicore/cm.h */
 
 struct adv_city; /* defined in ./server/advisors/infracache.h */
 
@@ -334,6 +336,13 @@ struct city {
    * radius. */
   int tile_cache_radius_sq;
 
+  /* Values of effects at the city (see get_city_bonus()). */
+  struct effect_city_cache *effect_cache;
+
+  /* The last arrangement found by the city governor. It is used as the
+   * starting point of the next search (see cm_query_result()). */
+  struct cm_result *cm_last;
+
   /* the productions */
   int surplus[O_LAST]; /* Final surplus in each category. */
   int waste[O_LAST]; /* Waste/corruption in each category. */
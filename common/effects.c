@@ -119,8 +119,62 @@ static struct {
     /* ...advances... */
     struct effect_list *advances[A_LAST];
   } reqs;
+
+  /* What the effects of each type read when evaluated for a city,
+   * as EFFECT_DEP_* bits. */
+  unsigned int city_deps[EFT_COUNT];
 } ruleset_cache;
 
+/**************************************************************************
+  City effect cache. get_city_bonus() and get_city_output_bonus() keep
+  the values they computed in the city, and return them again as long as
+  nothing the effects of that type read has changed.
+
+  What the effects read is worked out from their requirements when the
+  ruleset is loaded. The owner of the city, its government and the city
+  size are kept in the cache and compared on every lookup. Changes to
+  techs, wonders, the terrain and the buildings of the city are tracked
+  with sequence numbers: each change takes the next number, and a cached
+  value is only good if it was computed after the last change to
+  everything it depends on. Effect types that read anything else (like
+  diplomatic states, culture, or trade partners) are never cached.
+
+  The cache is only used by the server; the client gets most of this
+  state from packets that do not go through the functions that report
+  the changes.
+**************************************************************************/
+
+/* Bits of ruleset_cache.city_deps[], after the enum effect_cache_dep
+ * ones. */
+#define EFFECT_DEP(dep) (1u << (dep))
+#define EFFECT_DEP_BUILDINGS (1u << ECD_COUNT)
+#define EFFECT_DEP_NO_CACHE (1u << (ECD_COUNT + 1))
+
+/* Requirements nested deeper than this in improvement obsolescence are
+ * not followed, and make the effect type uncacheable. */
+#define EFFECT_DEP_MAX_DEPTH 8
+
+struct effect_cache_entry {
+  int value;
+  unsigned int stamp;   /* Sequence number when it was computed */
+};
+
+struct effect_city_cache {
+  const struct player *owner;
+  const struct government *government;
+  citizens size;
+  unsigned int buildings_changed;
+
+  /* Indexed by output type, O_LAST for no output type. */
+  struct effect_cache_entry entries[EFT_COUNT][O_LAST + 1];
+};
+
+static struct {
+  unsigned int seq;
+  unsigned int reset;   /* All values computed before are stale */
+  unsigned int changed[ECD_COUNT];
+} effect_cache = { 1, 1, };
+
 
 /**********************************************************************//**
   Get a list of effects of this type.
@@ -165,6 +219,114 @@ struct effect_list *get_req_source_effects(struct universal *psource)
   }
 }
 
+/**********************************************************************//**
+  Return what the requirement reads when it is evaluated for a city
+  (with no other target than the city tile or an output type), as a
+  mask of EFFECT_DEP_* bits.
+**************************************************************************/
+static unsigned int req_city_deps(const struct requirement *preq,
+                                  int depth)
+{
+  switch (preq->source.kind) {
+  case VUT_NONE:
+  case VUT_TOPO:
+    return 0;
+  case VUT_GOVERNMENT:
+    /* Compared directly. */
+    return 0;
+  case VUT_IMPR_GENUS:
+  case VUT_UTYPE:
+  case VUT_UTFLAG:
+  case VUT_UCLASS:
+  case VUT_UCFLAG:
+  case VUT_MINVETERAN:
+  case VUT_UNITSTATE:
+  case VUT_MINMOVES:
+  case VUT_MINHP:
+  case VUT_ACTION:
+  case VUT_OTYPE:
+  case VUT_SPECIALIST:
+    /* Only about targets that are fixed for the cached queries. */
+    return 0;
+  case VUT_ADVANCE:
+    if (preq->range == REQ_RANGE_PLAYER || preq->survives) {
+      return EFFECT_DEP(ECD_ADVANCES);
+    }
+    break;
+  case VUT_TECHFLAG:
+    if (preq->range == REQ_RANGE_PLAYER) {
+      return EFFECT_DEP(ECD_ADVANCES);
+    }
+    break;
+  case VUT_NATION:
+  case VUT_NATIONGROUP:
+    /* The owner is compared directly. */
+    if (preq->range == REQ_RANGE_PLAYER) {
+      return 0;
+    }
+    break;
+  case VUT_MINSIZE:
+    /* The city size is compared directly. */
+    if (preq->range == REQ_RANGE_CITY) {
+      return 0;
+    }
+    break;
+  case VUT_CITYTILE:
+    if (preq->source.value.citytile == CITYT_CENTER) {
+      return 0;
+    }
+    break;
+  case VUT_TERRAIN:
+  case VUT_TERRAINCLASS:
+  case VUT_TERRFLAG:
+  case VUT_TERRAINALTER:
+  case VUT_EXTRA:
+  case VUT_EXTRAFLAG:
+  case VUT_BASEFLAG:
+  case VUT_ROADFLAG:
+    if (preq->range == REQ_RANGE_LOCAL
+        || preq->range == REQ_RANGE_CADJACENT
+        || preq->range == REQ_RANGE_ADJACENT) {
+      return EFFECT_DEP(ECD_TERRAIN);
+    }
+    break;
+  case VUT_IMPROVEMENT:
+    {
+      unsigned int deps;
+
+      switch (preq->range) {
+      case REQ_RANGE_LOCAL:
+        deps = 0;
+        break;
+      case REQ_RANGE_CITY:
+        deps = EFFECT_DEP_BUILDINGS;
+        break;
+      case REQ_RANGE_PLAYER:
+      case REQ_RANGE_WORLD:
+        deps = EFFECT_DEP(ECD_WONDERS);
+        break;
+      default:
+        return EFFECT_DEP_NO_CACHE;
+      }
+
+      /* Whether the building is obsolete is checked first. */
+      if (depth >= EFFECT_DEP_MAX_DEPTH) {
+        return EFFECT_DEP_NO_CACHE;
+      }
+      requirement_vector_iterate(&preq->source.value.building->obsolete_by,
+                                 pobs) {
+        deps |= req_city_deps(pobs, depth + 1);
+      } requirement_vector_iterate_end;
+
+      return deps;
+    }
+  default:
+    break;
+  }
+
+  return EFFECT_DEP_NO_CACHE;
+}
+
 /**********************************************************************//**
   Add effect to ruleset cache.
 **************************************************************************/
@@ -180,11 +342,17 @@ struct effect *effect_new(enum effect_type type, int value,
   peffect->multiplier = pmul;
 
   requirement_vector_init(&peffect->reqs);
+  peffect->prog = NULL;
 
   /* Now add the effect to the ruleset cache. */
   effect_list_append(ruleset_cache.tracker, peffect);
   effect_list_append(get_effects(type), peffect);
 
+  if (pmul != NULL) {
+    /* Multipliers can be changed by the player at any time. */
+    ruleset_cache.city_deps[type] |= EFFECT_DEP_NO_CACHE;
+  }
+
   return peffect;
 }
 
@@ -204,19 +372,38 @@ struct effect *effect_copy(struct effect *old)
 }
 
 /**********************************************************************//**
-  Append requirement to effect.
+  Append requirement to effect. The requirements are compiled again by
+  the next ruleset_cache_compile().
 **************************************************************************/
 void effect_req_append(struct effect *peffect, struct requirement req)
 {
   struct effect_list *eff_list = get_req_source_effects(&req.source);
 
   requirement_vector_append(&peffect->reqs, req);
+  req_program_destroy(peffect->prog);
+  peffect->prog = NULL;
+  ruleset_cache.city_deps[peffect->type] |= req_city_deps(&req, 0);
 
   if (eff_list) {
     effect_list_append(eff_list, peffect);
   }
 }
 
+/**********************************************************************//**
+  Update the compiled requirements and the city dependencies of the
+  effect type after the requirement vector of peffect was changed in
+  place.
+**************************************************************************/
+void effect_reqs_changed(struct effect *peffect)
+{
+  req_program_destroy(peffect->prog);
+  peffect->prog = req_program_new(&peffect->reqs);
+
+  requirement_vector_iterate(&peffect->reqs, preq) {
+    ruleset_cache.city_deps[peffect->type] |= req_city_deps(preq, 0);
+  } requirement_vector_iterate_end;
+}
+
 /**********************************************************************//**
   Initialize the ruleset cache.  The ruleset cache should be empty
   before this is done (so if it's previously been initialized, it needs
@@ -229,6 +416,8 @@ void ruleset_cache_init(void)
   initialized = TRUE;
 
   ruleset_cache.tracker = effect_list_new();
+  memset(ruleset_cache.city_deps, 0, sizeof(ruleset_cache.city_deps));
+  effect_cache.reset = ++effect_cache.seq;
 
   for (i = 0; i < ARRAY_SIZE(ruleset_cache.effects); i++) {
     ruleset_cache.effects[i] = effect_list_new();
@@ -244,6 +433,21 @@ void ruleset_cache_init(void)
   }
 }
 
+/**********************************************************************//**
+  Compile the requirements of the effects that have been added or had
+  requirements appended since the last call. Call this once the effects
+  of a ruleset are all loaded; until then their requirement vectors are
+  checked directly.
+**************************************************************************/
+void ruleset_cache_compile(void)
+{
+  effect_list_iterate(ruleset_cache.tracker, peffect) {
+    if (peffect->prog == NULL) {
+      peffect->prog = req_program_new(&peffect->reqs);
+    }
+  } effect_list_iterate_end;
+}
+
 /**********************************************************************//**
   Free the ruleset cache.  This should be called at the end of the game or
   when the client disconnects from the server.  See ruleset_cache_init.
@@ -255,6 +459,7 @@ void ruleset_cache_free(void)
 
   if (tracker_list) {
     effect_list_iterate(tracker_list, peffect) {
+      req_program_destroy(peffect->prog);
       requirement_vector_free(&peffect->reqs);
       free(peffect);
     } effect_list_iterate_end;
@@ -301,6 +506,135 @@ void ruleset_cache_free(void)
   initialized = FALSE;
 }
 
+/**********************************************************************//**
+  Tell the city effect cache that techs, wonders or the terrain have
+  changed.
+**************************************************************************/
+void effect_cache_changed(enum effect_cache_dep dep)
+{
+  fc_assert_ret(dep >= 0 && dep < ECD_COUNT);
+
+  effect_cache.changed[dep] = ++effect_cache.seq;
+}
+
+/**********************************************************************//**
+  Tell the city effect cache that the buildings of the city have
+  changed.
+**************************************************************************/
+void effect_cache_city_changed(struct city *pcity)
+{
+  if (pcity->effect_cache != NULL) {
+    pcity->effect_cache->buildings_changed = ++effect_cache.seq;
+  }
+}
+
+/**********************************************************************//**
+  Free the effect cache of the city.
+**************************************************************************/
+void effect_cache_city_free(struct city *pcity)
+{
+  if (pcity->effect_cache != NULL) {
+    free(pcity->effect_cache);
+    pcity->effect_cache = NULL;
+  }
+}
+
+/**********************************************************************//**
+  Return the cache entry for the value of the effect type in the city
+  (for the given output type, or NULL), or NULL if it cannot be cached.
+  The cache is part of the city, so this only changes the city itself.
+**************************************************************************/
+static struct effect_cache_entry *
+city_cache_entry(const struct city *pcity,
+                 const struct output_type *poutput,
+                 enum effect_type effect_type)
+{
+  struct effect_city_cache *cache;
+  const struct player *owner = city_owner(pcity);
+
+  if (!is_server() || pcity->id == 0
+      || (ruleset_cache.city_deps[effect_type] & EFFECT_DEP_NO_CACHE)) {
+    /* Virtual cities are too short lived to be worth it. */
+    return NULL;
+  }
+
+  cache = pcity->effect_cache;
+  if (cache == NULL) {
+    cache = fc_calloc(1, sizeof(*cache));
+    ((struct city *) pcity)->effect_cache = cache;
+  }
+
+  if (cache->owner != owner
+      || cache->government != government_of_player(owner)
+      || cache->size != city_size_get(pcity)) {
+    memset(cache->entries, 0, sizeof(cache->entries));
+    cache->owner = owner;
+    cache->government = government_of_player(owner);
+    cache->size = city_size_get(pcity);
+  }
+
+  return &cache->entries[effect_type][poutput != NULL ? poutput->index
+                                                      : O_LAST];
+}
+
+/**********************************************************************//**
+  Return TRUE iff the cached value is still good.
+**************************************************************************/
+static bool city_cache_entry_valid(const struct city *pcity,
+                                   const struct effect_cache_entry *entry,
+                                   enum effect_type effect_type)
+{
+  unsigned int deps = ruleset_cache.city_deps[effect_type];
+  int dep;
+
+  if (entry->stamp < effect_cache.reset) {
+    /* Includes entries never computed. */
+    return FALSE;
+  }
+  if ((deps & EFFECT_DEP_BUILDINGS)
+      && entry->stamp < pcity->effect_cache->buildings_changed) {
+    return FALSE;
+  }
+  for (dep = 0; dep < ECD_COUNT; dep++) {
+    if ((deps & EFFECT_DEP(dep))
+        && entry->stamp < effect_cache.changed[dep]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**********************************************************************//**
+  Returns the effect bonus at a city, for the given output type (or
+  NULL) and tile (city center or NULL), using the city effect cache.
+**************************************************************************/
+static int get_city_target_bonus(const struct city *pcity,
+                                 const struct tile *ptile,
+                                 const struct output_type *poutput,
+                                 enum effect_type effect_type)
+{
+  struct effect_cache_entry *entry = city_cache_entry(pcity, poutput,
+                                                      effect_type);
+  int value;
+
+  if (entry != NULL && city_cache_entry_valid(pcity, entry, effect_type)) {
+    return entry->value;
+  }
+
+  value = get_target_bonus_effects(NULL,
+                                   city_owner(pcity), NULL, pcity, NULL,
+                                   ptile, NULL, NULL, poutput, NULL,
+                                   NULL, effect_type);
+
+  if (entry != NULL) {
+    entry->value = value;
+    entry->stamp = effect_cache.seq;
+  }
+
+  return value;
+}
+
 /**********************************************************************//**
   Get the maximum effect value in this ruleset for the universal
   (that is, the sum of all positive effects clauses that apply specifically
@@ -616,11 +950,16 @@ int get_target_bonus_effects(struct effect_list *plist,
   /* Loop over all effects of this type. */
   effect_list_iterate(get_effects(effect_type), peffect) {
     /* For each effect, see if it is active. */
-    if (are_reqs_active(target_player, other_player, target_city,
-                        target_building, target_tile,
-                        target_unit, target_unittype,
-                        target_output, target_specialist, target_action,
-			&peffect->reqs, RPT_CERTAIN)) {
+    if (peffect->prog != NULL
+        ? req_program_active(peffect->prog, target_player, other_player,
+                             target_city, target_building, target_tile,
+                             target_unit, target_unittype,
+                             target_output, target_specialist, target_action,
+                             RPT_CERTAIN)
+        : are_reqs_active(target_player, other_player, target_city,
+                          target_building, target_tile, target_unit,
+                          target_unittype, target_output, target_specialist,
+                          target_action, &peffect->reqs, RPT_CERTAIN)) {
       /* This code will add value of effect. If there's multiplier for 
        * effect and target_player aren't null, then value is multiplied
        * by player's multiplier factor. */
@@ -683,10 +1022,7 @@ int get_city_bonus(const struct city *pcity, enum effect_type effect_type)
     return 0;
   }
 
-  return get_target_bonus_effects(NULL,
-                                  city_owner(pcity), NULL, pcity, NULL,
-                                  city_tile(pcity), NULL, NULL, NULL, NULL,
-                                  NULL, effect_type);
+  return get_city_target_bonus(pcity, city_tile(pcity), NULL, effect_type);
 }
 
 /**********************************************************************//**
@@ -784,10 +1120,7 @@ int get_city_output_bonus(const struct city *pcity,
   fc_assert_ret_val(pcity != NULL, 0);
   fc_assert_ret_val(poutput != NULL, 0);
   fc_assert_ret_val(effect_type != EFT_COUNT, 0);
-  return get_target_bonus_effects(NULL, city_owner(pcity), NULL, pcity,
-                                  NULL, NULL, NULL, NULL, poutput, NULL,
-                                  NULL,
-                                  effect_type);
+  return get_city_target_bonus(pcity, NULL, poutput, effect_type);
 }
 
 /**********************************************************************//**
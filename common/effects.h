@@ -317,6 +317,10 @@ struct effect {
   /* An effect can have multiple requirements.  The effect will only be
    * active if all of these requirement are met. */
   struct requirement_vector reqs;
+
+  /* The requirements compiled by ruleset_cache_compile() and
+   * effect_reqs_changed(); NULL while requirements are being appended. */
+  struct req_program *prog;
 };
 
 /* An effect_list is a list of effects. */
@@ -331,6 +335,7 @@ struct effect *effect_new(enum effect_type type, int value,
                           struct multiplier *pmul);
 struct effect *effect_copy(struct effect *old);
 void effect_req_append(struct effect *peffect, struct requirement req);
+void effect_reqs_changed(struct effect *peffect);
 
 struct astring;
 void get_effect_req_text(const struct effect *peffect,
@@ -343,9 +348,23 @@ struct packet_ruleset_effect;
 
 void ruleset_cache_init(void);
 void ruleset_cache_free(void);
+void ruleset_cache_compile(void);
 void recv_ruleset_effect(const struct packet_ruleset_effect *packet);
 void send_ruleset_cache(struct conn_list *dest);
 
+/* Things that the effect values cached for cities depend on. Whoever
+ * changes one of them has to call effect_cache_changed(). */
+enum effect_cache_dep {
+  ECD_ADVANCES,  /* Techs known by any player */
+  ECD_WONDERS,   /* Wonders built or lost by any player */
+  ECD_TERRAIN,   /* Terrain and extras of the map */
+  ECD_COUNT
+};
+
+void effect_cache_changed(enum effect_cache_dep dep);
+void effect_cache_city_changed(struct city *pcity);
+void effect_cache_city_free(struct city *pcity);
+
 int effect_cumulative_max(enum effect_type type, struct universal *for_uni);
 int effect_cumulative_min(enum effect_type type, struct universal *for_uni);
 
@@ -22,6 +22,7 @@
 #include "mem.h"
 #include "shared.h"
 #include "support.h"
+#include "workpool.h"
 
 /* aicore */
 #include "cm.h"
@@ -33,6 +34,7 @@
 #include "city.h"
 #include "connection.h"
 #include "disaster.h"
+#include "effects.h"
 #include "extras.h"
 #include "government.h"
 #include "idex.h"
@@ -59,6 +61,11 @@ struct world wld;
 
 bool am_i_server = FALSE;
 
+/* Helper threads of the 'citythreads' server setting, and how many of
+ * them there are. */
+static struct fc_workpool *helper_pool = NULL;
+static int helper_pool_threads = 0;
+
 static void game_defaults(bool keep_ruleset_value);
 
 /**********************************************************************//**
@@ -391,6 +398,7 @@ static void game_defaults(bool keep_ruleset_value)
     game.server.natural_city_names = GAME_DEFAULT_NATURALCITYNAMES;
     game.server.nuclear_winter_percent = GAME_DEFAULT_NUCLEAR_WINTER_PERCENT;
     game.server.plrcolormode      = GAME_DEFAULT_PLRCOLORMODE;
+    game.server.netbuffer         = GAME_DEFAULT_NETBUFFER;
     game.server.netwait           = GAME_DEFAULT_NETWAIT;
     game.server.occupychance      = GAME_DEFAULT_OCCUPYCHANCE;
     game.server.onsetbarbarian    = GAME_DEFAULT_ONSETBARBARIAN;
@@ -483,6 +491,40 @@ void game_free(void)
   cm_free();
 }
 
+/**********************************************************************//**
+  Return the pool of helper threads that the server splits big jobs
+  between, as set by the 'citythreads' setting, or NULL if there should be
+  none. Everything that uses helper threads shares this one pool. It is
+  only to be used from the main thread.
+**************************************************************************/
+struct fc_workpool *game_helper_pool(void)
+{
+  int threads = is_server() ? game.server.city_threads : 0;
+
+  if (helper_pool != NULL && helper_pool_threads != threads) {
+    game_helper_pool_free();
+  }
+
+  if (helper_pool == NULL && threads > 0) {
+    helper_pool = fc_workpool_new(threads);
+    helper_pool_threads = threads;
+  }
+
+  return helper_pool;
+}
+
+/**********************************************************************//**
+  Stop the helper threads.
+**************************************************************************/
+void game_helper_pool_free(void)
+{
+  if (helper_pool != NULL) {
+    fc_workpool_destroy(helper_pool);
+    helper_pool = NULL;
+    helper_pool_threads = 0;
+  }
+}
+
 /**********************************************************************//**
   Do all changes to change view, and not full
   game_free()/game_init().
@@ -690,6 +732,7 @@ void initialize_globals(void)
       } city_built_iterate_end;
     } city_list_iterate_end;
   } players_iterate_end;
+  effect_cache_changed(ECD_WONDERS);
 }
 
 /**********************************************************************//**
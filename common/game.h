@@ -161,7 +161,8 @@ struct civ_game {
       enum trait_dist_mode trait_dist;
       int min_players;
       bool natural_city_names;
-      int netwait;
+      int netbuffer;
+      int netwait;              /* Deprecated, has no effect */
       int num_phases;
       int occupychance;
       int onsetbarbarian;
@@ -172,6 +173,9 @@ struct civ_game {
       unsigned revealmap;
       int revolution_length;
       bool threaded_save;
+      bool binary_save;
+      bool forked_save;
+      int city_threads;
       int save_compress_level;
       enum fz_method save_compress_type;
       int save_nturns;
@@ -286,6 +290,12 @@ struct civ_game {
   struct {
     /* Function to be called in game_remove_unit when a unit is deleted. */
     void (*unit_deallocate)(int unit_id);
+    /* Functions to be called when the terrain, extras or city of a tile
+     * change, when a unit is put on a tile or changes type, and when the
+     * main map is freed. */
+    void (*tile_changed)(const struct tile *ptile);
+    void (*unit_changed)(const struct unit *punit);
+    void (*map_freed)(void);
   } callbacks;
 };
 
@@ -302,6 +312,10 @@ void game_map_init(void);
 void game_free(void);
 void game_reset(void);
 
+struct fc_workpool;
+struct fc_workpool *game_helper_pool(void);
+void game_helper_pool_free(void);
+
 void game_ruleset_init(void);
 void game_ruleset_free(void);
 
@@ -571,6 +585,10 @@ extern struct world wld;
 #define GAME_MIN_NETWAIT             0
 #define GAME_MAX_NETWAIT             20
 
+#define GAME_DEFAULT_NETBUFFER       4096     /* KiB */
+#define GAME_MIN_NETBUFFER           512
+#define GAME_MAX_NETBUFFER           262144
+
 #define GAME_DEFAULT_PINGTIME        20
 #define GAME_MIN_PINGTIME            1
 #define GAME_MAX_PINGTIME            1800
@@ -636,6 +654,12 @@ extern struct world wld;
 #endif /* FREECIV_WEB */
 
 #define GAME_DEFAULT_THREADED_SAVE   FALSE
+#define GAME_DEFAULT_BINARY_SAVE     FALSE
+#define GAME_DEFAULT_FORKED_SAVE     FALSE
+
+#define GAME_DEFAULT_CITY_THREADS    0
+#define GAME_MIN_CITY_THREADS        0
+#define GAME_MAX_CITY_THREADS        64
 
 #define GAME_DEFAULT_USER_META_MESSAGE ""
 
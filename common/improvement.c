@@ -24,6 +24,7 @@
 #include "support.h"
 
 /* common */
+#include "effects.h"
 #include "game.h"
 #include "map.h"
 #include "tech.h"
@@ -727,6 +728,7 @@ void wonder_built(const struct city *pcity, const struct impr_type *pimprove)
   if (is_great_wonder(pimprove)) {
     game.info.great_wonder_owners[windex] = player_number(pplayer);
   }
+  effect_cache_changed(ECD_WONDERS);
 }
 
 /**********************************************************************//**
@@ -751,6 +753,7 @@ void wonder_destroyed(const struct city *pcity,
                    == player_number(pplayer));
     game.info.great_wonder_owners[windex] = WONDER_DESTROYED;
   }
+  effect_cache_changed(ECD_WONDERS);
 }
 
 /**********************************************************************//**
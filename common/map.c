@@ -549,6 +549,9 @@ void map_free(struct civ_map *fmap)
 ***********************************************************************/
 void main_map_free(void)
 {
+  if (game.callbacks.map_freed) {
+    (game.callbacks.map_freed)();
+  }
   map_free(&(wld.map));
   CALL_FUNC_EACH_AI(map_free);
 }
@@ -21,6 +21,10 @@
   #include <wand/MagickWand.h>
 #endif /* HAVE_MAPIMG_MAGICKWAND */
 
+#ifdef FREECIV_HAVE_LIBZ
+#include <zlib.h>
+#endif /* FREECIV_HAVE_LIBZ */
+
 /* utility */
 #include "astring.h"
 #include "bitvector.h"
@@ -30,6 +34,7 @@
 #include "mem.h"
 #include "string_vector.h"
 #include "timing.h"
+#include "workpool.h"
 
 /* common */
 #include "calendar.h"
@@ -265,6 +270,8 @@ BV_DEFINE(bv_mapdef_arg, MAPDEF_COUNT);
 #define SPECENUM_VALUE0NAME "ppm"
 #define SPECENUM_VALUE1     IMGTOOL_MAGICKWAND
 #define SPECENUM_VALUE1NAME "magick"
+#define SPECENUM_VALUE2     IMGTOOL_PNG
+#define SPECENUM_VALUE2NAME "png"
 #include "specenum_gen.h"
 
 /* player definitions */
@@ -400,6 +407,9 @@ static void img_plot_tile(struct img *pimg, const struct tile *ptile,
 static bool img_save(const struct img *pimg, const char *mapimgfile,
                      const char *path);
 static bool img_save_ppm(const struct img *pimg, const char *mapimgfile);
+#ifdef FREECIV_HAVE_LIBZ
+static bool img_save_png(const struct img *pimg, const char *mapimgfile);
+#endif /* FREECIV_HAVE_LIBZ */
 #ifdef HAVE_MAPIMG_MAGICKWAND
 static bool img_save_magickwand(const struct img *pimg,
                                 const char *mapimgfile);
@@ -433,6 +443,11 @@ static struct toolkit img_toolkits[] = {
               img_save_magickwand,
               N_("ImageMagick"))
 #endif /* HAVE_MAPIMG_MAGICKWAND */
+#ifdef FREECIV_HAVE_LIBZ
+  GEN_TOOLKIT(IMGTOOL_PNG, IMGFORMAT_PNG, IMGFORMAT_PNG,
+              img_save_png,
+              N_("Built-in png files"))
+#endif /* FREECIV_HAVE_LIBZ */
 };
 
 static const int img_toolkits_count = ARRAY_SIZE(img_toolkits);
@@ -440,6 +455,9 @@ static const int img_toolkits_count = ARRAY_SIZE(img_toolkits);
 #ifdef HAVE_MAPIMG_MAGICKWAND
   #define MAPIMG_DEFAULT_IMGFORMAT IMGFORMAT_GIF
   #define MAPIMG_DEFAULT_IMGTOOL   IMGTOOL_MAGICKWAND
+#elif defined(FREECIV_HAVE_LIBZ)
+  #define MAPIMG_DEFAULT_IMGFORMAT IMGFORMAT_PNG
+  #define MAPIMG_DEFAULT_IMGTOOL   IMGTOOL_PNG
 #else
   #define MAPIMG_DEFAULT_IMGFORMAT IMGFORMAT_PPM
   #define MAPIMG_DEFAULT_IMGTOOL   IMGTOOL_PPM
@@ -2350,6 +2368,213 @@ static bool img_save_ppm(const struct img *pimg, const char *mapimgfile)
   return TRUE;
 }
 
+#ifdef FREECIV_HAVE_LIBZ
+/* Size of the compressed data written per IDAT chunk. */
+#define PNG_IDAT_SIZE 65536
+
+/************************************************************************//**
+  Store a 32 bit value in png (big endian) byte order.
+****************************************************************************/
+static void img_png_put32(unsigned char *buf, unsigned long value)
+{
+  buf[0] = (value >> 24) & 0xff;
+  buf[1] = (value >> 16) & 0xff;
+  buf[2] = (value >> 8) & 0xff;
+  buf[3] = value & 0xff;
+}
+
+/************************************************************************//**
+  Write one png chunk.
+****************************************************************************/
+static bool img_png_chunk(FILE *fp, const char *type,
+                          const unsigned char *data, size_t len)
+{
+  unsigned char buf[4];
+  uLong crc;
+
+  crc = crc32(0L, (const Bytef *) type, 4);
+  if (len > 0) {
+    crc = crc32(crc, data, len);
+  }
+
+  img_png_put32(buf, len);
+  fwrite(buf, 1, 4, fp);
+  fwrite(type, 1, 4, fp);
+  if (len > 0) {
+    fwrite(data, 1, len, fp);
+  }
+  img_png_put32(buf, crc);
+  fwrite(buf, 1, 4, fp);
+
+  return !ferror(fp);
+}
+
+/************************************************************************//**
+  Compress the pending input of the stream and write full IDAT chunks.
+  With Z_FINISH, also write the last, partial one.
+****************************************************************************/
+static bool img_png_deflate(FILE *fp, z_stream *stream, unsigned char *out,
+                            int flush)
+{
+  int ret;
+
+  do {
+    ret = deflate(stream, flush);
+    if (ret == Z_STREAM_ERROR) {
+      return FALSE;
+    }
+    if (stream->avail_out == 0
+        || (flush == Z_FINISH && stream->avail_out < PNG_IDAT_SIZE)) {
+      if (!img_png_chunk(fp, "IDAT", out,
+                         PNG_IDAT_SIZE - stream->avail_out)) {
+        return FALSE;
+      }
+      stream->next_out = out;
+      stream->avail_out = PNG_IDAT_SIZE;
+    }
+  } while (stream->avail_in > 0
+           || (flush == Z_FINISH && ret != Z_STREAM_END));
+
+  return TRUE;
+}
+
+/************************************************************************//**
+  Save an image as png file (toolkit: png). The rows are compressed with
+  zlib as they are generated, so the whole image is never held in memory.
+****************************************************************************/
+static bool img_save_png(const struct img *pimg, const char *mapimgfile)
+{
+  static const unsigned char signature[] = {
+    0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+  };
+  char pngname[MAX_LEN_PATH];
+  struct astring comment = ASTRING_INIT;
+  unsigned char header[13];
+  unsigned char *text, *row, *out;
+  z_stream stream;
+  FILE *fp;
+  int width = pimg->imgsize.x * pimg->def->zoom;
+  int height = pimg->imgsize.y * pimg->def->zoom;
+  int x, y, xxx, yyy;
+  bool ok = TRUE;
+
+  if (pimg->def->format != IMGFORMAT_PNG) {
+    MAPIMG_LOG(_("the png toolkit can only create images in the png "
+                 "format"));
+    return FALSE;
+  }
+
+  if (!img_filename(mapimgfile, IMGFORMAT_PNG, pngname, sizeof(pngname))) {
+    MAPIMG_LOG(_("error generating the file name"));
+    return FALSE;
+  }
+
+  fp = fopen(pngname, "wb");
+  if (!fp) {
+    MAPIMG_LOG(_("could not open file: %s"), pngname);
+    return FALSE;
+  }
+
+  fwrite(signature, 1, sizeof(signature), fp);
+
+  img_png_put32(header, width);
+  img_png_put32(header + 4, height);
+  header[8] = 8;    /* Bit depth */
+  header[9] = 2;    /* Color type: RGB */
+  header[10] = 0;   /* Compression method */
+  header[11] = 0;   /* Filter method */
+  header[12] = 0;   /* No interlace */
+  ok = img_png_chunk(fp, "IHDR", header, sizeof(header));
+
+  /* The same information as in the header of ppm files. */
+  astr_set(&comment, "version:2\nmap definition: %s\n", pimg->def->maparg);
+  if (pimg->def->colortest) {
+    astr_add(&comment, "color test\n");
+  } else if (BV_ISSET_ANY(pimg->def->player.checked_plrbv)) {
+    players_iterate(pplayer) {
+      if (BV_ISSET(pimg->def->player.checked_plrbv, player_index(pplayer))) {
+        astr_add(&comment, "%s\n", img_playerstr(pplayer));
+      }
+    } players_iterate_end;
+  } else {
+    astr_add(&comment, "no players\n");
+  }
+  /* The keyword and the text are separated by a '\0'. */
+  text = fc_malloc(sizeof("Comment") + astr_len(&comment));
+  memcpy(text, "Comment", sizeof("Comment"));
+  memcpy(text + sizeof("Comment"), astr_str(&comment), astr_len(&comment));
+  if (ok) {
+    ok = img_png_chunk(fp, "tEXt", text,
+                       sizeof("Comment") + astr_len(&comment));
+  }
+  free(text);
+  astr_free(&comment);
+
+  row = fc_malloc(1 + 3 * width);
+  out = fc_malloc(PNG_IDAT_SIZE);
+
+  memset(&stream, 0, sizeof(stream));
+  if (ok && deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+    MAPIMG_LOG(_("could not initialise the compression"));
+    ok = FALSE;
+  }
+  stream.next_out = out;
+  stream.avail_out = PNG_IDAT_SIZE;
+
+  /* y coordinate */
+  for (y = 0; ok && y < pimg->imgsize.y; y++) {
+    unsigned char *p = row;
+
+    *p++ = 0;   /* Filter type: none */
+    /* x coordinate */
+    for (x = 0; x < pimg->imgsize.x; x++) {
+      const struct rgbcolor *pcolor = pimg->map[img_index(x, y, pimg)];
+
+      if (pcolor == NULL) {
+        pcolor = imgcolor_special(IMGCOLOR_BACKGROUND);
+      }
+      /* zoom for x */
+      for (xxx = 0; xxx < pimg->def->zoom; xxx++) {
+        *p++ = pcolor->r;
+        *p++ = pcolor->g;
+        *p++ = pcolor->b;
+      }
+    }
+
+    /* zoom for y */
+    for (yyy = 0; ok && yyy < pimg->def->zoom; yyy++) {
+      stream.next_in = row;
+      stream.avail_in = 1 + 3 * width;
+      ok = img_png_deflate(fp, &stream, out, Z_NO_FLUSH);
+    }
+  }
+
+  if (ok) {
+    ok = img_png_deflate(fp, &stream, out, Z_FINISH);
+  }
+  deflateEnd(&stream);
+  free(out);
+  free(row);
+
+  if (ok) {
+    ok = img_png_chunk(fp, "IEND", NULL, 0);
+  }
+
+  if (fclose(fp) != 0) {
+    ok = FALSE;
+  }
+
+  if (!ok) {
+    MAPIMG_LOG(_("could not write file: %s"), pngname);
+    return FALSE;
+  }
+
+  log_verbose("Map image saved as '%s'.", pngname);
+
+  return TRUE;
+}
+#endif /* FREECIV_HAVE_LIBZ */
+
 /************************************************************************//**
   Generate the final filename.
 ****************************************************************************/
@@ -2380,113 +2605,226 @@ static const char *img_playerstr(const struct player *pplayer)
   return buf;
 }
 
+/* Tiles worked out by img_createmap() before it plots them. */
+#define IMG_RENDER_BATCH 16384
+/* Tiles given to a helper thread at a time. */
+#define IMG_RENDER_STRIPE 256
+/* Plots of one tile: terrain, area or border, city or unit, fog. */
+#define IMG_TILE_PLOTS 4
+
+/* What img_createmap() plots on one tile, in that order. */
+struct img_tile_plots {
+  int count;
+  struct {
+    const struct rgbcolor *pcolor;
+    bv_pixel pixel;
+  } plot[IMG_TILE_PLOTS];
+};
+
+/* One batch of tiles of img_createmap(). */
+struct img_render {
+  const struct img *pimg;
+  struct player *pplayer;       /* The one displayed player, or NULL */
+  int first;                    /* Tile index of plots[0] */
+  int count;
+  struct img_tile_plots *plots;
+};
+
 /************************************************************************//**
-  Create the map considering the options (terrain, player(s), cities,
-  units, borders, known, fogofwar, ...).
+  Add a plot to the ones of a tile. Plots without any pixel are dropped,
+  as img_plot() would not do anything for them.
 ****************************************************************************/
-static void img_createmap(struct img *pimg)
+static void img_tile_plots_add(struct img_tile_plots *plots,
+                               const struct rgbcolor *pcolor,
+                               const bv_pixel pixel)
+{
+  if (BV_ISSET_ANY(pixel)) {
+    fc_assert_ret(plots->count < IMG_TILE_PLOTS);
+    plots->plot[plots->count].pcolor = pcolor;
+    plots->plot[plots->count].pixel = pixel;
+    plots->count++;
+  }
+}
+
+/************************************************************************//**
+  Work out what to plot on the tile considering the options (terrain,
+  player(s), cities, units, borders, known, fogofwar, ...). This only
+  reads the game state, so it may run in a helper thread.
+****************************************************************************/
+static void img_tile_render(const struct img *pimg, const struct tile *ptile,
+                            struct player *pplayer,
+                            struct img_tile_plots *plots)
 {
   const struct rgbcolor *pcolor;
   bv_pixel pixel;
   int player_id;
-  struct player *pplayer = NULL;
   struct player *plr_tile = NULL, *plr_city = NULL, *plr_unit = NULL;
   enum known_type tile_knowledge = TILE_UNKNOWN;
   struct terrain *pterrain = NULL;
   bool plr_knowledge = pimg->def->layers[MAPIMG_LAYER_KNOWLEDGE];
 
-  whole_map_iterate(&(wld.map), ptile) {
-    if (bvplayers_count(pimg->def) == 1) {
-      /* only one player; get player id for 'known' and 'fogofwar' */
-      players_iterate(aplayer) {
-        if (BV_ISSET(pimg->def->player.checked_plrbv,
-                     player_index(aplayer))) {
-          pplayer = aplayer;
-          tile_knowledge = mapimg.mapimg_tile_known(ptile, pplayer,
-                                                    plr_knowledge);
-          break;
-        }
-      } players_iterate_end;
-    }
+  plots->count = 0;
 
-    /* known tiles */
-    if (plr_knowledge && pplayer != NULL && tile_knowledge == TILE_UNKNOWN) {
-      /* plot nothing iff tile is not known */
-      continue;
-    }
+  if (pplayer != NULL) {
+    /* only one player; get tile knowledge for 'known' and 'fogofwar' */
+    tile_knowledge = mapimg.mapimg_tile_known(ptile, pplayer,
+                                              plr_knowledge);
+  }
 
-    /* terrain */
-    pterrain = mapimg.mapimg_tile_terrain(ptile, pplayer, plr_knowledge);
-    if (pimg->def->layers[MAPIMG_LAYER_TERRAIN]) {
-      /* full terrain */
-      pixel = pimg->pixel_tile(ptile, pplayer, plr_knowledge);
-      pcolor = imgcolor_terrain(pterrain);
-      img_plot_tile(pimg, ptile, pcolor, pixel);
+  /* known tiles */
+  if (plr_knowledge && pplayer != NULL && tile_knowledge == TILE_UNKNOWN) {
+    /* plot nothing iff tile is not known */
+    return;
+  }
+
+  /* terrain */
+  pterrain = mapimg.mapimg_tile_terrain(ptile, pplayer, plr_knowledge);
+  if (pimg->def->layers[MAPIMG_LAYER_TERRAIN]) {
+    /* full terrain */
+    pixel = pimg->pixel_tile(ptile, pplayer, plr_knowledge);
+    pcolor = imgcolor_terrain(pterrain);
+    img_tile_plots_add(plots, pcolor, pixel);
+  } else {
+    /* basic terrain */
+    pixel = pimg->pixel_tile(ptile, pplayer, plr_knowledge);
+    if (is_ocean(pterrain)) {
+      img_tile_plots_add(plots, imgcolor_special(IMGCOLOR_OCEAN), pixel);
     } else {
-      /* basic terrain */
+      img_tile_plots_add(plots, imgcolor_special(IMGCOLOR_GROUND), pixel);
+    }
+  }
+
+  /* (land) area within borders and borders */
+  plr_tile = mapimg.mapimg_tile_owner(ptile, pplayer, plr_knowledge);
+  if (game.info.borders > 0 && NULL != plr_tile) {
+    player_id = player_index(plr_tile);
+    if (pimg->def->layers[MAPIMG_LAYER_AREA] && !is_ocean(pterrain)
+        && BV_ISSET(pimg->def->player.checked_plrbv, player_id)) {
+      /* the tile is land and inside the players borders */
       pixel = pimg->pixel_tile(ptile, pplayer, plr_knowledge);
-      if (is_ocean(pterrain)) {
-        img_plot_tile(pimg, ptile, imgcolor_special(IMGCOLOR_OCEAN), pixel);
-      } else {
-        img_plot_tile(pimg, ptile, imgcolor_special(IMGCOLOR_GROUND), pixel);
-      }
+      pcolor = imgcolor_player(player_id);
+      img_tile_plots_add(plots, pcolor, pixel);
+    } else if (pimg->def->layers[MAPIMG_LAYER_BORDERS]
+               && (BV_ISSET(pimg->def->player.checked_plrbv, player_id)
+                   || (plr_knowledge && pplayer != NULL))) {
+      /* plot borders if player is selected or view range of the one
+       * displayed player */
+      pixel = pimg->pixel_border(ptile, pplayer, plr_knowledge);
+      pcolor = imgcolor_player(player_id);
+      img_tile_plots_add(plots, pcolor, pixel);
     }
+  }
 
-    /* (land) area within borders and borders */
-    plr_tile = mapimg.mapimg_tile_owner(ptile, pplayer, plr_knowledge);
-    if (game.info.borders > 0 && NULL != plr_tile) {
-      player_id = player_index(plr_tile);
-      if (pimg->def->layers[MAPIMG_LAYER_AREA] && !is_ocean(pterrain)
-          && BV_ISSET(pimg->def->player.checked_plrbv, player_id)) {
-        /* the tile is land and inside the players borders */
-        pixel = pimg->pixel_tile(ptile, pplayer, plr_knowledge);
-        pcolor = imgcolor_player(player_id);
-        img_plot_tile(pimg, ptile, pcolor, pixel);
-      } else if (pimg->def->layers[MAPIMG_LAYER_BORDERS]
-                 && (BV_ISSET(pimg->def->player.checked_plrbv, player_id)
-                     || (plr_knowledge && pplayer != NULL))) {
-        /* plot borders if player is selected or view range of the one
-         * displayed player */
-        pixel = pimg->pixel_border(ptile, pplayer, plr_knowledge);
-        pcolor = imgcolor_player(player_id);
-        img_plot_tile(pimg, ptile, pcolor, pixel);
-      }
+  /* cities and units */
+  plr_city = mapimg.mapimg_tile_city(ptile, pplayer, plr_knowledge);
+  plr_unit = mapimg.mapimg_tile_unit(ptile, pplayer, plr_knowledge);
+  if (pimg->def->layers[MAPIMG_LAYER_CITIES] && plr_city) {
+    player_id = player_index(plr_city);
+    if (BV_ISSET(pimg->def->player.checked_plrbv, player_id)
+        || (plr_knowledge && pplayer != NULL)) {
+      /* plot cities if player is selected or view range of the one
+       * displayed player */
+      pixel = pimg->pixel_city(ptile, pplayer, plr_knowledge);
+      pcolor = imgcolor_player(player_id);
+      img_tile_plots_add(plots, pcolor, pixel);
+    }
+  } else if (pimg->def->layers[MAPIMG_LAYER_UNITS] && plr_unit) {
+    player_id = player_index(plr_unit);
+    if (BV_ISSET(pimg->def->player.checked_plrbv, player_id)
+        || (plr_knowledge && pplayer != NULL)) {
+      /* plot units if player is selected or view range of the one
+       * displayed player */
+      pixel = pimg->pixel_unit(ptile, pplayer, plr_knowledge);
+      pcolor = imgcolor_player(player_id);
+      img_tile_plots_add(plots, pcolor, pixel);
     }
+  }
+
+  /* fogofwar; if only 1 player is plotted */
+  if (game.info.fogofwar && pimg->def->layers[MAPIMG_LAYER_FOGOFWAR]
+      && pplayer != NULL
+      && tile_knowledge == TILE_KNOWN_UNSEEN) {
+    pixel = pimg->pixel_fogofwar(ptile, pplayer, plr_knowledge);
+    pcolor = NULL;
+    img_tile_plots_add(plots, pcolor, pixel);
+  }
+}
+
+/************************************************************************//**
+  Work out the plots of one stripe of tiles of the batch.
+****************************************************************************/
+static void img_render_work(int index, void *data)
+{
+  struct img_render *render = (struct img_render *) data;
+  int i = index * IMG_RENDER_STRIPE;
+  int end = MIN(i + IMG_RENDER_STRIPE, render->count);
+
+  for (; i < end; i++) {
+    img_tile_render(render->pimg,
+                    index_to_tile(&(wld.map), render->first + i),
+                    render->pplayer, &render->plots[i]);
+  }
+}
 
-    /* cities and units */
-    plr_city = mapimg.mapimg_tile_city(ptile, pplayer, plr_knowledge);
-    plr_unit = mapimg.mapimg_tile_unit(ptile, pplayer, plr_knowledge);
-    if (pimg->def->layers[MAPIMG_LAYER_CITIES] && plr_city) {
-      player_id = player_index(plr_city);
-      if (BV_ISSET(pimg->def->player.checked_plrbv, player_id)
-          || (plr_knowledge && pplayer != NULL)) {
-        /* plot cities if player is selected or view range of the one
-         * displayed player */
-        pixel = pimg->pixel_city(ptile, pplayer, plr_knowledge);
-        pcolor = imgcolor_player(player_id);
-        img_plot_tile(pimg, ptile, pcolor, pixel);
+/************************************************************************//**
+  Create the map considering the options (terrain, player(s), cities,
+  units, borders, known, fogofwar, ...).
+
+  The tiles are done in batches. What to plot on each tile of a batch is
+  worked out in stripes by the helper threads, if there are any; then the
+  plots are drawn in the order of the tiles, so that overlapping pixels
+  always end up the same.
+****************************************************************************/
+static void img_createmap(struct img *pimg)
+{
+  struct fc_workpool *pool = game_helper_pool();
+  struct img_render render;
+  int i, j;
+
+  render.pimg = pimg;
+  render.pplayer = NULL;
+  render.plots = fc_malloc(MIN(IMG_RENDER_BATCH, MAP_INDEX_SIZE)
+                           * sizeof(*render.plots));
+
+  if (bvplayers_count(pimg->def) == 1) {
+    /* only one player; get player id for 'known' and 'fogofwar' */
+    players_iterate(aplayer) {
+      if (BV_ISSET(pimg->def->player.checked_plrbv,
+                   player_index(aplayer))) {
+        render.pplayer = aplayer;
+        break;
       }
-    } else if (pimg->def->layers[MAPIMG_LAYER_UNITS] && plr_unit) {
-      player_id = player_index(plr_unit);
-      if (BV_ISSET(pimg->def->player.checked_plrbv, player_id)
-          || (plr_knowledge && pplayer != NULL)) {
-        /* plot units if player is selected or view range of the one
-         * displayed player */
-        pixel = pimg->pixel_unit(ptile, pplayer, plr_knowledge);
-        pcolor = imgcolor_player(player_id);
-        img_plot_tile(pimg, ptile, pcolor, pixel);
+    } players_iterate_end;
+  }
+
+  for (render.first = 0; render.first < MAP_INDEX_SIZE;
+       render.first += IMG_RENDER_BATCH) {
+    int stripes;
+
+    render.count = MIN(IMG_RENDER_BATCH, MAP_INDEX_SIZE - render.first);
+    stripes = (render.count + IMG_RENDER_STRIPE - 1) / IMG_RENDER_STRIPE;
+
+    if (pool != NULL) {
+      fc_workpool_run(pool, stripes, img_render_work, &render);
+    } else {
+      for (i = 0; i < stripes; i++) {
+        img_render_work(i, &render);
       }
     }
 
-    /* fogofwar; if only 1 player is plotted */
-    if (game.info.fogofwar && pimg->def->layers[MAPIMG_LAYER_FOGOFWAR]
-        && pplayer != NULL
-        && tile_knowledge == TILE_KNOWN_UNSEEN) {
-      pixel = pimg->pixel_fogofwar(ptile, pplayer, plr_knowledge);
-      pcolor = NULL;
-      img_plot_tile(pimg, ptile, pcolor, pixel);
+    for (i = 0; i < render.count; i++) {
+      const struct img_tile_plots *plots = &render.plots[i];
+      const struct tile *ptile = index_to_tile(&(wld.map),
+                                               render.first + i);
+
+      for (j = 0; j < plots->count; j++) {
+        img_plot_tile(pimg, ptile, plots->plot[j].pcolor,
+                      plots->plot[j].pixel);
+      }
     }
-  } whole_map_iterate_end;
+  }
+
+  free(render.plots);
 }
 
 /*
@@ -33,19 +33,36 @@
 #endif
 
 /* utility */
+#include "capability.h"
 #include "fcintl.h"
 #include "genhash.h"
 #include "log.h"
 #include "mem.h"
 #include "netintf.h"
+#include "netpoll.h"
 #include "support.h"            /* fc_str(n)casecmp */
 
 /* common */
+#include "capstr.h"
 #include "game.h"               /* game.all_connections */
 #include "packets.h"
 
 #include "connection.h"
 
+#ifdef USE_COMPRESSION
+#include <zlib.h>
+#endif
+
+
+/* Size of one chunk of a send queue. */
+#define SEND_CHUNK_SIZE (4 * MAX_LEN_PACKET)
+
+struct send_chunk {
+  struct send_chunk *next;
+  int start;                    /* First byte not written yet */
+  int end;                      /* First byte not filled yet */
+  unsigned char data[SEND_CHUNK_SIZE];
+};
 
 static void default_conn_close_callback(struct connection *pconn);
 
@@ -157,63 +174,101 @@ int read_socket_data(int sock, struct socket_packet_buffer *buffer)
 }
 
 /**********************************************************************//**
-  write wrapper function -vasc
+  Maximum number of bytes that may wait in the send queue of a connection.
+**************************************************************************/
+static int send_queue_limit(void)
+{
+  if (is_server()) {
+    return game.server.netbuffer * 1024;
+  }
+
+  return MAX_LEN_BUFFER;
+}
+
+/**********************************************************************//**
+  Returns whether writing to the sockets of connections may block. Only
+  the sockets the server accepts are made non-blocking; the client writes
+  to a blocking socket.
+**************************************************************************/
+static bool send_may_block(void)
+{
+#ifdef NONBLOCKING_SOCKETS
+  return !is_server();
+#else
+  return TRUE;
+#endif /* NONBLOCKING_SOCKETS */
+}
+
+/**********************************************************************//**
+  Write queued data to the socket, until no more than 'limit' bytes are
+  left or the socket doesn't accept more without blocking.
 **************************************************************************/
 static int write_socket_data(struct connection *pc,
-			     struct socket_packet_buffer *buf, int limit)
+                             struct socket_send_queue *queue, int limit)
 {
-  int start, nput, nblock;
+  bool may_block = send_may_block();
+  int written = 0;
 
   if (is_server() && pc->server.is_closing) {
     return 0;
   }
 
-  for (start=0; buf->ndata-start>limit;) {
-    fd_set writefs, exceptfs;
-    fc_timeval tv;
+  while (queue->ndata > limit) {
+    struct send_chunk *chunk = queue->head;
+    int nblock = chunk->end - chunk->start;
+    int nput;
 
-    FC_FD_ZERO(&writefs);
-    FC_FD_ZERO(&exceptfs);
-    FD_SET(pc->sock, &writefs);
-    FD_SET(pc->sock, &exceptfs);
+    if (may_block) {
+      /* Only write when the socket is ready, and no more than a packet
+       * at a time, so as not to wait for the other end. */
+      struct fc_pollsock psock;
 
-    tv.tv_sec = 0; tv.tv_usec = 0;
+      psock.sock = pc->sock;
+      psock.events = FC_POLL_OUT;
 
-    if (fc_select(pc->sock+1, NULL, &writefs, &exceptfs, &tv) <= 0) {
-      if (errno != EINTR) {
-	break;
-      } else {
-	/* EINTR can happen sometimes, especially when compiling with -pg.
-	 * Generally we just want to run select again. */
-	continue;
+      if (fc_poll_sockets(&psock, 1, 0) <= 0) {
+        break;
+      }
+      if (psock.revents & FC_POLL_ERR) {
+        connection_close(pc, _("network exception"));
+        return -1;
       }
+      nblock = MIN(nblock, MAX_LEN_PACKET);
     }
 
-    if (FD_ISSET(pc->sock, &exceptfs)) {
-      connection_close(pc, _("network exception"));
+    log_debug("trying to write %d limit=%d", nblock, limit);
+    nput = fc_writesocket(pc->sock, chunk->data + chunk->start, nblock);
+    if (nput == -1) {
+#ifdef NONBLOCKING_SOCKETS
+      if (errno == EWOULDBLOCK || errno == EAGAIN) {
+        break;
+      }
+#endif /* NONBLOCKING_SOCKETS */
+      connection_close(pc, _("lagging connection"));
       return -1;
     }
 
-    if (FD_ISSET(pc->sock, &writefs)) {
-      nblock=MIN(buf->ndata-start, MAX_LEN_PACKET);
-      log_debug("trying to write %d limit=%d", nblock, limit);
-      if ((nput = fc_writesocket(pc->sock, 
-                                 (const char *)buf->data+start, nblock)) == -1) {
-#ifdef NONBLOCKING_SOCKETS
-	if (errno == EWOULDBLOCK || errno == EAGAIN) {
-	  break;
-	}
-#endif
-        connection_close(pc, _("lagging connection"));
-        return -1;
+    chunk->start += nput;
+    queue->ndata -= nput;
+    written += nput;
+
+    if (chunk->start == chunk->end) {
+      if (chunk->next != NULL) {
+        queue->head = chunk->next;
+        queue->nsize -= sizeof(*chunk);
+        free(chunk);
+      } else {
+        /* Keep the last chunk around for the next data. */
+        chunk->start = chunk->end = 0;
       }
-      start += nput;
+    }
+    if (nput < nblock) {
+      /* The socket is full. */
+      break;
     }
   }
 
-  if (start > 0) {
-    buf->ndata -= start;
-    memmove(buf->data, buf->data+start, buf->ndata);
+  if (written > 0) {
     pc->last_write = timer_renew(pc->last_write, TIMER_USER, TIMER_ACTIVE);
     timer_start(pc->last_write);
   }
@@ -257,7 +312,7 @@ static void flush_connection_send_buffer_packets(struct connection *pc)
 static bool add_connection_data(struct connection *pconn,
                                 const unsigned char *data, int len)
 {
-  struct socket_packet_buffer *buf;
+  struct socket_send_queue *queue;
 
   if (NULL == pconn
       || !pconn->used
@@ -265,15 +320,42 @@ static bool add_connection_data(struct connection *pconn,
     return TRUE;
   }
 
-  buf = pconn->send_buffer;
-  log_debug("add %d bytes to %d (space =%d)", len, buf->ndata, buf->nsize);
-  if (!buffer_ensure_free_extra_space(buf, len)) {
+  queue = pconn->send_buffer;
+  log_debug("add %d bytes to %d (space =%d)", len, queue->ndata,
+            queue->nsize);
+  if (queue->ndata + len > send_queue_limit()) {
     connection_close(pconn, _("buffer overflow"));
     return FALSE;
   }
 
-  memcpy(buf->data + buf->ndata, data, len);
-  buf->ndata += len;
+  if (queue->ndata == 0) {
+    /* Waiting for the socket starts now. */
+    pconn->last_write = timer_renew(pconn->last_write, TIMER_USER,
+                                    TIMER_ACTIVE);
+    timer_start(pconn->last_write);
+  }
+
+  while (len > 0) {
+    struct send_chunk *chunk = queue->tail;
+    int ncopy = MIN(len, SEND_CHUNK_SIZE - chunk->end);
+
+    if (ncopy == 0) {
+      chunk = fc_malloc(sizeof(*chunk));
+      chunk->next = NULL;
+      chunk->start = chunk->end = 0;
+      queue->tail->next = chunk;
+      queue->tail = chunk;
+      queue->nsize += sizeof(*chunk);
+      continue;
+    }
+
+    memcpy(chunk->data + chunk->end, data, ncopy);
+    chunk->end += ncopy;
+    queue->ndata += ncopy;
+    data += ncopy;
+    len -= ncopy;
+  }
+
   return TRUE;
 }
 
@@ -452,6 +534,40 @@ static void free_socket_packet_buffer(struct socket_packet_buffer *buf)
   }
 }
 
+/**********************************************************************//**
+  Return malloced send queue, with one empty chunk.
+**************************************************************************/
+static struct socket_send_queue *new_socket_send_queue(void)
+{
+  struct socket_send_queue *queue = fc_malloc(sizeof(*queue));
+
+  queue->ndata = 0;
+  queue->do_buffer_sends = 0;
+  queue->head = fc_malloc(sizeof(*queue->head));
+  queue->head->next = NULL;
+  queue->head->start = queue->head->end = 0;
+  queue->tail = queue->head;
+  queue->nsize = sizeof(*queue->head);
+
+  return queue;
+}
+
+/**********************************************************************//**
+  Free send queue and all the data still in it.
+**************************************************************************/
+static void free_socket_send_queue(struct socket_send_queue *queue)
+{
+  if (queue) {
+    while (queue->head != NULL) {
+      struct send_chunk *chunk = queue->head;
+
+      queue->head = chunk->next;
+      free(chunk);
+    }
+    free(queue);
+  }
+}
+
 /**********************************************************************//**
   Return pointer to static string containing a description for this
   connection, based on pconn->name, pconn->addr, and (if applicable)
@@ -531,8 +647,25 @@ int get_next_request_id(int old_request_id)
 void free_compression_queue(struct connection *pc)
 {
 #ifdef USE_COMPRESSION
+  log_verbose("%s: compressed %lu bytes into %lu; %lu bytes sent alone, "
+              "%lu queued bytes sent uncompressed", conn_description(pc),
+              pc->compression.stats.uncompressed,
+              pc->compression.stats.compressed,
+              pc->compression.stats.alone,
+              pc->compression.stats.no_compression);
+
   byte_vector_free(&pc->compression.queue);
-#endif
+  if (NULL != pc->compression.deflater) {
+    deflateEnd(pc->compression.deflater);
+    free(pc->compression.deflater);
+    pc->compression.deflater = NULL;
+  }
+  if (NULL != pc->compression.inflater) {
+    inflateEnd(pc->compression.inflater);
+    free(pc->compression.inflater);
+    pc->compression.inflater = NULL;
+  }
+#endif /* USE_COMPRESSION */
 }
 
 /**********************************************************************//**
@@ -592,7 +725,7 @@ void connection_common_init(struct connection *pconn)
   pconn->closing_reason = NULL;
   pconn->last_write = NULL;
   pconn->buffer = new_socket_packet_buffer();
-  pconn->send_buffer = new_socket_packet_buffer();
+  pconn->send_buffer = new_socket_send_queue();
   pconn->statistics.bytes_send = 0;
 #ifdef FREECIV_JSON_CONNECTION
   pconn->json_mode = TRUE;
@@ -603,7 +736,11 @@ void connection_common_init(struct connection *pconn)
 #ifdef USE_COMPRESSION
   byte_vector_init(&pconn->compression.queue);
   pconn->compression.frozen_level = 0;
-#endif
+  pconn->compression.stream = FALSE;
+  pconn->compression.deflater = NULL;
+  pconn->compression.inflater = NULL;
+  memset(&pconn->compression.stats, 0, sizeof(pconn->compression.stats));
+#endif /* USE_COMPRESSION */
 }
 
 /**********************************************************************//**
@@ -617,6 +754,7 @@ void connection_common_close(struct connection *pconn)
     fc_closesocket(pconn->sock);
     pconn->used = FALSE;
     pconn->established = FALSE;
+    free_compression_queue(pconn);
     if (NULL != pconn->closing_reason) {
       free(pconn->closing_reason);
     }
@@ -624,7 +762,7 @@ void connection_common_close(struct connection *pconn)
     free_socket_packet_buffer(pconn->buffer);
     pconn->buffer = NULL;
 
-    free_socket_packet_buffer(pconn->send_buffer);
+    free_socket_send_queue(pconn->send_buffer);
     pconn->send_buffer = NULL;
 
     if (pconn->last_write) {
@@ -632,7 +770,6 @@ void connection_common_close(struct connection *pconn)
       pconn->last_write = NULL;
     }
 
-    free_compression_queue(pconn);
     free_packet_hashes(pconn);
   }
 }
@@ -645,6 +782,11 @@ void conn_set_capability(struct connection *pconn, const char *capability)
   fc_assert(strlen(capability) < sizeof(pconn->capability));
   sz_strlcpy(pconn->capability, capability);
   pconn->phs.handlers = packet_handlers_get(capability);
+#ifdef USE_COMPRESSION
+  pconn->compression.stream = (has_capability("StreamCompress", capability)
+                               && has_capability("StreamCompress",
+                                                 our_capability));
+#endif /* USE_COMPRESSION */
 }
 
 /**********************************************************************//**
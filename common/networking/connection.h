@@ -125,6 +125,21 @@ struct socket_packet_buffer {
   unsigned char *data;
 };
 
+/***********************************************************
+  This is where outgoing data waits until the socket accepts
+  it. It is kept in chunks, so writing only a part of it
+  never moves the rest around.
+***********************************************************/
+struct send_chunk;
+
+struct socket_send_queue {
+  int ndata;                    /* Bytes waiting to be written */
+  int do_buffer_sends;
+  int nsize;                    /* Bytes allocated */
+  struct send_chunk *head;      /* Chunk to write from */
+  struct send_chunk *tail;      /* Chunk to append to */
+};
+
 struct packet_header {
   unsigned int length : 4;      /* Actually 'enum data_type' */
   unsigned int type : 4;        /* Actually 'enum data_type' */
@@ -156,7 +171,7 @@ struct connection {
   struct player *playing;
 
   struct socket_packet_buffer *buffer;
-  struct socket_packet_buffer *send_buffer;
+  struct socket_send_queue *send_buffer;
   struct timer *last_write;
 #ifdef FREECIV_JSON_CONNECTION
   bool json_mode;
@@ -272,6 +287,19 @@ struct connection {
     int frozen_level;
 
     struct byte_vector queue;
+
+    /* Both ends support persistent compression streams. The streams
+     * get created when first used. */
+    bool stream;
+    struct z_stream_s *deflater;
+    struct z_stream_s *inflater;
+
+    struct {
+      unsigned long alone;          /* Bytes sent without queueing */
+      unsigned long uncompressed;   /* Queued bytes sent compressed... */
+      unsigned long compressed;     /* ...and their compressed size */
+      unsigned long no_compression; /* Queued bytes sent as they are */
+    } stats;
   } compression;
 #endif
   struct {
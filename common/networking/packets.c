@@ -86,11 +86,6 @@ extern const char *const packet_functional_capability;
 static struct packet_handler_hash *packet_handlers = NULL;
 
 #ifdef USE_COMPRESSION
-static int stat_size_alone = 0;
-static int stat_size_uncompressed = 0;
-static int stat_size_compressed = 0;
-static int stat_size_no_compression = 0;
-
 /**********************************************************************//**
   Returns the compression level. Initilialize it if needed.
 **************************************************************************/
@@ -109,40 +104,118 @@ static inline int get_compression_level(void)
   return level;
 }
 
+/**********************************************************************//**
+  Compress the waiting data with the persistent compression stream of the
+  connection. The output is flushed so that the other end can decompress
+  it right away, but the stream keeps its history; the data repeated from
+  earlier bursts thus compresses much better than with a fresh dictionary.
+  Returns malloced compressed data, or NULL on failure.
+**************************************************************************/
+static Bytef *conn_compression_deflate(struct connection *pconn, int level,
+                                       uLongf *compressed_size)
+{
+  z_stream *zs = pconn->compression.deflater;
+  uLongf nsize;
+  Bytef *compressed;
+
+  if (NULL == zs) {
+    /* Default window and memory level: the state takes about 256 kB. */
+    zs = fc_calloc(1, sizeof(*zs));
+    if (Z_OK != deflateInit(zs, level)) {
+      log_error("Failed to init compression stream for %s.",
+                conn_description(pconn));
+      free(zs);
+      return NULL;
+    }
+    pconn->compression.deflater = zs;
+  }
+
+  zs->next_in = pconn->compression.queue.p;
+  zs->avail_in = pconn->compression.queue.size;
+  /* Room for a flush marker on top of the bound. */
+  nsize = deflateBound(zs, zs->avail_in) + 16;
+  compressed = fc_malloc(nsize);
+  *compressed_size = 0;
+
+  do {
+    int error;
+
+    if (*compressed_size == nsize) {
+      nsize *= 2;
+      compressed = fc_realloc(compressed, nsize);
+    }
+    zs->next_out = compressed + *compressed_size;
+    zs->avail_out = nsize - *compressed_size;
+    error = deflate(zs, Z_SYNC_FLUSH);
+    if (Z_OK != error && Z_BUF_ERROR != error) {
+      log_error("Compression for %s failed: %d.",
+                conn_description(pconn), error);
+      free(compressed);
+      return NULL;
+    }
+    *compressed_size = nsize - zs->avail_out;
+  } while (0 == zs->avail_out);
+
+  return compressed;
+}
+
 /**********************************************************************//**
   Send all waiting data. Return TRUE on success.
 **************************************************************************/
 static bool conn_compression_flush(struct connection *pconn)
 {
   int compression_level = get_compression_level();
-  uLongf compressed_size = 12 + 1.001 * pconn->compression.queue.size;
-  int error;
-  Bytef compressed[compressed_size];
+  uLongf compressed_size;
+  Bytef *compressed;
   bool jumbo;
   unsigned long compressed_packet_len;
 
-  error = compress2(compressed, &compressed_size,
-                    pconn->compression.queue.p,
-                    pconn->compression.queue.size,
-                    compression_level);
-  fc_assert_ret_val(error == Z_OK, FALSE);
+  if (0 == pconn->compression.queue.size) {
+    return pconn->used;
+  }
+
+  if (pconn->compression.stream) {
+    compressed = conn_compression_deflate(pconn, compression_level,
+                                          &compressed_size);
+    fc_assert_ret_val(NULL != compressed, FALSE);
+  } else {
+    int error;
+
+    compressed_size = compressBound(pconn->compression.queue.size);
+    compressed = fc_malloc(compressed_size);
+    error = compress2(compressed, &compressed_size,
+                      pconn->compression.queue.p,
+                      pconn->compression.queue.size,
+                      compression_level);
+    if (error != Z_OK) {
+      free(compressed);
+      fc_assert_ret_val(error == Z_OK, FALSE);
+    }
+  }
 
   /* Compression signalling currently assumes a 2-byte packet length; if that
    * changes, the protocol should probably be changed */
-  fc_assert_ret_val(data_type_size(pconn->packet_header.length) == 2, FALSE);
+  if (data_type_size(pconn->packet_header.length) != 2) {
+    free(compressed);
+    fc_assert_ret_val(data_type_size(pconn->packet_header.length) == 2,
+                      FALSE);
+  }
 
   /* Include normal length field in decision */
   jumbo = (compressed_size+2 >= JUMBO_BORDER);
 
   compressed_packet_len = compressed_size + (jumbo ? 6 : 2);
-  if (compressed_packet_len < pconn->compression.queue.size) {
+  /* What went into the stream must be sent, or the other end would lose
+   * track of it. */
+  if (pconn->compression.stream
+      || compressed_packet_len < pconn->compression.queue.size) {
     struct raw_data_out dout;
 
     log_compress("COMPRESS: compressed %lu bytes to %ld (level %d)",
                  (unsigned long) pconn->compression.queue.size,
                  compressed_size, compression_level);
-    stat_size_uncompressed += pconn->compression.queue.size;
-    stat_size_compressed += compressed_size;
+    pconn->compression.stats.uncompressed += pconn->compression.queue.size;
+    pconn->compression.stats.compressed += compressed_packet_len;
 
     if (!jumbo) {
       unsigned char header[2];
@@ -174,10 +247,63 @@ static bool conn_compression_flush(struct connection *pconn)
                  compressed_packet_len);
     connection_send_data(pconn, pconn->compression.queue.p,
                          pconn->compression.queue.size);
-    stat_size_no_compression += pconn->compression.queue.size;
+    pconn->compression.stats.no_compression += pconn->compression.queue.size;
   }
+  free(compressed);
+
   return pconn->used;
 }
+
+/**********************************************************************//**
+  Decompress a packet received from the persistent compression stream of
+  the other end. Returns malloced data, or NULL on failure.
+**************************************************************************/
+static void *conn_compression_inflate(struct connection *pconn,
+                                      void *data, uLong size,
+                                      unsigned long int *decompressed_size)
+{
+  z_stream *zs = pconn->compression.inflater;
+  unsigned long int nsize = 4 * size + MAX_LEN_PACKET;
+  Bytef *decompressed;
+
+  if (NULL == zs) {
+    zs = fc_calloc(1, sizeof(*zs));
+    if (Z_OK != inflateInit(zs)) {
+      free(zs);
+      return NULL;
+    }
+    pconn->compression.inflater = zs;
+  }
+
+  zs->next_in = data;
+  zs->avail_in = size;
+  decompressed = fc_malloc(nsize);
+  *decompressed_size = 0;
+
+  do {
+    int error;
+
+    if (*decompressed_size == nsize) {
+      if (nsize >= MAX_LEN_BUFFER) {
+        /* The other end never queues this much. */
+        free(decompressed);
+        return NULL;
+      }
+      nsize *= 2;
+      decompressed = fc_realloc(decompressed, nsize);
+    }
+    zs->next_out = decompressed + *decompressed_size;
+    zs->avail_out = nsize - *decompressed_size;
+    error = inflate(zs, Z_SYNC_FLUSH);
+    if (Z_OK != error && Z_BUF_ERROR != error) {
+      free(decompressed);
+      return NULL;
+    }
+    *decompressed_size = nsize - zs->avail_out;
+  } while (0 < zs->avail_in || 0 == zs->avail_out);
+
+  return decompressed;
+}
 #endif /* USE_COMPRESSION */
 
 /**********************************************************************//**
@@ -260,16 +386,18 @@ int send_packet_data(struct connection *pc, unsigned char *data, int len,
       log_compress2("COMPRESS: putting %s into the queue",
                     packet_name(packet_type));
     } else {
-      stat_size_alone += size;
-      log_compress("COMPRESS: sending %s alone (%d bytes total)",
-                   packet_name(packet_type), stat_size_alone);
+      pc->compression.stats.alone += size;
+      log_compress("COMPRESS: sending %s alone (%lu bytes total)",
+                   packet_name(packet_type), pc->compression.stats.alone);
       connection_send_data(pc, data, len);
     }
 
-    log_compress2("COMPRESS: STATS: alone=%d compression-expand=%d "
-                  "compression (before/after) = %d/%d",
-                  stat_size_alone, stat_size_no_compression,
-                  stat_size_uncompressed, stat_size_compressed);
+    log_compress2("COMPRESS: STATS: alone=%lu compression-expand=%lu "
+                  "compression (before/after) = %lu/%lu",
+                  pc->compression.stats.alone,
+                  pc->compression.stats.no_compression,
+                  pc->compression.stats.uncompressed,
+                  pc->compression.stats.compressed);
   }
 #else  /* USE_COMPRESSION */
   connection_send_data(pc, data, len);
@@ -440,9 +568,24 @@ void *get_packet_from_connection_raw(struct connection *pc,
     unsigned long int decompressed_size = decompress_factor * compressed_size;
     int error = Z_DATA_ERROR;
     struct socket_packet_buffer *buffer = pc->buffer;
-    void *decompressed = fc_malloc(decompressed_size);
+    void *decompressed;
+
+    if (pc->compression.stream) {
+      decompressed =
+        conn_compression_inflate(pc, ADD_TO_POINTER(buffer->data, header_size),
+                                 compressed_size, &decompressed_size);
+      if (NULL == decompressed) {
+        log_verbose("Uncompressing of the packet stream failed. "
+                    "The connection will be closed now.");
+        connection_close(pc, _("decoding error"));
+        return NULL;
+      }
+      error = Z_OK;
+    } else {
+      decompressed = fc_malloc(decompressed_size);
+    }
 
-    do {
+    while (error != Z_OK) {
       error =
         uncompress(decompressed, &decompressed_size,
                    ADD_TO_POINTER(buffer->data, header_size),
@@ -462,8 +605,7 @@ void *get_packet_from_connection_raw(struct connection *pc,
           return NULL;
         }
       }
-
-    } while (error != Z_OK);
+    }
 
     buffer->ndata -= whole_packet_len;
     /* 
@@ -310,6 +310,13 @@ struct player {
 
       struct player_tile *private_map;
 
+      /* How many vision sources of the player, and of players sharing
+       * vision with them, see each tile; own_seen only counts their own.
+       * One array per vision layer, indexed by tile index. Kept out of
+       * private_map as they are looked at much more often. */
+      short int *seen_count[V_COUNT];
+      short int *own_seen[V_COUNT];
+
       /* Player can see inside his borders. */
       bool border_vision;
 
@@ -342,7 +349,7 @@ struct player {
       /* Only used at the client (the server is omniscient; ./client/). */
 
       /* Corresponds to the result of
-         (player:server:private_map[tile_index]:seen_count[vlayer] != 0). */
+         (pplayer->server.seen_count[vlayer][tile_index] != 0). */
       struct dbv tile_vision[V_COUNT];
 
       enum mood_type mood;
@@ -39,6 +39,13 @@
 
 #include "requirements.h"
 
+/* Check every compiled requirement program against are_reqs_active().
+ * On in debug builds; uncomment to have it in others too. */
+#ifdef FREECIV_DEBUG
+#define REQ_PROGRAM_CHECK
+#endif
+/* #define REQ_PROGRAM_CHECK */
+
 /************************************************************************
   Container for req_item_found functions
 ************************************************************************/
@@ -2749,36 +2756,70 @@ is_achievement_in_range(const struct player *target_player,
   }
 }
 
-/**********************************************************************//**
-  Checks the requirement to see if it is active on the given target.
-
-  target gives the type of the target
-  (player,city,building,tile) give the exact target
-  req gives the requirement itself
+/* The targets a requirement is evaluated against. */
+struct req_context {
+  const struct player *player;
+  const struct player *other_player;
+  const struct city *city;
+  const struct impr_type *building;
+  const struct tile *tile;
+  const struct unit *unit;
+  const struct unit_type *unittype;
+  const struct output_type *output;
+  const struct specialist *specialist;
+  const struct action *action;
+};
 
-  Make sure you give all aspects of the target when calling this function:
-  for instance if you have TARGET_CITY pass the city's owner as the target
-  player as well as the city itself as the target city.
+/**********************************************************************//**
+  Fill in the context for the given targets.
 **************************************************************************/
-bool is_req_active(const struct player *target_player,
-                   const struct player *other_player,
-                   const struct city *target_city,
-                   const struct impr_type *target_building,
-                   const struct tile *target_tile,
-                   const struct unit *target_unit,
-                   const struct unit_type *target_unittype,
-                   const struct output_type *target_output,
-                   const struct specialist *target_specialist,
-                   const struct action *target_action,
-                   const struct requirement *req,
-                   const enum   req_problem_type prob_type)
+static inline void req_context_init(struct req_context *context,
+                                    const struct player *target_player,
+                                    const struct player *other_player,
+                                    const struct city *target_city,
+                                    const struct impr_type *target_building,
+                                    const struct tile *target_tile,
+                                    const struct unit *target_unit,
+                                    const struct unit_type *target_unittype,
+                                    const struct output_type *target_output,
+                                    const struct specialist *target_specialist,
+                                    const struct action *target_action)
 {
-  enum fc_tristate eval = TRI_NO;
-
+  context->player = target_player;
+  context->other_player = other_player;
+  context->city = target_city;
+  context->building = target_building;
+  context->tile = target_tile;
+  context->unit = target_unit;
   /* The supplied unit has a type. Use it if the unit type is missing. */
   if (target_unittype == NULL && target_unit != NULL) {
-    target_unittype = unit_type_get(target_unit);
+    context->unittype = unit_type_get(target_unit);
+  } else {
+    context->unittype = target_unittype;
   }
+  context->output = target_output;
+  context->specialist = target_specialist;
+  context->action = target_action;
+}
+
+/**********************************************************************//**
+  Evaluate the requirement source and range against the targets,
+  ignoring whether the requirement is 'present'.
+**************************************************************************/
+static enum fc_tristate req_eval(const struct req_context *context,
+                                 const struct requirement *req)
+{
+  const struct player *target_player = context->player;
+  const struct player *other_player = context->other_player;
+  const struct city *target_city = context->city;
+  const struct impr_type *target_building = context->building;
+  const struct tile *target_tile = context->tile;
+  const struct unit *target_unit = context->unit;
+  const struct unit_type *target_unittype = context->unittype;
+  const struct output_type *target_output = context->output;
+  const struct specialist *target_specialist = context->specialist;
+  const struct action *target_action = context->action;
+  enum fc_tristate eval = TRI_NO;
 
   /* Note the target may actually not exist.  In particular, effects that
    * have a VUT_TERRAIN may often be passed
@@ -3085,9 +3126,20 @@ bool is_req_active(const struct player *target_player,
     break;
   case VUT_COUNT:
     log_error("is_req_active(): invalid source kind %d.", req->source.kind);
-    return FALSE;
+    /* Not active, whether present or not. */
+    return req->present ? TRI_NO : TRI_YES;
   }
 
+  return eval;
+}
+
+/**********************************************************************//**
+  Return whether a requirement that evaluated to 'eval' is active.
+**************************************************************************/
+static inline bool req_eval_active(const struct requirement *req,
+                                   enum fc_tristate eval,
+                                   const enum req_problem_type prob_type)
+{
   if (eval == TRI_MAYBE) {
     if (prob_type == RPT_POSSIBLE) {
       return TRUE;
@@ -3102,6 +3154,40 @@ bool is_req_active(const struct player *target_player,
   }
 }
 
+/**********************************************************************//**
+  Checks the requirement to see if it is active on the given target.
+
+  target gives the type of the target
+  (player,city,building,tile) give the exact target
+  req gives the requirement itself
+
+  Make sure you give all aspects of the target when calling this function:
+  for instance if you have TARGET_CITY pass the city's owner as the target
+  player as well as the city itself as the target city.
+**************************************************************************/
+bool is_req_active(const struct player *target_player,
+                   const struct player *other_player,
+                   const struct city *target_city,
+                   const struct impr_type *target_building,
+                   const struct tile *target_tile,
+                   const struct unit *target_unit,
+                   const struct unit_type *target_unittype,
+                   const struct output_type *target_output,
+                   const struct specialist *target_specialist,
+                   const struct action *target_action,
+                   const struct requirement *req,
+                   const enum   req_problem_type prob_type)
+{
+  struct req_context context;
+
+  req_context_init(&context, target_player, other_player, target_city,
+                   target_building, target_tile, target_unit,
+                   target_unittype, target_output, target_specialist,
+                   target_action);
+
+  return req_eval_active(req, req_eval(&context, req), prob_type);
+}
+
 /**********************************************************************//**
   Checks the requirement(s) to see if they are active on the given target.
 
@@ -3140,6 +3226,362 @@ bool are_reqs_active(const struct player *target_player,
   return TRUE;
 }
 
+/* Evaluator for one kind of requirement, picked when the program is
+ * compiled. */
+typedef enum fc_tristate
+  (*req_eval_func)(const struct req_context *context,
+                   const struct requirement *req);
+
+struct req_op {
+  struct requirement req;
+  req_eval_func eval;
+};
+
+struct req_program {
+  bool never_active;    /* Has a requirement that can never be met */
+  int count;
+  struct req_op *ops;   /* Cheapest first */
+#ifdef REQ_PROGRAM_CHECK
+  const struct requirement_vector *source;
+#endif
+};
+
+/**********************************************************************//**
+  Output type requirement.
+**************************************************************************/
+static enum fc_tristate req_eval_otype(const struct req_context *context,
+                                       const struct requirement *req)
+{
+  return BOOL_TO_TRISTATE(context->output != NULL
+                          && context->output->index
+                             == req->source.value.outputtype);
+}
+
+/**********************************************************************//**
+  Specialist requirement.
+**************************************************************************/
+static enum fc_tristate
+req_eval_specialist(const struct req_context *context,
+                    const struct requirement *req)
+{
+  return BOOL_TO_TRISTATE(context->specialist != NULL
+                          && context->specialist
+                             == req->source.value.specialist);
+}
+
+/**********************************************************************//**
+  Action requirement.
+**************************************************************************/
+static enum fc_tristate req_eval_action(const struct req_context *context,
+                                        const struct requirement *req)
+{
+  return BOOL_TO_TRISTATE(context->action != NULL
+                          && action_number(context->action)
+                             == action_number(req->source.value.action));
+}
+
+/**********************************************************************//**
+  Government requirement.
+**************************************************************************/
+static enum fc_tristate
+req_eval_government(const struct req_context *context,
+                    const struct requirement *req)
+{
+  if (context->player == NULL) {
+    return TRI_MAYBE;
+  }
+
+  return BOOL_TO_TRISTATE(government_of_player(context->player)
+                          == req->source.value.govern);
+}
+
+/**********************************************************************//**
+  Unit type requirement at local range.
+**************************************************************************/
+static enum fc_tristate
+req_eval_utype_local(const struct req_context *context,
+                     const struct requirement *req)
+{
+  if (context->unittype == NULL) {
+    return TRI_MAYBE;
+  }
+
+  return BOOL_TO_TRISTATE(context->unittype == req->source.value.utype);
+}
+
+/**********************************************************************//**
+  Unit class requirement at local range.
+**************************************************************************/
+static enum fc_tristate
+req_eval_uclass_local(const struct req_context *context,
+                      const struct requirement *req)
+{
+  if (context->unittype == NULL) {
+    return TRI_MAYBE;
+  }
+
+  return BOOL_TO_TRISTATE(utype_class(context->unittype)
+                          == req->source.value.uclass);
+}
+
+/**********************************************************************//**
+  Non surviving tech requirement at player range.
+**************************************************************************/
+static enum fc_tristate
+req_eval_advance_player(const struct req_context *context,
+                        const struct requirement *req)
+{
+  if (context->player == NULL) {
+    return TRI_MAYBE;
+  }
+
+  return BOOL_TO_TRISTATE(TECH_KNOWN
+                          == research_invention_state(
+                               research_get(context->player),
+                               advance_number(req->source.value.advance)));
+}
+
+/**********************************************************************//**
+  Non surviving building requirement at city range.
+**************************************************************************/
+static enum fc_tristate
+req_eval_improvement_city(const struct req_context *context,
+                          const struct requirement *req)
+{
+  const struct impr_type *source = req->source.value.building;
+
+  if (improvement_obsolete(context->player, source, context->city)) {
+    return TRI_NO;
+  }
+  if (context->city == NULL) {
+    return TRI_MAYBE;
+  }
+
+  return BOOL_TO_TRISTATE(num_city_buildings(context->city, source) > 0);
+}
+
+/**********************************************************************//**
+  Return the evaluator to use for the requirement. Requirements without
+  a special one use req_eval().
+**************************************************************************/
+static req_eval_func req_eval_select(const struct requirement *req)
+{
+  switch (req->source.kind) {
+  case VUT_OTYPE:
+    return req_eval_otype;
+  case VUT_SPECIALIST:
+    return req_eval_specialist;
+  case VUT_ACTION:
+    return req_eval_action;
+  case VUT_GOVERNMENT:
+    return req_eval_government;
+  case VUT_UTYPE:
+    if (req->range == REQ_RANGE_LOCAL) {
+      return req_eval_utype_local;
+    }
+    break;
+  case VUT_UCLASS:
+    if (req->range == REQ_RANGE_LOCAL) {
+      return req_eval_uclass_local;
+    }
+    break;
+  case VUT_ADVANCE:
+    if (req->range == REQ_RANGE_PLAYER && !req->survives) {
+      return req_eval_advance_player;
+    }
+    break;
+  case VUT_IMPROVEMENT:
+    if (req->range == REQ_RANGE_CITY && !req->survives) {
+      return req_eval_improvement_city;
+    }
+    break;
+  default:
+    break;
+  }
+
+  return req_eval;
+}
+
+/**********************************************************************//**
+  Rough cost of evaluating the requirement: 0 for comparisons with the
+  targets, 1 for a lookup in the player, city or tile, 2 for anything
+  that has to look at several players, cities or tiles.
+**************************************************************************/
+static int req_eval_cost(const struct requirement *req)
+{
+  switch (req->source.kind) {
+  case VUT_NONE:
+  case VUT_OTYPE:
+  case VUT_SPECIALIST:
+  case VUT_ACTION:
+  case VUT_GOVERNMENT:
+  case VUT_STYLE:
+  case VUT_AI_LEVEL:
+  case VUT_IMPR_GENUS:
+  case VUT_UTYPE:
+  case VUT_UTFLAG:
+  case VUT_UCLASS:
+  case VUT_UCFLAG:
+  case VUT_MINVETERAN:
+  case VUT_MINMOVES:
+  case VUT_MINHP:
+  case VUT_MINYEAR:
+  case VUT_MINCALFRAG:
+  case VUT_TOPO:
+    return 0;
+  case VUT_NATIONALITY:
+  case VUT_MINCULTURE:
+  case VUT_SERVERSETTING:
+    return 2;
+  default:
+    break;
+  }
+
+  switch (req->range) {
+  case REQ_RANGE_LOCAL:
+  case REQ_RANGE_CITY:
+  case REQ_RANGE_PLAYER:
+    return 1;
+  case REQ_RANGE_WORLD:
+    /* Surviving requirements are looked up in game wide caches. */
+    return req->survives ? 1 : 2;
+  default:
+    return 2;
+  }
+}
+
+/**********************************************************************//**
+  Compile the requirement vector into a program. The program checks the
+  cheap requirements first, has the evaluation of some common kinds of
+  requirements picked in advance and drops requirements that are always
+  met or given more than once.
+**************************************************************************/
+struct req_program *req_program_new(const struct requirement_vector *reqs)
+{
+  struct req_program *prog = fc_calloc(1, sizeof(*prog));
+  int size = requirement_vector_size(reqs);
+
+  if (size > 0) {
+    prog->ops = fc_malloc(size * sizeof(*prog->ops));
+  }
+#ifdef REQ_PROGRAM_CHECK
+  prog->source = reqs;
+#endif
+
+  requirement_vector_iterate(reqs, preq) {
+    int cost = req_eval_cost(preq);
+    bool duplicate = FALSE;
+    int i;
+
+    if (preq->source.kind == VUT_NONE) {
+      if (!preq->present) {
+        prog->never_active = TRUE;
+      }
+      continue;
+    }
+
+    for (i = 0; i < prog->count; i++) {
+      if (are_requirements_equal(&prog->ops[i].req, preq)) {
+        duplicate = TRUE;
+        break;
+      }
+    }
+    if (duplicate) {
+      continue;
+    }
+
+    /* Keep the order of the vector among requirements of equal cost. */
+    for (i = prog->count;
+         i > 0 && req_eval_cost(&prog->ops[i - 1].req) > cost; i--) {
+      prog->ops[i] = prog->ops[i - 1];
+    }
+    prog->ops[i].req = *preq;
+    prog->ops[i].eval = req_eval_select(preq);
+    prog->count++;
+  } requirement_vector_iterate_end;
+
+  return prog;
+}
+
+/**********************************************************************//**
+  Free a requirement program.
+**************************************************************************/
+void req_program_destroy(struct req_program *prog)
+{
+  if (prog != NULL) {
+    free(prog->ops);
+    free(prog);
+  }
+}
+
+/**********************************************************************//**
+  Run the program against the context.
+**************************************************************************/
+static bool req_program_run(const struct req_program *prog,
+                            const struct req_context *context,
+                            const enum req_problem_type prob_type)
+{
+  int i;
+
+  if (prog->never_active) {
+    return FALSE;
+  }
+
+  for (i = 0; i < prog->count; i++) {
+    const struct req_op *op = &prog->ops[i];
+
+    if (!req_eval_active(&op->req, op->eval(context, &op->req),
+                         prob_type)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**********************************************************************//**
+  Checks the compiled requirements to see if they are all active on the
+  given target. Gives the same answer as are_reqs_active() for the vector
+  the program was compiled from.
+**************************************************************************/
+bool req_program_active(const struct req_program *prog,
+                        const struct player *target_player,
+                        const struct player *other_player,
+                        const struct city *target_city,
+                        const struct impr_type *target_building,
+                        const struct tile *target_tile,
+                        const struct unit *target_unit,
+                        const struct unit_type *target_unittype,
+                        const struct output_type *target_output,
+                        const struct specialist *target_specialist,
+                        const struct action *target_action,
+                        const enum   req_problem_type prob_type)
+{
+  struct req_context context;
+  bool active;
+
+  req_context_init(&context, target_player, other_player, target_city,
+                   target_building, target_tile, target_unit,
+                   target_unittype, target_output, target_specialist,
+                   target_action);
+
+  active = req_program_run(prog, &context, prob_type);
+
+#ifdef REQ_PROGRAM_CHECK
+  if (active != are_reqs_active(target_player, other_player, target_city,
+                                target_building, target_tile, target_unit,
+                                target_unittype, target_output,
+                                target_specialist, target_action,
+                                prog->source, prob_type)) {
+    log_error("Requirement program of %d requirements gave %s.",
+              (int) requirement_vector_size(prog->source),
+              active ? "TRUE" : "FALSE");
+  }
+#endif /* REQ_PROGRAM_CHECK */
+
+  return active;
+}
+
 /**********************************************************************//**
   Return TRUE if this is an "unchanging" requirement.  This means that
   if a target can't meet the requirement now, it probably won't ever be able
@@ -135,6 +135,26 @@ bool are_reqs_active(const struct player *target_player,
                      const struct requirement_vector *reqs,
                      const enum   req_problem_type prob_type);
 
+/* A requirement vector compiled for faster evaluation. The program keeps
+ * its own copy of the requirements, so it has to be compiled again when
+ * the vector changes. */
+struct req_program;
+
+struct req_program *req_program_new(const struct requirement_vector *reqs);
+void req_program_destroy(struct req_program *prog);
+bool req_program_active(const struct req_program *prog,
+                        const struct player *target_player,
+                        const struct player *other_player,
+                        const struct city *target_city,
+                        const struct impr_type *target_building,
+                        const struct tile *target_tile,
+                        const struct unit *target_unit,
+                        const struct unit_type *target_unittype,
+                        const struct output_type *target_output,
+                        const struct specialist *target_specialist,
+                        const struct action *target_action,
+                        const enum   req_problem_type prob_type);
+
 bool is_req_unchanging(const struct requirement *req);
 
 bool is_req_in_vec(const struct requirement *req,
@@ -21,6 +21,7 @@
 #include "support.h"
 
 /* common */
+#include "effects.h"
 #include "fc_interface.h"
 #include "game.h"
 #include "map.h"
@@ -98,11 +99,32 @@ struct city *tile_worked(const struct tile *ptile)
 }
 #endif
 
+/************************************************************************//**
+  Tell the caches that depend on the terrain and extras of the tile that
+  they have changed.
+****************************************************************************/
+static void tile_contents_changed(struct tile *ptile)
+{
+  if (game.callbacks.tile_changed) {
+    (game.callbacks.tile_changed)(ptile);
+  }
+  if (!tile_virtual_check(ptile)) {
+    effect_cache_changed(ECD_TERRAIN);
+  }
+}
+
 /************************************************************************//**
   Set the city/worker on the tile (may be NULL).
 ****************************************************************************/
 void tile_set_worked(struct tile *ptile, struct city *pcity)
 {
+  if ((NULL != ptile->worked && is_city_center(ptile->worked, ptile))
+      || (NULL != pcity && is_city_center(pcity, ptile))) {
+    /* A city appears or goes away. */
+    if (game.callbacks.tile_changed) {
+      (game.callbacks.tile_changed)(ptile);
+    }
+  }
   ptile->worked = pcity;
 }
 
@@ -143,6 +165,7 @@ void tile_set_terrain(struct tile *ptile, struct terrain *pterrain)
                 tile_city(ptile)->id);
 
   ptile->terrain = pterrain;
+  tile_contents_changed(ptile);
   if (ptile->resource != NULL) {
     if (NULL != pterrain
         && terrain_has_resource(pterrain, ptile->resource)) {
@@ -974,6 +997,7 @@ void tile_add_extra(struct tile *ptile, const struct extra_type *pextra)
 {
   if (pextra != NULL) {
     BV_SET(ptile->extras, extra_index(pextra));
+    tile_contents_changed(ptile);
   }
 }
 
@@ -984,6 +1008,7 @@ void tile_remove_extra(struct tile *ptile, const struct extra_type *pextra)
 {
   if (pextra != NULL) {
     BV_CLR(ptile->extras, extra_index(pextra));
+    tile_contents_changed(ptile);
   }
 }
 
@@ -1224,6 +1224,9 @@ void unit_tile_set(struct unit *punit, struct tile *ptile)
 {
   fc_assert_ret(NULL != punit);
   punit->tile = ptile;
+  if (game.callbacks.unit_changed) {
+    (game.callbacks.unit_changed)(punit);
+  }
 }
 
 /**********************************************************************//**
@@ -40,6 +40,7 @@ struct vision *vision_new(struct player *pplayer, struct tile *ptile)
   vision->radius_sq[V_MAIN] = -1;
   vision->radius_sq[V_INVIS] = -1;
   vision->radius_sq[V_SUBSURFACE] = -1;
+  vision->handed_over = NULL;
 
   return vision;
 }
@@ -69,6 +69,13 @@ extern "C" {
   note that for all the code in the middle both the new and the old
   vision sources are active.  The same process applies when transferring
   a unit or city between players, etc.
+
+  When the new source is one step away from the old one, with the same
+  owner and sight, vision_move_sight(new_vision, old_vision, radius_sq)
+  can be used in place of vision_change_sight().  It only unfogs the
+  tiles that the old source does not see, and hands the tiles both see
+  over to the new source; vision_clear_sight() on the old source then
+  only fogs the tiles that were left behind.
 ****************************************************************************/
 
 /* Invariants: V_MAIN vision ranges must always be more than V_INVIS
@@ -90,6 +97,10 @@ struct vision {
 
   /* The radius of the vision source. */
   v_radius_t radius_sq;
+
+  /* Server only: set by vision_move_sight() once the tiles shared with
+   * the new source have been handed over to it. */
+  const struct vision_delta_mask *handed_over;
 };
 
 /* Initialize a vision radius array. */
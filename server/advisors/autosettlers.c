@@ -450,7 +450,9 @@ adv_want settler_evaluate_improvements(struct unit *punit,
   pft_fill_unit_parameter(&parameter, punit);
   parameter.omniscience = !has_handicap(pplayer, H_MAP);
   parameter.get_TB = autosettler_tile_behavior;
-  pfm = pf_map_new(&parameter);
+  /* Other workers on the same tile, or the later evaluations of this one,
+   * get the same map. */
+  pfm = pf_map_cache_get(&parameter);
 
   city_list_iterate(pplayer->cities, pcity) {
     struct tile *pcenter = city_tile(pcity);
@@ -780,8 +782,6 @@ adv_want settler_evaluate_improvements(struct unit *punit,
     *path = *best_tile ? pf_map_path(pfm, *best_tile) : NULL;
   }
 
-  pf_map_destroy(pfm);
-
   return best_newv;
 }
 
@@ -805,7 +805,7 @@ struct city *settler_evaluate_city_requests(struct unit *punit,
   pft_fill_unit_parameter(&parameter, punit);
   parameter.omniscience = !has_handicap(pplayer, H_MAP);
   parameter.get_TB = autosettler_tile_behavior;
-  pfm = pf_map_new(&parameter);
+  pfm = pf_map_cache_get(&parameter);
 
   /* Have nearby cities requests? */
   city_list_iterate(pplayer->cities, pcity) {
@@ -869,8 +869,6 @@ struct city *settler_evaluate_city_requests(struct unit *punit,
     *path = best ? pf_map_path(pfm, best->ptile) : NULL;
   }
 
-  pf_map_destroy(pfm);
-
   return taskcity;
 }
 
@@ -970,7 +968,6 @@ bool auto_settler_setup_work(struct player *pplayer, struct unit *punit,
 {
   /* Run the "autosettler" program */
   if (punit->server.adv->task == AUT_AUTO_SETTLER) {
-    struct pf_map *pfm = NULL;
     struct pf_parameter parameter;
     bool working = FALSE;
     struct unit *displaced;
@@ -1043,8 +1040,7 @@ bool auto_settler_setup_work(struct player *pplayer, struct unit *punit,
       pft_fill_unit_parameter(&parameter, punit);
       parameter.omniscience = !has_handicap(pplayer, H_MAP);
       parameter.get_TB = autosettler_tile_behavior;
-      pfm = pf_map_new(&parameter);
-      path = pf_map_path(pfm, best_tile);
+      path = pf_map_path(pf_map_cache_get(&parameter), best_tile);
     }
 
     if (path) {
@@ -1077,10 +1073,6 @@ bool auto_settler_setup_work(struct player *pplayer, struct unit *punit,
                TILE_XY(unit_tile(punit)), TILE_XY(best_tile));
     }
 
-    if (pfm) {
-      pf_map_destroy(pfm);
-    }
-
     return working;
   }
 
@@ -55,6 +55,9 @@
 /* common/scriptcore */
 #include "luascript_types.h"
 
+/* common/aicore */
+#include "path_finding.h"
+
 /* server */
 #include "barbarian.h"
 #include "citizenshand.h"
@@ -1094,6 +1097,8 @@ bool transfer_city(struct player *ptaker, struct city *pcity,
                                : NULL);
   int i;
 
+  pf_map_cache_invalidate();
+
   fc_assert_ret_val(pgiver != ptaker, TRUE);
 
   /* Remember what player see what unit. */
@@ -1475,6 +1480,8 @@ void create_city(struct player *pplayer, struct tile *ptile,
 
   log_debug("create_city() %s", name);
 
+  pf_map_cache_invalidate();
+
   pcity = create_city_virtual(pplayer, ptile, name);
 
   /* Remove units no more seen. Do it before city is really put into the
@@ -1634,6 +1641,8 @@ void remove_city(struct city *pcity)
   struct tile_list *process_queue;
   const char *ctl = city_tile_link(pcity);
 
+  pf_map_cache_invalidate();
+
   CALL_PLR_AI_FUNC(city_lost, powner, powner, pcity);
   CALL_FUNC_EACH_AI(city_destroyed, pcity);
 
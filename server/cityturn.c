@@ -27,6 +27,7 @@
 #include "rand.h"
 #include "shared.h"
 #include "support.h"
+#include "workpool.h"
 
 /* common/aicore */
 #include "cm.h"
@@ -83,6 +84,22 @@
 /* Queue for pending city_refresh() */
 static struct city_list *city_refresh_queue = NULL;
 
+/* Fewer cities than this are refreshed without the helper threads. */
+#define CITY_REFRESH_PARALLEL_MIN 8
+
+/* An array of cities that is kept from one use to the next. A use that
+ * starts while the array is taken gets an array of its own. */
+struct city_buffer {
+  struct city **cities;
+  int size;
+  bool taken;
+};
+
+/* Cities being refreshed at once, and cities of the player whose turn
+ * is being done in update_city_activities(). */
+static struct city_buffer city_refresh_buffer = { NULL, 0, FALSE };
+static struct city_buffer city_activities_buffer = { NULL, 0, FALSE };
+
 /* The game is currently considering to remove the listed units because of
  * missing gold upkeep. A unit ends up here if it has gold upkeep that
  * can't be payed. A random unit in the list will be removed until the
@@ -147,6 +164,16 @@ static bool do_city_migration(struct city *pcity_from,
                               struct city *pcity_to);
 static bool check_city_migrations_player(const struct player *pplayer);
 
+/**********************************************************************//**
+  Recalculate the city internal cached data. Only the city itself is
+  changed, so this can be done for several cities at the same time.
+**************************************************************************/
+static void city_refresh_self(struct city *pcity)
+{
+  city_refresh_from_main_map(pcity, NULL);
+  city_style_refresh(pcity);
+}
+
 /**********************************************************************//**
   Updates unit upkeeps and city internal cached data. Returns whether
   city radius has changed.
@@ -159,8 +186,7 @@ bool city_refresh(struct city *pcity)
 
   retval = city_map_update_radius_sq(pcity);
   city_units_upkeep(pcity); /* update unit upkeep */
-  city_refresh_from_main_map(pcity, NULL);
-  city_style_refresh(pcity);
+  city_refresh_self(pcity);
 
   if (retval) {
     /* Force a sync of the city after the change. */
@@ -170,19 +196,173 @@ bool city_refresh(struct city *pcity)
   return retval;
 }
 
+/**********************************************************************//**
+  Return the cities of the list in an array from the buffer. Give it back
+  with city_buffer_release().
+**************************************************************************/
+static struct city **city_buffer_fill(struct city_buffer *buf,
+                                      const struct city_list *list)
+{
+  int n = city_list_size(list);
+  struct city **cities;
+  int i = 0;
+
+  if (buf->taken) {
+    cities = fc_malloc(MAX(n, 1) * sizeof(*cities));
+  } else {
+    if (buf->size < n) {
+      buf->size = MAX(n, 2 * buf->size);
+      buf->cities = fc_realloc(buf->cities,
+                               buf->size * sizeof(*buf->cities));
+    }
+    cities = buf->cities;
+    buf->taken = TRUE;
+  }
+
+  city_list_iterate(list, pcity) {
+    cities[i++] = pcity;
+  } city_list_iterate_end;
+
+  return cities;
+}
+
+/**********************************************************************//**
+  Give back an array returned by city_buffer_fill().
+**************************************************************************/
+static void city_buffer_release(struct city_buffer *buf,
+                                struct city **cities)
+{
+  if (cities == buf->cities && buf->taken) {
+    buf->taken = FALSE;
+  } else {
+    free(cities);
+  }
+}
+
+/**********************************************************************//**
+  Free the array of the buffer.
+**************************************************************************/
+static void city_buffer_free(struct city_buffer *buf)
+{
+  fc_assert(!buf->taken);
+  free(buf->cities);
+  buf->cities = NULL;
+  buf->size = 0;
+}
+
+/**********************************************************************//**
+  Free the data kept between turns.
+**************************************************************************/
+void cityturn_free(void)
+{
+  city_buffer_free(&city_refresh_buffer);
+  city_buffer_free(&city_activities_buffer);
+}
+
+/**********************************************************************//**
+  Work function for the helper threads; 'data' is the array of cities.
+**************************************************************************/
+static void city_refresh_work(int idx, void *data)
+{
+  city_refresh_self(((struct city **) data)[idx]);
+}
+
+/**********************************************************************//**
+  Finish the refresh of cities whose radius and unit upkeep have already
+  been updated, and send them to 'dest' (city owner if NULL).
+**************************************************************************/
+static void city_refresh_run(struct city **cities, int n,
+                             struct player *dest)
+{
+  struct fc_workpool *pool = NULL;
+  int i;
+
+  if (n >= CITY_REFRESH_PARALLEL_MIN) {
+    pool = game_helper_pool();
+  }
+
+  if (pool != NULL) {
+    fc_workpool_run(pool, n, city_refresh_work, cities);
+  } else {
+    for (i = 0; i < n; i++) {
+      city_refresh_self(cities[i]);
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    send_city_info(dest != NULL ? dest : city_owner(cities[i]), cities[i]);
+  }
+}
+
+/**********************************************************************//**
+  Refresh the cities in the given order, arrange workers of those whose
+  radius changed, and send them to 'dest' (city owner if NULL). If
+  'queued' is TRUE, cities that no longer need a refresh are skipped.
+  The array is overwritten.
+
+  The result is the same as calling city_refresh() for one city after
+  the other. city_refresh_self() only changes the city itself, so it is
+  done in parallel for each run of cities. A radius change affects the
+  map and can make a city rearrange its workers, so such a city ends
+  the run and is handled on its own. The trade of a city with trade
+  routes depends on what the refresh of its partners writes, so such
+  cities are refreshed one after the other on this thread; no other
+  city reads them, so they need not end the run.
+**************************************************************************/
+static void city_refresh_cities(struct city **cities, int n,
+                                struct player *dest, bool queued)
+{
+  int i, nrun = 0;
+
+  for (i = 0; i < n; i++) {
+    struct city *pcity = cities[i];
+
+    if (queued && !pcity->server.needs_refresh) {
+      continue;
+    }
+
+    pcity->server.needs_refresh = FALSE;
+
+    if (!city_map_update_radius_sq(pcity)) {
+      city_units_upkeep(pcity);
+      if (0 < trade_route_list_size(pcity->routes)) {
+        city_refresh_self(pcity);
+        send_city_info(dest != NULL ? dest : city_owner(pcity), pcity);
+      } else {
+        /* The run is gathered at the start of the array; 'nrun' never
+         * gets past 'i'. */
+        cities[nrun++] = pcity;
+      }
+      continue;
+    }
+
+    city_refresh_run(cities, nrun, dest);
+    nrun = 0;
+
+    city_units_upkeep(pcity);
+    city_refresh_self(pcity);
+    /* Force a sync of the city after the change, as city_refresh(). */
+    send_city_info(city_owner(pcity), pcity);
+    auto_arrange_workers(pcity);
+    send_city_info(dest != NULL ? dest : city_owner(pcity), pcity);
+  }
+
+  city_refresh_run(cities, nrun, dest);
+}
+
 /**********************************************************************//**
   Called on government change or wonder completion or stuff like that
   -- Syela
 **************************************************************************/
 void city_refresh_for_player(struct player *pplayer)
 {
+  int n = city_list_size(pplayer->cities);
+  struct city **cities;
+
   conn_list_do_buffer(pplayer->connections);
-  city_list_iterate(pplayer->cities, pcity) {
-    if (city_refresh(pcity)) {
-      auto_arrange_workers(pcity);
-    }
-    send_city_info(pplayer, pcity);
-  } city_list_iterate_end;
+  cities = city_buffer_fill(&city_refresh_buffer, pplayer->cities);
+  city_refresh_cities(cities, n, pplayer, FALSE);
+  city_buffer_release(&city_refresh_buffer, cities);
   conn_list_do_unbuffer(pplayer->connections);
 }
 
@@ -207,18 +387,17 @@ void city_refresh_queue_add(struct city *pcity)
 **************************************************************************/
 void city_refresh_queue_processing(void)
 {
-  if (NULL == city_refresh_queue) {
+  struct city_list *queue = city_refresh_queue;
+  struct city **cities;
+
+  if (NULL == queue) {
     return;
   }
 
-  city_list_iterate(city_refresh_queue, pcity) {
-    if (pcity->server.needs_refresh) {
-      if (city_refresh(pcity)) {
-        auto_arrange_workers(pcity);
-      }
-      send_city_info(city_owner(pcity), pcity);
-    }
-  } city_list_iterate_end;
+  /* Cities queued while processing get dropped with the list. */
+  cities = city_buffer_fill(&city_refresh_buffer, queue);
+  city_refresh_cities(cities, city_list_size(queue), NULL, TRUE);
+  city_buffer_release(&city_refresh_buffer, cities);
 
   city_list_destroy(city_refresh_queue);
   city_refresh_queue = NULL;
@@ -332,7 +511,6 @@ void auto_arrange_workers(struct city *pcity)
   city_refresh(pcity);
 
   sanity_check_city(pcity);
-  cm_clear_cache(pcity);
 
   cm_init_parameter(&cmp);
   cmp.require_happy = FALSE;
@@ -555,8 +733,10 @@ void update_city_activities(struct player *pplayer)
   pplayer->server.bulbs_last_turn = 0;
 
   if (n > 0) {
-    struct city *cities[n];
-    int i = 0, r;
+    /* The cities in an array for later random order handling */
+    struct city **cities = city_buffer_fill(&city_activities_buffer,
+                                            pplayer->cities);
+    int i = n, r;
 
     city_list_iterate(pplayer->cities, pcity) {
 
@@ -591,9 +771,6 @@ void update_city_activities(struct player *pplayer)
           }
         }
       } trade_routes_iterate_safe_end;
-
-      /* Add cities to array for later random order handling */
-      cities[i++] = pcity;
     } city_list_iterate_end;
 
     /* How gold upkeep is handled depends on the setting
@@ -615,6 +792,7 @@ void update_city_activities(struct player *pplayer)
       update_city_activity(cities[r]);
       cities[r] = cities[--i];
     }
+    city_buffer_release(&city_activities_buffer, cities);
 
     if (pplayer->economic.gold < 0) {
       switch (game.info.gold_upkeep_style) {
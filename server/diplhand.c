@@ -38,6 +38,9 @@
 /* common/scriptcore */
 #include "luascript_types.h"
 
+/* common/aicore */
+#include "path_finding.h"
+
 /* server */
 #include "citytools.h"
 #include "cityturn.h"
@@ -407,6 +410,9 @@ void handle_diplomacy_accept_treaty_req(struct player *pplayer,
       }
     } clause_list_iterate_end;
 
+    /* The clauses may change diplomatic states and move cities. */
+    pf_map_cache_invalidate();
+
     call_treaty_accepted(pplayer, pother, ptreaty);
     call_treaty_accepted(pother, pplayer, ptreaty);
 
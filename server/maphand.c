@@ -42,6 +42,9 @@
 #include "vision.h"
 #include "astring.h"
 
+/* common/aicore */
+#include "path_finding.h"
+
 /* server */
 #include "citytools.h"
 #include "cityturn.h"
@@ -63,6 +66,50 @@
 /* Suppress send_tile_info() during game_load() */
 static bool send_tile_suppressed = FALSE;
 
+/* Tile infos waiting for send_tile_info_batch_end() */
+struct tile_info_dirty {
+  bool queued;          /* In tile_info_batch.tiles */
+  bool all;             /* For every connection */
+  bool observers;       /* For the global observers */
+  bv_player players;
+};
+
+static struct {
+  int depth;
+  struct tile_list *tiles;          /* In the order they were queued */
+  struct tile_info_dirty *dirty;    /* Indexed by tile index; kept clear
+                                     * outside of batches */
+  int num_dirty;                    /* Size of 'dirty' */
+} tile_info_batch = { 0, NULL, NULL, 0 };
+
+/* A tile whose seen counts change when a vision source moves one step. */
+struct vision_delta {
+  int dx, dy;           /* Map vector from the center */
+  v_radius_t change;    /* 1 for the layers that change, 0 for the others */
+};
+
+/* The tiles that enter and leave the sight of a vision source with the
+ * given radii when it moves by (step_dx, step_dy). Built on demand by
+ * vision_delta_mask_get() and kept for the rest of the game. */
+struct vision_delta_mask {
+  v_radius_t radius_sq;
+  int step_dx, step_dy;
+  int topology_id;
+
+  int num_enter;
+  struct vision_delta *enter;   /* From the new center */
+  int num_leave;
+  struct vision_delta *leave;   /* From the old center */
+
+  struct vision_delta_mask *next;
+};
+
+static struct vision_delta_mask *vision_delta_masks = NULL;
+
+static bool tile_info_fill(struct packet_tile_info *info,
+                           const struct tile *ptile,
+                           const struct player *pplayer,
+                           bool send_unknown);
 static void player_tile_init(struct tile *ptile, struct player *pplayer);
 static void player_tile_free(struct tile *ptile, struct player *pplayer);
 static void give_tile_info_from_player_to_player(struct player *pfrom,
@@ -139,6 +186,7 @@ void climate_change(bool warming, int effect)
   log_verbose("Climate change: %s (%d)",
               warming ? "Global warming" : "Nuclear winter", effect);
 
+  send_tile_info_batch_begin();
   while (effect > 0 && (k--) > 0) {
     struct terrain *old, *candidates[2], *new;
     struct tile *ptile;
@@ -217,6 +265,7 @@ void climate_change(bool warming, int effect)
       effect--;
     }
   }
+  send_tile_info_batch_end();
 }
 
 /**********************************************************************//**
@@ -464,6 +513,263 @@ bool send_tile_suppression(bool now)
   return formerly;
 }
 
+/**********************************************************************//**
+  Remember that the tile info of the tile must be sent to the player, or
+  to the global observers if pplayer is NULL, or to everyone if 'all' is
+  set, when the outermost batch ends.
+**************************************************************************/
+static void tile_info_batch_add(struct tile *ptile,
+                                const struct player *pplayer, bool all)
+{
+  struct tile_info_dirty *pdirty = &tile_info_batch.dirty[tile_index(ptile)];
+
+  if (!pdirty->queued) {
+    pdirty->queued = TRUE;
+    tile_list_append(tile_info_batch.tiles, ptile);
+  }
+
+  if (all) {
+    pdirty->all = TRUE;
+  } else if (pplayer != NULL) {
+    BV_SET(pdirty->players, player_index(pplayer));
+  } else {
+    pdirty->observers = TRUE;
+  }
+}
+
+/**********************************************************************//**
+  Start collecting the tile infos that would be sent to everyone, or by
+  update_tile_knowledge(). They get sent by the matching
+  send_tile_info_batch_end(), once per tile and player however often the
+  tile changed in between. Batches can be nested.
+
+  Tile infos sent because a player gets to see the tile are not collected,
+  so clients still learn about a tile before the units on it. Collected
+  tile infos get sent after everything else that was sent in the batch.
+**************************************************************************/
+void send_tile_info_batch_begin(void)
+{
+  if (tile_info_batch.depth++ > 0) {
+    return;
+  }
+
+  if (tile_info_batch.num_dirty != map_num_tiles()) {
+    /* First batch on this map. */
+    send_tile_info_batch_free();
+    tile_info_batch.tiles = tile_list_new();
+    tile_info_batch.dirty = fc_calloc(map_num_tiles(),
+                                      sizeof(*tile_info_batch.dirty));
+    tile_info_batch.num_dirty = map_num_tiles();
+  }
+}
+
+/**********************************************************************//**
+  Free the tile info batch data kept for the map.
+**************************************************************************/
+void send_tile_info_batch_free(void)
+{
+  fc_assert_ret(tile_info_batch.depth <= 1);
+
+  if (NULL != tile_info_batch.tiles) {
+    tile_list_destroy(tile_info_batch.tiles);
+    tile_info_batch.tiles = NULL;
+  }
+  free(tile_info_batch.dirty);
+  tile_info_batch.dirty = NULL;
+  tile_info_batch.num_dirty = 0;
+}
+
+/**********************************************************************//**
+  End a batch started by send_tile_info_batch_begin(). When the outermost
+  batch ends, the collected tile infos are sent. Each player's packet is
+  made once per tile and sent to all connections of the player.
+**************************************************************************/
+void send_tile_info_batch_end(void)
+{
+  struct conn_list *class_conns;
+  struct tile_list *tiles;
+  struct tile_info_dirty *dirty;
+
+  fc_assert_ret(tile_info_batch.depth > 0);
+
+  if (--tile_info_batch.depth > 0) {
+    return;
+  }
+
+  tiles = tile_info_batch.tiles;
+  dirty = tile_info_batch.dirty;
+
+  class_conns = conn_list_new();
+  conn_list_do_buffer(game.est_connections);
+
+  conn_list_iterate(game.est_connections, pconn) {
+    struct player *pplayer = pconn->playing;
+    bool handled = FALSE;
+
+    if (NULL == pplayer && !pconn->observer) {
+      continue;
+    }
+
+    /* Connections that see the same are handled together, by the first
+     * of them. */
+    conn_list_iterate(game.est_connections, pother) {
+      if (pother == pconn) {
+        break;
+      }
+      if (pother->playing == pplayer
+          && (NULL != pplayer || pother->observer)) {
+        handled = TRUE;
+        break;
+      }
+    } conn_list_iterate_end;
+    if (handled) {
+      continue;
+    }
+
+    conn_list_clear(class_conns);
+    conn_list_iterate(game.est_connections, pother) {
+      if (pother->playing == pplayer
+          && (NULL != pplayer || pother->observer)) {
+        conn_list_append(class_conns, pother);
+      }
+    } conn_list_iterate_end;
+
+    tile_list_iterate(tiles, ptile) {
+      struct tile_info_dirty *pdirty = &dirty[tile_index(ptile)];
+      struct packet_tile_info info;
+
+      if (!pdirty->all
+          && !(NULL != pplayer
+               ? BV_ISSET(pdirty->players, player_index(pplayer))
+               : pdirty->observers)) {
+        continue;
+      }
+
+      if (tile_info_fill(&info, ptile, pplayer, FALSE)) {
+        conn_list_iterate(class_conns, pdest) {
+          send_packet_tile_info(pdest, &info);
+        } conn_list_iterate_end;
+      }
+    } tile_list_iterate_end;
+  } conn_list_iterate_end;
+
+  conn_list_do_unbuffer(game.est_connections);
+  conn_list_destroy(class_conns);
+
+  /* Only the queued tiles have anything to clear. */
+  tile_list_iterate(tiles, ptile) {
+    memset(&dirty[tile_index(ptile)], 0, sizeof(*dirty));
+  } tile_list_iterate_end;
+  tile_list_clear(tiles);
+}
+
+/**********************************************************************//**
+  Fill in the tile info packet as the given player should see the tile.
+  A NULL player is a global observer. Returns FALSE when nothing should
+  be sent to the player.
+**************************************************************************/
+static bool tile_info_fill(struct packet_tile_info *info,
+                           const struct tile *ptile,
+                           const struct player *pplayer,
+                           bool send_unknown)
+{
+  const struct player *owner;
+  const struct player *eowner;
+
+  info->tile = tile_index(ptile);
+
+  if (ptile->spec_sprite) {
+    sz_strlcpy(info->spec_sprite, ptile->spec_sprite);
+  } else {
+    info->spec_sprite[0] = '\0';
+  }
+
+  if (!pplayer || map_is_known_and_seen(ptile, pplayer, V_MAIN)) {
+    info->known = TILE_KNOWN_SEEN;
+    info->continent = tile_continent(ptile);
+    owner = tile_owner(ptile);
+    eowner = extra_owner(ptile);
+    info->owner = (owner ? player_number(owner) : MAP_TILE_OWNER_NULL);
+    info->extras_owner = (eowner ? player_number(eowner) : MAP_TILE_OWNER_NULL);
+    info->worked = (NULL != tile_worked(ptile))
+                   ? tile_worked(ptile)->id
+                   : IDENTITY_NUMBER_ZERO;
+
+    info->terrain = (NULL != tile_terrain(ptile))
+                    ? terrain_number(tile_terrain(ptile))
+                    : terrain_count();
+    info->resource = (NULL != tile_resource(ptile))
+                     ? extra_number(tile_resource(ptile))
+                     : MAX_EXTRA_TYPES;
+
+    if (pplayer != NULL) {
+      info->extras = map_get_player_tile(ptile, pplayer)->extras;
+    } else {
+      info->extras = ptile->extras;
+    }
+
+    if (ptile->label != NULL) {
+      /* Always leave final '\0' in place */
+      strncpy(info->label, ptile->label, sizeof(info->label) - 1);
+      info->label[sizeof(info->label) - 1] = '\0';
+    } else {
+      info->label[0] = '\0';
+    }
+
+    return TRUE;
+  } else if (map_is_known(ptile, pplayer)) {
+    struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
+    struct vision_site *psite = map_get_player_site(ptile, pplayer);
+
+    info->known = TILE_KNOWN_UNSEEN;
+    info->continent = tile_continent(ptile);
+    owner = (game.server.foggedborders
+             ? plrtile->owner
+             : tile_owner(ptile));
+    eowner = plrtile->extras_owner;
+    info->owner = (owner ? player_number(owner) : MAP_TILE_OWNER_NULL);
+    info->extras_owner = (eowner ? player_number(eowner) : MAP_TILE_OWNER_NULL);
+    info->worked = (NULL != psite)
+                   ? psite->identity
+                   : IDENTITY_NUMBER_ZERO;
+
+    info->terrain = (NULL != plrtile->terrain)
+                    ? terrain_number(plrtile->terrain)
+                    : terrain_count();
+    info->resource = (NULL != plrtile->resource)
+                     ? extra_number(plrtile->resource)
+                     : MAX_EXTRA_TYPES;
+
+    info->extras = plrtile->extras;
+
+    /* Labels never change, so they are not subject to fog of war */
+    if (ptile->label != NULL) {
+      sz_strlcpy(info->label, ptile->label);
+    } else {
+      info->label[0] = '\0';
+    }
+
+    return TRUE;
+  } else if (send_unknown) {
+    info->known = TILE_UNKNOWN;
+    info->continent = 0;
+    info->owner = MAP_TILE_OWNER_NULL;
+    info->extras_owner = MAP_TILE_OWNER_NULL;
+    info->worked = IDENTITY_NUMBER_ZERO;
+
+    info->terrain = terrain_count();
+    info->resource = MAX_EXTRA_TYPES;
+
+    BV_CLR_ALL(info->extras);
+
+    info->label[0] = '\0';
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
 /**********************************************************************//**
   Send tile information to all the clients in dest which know and see
   the tile. If dest is NULL, sends to all clients (game.est_connections)
@@ -476,8 +782,9 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
                     bool send_unknown)
 {
   struct packet_tile_info info;
-  const struct player *owner;
-  const struct player *eowner;
+  const struct player *filled_for = NULL;
+  bool filled = FALSE;
+  bool send = FALSE;
 
   if (dest == NULL) {
     CALL_FUNC_EACH_AI(tile_info, ptile);
@@ -487,16 +794,13 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
     return;
   }
 
-  if (!dest) {
-    dest = game.est_connections;
+  if (dest == NULL && !send_unknown && tile_info_batch.depth > 0) {
+    tile_info_batch_add(ptile, NULL, TRUE);
+    return;
   }
 
-  info.tile = tile_index(ptile);
-
-  if (ptile->spec_sprite) {
-    sz_strlcpy(info.spec_sprite, ptile->spec_sprite);
-  } else {
-    info.spec_sprite[0] = '\0';
+  if (!dest) {
+    dest = game.est_connections;
   }
 
   conn_list_iterate(dest, pconn) {
@@ -506,85 +810,14 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
       continue;
     }
 
-    if (!pplayer || map_is_known_and_seen(ptile, pplayer, V_MAIN)) {
-      info.known = TILE_KNOWN_SEEN;
-      info.continent = tile_continent(ptile);
-      owner = tile_owner(ptile);
-      eowner = extra_owner(ptile);
-      info.owner = (owner ? player_number(owner) : MAP_TILE_OWNER_NULL);
-      info.extras_owner = (eowner ? player_number(eowner) : MAP_TILE_OWNER_NULL);
-      info.worked = (NULL != tile_worked(ptile))
-                     ? tile_worked(ptile)->id
-                     : IDENTITY_NUMBER_ZERO;
-
-      info.terrain = (NULL != tile_terrain(ptile))
-                      ? terrain_number(tile_terrain(ptile))
-                      : terrain_count();
-      info.resource = (NULL != tile_resource(ptile))
-                       ? extra_number(tile_resource(ptile))
-                       : MAX_EXTRA_TYPES;
-
-      if (pplayer != NULL) {
-	info.extras = map_get_player_tile(ptile, pplayer)->extras;
-      } else {
-	info.extras = ptile->extras;
-      }
-
-      if (ptile->label != NULL) {
-        /* Always leave final '\0' in place */
-        strncpy(info.label, ptile->label, sizeof(info.label) - 1);
-      } else {
-        info.label[0] = '\0';
-      }
-
-      send_packet_tile_info(pconn, &info);
-    } else if (pplayer && map_is_known(ptile, pplayer)) {
-      struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
-      struct vision_site *psite = map_get_player_site(ptile, pplayer);
-
-      info.known = TILE_KNOWN_UNSEEN;
-      info.continent = tile_continent(ptile);
-      owner = (game.server.foggedborders
-               ? plrtile->owner
-               : tile_owner(ptile));
-      eowner = plrtile->extras_owner;
-      info.owner = (owner ? player_number(owner) : MAP_TILE_OWNER_NULL);
-      info.extras_owner = (eowner ? player_number(eowner) : MAP_TILE_OWNER_NULL);
-      info.worked = (NULL != psite)
-                    ? psite->identity
-                    : IDENTITY_NUMBER_ZERO;
-
-      info.terrain = (NULL != plrtile->terrain)
-                      ? terrain_number(plrtile->terrain)
-                      : terrain_count();
-      info.resource = (NULL != plrtile->resource)
-                       ? extra_number(plrtile->resource)
-                       : MAX_EXTRA_TYPES;
-
-      info.extras = plrtile->extras;
-
-      /* Labels never change, so they are not subject to fog of war */
-      if (ptile->label != NULL) {
-        sz_strlcpy(info.label, ptile->label);
-      } else {
-        info.label[0] = '\0';
-      }
-
-      send_packet_tile_info(pconn, &info);
-    } else if (send_unknown) {
-      info.known = TILE_UNKNOWN;
-      info.continent = 0;
-      info.owner = MAP_TILE_OWNER_NULL;
-      info.extras_owner = MAP_TILE_OWNER_NULL;
-      info.worked = IDENTITY_NUMBER_ZERO;
-
-      info.terrain = terrain_count();
-      info.resource = MAX_EXTRA_TYPES;
-
-      BV_CLR_ALL(info.extras);
-
-      info.label[0] = '\0';
+    /* Connections of the same player see the same. */
+    if (!filled || pplayer != filled_for) {
+      send = tile_info_fill(&info, ptile, pplayer, send_unknown);
+      filled_for = pplayer;
+      filled = TRUE;
+    }
 
+    if (send) {
       send_packet_tile_info(pconn, &info);
     }
   }
@@ -686,6 +919,134 @@ void map_vision_update(struct player *pplayer, struct tile *ptile,
   unbuffer_shared_vision(pplayer);
 }
 
+/**********************************************************************//**
+  Return the mask of the tiles that enter and leave the sight of a vision
+  source with the given radii when it moves by (step_dx, step_dy). Both
+  lists are built by walking wld.map.iterate_outwards_indices, so they
+  keep its order. circle_dxyr_iterate() goes through square_dxy_iterate()
+  over the same indices, so map_vision_update() visits the tiles in that
+  order as well.
+**************************************************************************/
+static const struct vision_delta_mask *
+vision_delta_mask_get(const v_radius_t radius_sq, int step_dx, int step_dy)
+{
+  struct vision_delta_mask *mask;
+  int max_radius = 0;
+  int cr_radius, i;
+
+  for (mask = vision_delta_masks; mask != NULL; mask = mask->next) {
+    if (mask->step_dx == step_dx && mask->step_dy == step_dy
+        && mask->topology_id == wld.map.topology_id
+        && 0 == memcmp(mask->radius_sq, radius_sq, sizeof(v_radius_t))) {
+      return mask;
+    }
+  }
+
+  vision_layer_iterate(v) {
+    if (max_radius < radius_sq[v]) {
+      max_radius = radius_sq[v];
+    }
+  } vision_layer_iterate_end;
+  cr_radius = (int)sqrt((double)max_radius);
+
+  mask = fc_calloc(1, sizeof(*mask));
+  memcpy(mask->radius_sq, radius_sq, sizeof(v_radius_t));
+  mask->step_dx = step_dx;
+  mask->step_dy = step_dy;
+  mask->topology_id = wld.map.topology_id;
+
+  for (i = 0; i < wld.map.num_iterate_outwards_indices; i++) {
+    int dx = wld.map.iterate_outwards_indices[i].dx;
+    int dy = wld.map.iterate_outwards_indices[i].dy;
+    int dr = map_vector_to_sq_distance(dx, dy);
+    /* The same tile as seen from the other end of the step. */
+    int dr_from_old = map_vector_to_sq_distance(dx + step_dx, dy + step_dy);
+    int dr_from_new = map_vector_to_sq_distance(dx - step_dx, dy - step_dy);
+    struct vision_delta enter = { dx, dy, V_RADIUS(0, 0, 0) };
+    struct vision_delta leave = { dx, dy, V_RADIUS(0, 0, 0) };
+    bool enters = FALSE, leaves = FALSE;
+
+    if (wld.map.iterate_outwards_indices[i].dist > cr_radius) {
+      break;
+    }
+    if (dr > max_radius) {
+      continue;
+    }
+
+    vision_layer_iterate(v) {
+      if (dr <= radius_sq[v] && dr_from_old > radius_sq[v]) {
+        enter.change[v] = 1;
+        enters = TRUE;
+      }
+      if (dr <= radius_sq[v] && dr_from_new > radius_sq[v]) {
+        leave.change[v] = 1;
+        leaves = TRUE;
+      }
+    } vision_layer_iterate_end;
+
+    if (enters) {
+      mask->enter = fc_realloc(mask->enter,
+                               (mask->num_enter + 1) * sizeof(*mask->enter));
+      mask->enter[mask->num_enter++] = enter;
+    }
+    if (leaves) {
+      mask->leave = fc_realloc(mask->leave,
+                               (mask->num_leave + 1) * sizeof(*mask->leave));
+      mask->leave[mask->num_leave++] = leave;
+    }
+  }
+
+  mask->next = vision_delta_masks;
+  vision_delta_masks = mask;
+
+  return mask;
+}
+
+/**********************************************************************//**
+  Add sign to the seen counts of the tiles in the delta list around
+  ptile, as map_vision_update() would for them.
+**************************************************************************/
+static void vision_delta_apply(struct player *pplayer, struct tile *ptile,
+                               const struct vision_delta *deltas, int count,
+                               int sign, bool can_reveal_tiles)
+{
+  int center_x, center_y, i;
+
+  index_to_map_pos(&center_x, &center_y, tile_index(ptile));
+
+  buffer_shared_vision(pplayer);
+  for (i = 0; i < count; i++) {
+    struct tile *tile1 = map_pos_to_tile(&(wld.map),
+                                         center_x + deltas[i].dx,
+                                         center_y + deltas[i].dy);
+    v_radius_t change;
+
+    if (NULL == tile1) {
+      continue;
+    }
+    vision_layer_iterate(v) {
+      change[v] = sign * deltas[i].change[v];
+    } vision_layer_iterate_end;
+    shared_vision_change_seen(pplayer, tile1, change, can_reveal_tiles);
+  }
+  unbuffer_shared_vision(pplayer);
+}
+
+/**********************************************************************//**
+  Free the masks built by vision_delta_mask_get().
+**************************************************************************/
+void vision_delta_masks_free(void)
+{
+  while (NULL != vision_delta_masks) {
+    struct vision_delta_mask *mask = vision_delta_masks;
+
+    vision_delta_masks = mask->next;
+    free(mask->enter);
+    free(mask->leave);
+    free(mask);
+  }
+}
+
 /**********************************************************************//**
   Turn a players ability to see inside his borders on or off.
 
@@ -873,7 +1234,7 @@ static inline int map_get_seen(const struct player *pplayer,
                                const struct tile *ptile,
                                enum vision_layer vlayer)
 {
-  return map_get_player_tile(ptile, pplayer)->seen_count[vlayer];
+  return pplayer->server.seen_count[vlayer][tile_index(ptile)];
 }
 
 /**********************************************************************//**
@@ -888,6 +1249,8 @@ void map_change_seen(struct player *pplayer,
                      bool can_reveal_tiles)
 {
   struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
+  short int **seen_count = pplayer->server.seen_count;
+  int tindex = tile_index(ptile);
   bool revealing_tile = FALSE;
 
 #ifdef FREECIV_DEBUG
@@ -896,15 +1259,17 @@ void map_change_seen(struct player *pplayer,
             TILE_XY(ptile));
   vision_layer_iterate(v) {
     log_debug("  vision layer %d is changing from %d to %d.",
-              v, plrtile->seen_count[v], plrtile->seen_count[v] + change[v]);
+              v, seen_count[v][tindex], seen_count[v][tindex] + change[v]);
   } vision_layer_iterate_end;
 #endif /* FREECIV_DEBUG */
 
+  pf_map_cache_invalidate();
+
   /* Removes units out of vision. First, check invisible layers because
    * we must remove all units before fog of war because clients expect
    * the tile is empty when it is fogged. */
   if (0 > change[V_INVIS]
-      && plrtile->seen_count[V_INVIS] == -change[V_INVIS]) {
+      && seen_count[V_INVIS][tindex] == -change[V_INVIS]) {
     log_debug("(%d, %d): hiding invisible units to player %s (nb %d).",
               TILE_XY(ptile), player_name(pplayer), player_number(pplayer));
 
@@ -916,7 +1281,7 @@ void map_change_seen(struct player *pplayer,
     } unit_list_iterate_end;
   }
   if (0 > change[V_SUBSURFACE]
-      && plrtile->seen_count[V_SUBSURFACE] == -change[V_SUBSURFACE]) {
+      && seen_count[V_SUBSURFACE][tindex] == -change[V_SUBSURFACE]) {
     log_debug("(%d, %d): hiding subsurface units to player %s (nb %d).",
               TILE_XY(ptile), player_name(pplayer), player_number(pplayer));
 
@@ -929,7 +1294,7 @@ void map_change_seen(struct player *pplayer,
   }
 
   if (0 > change[V_MAIN]
-      && plrtile->seen_count[V_MAIN] == -change[V_MAIN]) {
+      && seen_count[V_MAIN][tindex] == -change[V_MAIN]) {
     log_debug("(%d, %d): hiding visible units to player %s (nb %d).",
               TILE_XY(ptile), player_name(pplayer), player_number(pplayer));
 
@@ -943,8 +1308,8 @@ void map_change_seen(struct player *pplayer,
 
   vision_layer_iterate(v) {
     /* Avoid underflow. */
-    fc_assert(0 <= change[v] || -change[v] <= plrtile->seen_count[v]);
-    plrtile->seen_count[v] += change[v];
+    fc_assert(0 <= change[v] || -change[v] <= seen_count[v][tindex]);
+    seen_count[v][tindex] += change[v];
   } vision_layer_iterate_end;
 
   /* V_MAIN vision ranges must always be more than invisible ranges
@@ -952,13 +1317,13 @@ void map_change_seen(struct player *pplayer,
    * seen count cannot be inferior to V_INVIS or V_SUBSURFACE seen count.
    * Moreover, when the fog of war is disabled, V_MAIN has an extra
    * seen count point. */
-  fc_assert(plrtile->seen_count[V_INVIS] + !game.info.fogofwar
-            <= plrtile->seen_count[V_MAIN]);
-  fc_assert(plrtile->seen_count[V_SUBSURFACE] + !game.info.fogofwar
-            <= plrtile->seen_count[V_MAIN]);
+  fc_assert(seen_count[V_INVIS][tindex] + !game.info.fogofwar
+            <= seen_count[V_MAIN][tindex]);
+  fc_assert(seen_count[V_SUBSURFACE][tindex] + !game.info.fogofwar
+            <= seen_count[V_MAIN][tindex]);
 
   if (!map_is_known(ptile, pplayer)) {
-    if (0 < plrtile->seen_count[V_MAIN] && can_reveal_tiles) {
+    if (0 < seen_count[V_MAIN][tindex] && can_reveal_tiles) {
       log_debug("(%d, %d): revealing tile to player %s (nb %d).",
                 TILE_XY(ptile), player_name(pplayer),
                 player_number(pplayer));
@@ -971,7 +1336,7 @@ void map_change_seen(struct player *pplayer,
   }
 
   /* Fog the tile. */
-  if (0 > change[V_MAIN] && 0 == plrtile->seen_count[V_MAIN]) {
+  if (0 > change[V_MAIN] && 0 == seen_count[V_MAIN][tindex]) {
     log_debug("(%d, %d): fogging tile for player %s (nb %d).",
               TILE_XY(ptile), player_name(pplayer), player_number(pplayer));
 
@@ -983,12 +1348,12 @@ void map_change_seen(struct player *pplayer,
     send_tile_info(pplayer->connections, ptile, FALSE);
   }
 
-  if ((revealing_tile && 0 < plrtile->seen_count[V_MAIN])
+  if ((revealing_tile && 0 < seen_count[V_MAIN][tindex])
       || (0 < change[V_MAIN]
-          /* plrtile->seen_count[V_MAIN] Always set to 1
+          /* seen_count[V_MAIN][tindex] Always set to 1
             * when the fog of war is disabled. */
           && (change[V_MAIN] + !game.info.fogofwar
-              == (plrtile->seen_count[V_MAIN])))) {
+              == (seen_count[V_MAIN][tindex])))) {
     struct city *pcity;
 
     log_debug("(%d, %d): unfogging tile for player %s (nb %d).",
@@ -1016,9 +1381,9 @@ void map_change_seen(struct player *pplayer,
     }
   }
 
-  if ((revealing_tile && 0 < plrtile->seen_count[V_INVIS])
+  if ((revealing_tile && 0 < seen_count[V_INVIS][tindex])
       || (0 < change[V_INVIS]
-          && change[V_INVIS] == plrtile->seen_count[V_INVIS])) {
+          && change[V_INVIS] == seen_count[V_INVIS][tindex])) {
     log_debug("(%d, %d): revealing invisible units to player %s (nb %d).",
               TILE_XY(ptile), player_name(pplayer),
               player_number(pplayer));
@@ -1029,9 +1394,9 @@ void map_change_seen(struct player *pplayer,
       }
     } unit_list_iterate_end;
   }
-  if ((revealing_tile && 0 < plrtile->seen_count[V_SUBSURFACE])
+  if ((revealing_tile && 0 < seen_count[V_SUBSURFACE][tindex])
       || (0 < change[V_SUBSURFACE]
-          && change[V_SUBSURFACE] == plrtile->seen_count[V_SUBSURFACE])) {
+          && change[V_SUBSURFACE] == seen_count[V_SUBSURFACE][tindex])) {
     log_debug("(%d, %d): revealing subsurface units to player %s (nb %d).",
               TILE_XY(ptile), player_name(pplayer),
               player_number(pplayer));
@@ -1054,7 +1419,7 @@ static inline int map_get_own_seen(const struct player *pplayer,
                                    const struct tile *ptile,
                                    enum vision_layer vlayer)
 {
-  return map_get_player_tile(ptile, pplayer)->own_seen[vlayer];
+  return pplayer->server.own_seen[vlayer][tile_index(ptile)];
 }
 
 /**********************************************************************//**
@@ -1064,10 +1429,10 @@ static void map_change_own_seen(struct player *pplayer,
                                 struct tile *ptile,
                                 const v_radius_t change)
 {
-  struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
+  int tindex = tile_index(ptile);
 
   vision_layer_iterate(v) {
-    plrtile->own_seen[v] += change[v];
+    pplayer->server.own_seen[v][tindex] += change[v];
   } vision_layer_iterate_end;
 }
 
@@ -1095,6 +1460,7 @@ void change_playertile_site(struct player_tile *ptile,
 **************************************************************************/
 void map_set_known(struct tile *ptile, struct player *pplayer)
 {
+  pf_map_cache_invalidate();
   dbv_set(&pplayer->tile_known, tile_index(ptile));
 }
 
@@ -1103,6 +1469,7 @@ void map_set_known(struct tile *ptile, struct player *pplayer)
 **************************************************************************/
 void map_clear_known(struct tile *ptile, struct player *pplayer)
 {
+  pf_map_cache_invalidate();
   dbv_clr(&pplayer->tile_known, tile_index(ptile));
 }
 
@@ -1146,6 +1513,24 @@ void player_map_init(struct player *pplayer)
     player_tile_init(ptile, pplayer);
   } whole_map_iterate_end;
 
+  /* We need to use fogofwar_old here, so the player's tiles get
+   * in the same state as the other players' tiles. */
+  vision_layer_iterate(v) {
+    short int initial = (v == V_MAIN ? !game.server.fogofwar_old : 0);
+    int i;
+
+    pplayer->server.seen_count[v]
+      = fc_realloc(pplayer->server.seen_count[v],
+                   MAP_INDEX_SIZE * sizeof(*pplayer->server.seen_count[v]));
+    pplayer->server.own_seen[v]
+      = fc_realloc(pplayer->server.own_seen[v],
+                   MAP_INDEX_SIZE * sizeof(*pplayer->server.own_seen[v]));
+    for (i = 0; i < MAP_INDEX_SIZE; i++) {
+      pplayer->server.seen_count[v][i] = initial;
+      pplayer->server.own_seen[v][i] = initial;
+    }
+  } vision_layer_iterate_end;
+
   dbv_init(&pplayer->tile_known, MAP_INDEX_SIZE);
 }
 
@@ -1165,6 +1550,13 @@ void player_map_free(struct player *pplayer)
   free(pplayer->server.private_map);
   pplayer->server.private_map = NULL;
 
+  vision_layer_iterate(v) {
+    free(pplayer->server.seen_count[v]);
+    pplayer->server.seen_count[v] = NULL;
+    free(pplayer->server.own_seen[v]);
+    pplayer->server.own_seen[v] = NULL;
+  } vision_layer_iterate_end;
+
   dbv_free(&pplayer->tile_known);
 }
 
@@ -1240,8 +1632,7 @@ void remove_player_from_maps(struct player *pplayer)
 }
 
 /**********************************************************************//**
-  We need to use fogofwar_old here, so the player's tiles get
-  in the same state as the other players' tiles.
+  Initialise what the player remembers of the tile.
 **************************************************************************/
 static void player_tile_init(struct tile *ptile, struct player *pplayer)
 {
@@ -1258,11 +1649,6 @@ static void player_tile_init(struct tile *ptile, struct player *pplayer)
   } else {
     plrtile->last_updated = game.info.year;
   }
-
-  plrtile->seen_count[V_MAIN] = !game.server.fogofwar_old;
-  plrtile->seen_count[V_INVIS] = 0;
-  plrtile->seen_count[V_SUBSURFACE] = 0;
-  memcpy(plrtile->own_seen, plrtile->seen_count, sizeof(v_radius_t));
 }
 
 /**********************************************************************//**
@@ -1369,15 +1755,26 @@ void update_tile_knowledge(struct tile *ptile)
     return;
   }
 
+  pf_map_cache_invalidate();
+
   /* Players */
   players_iterate(pplayer) {
     if (map_is_known_and_seen(ptile, pplayer, V_MAIN)) {
       if (update_player_tile_knowledge(pplayer, ptile)) {
-        send_tile_info(pplayer->connections, ptile, FALSE);
+        if (tile_info_batch.depth > 0 && !send_tile_suppressed) {
+          tile_info_batch_add(ptile, pplayer, FALSE);
+        } else {
+          send_tile_info(pplayer->connections, ptile, FALSE);
+        }
       }
     }
   } players_iterate_end;
 
+  if (tile_info_batch.depth > 0 && !send_tile_suppressed) {
+    tile_info_batch_add(ptile, NULL, FALSE);
+    return;
+  }
+
   /* Global observers */
   conn_list_iterate(game.est_connections, pconn) {
     struct player *pplayer = pconn->playing;
@@ -1475,9 +1872,15 @@ static void really_give_tile_info_from_player_to_player(struct player *pfrom,
 static void really_give_map_from_player_to_player(struct player *pfrom,
                                                   struct player *pdest)
 {
-  whole_map_iterate(&(wld.map), ptile) {
-    really_give_tile_info_from_player_to_player(pfrom, pdest, ptile);
-  } whole_map_iterate_end;
+  int tindex;
+
+  /* Only tiles known by pfrom can be given. */
+  for (tindex = dbv_next_set(&pfrom->tile_known, 0); tindex >= 0;
+       tindex = dbv_next_set(&pfrom->tile_known, tindex + 1)) {
+    really_give_tile_info_from_player_to_player(pfrom, pdest,
+                                                index_to_tile(&(wld.map),
+                                                              tindex));
+  }
 
   city_thaw_workers_queue();
   sync_cities();
@@ -2042,6 +2445,7 @@ static void map_claim_border_ownership(struct tile *ptile,
 void map_claim_ownership(struct tile *ptile, struct player *powner,
                          struct tile *psource, bool claim_bases)
 {
+  pf_map_cache_invalidate();
   map_claim_border_ownership(ptile, powner, psource);
 
   if (claim_bases) {
@@ -2218,11 +2622,13 @@ void map_calculate_borders(void)
 
   log_verbose("map_calculate_borders()");
 
+  send_tile_info_batch_begin();
   whole_map_iterate(&(wld.map), ptile) {
     if (is_border_source(ptile)) {
       map_claim_border(ptile, ptile->owner, -1);
     }
   } whole_map_iterate_end;
+  send_tile_info_batch_end();
 
   log_verbose("map_calculate_borders() workers");
   city_thaw_workers_queue();
@@ -2352,9 +2758,68 @@ void vision_clear_sight(struct vision *vision)
 {
   const v_radius_t vision_radius_sq = V_RADIUS(-1, -1, -1);
 
+  if (NULL != vision->handed_over) {
+    /* The new source already holds the tiles both of them see. */
+    const struct vision_delta_mask *mask = vision->handed_over;
+
+    vision_delta_apply(vision->player, vision->tile, mask->leave,
+                       mask->num_leave, -1, vision->can_reveal_tiles);
+    vision->handed_over = NULL;
+    memcpy(vision->radius_sq, vision_radius_sq, sizeof(v_radius_t));
+    return;
+  }
+
   vision_change_sight(vision, vision_radius_sq);
 }
 
+/**********************************************************************//**
+  Give the sight points to a new vision source that replaces old_vision
+  at an adjacent tile, as for a unit moving one step. Only the tiles
+  that are not already seen by old_vision get updated; the old source
+  then keeps the tiles that only it sees, and vision_clear_sight() on it
+  only fogs those. Falls back to vision_change_sight() when the sources
+  do not match or the circle is too large for the map to tell its tiles
+  apart.
+
+  See documentation in vision.h.
+**************************************************************************/
+void vision_move_sight(struct vision *new_vision, struct vision *old_vision,
+                       const v_radius_t radius_sq)
+{
+  const struct vision_delta_mask *mask;
+  int step_dx, step_dy, cr_radius;
+
+  if (NULL == old_vision
+      || NULL != old_vision->handed_over
+      || new_vision->player != old_vision->player
+      || new_vision->can_reveal_tiles != old_vision->can_reveal_tiles
+      || 0 != memcmp(old_vision->radius_sq, radius_sq, sizeof(v_radius_t))
+      || radius_sq[V_MAIN] < 0
+      || -1 != new_vision->radius_sq[V_MAIN]
+      || -1 != new_vision->radius_sq[V_INVIS]
+      || -1 != new_vision->radius_sq[V_SUBSURFACE]) {
+    vision_change_sight(new_vision, radius_sq);
+    return;
+  }
+
+  /* With wrapping, two offsets of the circles must never be the same
+   * tile. Keep the circles well within half of the map. */
+  cr_radius = (int)sqrt((double)radius_sq[V_MAIN]);
+  map_distance_vector(&step_dx, &step_dy, old_vision->tile,
+                      new_vision->tile);
+  if (abs(step_dx) > 1 || abs(step_dy) > 1
+      || 4 * (cr_radius + 1) >= MIN(wld.map.xsize, wld.map.ysize)) {
+    vision_change_sight(new_vision, radius_sq);
+    return;
+  }
+
+  mask = vision_delta_mask_get(radius_sq, step_dx, step_dy);
+  vision_delta_apply(new_vision->player, new_vision->tile, mask->enter,
+                     mask->num_enter, 1, new_vision->can_reveal_tiles);
+  memcpy(new_vision->radius_sq, radius_sq, sizeof(v_radius_t));
+  old_vision->handed_over = mask;
+}
+
 /**********************************************************************//**
   Create extra to tile.
 **************************************************************************/
@@ -34,12 +34,7 @@ struct player_tile {
   struct player *extras_owner;
   bv_extras extras;
 
-  /* If you build a city with an unknown square within city radius
-     the square stays unknown. However, we still have to keep count
-     of the seen points, so they are kept in here. When the tile
-     then becomes known they are moved to seen. */
-  v_radius_t own_seen;
-  v_radius_t seen_count;
+  /* The seen counts are in pplayer->server.seen_count and own_seen. */
   short last_updated;
 };
 
@@ -56,6 +51,9 @@ void give_citymap_from_player_to_player(struct city *pcity,
 void send_all_known_tiles(struct conn_list *dest);
 
 bool send_tile_suppression(bool now);
+void send_tile_info_batch_begin(void);
+void send_tile_info_batch_end(void);
+void send_tile_info_batch_free(void);
 void send_tile_info(struct conn_list *dest, struct tile *ptile,
                     bool send_unknown);
 
@@ -130,6 +128,9 @@ void bounce_units_on_terrain_change(struct tile *ptile);
 void vision_change_sight(struct vision *vision,
                          const v_radius_t radius_sq);
 void vision_clear_sight(struct vision *vision);
+void vision_move_sight(struct vision *new_vision, struct vision *old_vision,
+                       const v_radius_t radius_sq);
+void vision_delta_masks_free(void);
 
 void change_playertile_site(struct player_tile *ptile,
                             struct vision_site *new_site);
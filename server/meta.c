@@ -482,6 +482,19 @@ bool is_metaserver_open(void)
   return server_is_open;
 }
 
+/*********************************************************************//**
+  Wait until the thread sending info to the metaserver, if any, has
+  finished. The next send starts a new one.
+*************************************************************************/
+void server_meta_thread_wait(void)
+{
+  if (meta_srv_thread != NULL) {
+    fc_thread_wait(meta_srv_thread);
+    free(meta_srv_thread);
+    meta_srv_thread = NULL;
+  }
+}
+
 /*********************************************************************//**
   Control when we send info to the metaserver.
 *************************************************************************/
@@ -512,9 +525,7 @@ bool send_server_info_to_metaserver(enum meta_flag flag)
     send_to_metaserver(flag);
 
     /* Wait metaserver thread to finish */
-    fc_thread_wait(meta_srv_thread);
-    free(meta_srv_thread);
-    meta_srv_thread = NULL;
+    server_meta_thread_wait();
 
     return TRUE;
   }
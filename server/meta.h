@@ -47,6 +47,7 @@ char *meta_addr_port(void);
 void server_close_meta(void);
 bool server_open_meta(bool persistent);
 bool is_metaserver_open(void);
+void server_meta_thread_wait(void);
 
 bool send_server_info_to_metaserver(enum meta_flag flag);
 
@@ -480,32 +480,143 @@ struct event_cache_data {
   enum server_states server_state;
   enum event_cache_target target_type;
   bv_player target;     /* Used if target_type == ECT_PLAYERS. */
+  unsigned int serial;  /* Order in which the events were added. */
 };
 
-#define SPECLIST_TAG event_cache_data
-#define SPECLIST_TYPE struct event_cache_data
-#include "speclist.h"
-#define event_cache_iterate(pdata) \
-    TYPED_LIST_ITERATE(struct event_cache_data, event_cache, pdata)
-#define event_cache_iterate_end  LIST_ITERATE_END
+/* Events in the order they were added. Events only ever get added at the
+ * end and removed at the start, so a ring buffer holds them. */
+struct event_cache_ring {
+  struct event_cache_data **events;
+  int size;             /* Allocated slots. */
+  int first;            /* Slot of the oldest event. */
+  int count;
+};
+
+#define event_cache_iterate(pdata) {                                        \
+  int _pdata##_i;                                                           \
+                                                                            \
+  for (_pdata##_i = 0;                                                      \
+       NULL != event_cache && _pdata##_i < event_cache->count;              \
+       _pdata##_i++) {                                                      \
+    struct event_cache_data *pdata =                                        \
+        event_cache_ring_get(event_cache, _pdata##_i);
+#define event_cache_iterate_end  }}
 
 struct event_cache_players {
   bv_player vector;
 };
 
-/* The full list of the events. */
-static struct event_cache_data_list *event_cache = NULL;
+/* The full list of the events. This ring owns them. */
+static struct event_cache_ring *event_cache = NULL;
+
+/* The same events, by who may see them, so that sending the pending
+ * events to a connection only goes through the ones for it. */
+static struct event_cache_ring *event_cache_for_all = NULL;
+static struct event_cache_ring *event_cache_for_observers = NULL;
+static struct event_cache_ring *event_cache_for_player[MAX_NUM_PLAYER_SLOTS];
+
+/* Serial number of the next event. */
+static unsigned int event_cache_serial = 0;
 
 /* Event cache status: ON(TRUE) / OFF(FALSE); used for saving the
  * event cache */
 static bool event_cache_status = FALSE;
 
 /**********************************************************************//**
-  Callback for freeing event cache data
+  Create an empty event ring.
+**************************************************************************/
+static struct event_cache_ring *event_cache_ring_new(void)
+{
+  return fc_calloc(1, sizeof(struct event_cache_ring));
+}
+
+/**********************************************************************//**
+  Free an event ring. The events themselves are not freed.
+**************************************************************************/
+static void event_cache_ring_destroy(struct event_cache_ring *ring)
+{
+  if (NULL != ring) {
+    free(ring->events);
+    free(ring);
+  }
+}
+
+/**********************************************************************//**
+  Return the i-th oldest event of the ring.
+**************************************************************************/
+static inline struct event_cache_data *
+event_cache_ring_get(const struct event_cache_ring *ring, int i)
+{
+  return ring->events[(ring->first + i) % ring->size];
+}
+
+/**********************************************************************//**
+  Add an event at the end of the ring.
+**************************************************************************/
+static void event_cache_ring_push(struct event_cache_ring *ring,
+                                  struct event_cache_data *pdata)
+{
+  if (ring->count == ring->size) {
+    int size = MAX(16, 2 * ring->size);
+    struct event_cache_data **events = fc_malloc(size * sizeof(*events));
+    int i;
+
+    for (i = 0; i < ring->count; i++) {
+      events[i] = event_cache_ring_get(ring, i);
+    }
+    free(ring->events);
+    ring->events = events;
+    ring->size = size;
+    ring->first = 0;
+  }
+
+  ring->events[(ring->first + ring->count) % ring->size] = pdata;
+  ring->count++;
+}
+
+/**********************************************************************//**
+  Remove the oldest event of the ring, which must be pdata.
 **************************************************************************/
-static void event_cache_data_free(struct event_cache_data *data)
+static void event_cache_ring_pop(struct event_cache_ring *ring,
+                                 const struct event_cache_data *pdata)
 {
-  free(data);
+  fc_assert_ret(NULL != ring && 0 < ring->count);
+  fc_assert(event_cache_ring_get(ring, 0) == pdata);
+
+  ring->first = (ring->first + 1) % ring->size;
+  ring->count--;
+}
+
+/**********************************************************************//**
+  Remove the oldest event from the cache and free it.
+**************************************************************************/
+static void event_cache_pop_oldest(void)
+{
+  struct event_cache_data *pdata = event_cache_ring_get(event_cache, 0);
+
+  event_cache_ring_pop(event_cache, pdata);
+
+  switch (pdata->target_type) {
+  case ECT_ALL:
+    event_cache_ring_pop(event_cache_for_all, pdata);
+    break;
+  case ECT_PLAYERS:
+    {
+      int i;
+
+      for (i = 0; i < MAX_NUM_PLAYER_SLOTS; i++) {
+        if (BV_ISSET(pdata->target, i)) {
+          event_cache_ring_pop(event_cache_for_player[i], pdata);
+        }
+      }
+    }
+    break;
+  case ECT_GLOBAL_OBSERVERS:
+    event_cache_ring_pop(event_cache_for_observers, pdata);
+    break;
+  }
+
+  free(pdata);
 }
 
 /**********************************************************************//**
@@ -553,13 +664,37 @@ event_cache_data_new(const struct packet_chat_msg *packet,
   } else {
     BV_CLR_ALL(pdata->target);
   }
-  event_cache_data_list_append(event_cache, pdata);
+  pdata->serial = event_cache_serial++;
+  event_cache_ring_push(event_cache, pdata);
+
+  switch (target_type) {
+  case ECT_ALL:
+    event_cache_ring_push(event_cache_for_all, pdata);
+    break;
+  case ECT_PLAYERS:
+    {
+      int i;
+
+      for (i = 0; i < MAX_NUM_PLAYER_SLOTS; i++) {
+        if (BV_ISSET(pdata->target, i)) {
+          if (NULL == event_cache_for_player[i]) {
+            event_cache_for_player[i] = event_cache_ring_new();
+          }
+          event_cache_ring_push(event_cache_for_player[i], pdata);
+        }
+      }
+    }
+    break;
+  case ECT_GLOBAL_OBSERVERS:
+    event_cache_ring_push(event_cache_for_observers, pdata);
+    break;
+  }
 
   max_events = game.server.event_cache.max_size
                ? game.server.event_cache.max_size
                : GAME_MAX_EVENT_CACHE_MAX_SIZE;
-  while (event_cache_data_list_size(event_cache) > max_events) {
-    event_cache_data_list_pop_front(event_cache);
+  while (event_cache->count > max_events) {
+    event_cache_pop_oldest();
   }
 
   return pdata;
@@ -573,7 +708,9 @@ void event_cache_init(void)
   if (event_cache != NULL) {
     event_cache_free();
   }
-  event_cache = event_cache_data_list_new_full(event_cache_data_free);
+  event_cache = event_cache_ring_new();
+  event_cache_for_all = event_cache_ring_new();
+  event_cache_for_observers = event_cache_ring_new();
   event_cache_status = TRUE;
 }
 
@@ -583,8 +720,19 @@ void event_cache_init(void)
 void event_cache_free(void)
 {
   if (event_cache != NULL) {
-    event_cache_data_list_destroy(event_cache);
+    int i;
+
+    event_cache_clear();
+    event_cache_ring_destroy(event_cache);
     event_cache = NULL;
+    event_cache_ring_destroy(event_cache_for_all);
+    event_cache_for_all = NULL;
+    event_cache_ring_destroy(event_cache_for_observers);
+    event_cache_for_observers = NULL;
+    for (i = 0; i < MAX_NUM_PLAYER_SLOTS; i++) {
+      event_cache_ring_destroy(event_cache_for_player[i]);
+      event_cache_for_player[i] = NULL;
+    }
   }
   event_cache_status = FALSE;
 }
@@ -594,7 +742,9 @@ void event_cache_free(void)
 **************************************************************************/
 void event_cache_clear(void)
 {
-  event_cache_data_list_clear(event_cache);
+  while (NULL != event_cache && 0 < event_cache->count) {
+    event_cache_pop_oldest();
+  }
 }
 
 /**********************************************************************//**
@@ -602,15 +752,11 @@ void event_cache_clear(void)
 **************************************************************************/
 void event_cache_remove_old(void)
 {
-  struct event_cache_data *current;
-
   /* This assumes that entries are in order, the ones to be removed first. */
-  current = event_cache_data_list_get(event_cache, 0);
-
-    while (current != NULL
-           && current->packet.turn + game.server.event_cache.turns <= game.info.turn) {
-    event_cache_data_list_pop_front(event_cache);
-    current = event_cache_data_list_get(event_cache, 0);
+  while (NULL != event_cache && 0 < event_cache->count
+         && (event_cache_ring_get(event_cache, 0)->packet.turn
+             + game.server.event_cache.turns <= game.info.turn)) {
+    event_cache_pop_oldest();
   }
 }
 
@@ -653,12 +799,12 @@ void event_cache_add_for_player(const struct packet_chat_msg *packet,
 
   if (0 < game.server.event_cache.turns
       && (server_state() > S_S_INITIAL || !game.info.is_new_game)) {
-    struct event_cache_data *pdata;
+    struct event_cache_players players;
 
-    pdata = event_cache_data_new(packet, time(NULL),
-                                 server_state(), ECT_PLAYERS, NULL);
-    fc_assert_ret(NULL != pdata);
-    BV_SET(pdata->target, player_index(pplayer));
+    BV_CLR_ALL(players.vector);
+    BV_SET(players.vector, player_index(pplayer));
+    (void) event_cache_data_new(packet, time(NULL),
+                                server_state(), ECT_PLAYERS, &players);
   }
 }
 
@@ -757,8 +903,49 @@ void send_pending_events(struct connection *pconn, bool include_public)
   bool is_global_observer = conn_is_global_observer(pconn);
   char timestr[64];
   struct packet_chat_msg pcm;
+  struct event_cache_ring *rings[3];
+  int next[3] = { 0, 0, 0 };
+  int num_rings = 0;
+
+  if (NULL == event_cache) {
+    return;
+  }
+
+  /* Only go through the events that may be for this connection. */
+  if (NULL != pplayer
+      && NULL != event_cache_for_player[player_index(pplayer)]) {
+    rings[num_rings++] = event_cache_for_player[player_index(pplayer)];
+  }
+  if (include_public) {
+    rings[num_rings++] = event_cache_for_all;
+  }
+  if (is_global_observer) {
+    rings[num_rings++] = event_cache_for_observers;
+  }
+
+  for (;;) {
+    struct event_cache_data *pdata = NULL;
+    int i, from = -1;
+
+    /* Merge the rings back into the order the events were added. */
+    for (i = 0; i < num_rings; i++) {
+      if (next[i] < rings[i]->count) {
+        struct event_cache_data *pcandidate =
+            event_cache_ring_get(rings[i], next[i]);
+
+        /* Serial numbers may wrap around. */
+        if (NULL == pdata
+            || 0 > (int) (pcandidate->serial - pdata->serial)) {
+          pdata = pcandidate;
+          from = i;
+        }
+      }
+    }
+    if (NULL == pdata) {
+      break;
+    }
+    next[from]++;
 
-  event_cache_iterate(pdata) {
     if (event_cache_match(pdata, pplayer,
                           is_global_observer, include_public)) {
       if (game.server.event_cache.info) {
@@ -773,7 +960,7 @@ void send_pending_events(struct connection *pconn, bool include_public)
         notify_conn_packet(pconn->self, &pdata->packet, FALSE);
       }
     }
-  } event_cache_iterate_end;
+  }
 }
 
 /**********************************************************************//**
@@ -44,6 +44,9 @@
 /* common/scriptcore */
 #include "luascript_types.h"
 
+/* common/aicore */
+#include "path_finding.h"
+
 /* server */
 #include "aiiface.h"
 #include "barbarian.h"
@@ -764,6 +767,7 @@ void handle_diplomacy_cancel_pact(struct player *pplayer,
   }
 
   /* do the change */
+  pf_map_cache_invalidate();
   ds_plrplr2->type = ds_plr2plr->type = new_type;
   ds_plrplr2->turns_left = ds_plr2plr->turns_left = 16;
 
@@ -1404,7 +1408,7 @@ void server_player_init(struct player *pplayer, bool initmap,
 
   adv_data_default(pplayer);
 
-  /* We don't push this in calc_civ_score(), or it will be reset
+  /* We don't push this in calc_civ_scores(), or it will be reset
    * every turn. */
   pplayer->score.units_built = 0;
   pplayer->score.units_killed = 0;
@@ -2065,6 +2069,7 @@ void make_contact(struct player *pplayer1, struct player *pplayer2,
     enum diplstate_type new_state = get_default_diplstate(pplayer1,
                                                           pplayer2);
 
+    pf_map_cache_invalidate();
     ds_plr1plr2->type = new_state;
     ds_plr2plr1->type = new_state;
     ds_plr1plr2->first_contact_turn = game.info.turn;
@@ -196,8 +196,11 @@ static bool effect_handle_split_universal(struct effect *peffect,
     effect_copy(peffect);
 
     /* Replace the original requirement with the separated requirement. */
-    return universal_replace_in_req_vec(&peffect->reqs,
-                                        &original, &separated);
+    if (universal_replace_in_req_vec(&peffect->reqs,
+                                     &original, &separated)) {
+      effect_reqs_changed(peffect);
+      return TRUE;
+    }
   }
 
   return FALSE;
@@ -385,6 +388,7 @@ void rscompat_postprocess(struct rscompat_info *info)
                                   req_from_str("UnitClassFlag", "Local",
                                                FALSE, FALSE, TRUE,
                                                "Missile"));
+        action_enabler_reqs_changed(ae);
 
         /* The other allows suicide attacks. */
         enabler->action = ACTION_SUICIDE_ATTACK;
@@ -8255,6 +8255,9 @@ static bool load_rulesetdir(const char *rsdir, bool compat_mode,
 
   if (ok) {
     rscompat_postprocess(&compat_info);
+
+    /* The effects are final now. */
+    ruleset_cache_compile();
   }
 
   if (ok) {
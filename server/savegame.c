@@ -15,17 +15,36 @@
 #include <fc_config.h>
 #endif
 
+#if defined(HAVE_WORKING_FORK) && !defined(FREECIV_MSWINDOWS)
+#define HAVE_USABLE_FORK
+#endif
+
+#ifdef HAVE_USABLE_FORK
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif /* HAVE_USABLE_FORK */
+
 /* utility */
 #include "log.h"
 #include "mem.h"
+#include "netintf.h"
 #include "registry.h"
+#include "registry_bin.h"
+#include "support.h"
 
 /* common */
 #include "capability.h"
+#include "connection.h"
 #include "game.h"
 
 /* server */
 #include "console.h"
+#include "meta.h"
 #include "notify.h"
 #include "savegame2.h"
 #include "savegame3.h"
@@ -34,6 +53,15 @@
 
 static fc_thread *save_thread = NULL;
 
+#ifdef HAVE_USABLE_FORK
+/* Seconds to wait for the save process before it is killed. */
+#define SAVE_FORK_TIMEOUT 300
+
+/* Process doing the last save, see save_fork_run(). */
+static pid_t save_pid = -1;
+static char save_pid_filepath[600];
+#endif /* HAVE_USABLE_FORK */
+
 /************************************************************************//**
   Main entry point for loading a game.
 ****************************************************************************/
@@ -90,17 +118,15 @@ struct save_thread_data
   char filepath[600];
   int save_compress_level;
   enum fz_method save_compress_type;
+  bool binary;
 };
 
 /************************************************************************//**
-  Run game saving thread.
+  Report the result of saving, and free the save data.
 ****************************************************************************/
-static void save_thread_run(void *arg)
+static void save_done(struct save_thread_data *stdata, bool saved)
 {
-  struct save_thread_data *stdata = (struct save_thread_data *)arg;
-  
-  if (!secfile_save(stdata->sfile, stdata->filepath, stdata->save_compress_level,
-                    stdata->save_compress_type)) {
+  if (!saved) {
     con_write(C_FAIL, _("Failed saving game as %s"), stdata->filepath);
     log_error("Game saving failed: %s", secfile_error());
     notify_conn(NULL, NULL, E_LOG_ERROR, ftc_warning, _("Failed saving game."));
@@ -108,10 +134,174 @@ static void save_thread_run(void *arg)
     con_write(C_OK, _("Game saved as %s"), stdata->filepath);
   }
 
-  secfile_destroy(stdata->sfile);
-  free(arg);
+  if (NULL != stdata->sfile) {
+    secfile_destroy(stdata->sfile);
+  }
+  free(stdata);
+}
+
+/************************************************************************//**
+  Run game saving thread.
+****************************************************************************/
+static void save_thread_run(void *arg)
+{
+  struct save_thread_data *stdata = (struct save_thread_data *)arg;
+  bool saved;
+
+  if (stdata->binary) {
+    saved = binfile_save(stdata->sfile, stdata->filepath,
+                         stdata->save_compress_level,
+                         stdata->save_compress_type);
+  } else {
+    saved = secfile_save(stdata->sfile, stdata->filepath,
+                         stdata->save_compress_level,
+                         stdata->save_compress_type);
+  }
+
+  save_done(stdata, saved);
+}
+
+/************************************************************************//**
+  Save the game on the main thread, writing each part of the file as soon
+  as it is complete instead of building the whole section file first.
+****************************************************************************/
+static void save_stream_run(struct save_thread_data *stdata,
+                            const char *save_reason, bool scenario)
+{
+  bool saved = FALSE;
+
+  stdata->sfile = secfile_stream_new(stdata->filepath,
+                                     stdata->save_compress_level,
+                                     stdata->save_compress_type,
+                                     stdata->binary);
+  if (NULL != stdata->sfile) {
+    savegame_save(stdata->sfile, save_reason, scenario);
+    saved = secfile_stream_close(stdata->sfile);
+  }
+
+  save_done(stdata, saved);
 }
 
+#ifdef HAVE_USABLE_FORK
+/************************************************************************//**
+  Save the game from a copy of the server process. The operating system
+  gives the copy the game state as it is now, copying memory pages only
+  when the server changes them afterwards, so the server goes on at once
+  and nothing of the save runs on its main thread. Returns FALSE if the
+  process could not be started; stdata is then still owned by the
+  caller.
+****************************************************************************/
+static bool save_fork_run(struct save_thread_data *stdata,
+                          const char *save_reason, bool scenario)
+{
+  pid_t pid;
+
+  /* The copy gets only the calling thread. A lock another thread holds
+   * at this moment, such as the one of the log, would stay locked in the
+   * copy for good. The save thread has been waited for already and idle
+   * helper threads hold none; the metaserver thread may be running. */
+  server_meta_thread_wait();
+
+  /* Else the copy would write out buffered output a second time. */
+  fflush(NULL);
+
+  pid = fork();
+  if (pid < 0) {
+    log_error("Could not start a process for saving: %s",
+              fc_strerror(fc_get_errno()));
+    return FALSE;
+  }
+
+  if (0 == pid) {
+    bool saved = FALSE;
+
+    /* The copy must not talk to clients nor react to signals meant for
+     * the server, and has to keep connections open no longer than the
+     * server does. */
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+#ifdef SIGHUP
+    signal(SIGHUP, SIG_DFL);
+#endif
+    log_set_callback(NULL);
+    conn_list_iterate(game.all_connections, pconn) {
+      fc_closesocket(pconn->sock);
+    } conn_list_iterate_end;
+
+    stdata->sfile = secfile_stream_new(stdata->filepath,
+                                       stdata->save_compress_level,
+                                       stdata->save_compress_type,
+                                       stdata->binary);
+    if (NULL != stdata->sfile) {
+      savegame_save(stdata->sfile, save_reason, scenario);
+      saved = secfile_stream_close(stdata->sfile);
+    }
+    if (!saved) {
+      log_error("Game saving failed: %s", secfile_error());
+    }
+
+    /* No atexit() handlers, they belong to the server. */
+    _exit(saved ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  save_pid = pid;
+  sz_strlcpy(save_pid_filepath, stdata->filepath);
+  free(stdata);
+
+  return TRUE;
+}
+
+/************************************************************************//**
+  Report the result of the save process once it has ended. If wait is
+  FALSE, return at once if it is still running. If wait is TRUE, kill it
+  if it has not ended within SAVE_FORK_TIMEOUT seconds.
+****************************************************************************/
+static void save_fork_finish(bool wait)
+{
+  pid_t ret;
+  int status;
+  int waited = 0;
+
+  if (save_pid < 0) {
+    return;
+  }
+
+  while (TRUE) {
+    ret = waitpid(save_pid, &status, WNOHANG);
+    if (ret < 0 && EINTR == fc_get_errno()) {
+      continue;
+    }
+    if (0 != ret || !wait) {
+      break;
+    }
+    if (waited >= SAVE_FORK_TIMEOUT * 100) {
+      log_error("Save process did not end in %d seconds, killing it.",
+                SAVE_FORK_TIMEOUT);
+      kill(save_pid, SIGKILL);
+      do {
+        ret = waitpid(save_pid, &status, 0);
+      } while (ret < 0 && EINTR == fc_get_errno());
+      break;
+    }
+    fc_usleep(10000);
+    waited++;
+  }
+
+  if (0 == ret) {
+    /* Still running. */
+    return;
+  }
+  save_pid = -1;
+
+  if (ret > 0 && WIFEXITED(status) && EXIT_SUCCESS == WEXITSTATUS(status)) {
+    con_write(C_OK, _("Game saved as %s"), save_pid_filepath);
+  } else {
+    con_write(C_FAIL, _("Failed saving game as %s"), save_pid_filepath);
+    notify_conn(NULL, NULL, E_LOG_ERROR, ftc_warning, _("Failed saving game."));
+  }
+}
+#endif /* HAVE_USABLE_FORK */
+
 /************************************************************************//**
   Unconditionally save the game, with specified filename.
   Always prints a message: either save ok, or failed.
@@ -122,11 +312,17 @@ void save_game(const char *orig_filename, const char *save_reason,
   char *dot, *filename;
   struct timer *timer_cpu, *timer_user;
   struct save_thread_data *stdata;
+  bool forked = FALSE;
+
+#ifdef HAVE_USABLE_FORK
+  forked = game.server.forked_save;
+#endif
 
   stdata = fc_malloc(sizeof(*stdata));
 
   stdata->save_compress_type = game.server.save_compress_type;
   stdata->save_compress_level = game.server.save_compress_level;
+  stdata->binary = game.server.binary_save;
 
   if (!orig_filename) {
     con_write(C_FAIL, _("Failed saving game. Missing filename."));
@@ -171,15 +367,20 @@ void save_game(const char *orig_filename, const char *save_reason,
   timer_user = timer_new(TIMER_USER, TIMER_ACTIVE);
   timer_start(timer_user);
 
-  /* Allowing duplicates shouldn't be allowed. However, it takes very too
-   * long time for huge game saving... */
-  stdata->sfile = secfile_new(TRUE);
-  savegame_save(stdata->sfile, save_reason, scenario);
+  if (game.server.threaded_save && !forked) {
+    /* Allowing duplicates shouldn't be allowed. However, it takes very too
+     * long time for huge game saving... */
+    stdata->sfile = secfile_new(TRUE);
+    savegame_save(stdata->sfile, save_reason, scenario);
 
-  /* We have consistent game state in stdata->sfile now, so
-   * we could pass it to the saving thread already. We want to
-   * handle below notify_conn() and directory creation in
-   * main thread, though. */
+    /* We have consistent game state in stdata->sfile now, so
+     * we could pass it to the saving thread already. We want to
+     * handle below notify_conn() and directory creation in
+     * main thread, though. */
+  } else {
+    /* Streamed to the file below, once its name is known. */
+    stdata->sfile = NULL;
+  }
 
   /* Append ".sav" to filename. */
   sz_strlcat(stdata->filepath, ".sav");
@@ -238,22 +439,31 @@ void save_game(const char *orig_filename, const char *save_reason,
     sz_strlcpy(stdata->filepath, tmpname);
   }
 
+#ifdef HAVE_USABLE_FORK
+  /* Previously started process, it may be writing the same file. */
+  save_fork_finish(TRUE);
+#endif
+
   if (save_thread != NULL) {
     /* Previously started thread */
     fc_thread_wait(save_thread);
-    if (!game.server.threaded_save) {
+    if (!game.server.threaded_save || forked) {
       /* Setting has changed since the last save */
       free(save_thread);
       save_thread = NULL;
     }
-  } else if (game.server.threaded_save) {
+  } else if (game.server.threaded_save && !forked) {
     save_thread = fc_malloc(sizeof(save_thread));
   }
 
   if (save_thread != NULL) {
     fc_thread_start(save_thread, &save_thread_run, stdata);
+#ifdef HAVE_USABLE_FORK
+  } else if (forked && save_fork_run(stdata, save_reason, scenario)) {
+    /* Reported by save_fork_finish() later. */
+#endif
   } else {
-    save_thread_run(stdata);
+    save_stream_run(stdata, save_reason, scenario);
   }
 
 #ifdef LOG_TIMERS
@@ -265,6 +475,16 @@ void save_game(const char *orig_filename, const char *save_reason,
   timer_destroy(timer_user);
 }
 
+/************************************************************************//**
+  Report saves that have finished in the background meanwhile.
+****************************************************************************/
+void save_system_poll(void)
+{
+#ifdef HAVE_USABLE_FORK
+  save_fork_finish(FALSE);
+#endif
+}
+
 /************************************************************************//**
   Close saving system.
 ****************************************************************************/
@@ -275,5 +495,8 @@ void save_system_close(void)
     free(save_thread);
     save_thread = NULL;
   }
+#ifdef HAVE_USABLE_FORK
+  save_fork_finish(TRUE);
+#endif
 }
 
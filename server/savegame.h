@@ -25,6 +25,7 @@ void savegame_save(struct section_file *sfile, const char *save_reason,
 void save_game(const char *orig_filename, const char *save_reason,
                bool scenario);
 
+void save_system_poll(void);
 void save_system_close(void);
 
 #endif /* FC__SAVEGAME_H */
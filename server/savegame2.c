@@ -5167,9 +5167,7 @@ static void sg_load_sanitycheck(struct loaddata *loading)
     if (loading->version < 30) {
       /* For older savegames we have to recalculate the score with current data,
        * instead of using beginning-of-turn saved scores. */
-      players_iterate(pplayer) {
-        calc_civ_score(pplayer);
-      } players_iterate_end;
+      calc_civ_scores();
     }
   }
 
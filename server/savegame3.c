@@ -82,6 +82,7 @@
 #include "shared.h"
 #include "support.h"            /* bool type */
 #include "timing.h"
+#include "workpool.h"
 
 /* common */
 #include "achievements.h"
@@ -184,24 +185,14 @@ extern bool sg_success;
 }
 
 /*
- * This loops over the entire map to load data. It inputs a line of data
- * using the macro SECFILE_LOOKUP_LINE and then loops using the macro
- * SET_XY_CHAR to load each char into the map at (map_x, map_y). Internal
- * variables ch, map_x, map_y, nat_x, and nat_y are allocated within the
- * macro but definable by the caller.
- *
- * Parameters:
- *   ch:            a variable to hold a char (data for a single position,
- *                  used by SET_XY_CHAR)
- *   ptile:         current tile within the line (used by SET_XY_CHAR)
- *   SET_XY_CHAR:   macro to load the map character at each (map_x, map_y)
- *   secfile:       a secfile struct
- *   secpath, ...:  path as used for sprintf() with arguments; the last item
- *                  will be the y coordinate
- * Example:
- *   LOAD_MAP_CHAR(ch, ptile,
- *                 map_get_player_tile(ptile, plr)->terrain
- *                   = char2terrain(ch), file, "player%d.map_t%04d", plrno);
+ * Map data is saved in layers of one line of characters per native row,
+ * see SAVE_MAP_CHAR. sg_load_map_layers() loads layers by calling their
+ * sg_map_char_func for each tile with the character saved for it. The rows
+ * are shared out between the helper threads of the 'citythreads' setting,
+ * so the function must only write data belonging to 'ptile' (or to its
+ * index in an array of its own), and must not log. It returns FALSE if
+ * 'ch' is not valid for the layer; sg_load_map_layers() then reports the
+ * first such character of each row. 'data' is passed through unchanged.
  *
  * Note: some (but not all) of the code this is replacing used to skip over
  *       lines that did not exist. This allowed for backward-compatibility.
@@ -210,40 +201,52 @@ extern bool sg_success;
  *       early in this case. Instead, we let any map data type to be empty,
  *       and just print an informative warning message about it.
  */
-#define LOAD_MAP_CHAR(ch, ptile, SET_XY_CHAR, secfile, secpath, ...)        \
-{                                                                           \
-  int _nat_x, _nat_y;                                                       \
-  bool _printed_warning = FALSE;                                            \
-  for (_nat_y = 0; _nat_y < wld.map.ysize; _nat_y++) {                      \
-    const char *_line = secfile_lookup_str(secfile, secpath,                \
-                                           ## __VA_ARGS__, _nat_y);         \
-    if (NULL == _line) {                                                    \
-      char buf[64];                                                         \
-      fc_snprintf(buf, sizeof(buf), secpath, ## __VA_ARGS__, _nat_y);       \
-      log_verbose("Line not found='%s'", buf);                              \
-      _printed_warning = TRUE;                                              \
-      continue;                                                             \
-    } else if (strlen(_line) != wld.map.xsize) {                            \
-      char buf[64];                                                         \
-      fc_snprintf(buf, sizeof(buf), secpath, ## __VA_ARGS__, _nat_y);       \
-      log_verbose("Line too short (expected %d got %lu)='%s'",              \
-                  wld.map.xsize, (unsigned long) strlen(_line), buf);       \
-      _printed_warning = TRUE;                                              \
-      continue;                                                             \
-    }                                                                       \
-    for (_nat_x = 0; _nat_x < wld.map.xsize; _nat_x++) {                    \
-      const char ch = _line[_nat_x];                                        \
-      struct tile *ptile = native_pos_to_tile(&(wld.map), _nat_x, _nat_y);  \
-      (SET_XY_CHAR);                                                        \
-    }                                                                       \
-  }                                                                         \
-  if (_printed_warning) {                                                   \
-    /* TRANS: Minor error message. */                                       \
-    log_sg(_("Saved game contains incomplete map data. This can"            \
-             " happen with old saved games, or it may indicate an"          \
-             " invalid saved game file. Proceed at your own risk."));       \
-  }                                                                         \
-}
+typedef bool (*sg_map_char_func)(struct tile *ptile, char ch, void *data);
+
+/* What loading a layer does about characters its sg_map_char_func
+ * refuses. */
+enum sg_bad_char {
+  SG_BAD_CHAR_LOG,              /* Log them and go on. */
+  SG_BAD_CHAR_FAIL,             /* Log them and fail the loading. */
+  SG_BAD_CHAR_FATAL             /* Log them and exit. */
+};
+
+/* One layer of map data; see sg_map_layer_init(). */
+struct sg_map_layer {
+  char prefix[64];              /* The line of row y is "<prefix>%04d". */
+  sg_map_char_func func;
+  void *data;
+  enum sg_bad_char bad;
+  int *length;                  /* Per row; -1 if the line is missing. */
+  int *bad_x;                   /* Per row; first refused character, or
+                                 * -1. */
+};
+
+/* The layers loaded together by sg_load_map_layers(). */
+struct sg_map_layers {
+  const struct section_file *file;
+  struct sg_map_layer *layers;
+  int count;
+};
+
+/* A halfbyte of the known status or of a player map, for the
+ * sg_map_char_func that loads it. */
+struct sg_map_halfbyte {
+  unsigned int *known;          /* Known status of 32 players. */
+  struct player *plr;           /* Owner of the player map. */
+  struct extra_type **extras;   /* The extras of this halfbyte. */
+  int halfbyte;
+};
+
+/* The borders of a player map while sg_load_player_vision_borders() loads
+ * them. */
+struct sg_vision_borders {
+  const struct section_file *file;
+  struct player *plr;
+  char owner_prefix[64];
+  char extras_owner_prefix[64];
+  char (*error)[256];           /* Per row; empty if the row is fine. */
+};
 
 /* Iterate on the extras half-bytes */
 #define halfbyte_iterate_extras(e, num_extras_types)                        \
@@ -302,10 +305,20 @@ static void worklist_save(struct section_file *file,
                           int max_length, const char *path, ...);
 static void unit_ordering_calc(void);
 static void unit_ordering_apply(void);
-static void sg_extras_set(bv_extras *extras, char ch, struct extra_type **idx);
+static void sg_load_rows(fc_work_func func, void *data);
+static const char *sg_map_line(const struct section_file *file,
+                               const char *prefix, int nat_y);
+static void sg_map_layer_init(struct sg_map_layer *layer,
+                              sg_map_char_func func, void *data,
+                              enum sg_bad_char bad, const char *prefix, ...)
+                              fc__attribute((__format__ (__printf__, 5, 6)));
+static void sg_load_map_layers(struct loaddata *loading,
+                               struct sg_map_layer *layers, int count);
+static bool sg_hex_char_valid(char ch);
+static bool sg_extras_set(bv_extras *extras, char ch, struct extra_type **idx);
 static char sg_extras_get(bv_extras extras, struct extra_type *presource,
                           const int *idx);
-static struct terrain *char2terrain(char ch);
+static bool char2terrain(char ch, struct terrain **pterrain);
 static char terrain2char(const struct terrain *pterrain);
 static Tech_type_id technology_load(struct section_file *file,
                                     const char* path, int plrno);
@@ -374,6 +387,8 @@ static void sg_load_player_attributes(struct loaddata *loading,
                                       struct player *plr);
 static void sg_load_player_vision(struct loaddata *loading,
                                   struct player *plr);
+static void sg_load_player_vision_borders(struct loaddata *loading,
+                                          struct player *plr);
 static bool sg_load_player_vision_city(struct loaddata *loading,
                                        struct player *plr,
                                        struct vision_site *pdcity,
@@ -529,6 +544,9 @@ static void savegame3_save_real(struct section_file *file,
   sg_save_ruledata(saving);
   /* [map] */
   sg_save_map(saving);
+  /* Everything above is complete now ([game] gets its last entry from
+   * the map code), so a streamed file can write it out. */
+  secfile_flush(saving->file);
   /* [player<i>] */
   sg_save_players(saving);
   /* [research] */
@@ -1083,24 +1101,194 @@ static void unit_ordering_apply(void)
   } whole_map_iterate_end;
 }
 
+/************************************************************************//**
+  Call 'func' for each native row of the map, with the helper threads of
+  the game if there are any. 'func' must only write data
+  belonging to its row.
+****************************************************************************/
+static void sg_load_rows(fc_work_func func, void *data)
+{
+  struct fc_workpool *pool = game_helper_pool();
+  int nat_y;
+
+  if (pool != NULL) {
+    fc_workpool_run(pool, wld.map.ysize, func, data);
+    return;
+  }
+
+  for (nat_y = 0; nat_y < wld.map.ysize; nat_y++) {
+    func(nat_y, data);
+  }
+}
+
+/************************************************************************//**
+  Return the line "<prefix>%04d" of map data for row 'nat_y', or NULL if
+  there is no such string. Unlike secfile_lookup_str(), this leaves the
+  error buffer of the registry alone, so helper threads may call it.
+****************************************************************************/
+static const char *sg_map_line(const struct section_file *file,
+                               const char *prefix, int nat_y)
+{
+  const struct entry *pentry = secfile_entry_lookup(file, "%s%04d",
+                                                    prefix, nat_y);
+  const char *line;
+
+  if (NULL == pentry || ENTRY_STR != entry_type(pentry)
+      || !entry_str_get(pentry, &line)) {
+    return NULL;
+  }
+
+  return line;
+}
+
+/************************************************************************//**
+  Set up 'layer' for loading the lines "<prefix>%04d", where prefix is
+  formatted like sprintf(). See sg_map_char_func for what 'func' may do;
+  'bad' says what to do about characters it refuses.
+****************************************************************************/
+static void sg_map_layer_init(struct sg_map_layer *layer,
+                              sg_map_char_func func, void *data,
+                              enum sg_bad_char bad, const char *prefix, ...)
+{
+  va_list args;
+
+  va_start(args, prefix);
+  fc_vsnprintf(layer->prefix, sizeof(layer->prefix), prefix, args);
+  va_end(args);
+  layer->func = func;
+  layer->data = data;
+  layer->bad = bad;
+  layer->length = NULL;
+  layer->bad_x = NULL;
+}
+
+/************************************************************************//**
+  Load one row of each of the map layers in 'data' (a struct
+  sg_map_layers).
+****************************************************************************/
+static void sg_load_map_layers_row(int nat_y, void *data)
+{
+  struct sg_map_layers *job = data;
+  int i, nat_x;
+
+  for (i = 0; i < job->count; i++) {
+    struct sg_map_layer *layer = &job->layers[i];
+    const char *line = sg_map_line(job->file, layer->prefix, nat_y);
+
+    if (NULL == line) {
+      layer->length[nat_y] = -1;
+      continue;
+    }
+
+    layer->length[nat_y] = strlen(line);
+    layer->bad_x[nat_y] = -1;
+    if (layer->length[nat_y] != wld.map.xsize) {
+      continue;
+    }
+
+    for (nat_x = 0; nat_x < wld.map.xsize; nat_x++) {
+      if (!layer->func(native_pos_to_tile(&(wld.map), nat_x, nat_y),
+                       line[nat_x], layer->data)
+          && -1 == layer->bad_x[nat_y]) {
+        layer->bad_x[nat_y] = nat_x;
+      }
+    }
+  }
+}
+
+/************************************************************************//**
+  Load 'count' layers of map data, in one pass over the rows of the map.
+  The layers are loaded one after the other for each row, so a layer may
+  build on those before it. Missing and short lines, and the first refused
+  character of each row, are reported once all is done, in the order of
+  the layers and rows.
+****************************************************************************/
+static void sg_load_map_layers(struct loaddata *loading,
+                               struct sg_map_layer *layers, int count)
+{
+  struct sg_map_layers job;
+  int i, nat_y;
+
+  for (i = 0; i < count; i++) {
+    layers[i].length = fc_malloc(wld.map.ysize * sizeof(*layers[i].length));
+    layers[i].bad_x = fc_malloc(wld.map.ysize * sizeof(*layers[i].bad_x));
+  }
+
+  job.file = loading->file;
+  job.layers = layers;
+  job.count = count;
+  sg_load_rows(sg_load_map_layers_row, &job);
+
+  for (i = 0; i < count; i++) {
+    struct sg_map_layer *layer = &layers[i];
+    bool printed_warning = FALSE;
+
+    for (nat_y = 0; nat_y < wld.map.ysize; nat_y++) {
+      if (-1 != layer->length[nat_y] && -1 != layer->bad_x[nat_y]) {
+        char ch = sg_map_line(loading->file, layer->prefix,
+                              nat_y)[layer->bad_x[nat_y]];
+
+        if (SG_BAD_CHAR_FATAL == layer->bad) {
+          log_fatal("Unknown character '%c' (%d) in savegame line "
+                    "'%s%04d'.", ch, ch, layer->prefix, nat_y);
+          exit(EXIT_FAILURE);
+        }
+        log_sg("Unknown character '%c' (%d) in line '%s%04d'.",
+               ch, ch, layer->prefix, nat_y);
+        if (SG_BAD_CHAR_FAIL == layer->bad) {
+          sg_success = FALSE;
+        }
+      }
+      if (-1 == layer->length[nat_y]) {
+        log_verbose("Line not found='%s%04d'", layer->prefix, nat_y);
+        printed_warning = TRUE;
+      } else if (layer->length[nat_y] != wld.map.xsize) {
+        log_verbose("Line too short (expected %d got %d)='%s%04d'",
+                    wld.map.xsize, layer->length[nat_y], layer->prefix,
+                    nat_y);
+        printed_warning = TRUE;
+      }
+    }
+    free(layer->length);
+    layer->length = NULL;
+    free(layer->bad_x);
+    layer->bad_x = NULL;
+
+    if (printed_warning) {
+      /* TRANS: Minor error message. */
+      log_sg(_("Saved game contains incomplete map data. This can"
+               " happen with old saved games, or it may indicate an"
+               " invalid saved game file. Proceed at your own risk."));
+    }
+  }
+}
+
+/************************************************************************//**
+  Whether ascii_hex2bin() takes 'ch' without failing. Unlike it, this does
+  not log, so helper threads may call it.
+****************************************************************************/
+static bool sg_hex_char_valid(char ch)
+{
+  return ' ' == ch || ('\0' != ch && NULL != strchr(hex_chars, ch));
+}
+
 /************************************************************************//**
   Helper function for loading extras from a savegame.
 
   'ch' gives the character loaded from the savegame. Extras are packed
   in four to a character in hex notation. 'index' is a mapping of
-  savegame bit -> base bit.
+  savegame bit -> base bit. Returns FALSE, setting no extras, if 'ch' is
+  not a hex character. Does not log, so helper threads may call it.
 ****************************************************************************/
-static void sg_extras_set(bv_extras *extras, char ch, struct extra_type **idx)
+static bool sg_extras_set(bv_extras *extras, char ch, struct extra_type **idx)
 {
   int i, bin;
   const char *pch = strchr(hex_chars, ch);
 
   if (!pch || ch == '\0') {
-    log_sg("Unknown hex value: '%c' (%d)", ch, ch);
-    bin = 0;
-  } else {
-    bin = pch - hex_chars;
+    return FALSE;
   }
+  bin = pch - hex_chars;
 
   for (i = 0; i < 4; i++) {
     struct extra_type *pextra = idx[i];
@@ -1113,6 +1301,8 @@ static void sg_extras_set(bv_extras *extras, char ch, struct extra_type **idx)
       BV_SET(*extras, extra_index(pextra));
     }
   }
+
+  return TRUE;
 }
 
 /************************************************************************//**
@@ -1147,23 +1337,24 @@ static char sg_extras_get(bv_extras extras, struct extra_type *presource,
 }
 
 /************************************************************************//**
-  Dereferences the terrain character.  See terrains[].identifier
-    example: char2terrain('a') => T_ARCTIC
+  Dereferences the terrain character into 'pterrain'. Returns FALSE if
+  there is no such terrain. See terrains[].identifier
+    example: char2terrain('a', &pterrain) => T_ARCTIC
 ****************************************************************************/
-static struct terrain *char2terrain(char ch)
+static bool char2terrain(char ch, struct terrain **pterrain)
 {
-  /* terrain_by_identifier plus fatal error */
   if (ch == TERRAIN_UNKNOWN_IDENTIFIER) {
-    return T_UNKNOWN;
+    *pterrain = T_UNKNOWN;
+    return TRUE;
   }
-  terrain_type_iterate(pterrain) {
-    if (pterrain->identifier_load == ch) {
-      return pterrain;
+  terrain_type_iterate(pterr) {
+    if (pterr->identifier_load == ch) {
+      *pterrain = pterr;
+      return TRUE;
     }
   } terrain_type_iterate_end;
 
-  log_fatal("Unknown terrain identifier '%c' in savegame.", ch);
-  exit(EXIT_FAILURE);
+  return FALSE;
 }
 
 /************************************************************************//**
@@ -2537,11 +2728,30 @@ static void sg_save_map(struct savedata *saving)
   sg_save_map_known(saving);
 }
 
+/************************************************************************//**
+  sg_map_char_func for the terrain of the map.
+****************************************************************************/
+static bool sg_load_tile_terrain(struct tile *ptile, char ch, void *data)
+{
+  return char2terrain(ch, &ptile->terrain);
+}
+
+/************************************************************************//**
+  sg_map_char_func for a halfbyte of extras of the map; 'data' is the
+  mapping of the four bits to extra types.
+****************************************************************************/
+static bool sg_load_tile_extras(struct tile *ptile, char ch, void *data)
+{
+  return sg_extras_set(&ptile->extras, ch, data);
+}
+
 /************************************************************************//**
   Load tiles of the map.
 ****************************************************************************/
 static void sg_load_map_tiles(struct loaddata *loading)
 {
+  struct sg_map_layer terrain;
+
   /* Check status and return if not OK (sg_success != TRUE). */
   sg_check_ret();
 
@@ -2553,8 +2763,9 @@ static void sg_load_map_tiles(struct loaddata *loading)
   main_map_allocate();
 
   /* get the terrain type */
-  LOAD_MAP_CHAR(ch, ptile, ptile->terrain = char2terrain(ch), loading->file,
-                "map.t%04d");
+  sg_map_layer_init(&terrain, sg_load_tile_terrain, NULL,
+                    SG_BAD_CHAR_FATAL, "map.t");
+  sg_load_map_layers(loading, &terrain, 1);
   assign_continent_numbers();
 
   /* Check for special tile sprites. */
@@ -2564,8 +2775,9 @@ static void sg_load_map_tiles(struct loaddata *loading)
     int nat_x, nat_y;
 
     index_to_native_pos(&nat_x, &nat_y, tile_index(ptile));
-    spec_sprite = secfile_lookup_str(loading->file, "map.spec_sprite_%d_%d",
-                                     nat_x, nat_y);
+    spec_sprite = secfile_lookup_str_default(loading->file, NULL,
+                                             "map.spec_sprite_%d_%d",
+                                             nat_x, nat_y);
     label = secfile_lookup_str_default(loading->file, NULL, "map.label_%d_%d",
                                        nat_x, nat_y);
     if (NULL != ptile->spec_sprite) {
@@ -2610,14 +2822,21 @@ static void sg_save_map_tiles(struct savedata *saving)
 ****************************************************************************/
 static void sg_load_map_tiles_extras(struct loaddata *loading)
 {
+  struct sg_map_layer *layers;
+  int count = 0;
+
   /* Check status and return if not OK (sg_success != TRUE). */
   sg_check_ret();
 
   /* Load extras. */
+  layers = fc_malloc((loading->extra.size / 4 + 1) * sizeof(*layers));
   halfbyte_iterate_extras(j, loading->extra.size) {
-    LOAD_MAP_CHAR(ch, ptile, sg_extras_set(&ptile->extras, ch, loading->extra.order + 4 * j),
-                  loading->file, "map.e%02d_%04d", j);
+    sg_map_layer_init(&layers[count++], sg_load_tile_extras,
+                      loading->extra.order + 4 * j, SG_BAD_CHAR_LOG,
+                      "map.e%02d_", j);
   } halfbyte_iterate_extras_end;
+  sg_load_map_layers(loading, layers, count);
+  free(layers);
 
   if (S_S_INITIAL != loading->server_state
       || MAPGEN_SCENARIO != wld.map.server.generator
@@ -3050,6 +3269,22 @@ static void sg_save_map_worked(struct savedata *saving)
   }
 }
 
+/************************************************************************//**
+  sg_map_char_func for the known status of 32 players; 'data' is a
+  struct sg_map_halfbyte.
+****************************************************************************/
+static bool sg_load_tile_known(struct tile *ptile, char ch, void *data)
+{
+  struct sg_map_halfbyte *layer = data;
+
+  if (!sg_hex_char_valid(ch)) {
+    return FALSE;
+  }
+  layer->known[tile_index(ptile)] |= ascii_hex2bin(ch, layer->halfbyte);
+
+  return TRUE;
+}
+
 /************************************************************************//**
   Load tile known status
 ****************************************************************************/
@@ -3068,6 +3303,10 @@ static void sg_load_map_known(struct loaddata *loading)
                                   "game.save_known")) {
     int lines = player_slot_max_used_number()/32 + 1, j, p, l, i;
     unsigned int *known = fc_calloc(lines * MAP_INDEX_SIZE, sizeof(*known));
+    struct sg_map_layer *layers = fc_malloc(lines * 8 * sizeof(*layers));
+    struct sg_map_halfbyte *halfbytes
+      = fc_calloc(lines * 8, sizeof(*halfbytes));
+    int count = 0;
 
     for (l = 0; l < lines; l++) {
       for (j = 0; j < 8; j++) {
@@ -3075,15 +3314,20 @@ static void sg_load_map_known(struct loaddata *loading)
           /* Only bother trying to load the map for this halfbyte if at least
            * one of the corresponding player slots is in use. */
           if (player_slot_is_used(player_slot_by_number(l*32 + j*4 + i))) {
-            LOAD_MAP_CHAR(ch, ptile,
-                          known[l * MAP_INDEX_SIZE + tile_index(ptile)]
-                            |= ascii_hex2bin(ch, j),
-                          loading->file, "map.k%02d_%04d", l * 8 + j);
+            halfbytes[count].known = known + l * MAP_INDEX_SIZE;
+            halfbytes[count].halfbyte = j;
+            sg_map_layer_init(&layers[count], sg_load_tile_known,
+                              &halfbytes[count], SG_BAD_CHAR_FAIL,
+                              "map.k%02d_", l * 8 + j);
+            count++;
             break;
           }
         }
       }
     }
+    sg_load_map_layers(loading, layers, count);
+    free(layers);
+    free(halfbytes);
 
     players_iterate(pplayer) {
       dbv_clr_all(&pplayer->tile_known);
@@ -3129,16 +3373,17 @@ static void sg_save_map_known(struct savedata *saving)
       /* HACK: we convert the data into a 32-bit integer, and then save it as
        * hex. */
 
-      whole_map_iterate(&(wld.map), ptile) {
-        players_iterate(pplayer) {
-          if (map_is_known(ptile, pplayer)) {
-            p = player_index(pplayer);
-            l = p / 32;
-            known[l * MAP_INDEX_SIZE + tile_index(ptile)]
-              |= (1u << (p % 32)); /* "p % 32" = "p - l * 32" */ 
-          }
-        } players_iterate_end;
-      } whole_map_iterate_end;
+      players_iterate(pplayer) {
+        int tindex;
+
+        p = player_index(pplayer);
+        l = p / 32;
+        for (tindex = dbv_next_set(&pplayer->tile_known, 0); tindex >= 0;
+             tindex = dbv_next_set(&pplayer->tile_known, tindex + 1)) {
+          known[l * MAP_INDEX_SIZE + tindex]
+            |= (1u << (p % 32)); /* "p % 32" = "p - l * 32" */
+        }
+      } players_iterate_end;
 
       for (l = 0; l < lines; l++) {
         for (j = 0; j < 8; j++) {
@@ -3633,6 +3878,7 @@ static void sg_save_players(struct savedata *saving)
     sg_save_player_units(saving, pplayer);
     sg_save_player_attributes(saving, pplayer);
     sg_save_player_vision(saving, pplayer);
+    secfile_flush(saving->file);
   } players_iterate_end;
 }
 
@@ -6130,6 +6376,144 @@ static void sg_save_player_attributes(struct savedata *saving,
 #undef PART_SIZE
 }
 
+/************************************************************************//**
+  sg_map_char_func for the terrain of the player map 'data'.
+****************************************************************************/
+static bool sg_load_plrtile_terrain(struct tile *ptile, char ch, void *data)
+{
+  return char2terrain(ch, &map_get_player_tile(ptile, data)->terrain);
+}
+
+/************************************************************************//**
+  sg_map_char_func for a halfbyte of extras of a player map; 'data' is a
+  struct sg_map_halfbyte.
+****************************************************************************/
+static bool sg_load_plrtile_extras(struct tile *ptile, char ch, void *data)
+{
+  struct sg_map_halfbyte *layer = data;
+
+  return sg_extras_set(&map_get_player_tile(ptile, layer->plr)->extras, ch,
+                layer->extras);
+}
+
+/************************************************************************//**
+  sg_map_char_func for a 4-bit segment of the 16-bit update time of a
+  player map; 'data' is a struct sg_map_halfbyte.
+****************************************************************************/
+static bool sg_load_plrtile_updated(struct tile *ptile, char ch, void *data)
+{
+  struct sg_map_halfbyte *layer = data;
+  struct player_tile *plrtile = map_get_player_tile(ptile, layer->plr);
+
+  if (!sg_hex_char_valid(ch)) {
+    return FALSE;
+  }
+  if (layer->halfbyte == 0) {
+    plrtile->last_updated = ascii_hex2bin(ch, layer->halfbyte);
+  } else {
+    plrtile->last_updated |= ascii_hex2bin(ch, layer->halfbyte);
+  }
+
+  return TRUE;
+}
+
+/************************************************************************//**
+  Load one row of the borders of a player map; 'data' is a struct
+  sg_vision_borders. Errors are written to the row's error message
+  instead of being logged, for the caller to report.
+****************************************************************************/
+static void sg_load_player_vision_borders_row(int y, void *data)
+{
+  struct sg_vision_borders *borders = data;
+  const char *ptr = sg_map_line(borders->file, borders->owner_prefix, y);
+  const char *ptr2 = sg_map_line(borders->file,
+                                 borders->extras_owner_prefix, y);
+  char *error = borders->error[y];
+  size_t error_len = sizeof(borders->error[y]);
+  int x;
+
+  if (NULL == ptr) {
+    fc_snprintf(error, error_len,
+                "Savegame corrupt - map line %d not found.", y);
+    return;
+  }
+
+  for (x = 0; x < wld.map.xsize; x++) {
+    char token[TOKEN_SIZE];
+    char token2[TOKEN_SIZE];
+    int number;
+    struct player_tile *plrtile
+      = map_get_player_tile(native_pos_to_tile(&(wld.map), x, y),
+                            borders->plr);
+
+    scanin(&ptr, ",", token, sizeof(token));
+    if ('\0' == token[0]) {
+      fc_snprintf(error, error_len,
+                  "Savegame corrupt - map size not correct.");
+      return;
+    }
+    if (strcmp(token, "-") == 0) {
+      plrtile->owner = NULL;
+    } else if (str_to_int(token, &number)) {
+      plrtile->owner = player_by_number(number);
+    } else {
+      fc_snprintf(error, error_len,
+                  "Savegame corrupt - got tile owner=%s in (%d, %d).",
+                  token, x, y);
+      return;
+    }
+
+    scanin(&ptr2, ",", token2, sizeof(token2));
+    if ('\0' == token2[0]) {
+      fc_snprintf(error, error_len,
+                  "Savegame corrupt - map size not correct.");
+      return;
+    }
+    if (strcmp(token2, "-") == 0) {
+      plrtile->extras_owner = NULL;
+    } else if (str_to_int(token2, &number)) {
+      plrtile->extras_owner = player_by_number(number);
+    } else {
+      fc_snprintf(error, error_len,
+                  "Savegame corrupt - got extras owner=%s in (%d, %d).",
+                  token, x, y);
+      return;
+    }
+  }
+}
+
+/************************************************************************//**
+  Load the borders of the player map of 'plr'.
+****************************************************************************/
+static void sg_load_player_vision_borders(struct loaddata *loading,
+                                          struct player *plr)
+{
+  struct sg_vision_borders borders;
+  int plrno = player_number(plr);
+  int y;
+
+  borders.file = loading->file;
+  borders.plr = plr;
+  fc_snprintf(borders.owner_prefix, sizeof(borders.owner_prefix),
+              "player%d.map_owner", plrno);
+  fc_snprintf(borders.extras_owner_prefix,
+              sizeof(borders.extras_owner_prefix),
+              "player%d.extras_owner", plrno);
+  borders.error = fc_calloc(wld.map.ysize, sizeof(*borders.error));
+
+  sg_load_rows(sg_load_player_vision_borders_row, &borders);
+
+  /* Report the first error, as if the rows had been loaded in order. */
+  for (y = 0; y < wld.map.ysize; y++) {
+    if ('\0' != borders.error[y][0]) {
+      sg_success = FALSE;
+      log_sg("%s", borders.error[y]);
+      break;
+    }
+  }
+  free(borders.error);
+}
+
 /************************************************************************//**
   Load vision data
 ****************************************************************************/
@@ -6140,8 +6524,10 @@ static void sg_load_player_vision(struct loaddata *loading,
   int total_ncities =
       secfile_lookup_int_default(loading->file, -1,
                                  "player%d.dc_total", plrno);
-  int i;
+  int i, count = 0;
   bool someone_alive = FALSE;
+  struct sg_map_layer *layers;
+  struct sg_map_halfbyte *halfbytes;
 
   /* Check status and return if not OK (sg_success != TRUE). */
   sg_check_ret();
@@ -6188,84 +6574,42 @@ static void sg_load_player_vision(struct loaddata *loading,
     return;
   }
 
-  /* Load player map (terrain). */
-  LOAD_MAP_CHAR(ch, ptile,
-                map_get_player_tile(ptile, plr)->terrain
-                  = char2terrain(ch), loading->file,
-                "player%d.map_t%04d", plrno);
-
-  /* Load player map (extras). */
+  /* Load player map (terrain and extras). */
+  layers = fc_malloc((loading->extra.size / 4 + 5) * sizeof(*layers));
+  halfbytes = fc_calloc(loading->extra.size / 4 + 5, sizeof(*halfbytes));
+  sg_map_layer_init(&layers[count++], sg_load_plrtile_terrain, plr,
+                    SG_BAD_CHAR_FATAL, "player%d.map_t", plrno);
   halfbyte_iterate_extras(j, loading->extra.size) {
-    LOAD_MAP_CHAR(ch, ptile,
-                  sg_extras_set(&map_get_player_tile(ptile, plr)->extras,
-                                ch, loading->extra.order + 4 * j),
-                  loading->file, "player%d.map_e%02d_%04d", plrno, j);
+    halfbytes[count].plr = plr;
+    halfbytes[count].extras = loading->extra.order + 4 * j;
+    sg_map_layer_init(&layers[count], sg_load_plrtile_extras,
+                      &halfbytes[count], SG_BAD_CHAR_LOG,
+                      "player%d.map_e%02d_", plrno, j);
+    count++;
   } halfbyte_iterate_extras_end;
+  sg_load_map_layers(loading, layers, count);
 
   if (game.server.foggedborders) {
     /* Load player map (border). */
-    int x, y;
-
-    for (y = 0; y < wld.map.ysize; y++) {
-      const char *buffer
-        = secfile_lookup_str(loading->file, "player%d.map_owner%04d",
-                             plrno, y);
-      const char *buffer2
-        = secfile_lookup_str(loading->file, "player%d.extras_owner%04d",
-                             plrno, y);
-      const char *ptr = buffer;
-      const char *ptr2 = buffer2;
-
-      sg_failure_ret(NULL != buffer,
-                    "Savegame corrupt - map line %d not found.", y);
-      for (x = 0; x < wld.map.xsize; x++) {
-        char token[TOKEN_SIZE];
-        char token2[TOKEN_SIZE];
-        int number;
-        struct tile *ptile = native_pos_to_tile(&(wld.map), x, y);
-
-        scanin(&ptr, ",", token, sizeof(token));
-        sg_failure_ret('\0' != token[0],
-                       "Savegame corrupt - map size not correct.");
-        if (strcmp(token, "-") == 0) {
-          map_get_player_tile(ptile, plr)->owner = NULL;
-        } else  {
-          sg_failure_ret(str_to_int(token, &number),
-                         "Savegame corrupt - got tile owner=%s in (%d, %d).",
-                         token, x, y);
-          map_get_player_tile(ptile, plr)->owner = player_by_number(number);
-        }
-
-        scanin(&ptr2, ",", token2, sizeof(token2));
-        sg_failure_ret('\0' != token2[0],
-                       "Savegame corrupt - map size not correct.");
-        if (strcmp(token2, "-") == 0) {
-          map_get_player_tile(ptile, plr)->extras_owner = NULL;
-        } else  {
-          sg_failure_ret(str_to_int(token2, &number),
-                         "Savegame corrupt - got extras owner=%s in (%d, %d).",
-                         token, x, y);
-          map_get_player_tile(ptile, plr)->extras_owner = player_by_number(number);
-        }
-      }
+    sg_load_player_vision_borders(loading, plr);
+    if (!sg_success) {
+      free(layers);
+      free(halfbytes);
+      return;
     }
   }
 
   /* Load player map (update time). */
   for (i = 0; i < 4; i++) {
     /* put 4-bit segments of 16-bit "updated" field */
-    if (i == 0) {
-      LOAD_MAP_CHAR(ch, ptile,
-                    map_get_player_tile(ptile, plr)->last_updated
-                      = ascii_hex2bin(ch, i),
-                    loading->file, "player%d.map_u%02d_%04d", plrno, i);
-    } else {
-      LOAD_MAP_CHAR(ch, ptile,
-                    map_get_player_tile(ptile, plr)->last_updated
-                      |= ascii_hex2bin(ch, i),
-                    loading->file, "player%d.map_u%02d_%04d", plrno, i);
-    }
-  }
+    halfbytes[i].plr = plr;
+    halfbytes[i].halfbyte = i;
+    sg_map_layer_init(&layers[i], sg_load_plrtile_updated, &halfbytes[i],
+                      SG_BAD_CHAR_FAIL, "player%d.map_u%02d_", plrno, i);
+  }
+  sg_load_map_layers(loading, layers, 4);
+  free(layers);
+  free(halfbytes);
 
   /* Load player map known cities. */
   for (i = 0; i < total_ncities; i++) {
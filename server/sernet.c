@@ -65,6 +65,7 @@
 #include "log.h"
 #include "mem.h"
 #include "netintf.h"
+#include "netpoll.h"
 #include "shared.h"
 #include "support.h"
 #include "timing.h"
@@ -85,6 +86,7 @@
 #include "console.h"
 #include "meta.h"
 #include "plrhand.h"
+#include "savegame.h"
 #include "srv_main.h"
 #include "stdinhand.h"
 #include "voting.h"
@@ -93,6 +95,14 @@
 
 static struct connection connections[MAX_NUM_CONNECTIONS];
 
+/* All sockets the server waits for: listening sockets, connections and
+ * stdin. They are registered when opened and removed when closed. */
+static struct fc_poller *server_poller = NULL;
+static struct fc_poll_event *poll_ready = NULL;
+static int poll_ready_max = 0;
+static int conn_poll_handle[MAX_NUM_CONNECTIONS];
+static int stdin_poll_handle = -1;
+
 #ifdef GENERATING_MAC      /* mac network globals */
 TEndpointInfo serv_info;
 EndpointRef serv_ep;
@@ -220,6 +230,10 @@ static void close_connection(struct connection *pconn)
   pconn->playing = NULL;
   pconn->client_gui = GUI_STUB;
   pconn->access_level = ALLOW_NONE;
+  if (pconn->used && conn_poll_handle[pconn - connections] != -1) {
+    fc_poller_remove(server_poller, conn_poll_handle[pconn - connections]);
+    conn_poll_handle[pconn - connections] = -1;
+  }
   connection_common_close(pconn);
 
   send_updated_vote_totals(NULL);
@@ -252,6 +266,13 @@ void close_connections_and_socket(void)
   }
   FC_FREE(listen_socks);
 
+  if (server_poller != NULL) {
+    fc_poller_destroy(server_poller);
+    server_poller = NULL;
+    stdin_poll_handle = -1;
+  }
+  FC_FREE(poll_ready);
+
   if (srvarg.announce != ANNOUNCE_NONE) {
     fc_closesocket(socklan);
   }
@@ -329,10 +350,12 @@ static void cut_lagging_connection(struct connection *pconn)
   if (!pconn->server.is_closing
       && game.server.tcptimeout != 0
       && pconn->last_write
+      && pconn->send_buffer->ndata > game.server.netbuffer * 1024 / 4
       && conn_list_size(game.all_connections) > 1
       && pconn->access_level != ALLOW_HACK
       && timer_read_seconds(pconn->last_write) > game.server.tcptimeout) {
-    /* Cut the connections to players who lag too much.  This
+    /* Cut the connections to players who lag too much, i.e. lots of
+     * data is waiting for them and nothing got through for a while.  This
      * usually happens because client animation slows the client
      * too much and it can't keep up with the server.  We don't
      * cut HACK connections, or cut in single-player games, since
@@ -346,71 +369,42 @@ static void cut_lagging_connection(struct connection *pconn)
 }
 
 /*************************************************************************//**
-  Attempt to flush all information in the send buffers for upto 'netwait'
-  seconds.
+  Is the poller data the one of a listening socket?
 *****************************************************************************/
-void flush_packets(void)
+static bool is_listen_poll_data(const void *data)
 {
-  int i;
-  int max_desc;
-  fd_set writefs, exceptfs;
-  fc_timeval tv;
-  time_t start;
-
-  (void) time(&start);
-
-  for (;;) {
-    tv.tv_sec = (game.server.netwait - (time(NULL) - start));
-    tv.tv_usec = 0;
-
-    if (tv.tv_sec < 0) {
-      return;
-    }
-
-    FC_FD_ZERO(&writefs);
-    FC_FD_ZERO(&exceptfs);
-    max_desc = -1;
-
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-      struct connection *pconn = &connections[i];
-
-      if (pconn->used
-          && !pconn->server.is_closing
-          && 0 < pconn->send_buffer->ndata) {
-        FD_SET(pconn->sock, &writefs);
-        FD_SET(pconn->sock, &exceptfs);
-        max_desc = MAX(pconn->sock, max_desc);
-      }
-    }
-
-    if (max_desc == -1) {
-      return;
-    }
+  return ((const int *) data >= listen_socks
+          && (const int *) data < listen_socks + listen_count);
+}
 
-    if (fc_select(max_desc + 1, NULL, &writefs, &exceptfs, &tv) <= 0) {
-      return;
-    }
+/*************************************************************************//**
+  Connection a ready socket belongs to, or NULL if it is not a connection.
+*****************************************************************************/
+static struct connection *poll_ready_conn(const struct fc_poll_event *ready)
+{
+  if ((const struct connection *) ready->data >= connections
+      && (const struct connection *) ready->data
+         < connections + MAX_NUM_CONNECTIONS) {
+    return (struct connection *) ready->data;
+  }
 
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {   /* check for freaky players */
-      struct connection *pconn = &connections[i];
+  return NULL;
+}
 
-      if (pconn->used && !pconn->server.is_closing) {
-        if (FD_ISSET(pconn->sock, &exceptfs)) {
-          log_verbose("connection (%s) cut due to exception data",
-                      conn_description(pconn));
-          connection_close_server(pconn, _("network exception"));
-        } else {
-          if (pconn->send_buffer && pconn->send_buffer->ndata > 0) {
-            if (FD_ISSET(pconn->sock, &writefs)) {
-              flush_connection_send_buffer_all(pconn);
-            } else {
-              cut_lagging_connection(pconn);
-            }
-          }
-        }
-      }
+/*************************************************************************//**
+  Write as much of the queued data to the clients as their sockets accept
+  right now. Whatever is left gets written later from the main loop, when
+  the sockets become writable.
+*****************************************************************************/
+void flush_packets(void)
+{
+  conn_list_iterate(game.all_connections, pconn) {
+    if (!pconn->server.is_closing
+        && 0 < pconn->send_buffer->ndata) {
+      flush_connection_send_buffer_all(pconn);
+      cut_lagging_connection(pconn);
     }
-  }
+  } conn_list_iterate_end;
 }
 
 struct packet_to_handle {
@@ -493,11 +487,8 @@ static void incoming_client_packets(struct connection *pconn)
 *****************************************************************************/
 enum server_events server_sniff_all_input(void)
 {
-  int i, s;
-  int max_desc;
-  bool excepting;
-  fd_set readfs, writefs, exceptfs;
-  fc_timeval tv;
+  int i, num_ready;
+  bool excepting, stdin_ready;
 #ifdef FREECIV_SOCKET_ZERO_NOT_STDIN
   char *bufptr;
 #endif
@@ -656,45 +647,41 @@ enum server_events server_sniff_all_input(void)
       return S_E_END_OF_TURN_TIMEOUT;
     }
 
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
-
-    FC_FD_ZERO(&readfs);
-    FC_FD_ZERO(&writefs);
-    FC_FD_ZERO(&exceptfs);
-
     if (!no_input) {
 #ifdef FREECIV_SOCKET_ZERO_NOT_STDIN
       fc_init_console();
 #else /* FREECIV_SOCKET_ZERO_NOT_STDIN */
 #   if !defined(__VMS)
-      FD_SET(0, &readfs);
+      if (stdin_poll_handle == -1) {
+        stdin_poll_handle = fc_poller_add(server_poller, 0, FC_POLL_IN,
+                                          &stdin_poll_handle);
+      }
 #   endif /* VMS */
 #endif /* FREECIV_SOCKET_ZERO_NOT_STDIN */
+    } else if (stdin_poll_handle != -1) {
+      fc_poller_remove(server_poller, stdin_poll_handle);
+      stdin_poll_handle = -1;
     }
 
-    max_desc = 0;
-    for (i = 0; i < listen_count; i++) {
-      FD_SET(listen_socks[i], &readfs);
-      FD_SET(listen_socks[i], &exceptfs);
-      max_desc = MAX(max_desc, listen_socks[i]);
-    }
-
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-      struct connection *pconn = connections + i;
+    /* Wait for writability only when there is something to write. */
+    conn_list_iterate(game.all_connections, pconn) {
+      int events = 0;
 
-      if (pconn->used && !pconn->server.is_closing) {
-        FD_SET(pconn->sock, &readfs);
+      if (!pconn->server.is_closing) {
+        events = FC_POLL_IN;
         if (0 < pconn->send_buffer->ndata) {
-          FD_SET(pconn->sock, &writefs);
+          events |= FC_POLL_OUT;
         }
-        FD_SET(pconn->sock, &exceptfs);
-        max_desc = MAX(pconn->sock, max_desc);
       }
-    }
+      fc_poller_set_events(server_poller,
+                           conn_poll_handle[pconn - connections], events);
+    } conn_list_iterate_end;
     con_prompt_off();		/* output doesn't generate a new prompt */
 
-    if (fc_select(max_desc + 1, &readfs, &writefs, &exceptfs, &tv) == 0) {
+    stdin_ready = FALSE;
+    num_ready = fc_poller_wait(server_poller, 1000,
+                               poll_ready, poll_ready_max);
+    if (num_ready == 0) {
       /* timeout */
       call_ai_refresh();
       script_server_signal_emit("pulse");
@@ -736,7 +723,7 @@ enum server_events server_sniff_all_input(void)
 	    lib$stop(status);
 	  }
 	  if (ttchar.numchars) {
-	    FD_SET(0, &readfs);
+	    stdin_ready = TRUE;
 	  } else {
 	    continue;
 	  }
@@ -751,20 +738,25 @@ enum server_events server_sniff_all_input(void)
     }
 
     excepting = FALSE;
-    for (i = 0; i < listen_count; i++) {
-      if (FD_ISSET(listen_socks[i], &exceptfs)) {
+    for (i = 0; i < num_ready; i++) {
+      if (poll_ready[i].data == &stdin_poll_handle) {
+        if (poll_ready[i].revents & FC_POLL_IN) {
+          stdin_ready = TRUE;
+        }
+      } else if (is_listen_poll_data(poll_ready[i].data)
+                 && (poll_ready[i].revents & FC_POLL_ERR)) {
         excepting = TRUE;
-        break;
       }
     }
     if (excepting) {                  /* handle Ctrl-Z suspend/resume */
       continue;
     }
-    for (i = 0; i < listen_count; i++) {
-      s = listen_socks[i];
-      if (FD_ISSET(s, &readfs)) {     /* new players connects */
+    for (i = 0; i < num_ready; i++) {
+      if (is_listen_poll_data(poll_ready[i].data)
+          && (poll_ready[i].revents & FC_POLL_IN)) {
+        /* new players connects */
         log_verbose("got new connection");
-        if (-1 == server_accept_connection(s)) {
+        if (-1 == server_accept_connection(*(int *) poll_ready[i].data)) {
           /* There will be a log_error() message from
            * server_accept_connection() if something
            * goes wrong, so no need to make another
@@ -773,13 +765,14 @@ enum server_events server_sniff_all_input(void)
         }
       }
     }
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
+    for (i = 0; i < num_ready; i++) {
       /* check for freaky players */
-      struct connection *pconn = &connections[i];
+      struct connection *pconn = poll_ready_conn(&poll_ready[i]);
 
-      if (pconn->used
+      if (pconn != NULL
+          && pconn->used
           && !pconn->server.is_closing
-          && FD_ISSET(pconn->sock, &exceptfs)) {
+          && (poll_ready[i].revents & FC_POLL_ERR)) {
         log_verbose("connection (%s) cut due to exception data",
                     conn_description(pconn));
         connection_close_server(pconn, _("network exception"));
@@ -794,7 +787,7 @@ enum server_events server_sniff_all_input(void)
       free(bufptr_internal);
     }
 #else  /* !FREECIV_SOCKET_ZERO_NOT_STDIN */
-    if (!no_input && FD_ISSET(0, &readfs)) {    /* input from server operator */
+    if (!no_input && stdin_ready) {    /* input from server operator */
 #ifdef FREECIV_HAVE_LIBREADLINE
       rl_callback_read_char();
       if (readline_handled_input) {
@@ -844,13 +837,14 @@ enum server_events server_sniff_all_input(void)
 #endif /* !FREECIV_SOCKET_ZERO_NOT_STDIN */
 
     {                             /* input from a player */
-      for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-        struct connection *pconn = connections + i;
+      for (i = 0; i < num_ready; i++) {
+        struct connection *pconn = poll_ready_conn(&poll_ready[i]);
         int nb;
 
-        if (!pconn->used
+        if (pconn == NULL
+            || !pconn->used
             || pconn->server.is_closing
-            || !FD_ISSET(pconn->sock, &readfs)) {
+            || !(poll_ready[i].revents & FC_POLL_IN)) {
           continue;
         }
 
@@ -866,20 +860,24 @@ enum server_events server_sniff_all_input(void)
         }
       }
 
-      for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-        struct connection *pconn = &connections[i];
+      for (i = 0; i < num_ready; i++) {
+        struct connection *pconn = poll_ready_conn(&poll_ready[i]);
 
-        if (pconn->used
+        if (pconn != NULL
+            && pconn->used
             && !pconn->server.is_closing
+            && (poll_ready[i].revents & FC_POLL_OUT)) {
+          flush_connection_send_buffer_all(pconn);
+        }
+      }
+      conn_list_iterate(game.all_connections, pconn) {
+        if (!pconn->server.is_closing
             && pconn->send_buffer
             && pconn->send_buffer->ndata > 0) {
-          if (FD_ISSET(pconn->sock, &writefs)) {
-            flush_connection_send_buffer_all(pconn);
-          } else {
-            cut_lagging_connection(pconn);
-          }
+          /* Still blocked after writing what we could. */
+          cut_lagging_connection(pconn);
         }
-      }
+      } conn_list_iterate_end;
       really_close_connections();
       break;
     }
@@ -888,6 +886,7 @@ enum server_events server_sniff_all_input(void)
 
   call_ai_refresh();
   script_server_signal_emit("pulse");
+  save_system_poll();
 
   if (current_turn_timeout() > 0
       && S_S_RUNNING == server_state()
@@ -1042,6 +1041,13 @@ int server_make_connection(int new_sock, const char *client_addr,
     struct connection *pconn = &connections[i];
 
     if (!pconn->used) {
+      conn_poll_handle[i] = fc_poller_add(server_poller, new_sock,
+                                          FC_POLL_IN, pconn);
+      if (conn_poll_handle[i] == -1) {
+        fc_closesocket(new_sock);
+        return -1;
+      }
+
       connection_common_init(pconn);
       pconn->sock = new_sock;
       pconn->observer = FALSE;
@@ -1100,7 +1106,7 @@ int server_open_socket(void)
   struct ip_mreq mreq4;
 #endif
   const char *cause, *group;
-  int j, on, s;
+  int i, j, on, s;
   int lan_family;
   struct fc_sockaddr_list *list;
   int name_count;
@@ -1224,6 +1230,16 @@ int server_open_socket(void)
 
   fc_sockaddr_list_destroy(list);
 
+  server_poller = fc_poller_new();
+  for (i = 0; i < listen_count; i++) {
+    fc_poller_add(server_poller, listen_socks[i], FC_POLL_IN,
+                  listen_socks + i);
+  }
+  poll_ready_max = listen_count + MAX_NUM_CONNECTIONS + 1;
+  poll_ready = fc_malloc(poll_ready_max * sizeof(*poll_ready));
+  log_verbose("Waiting for sockets with %s.",
+              fc_poller_backend(server_poller));
+
   connections_set_close_callback(server_conn_close_callback);
 
   if (srvarg.announce == ANNOUNCE_NONE) {
@@ -1331,6 +1347,7 @@ void init_connections(void)
 
     pconn->used = FALSE;
     pconn->self = conn_list_new();
+    conn_poll_handle[i] = -1;
     conn_list_prepend(pconn->self, pconn);
   }
 #if defined(__VMS)
@@ -17,6 +17,7 @@
 
 /* utility */
 #include "astring.h"
+#include "deprecations.h"
 #include "fcintl.h"
 #include "game.h"
 #include "ioz.h"
@@ -1278,6 +1279,21 @@ static bool compresstype_callback(int value,
   return TRUE;
 }
 
+/************************************************************************//**
+  Warn that the netwait setting has no effect any more.
+****************************************************************************/
+static bool netwait_callback(int value, struct connection *caller,
+                             char *reject_msg, size_t reject_msg_len)
+{
+  if (value != GAME_DEFAULT_NETWAIT) {
+    log_deprecation("The 'netwait' setting is deprecated and has no "
+                    "effect; the server never waits for clients. See "
+                    "'netbuffer' instead.");
+  }
+
+  return TRUE;
+}
+
 /************************************************************************//**
   Validate that the player color mode can be used.
 ****************************************************************************/
@@ -2784,20 +2800,36 @@ static struct setting settings[] = {
   GEN_INT("nettimeout", game.server.tcptimeout,
           SSET_META, SSET_NETWORK, SSET_RARE, ALLOW_NONE, ALLOW_BASIC,
           N_("Seconds to let a client's network connection block"),
-          N_("If a network connection is blocking for a time greater than "
-             "this value, then the connection is closed. Zero "
-             "means there is no timeout (although connections will be "
-             "automatically disconnected eventually)."),
+          N_("If more than a quarter of the 'netbuffer' size is waiting "
+             "to be sent to a client, and the client has not accepted "
+             "any data for a time greater than this value, then the "
+             "connection is closed. Zero means there is no timeout "
+             "(although connections will be automatically disconnected "
+             "eventually)."),
           NULL, NULL, NULL,
           GAME_MIN_TCPTIMEOUT, GAME_MAX_TCPTIMEOUT, GAME_DEFAULT_TCPTIMEOUT)
 
+  GEN_INT("netbuffer", game.server.netbuffer,
+          SSET_META, SSET_NETWORK, SSET_RARE, ALLOW_NONE, ALLOW_BASIC,
+          N_("Kilobytes of data queued for each client at most"),
+          N_("Data that a client cannot receive right away is queued, "
+             "so that a slow client never makes the server wait. If "
+             "the queue of a client would grow bigger than this, the "
+             "client cannot keep up and its connection is closed."),
+          NULL, NULL, NULL,
+          GAME_MIN_NETBUFFER, GAME_MAX_NETBUFFER, GAME_DEFAULT_NETBUFFER)
+
   GEN_INT("netwait", game.server.netwait,
           SSET_META, SSET_NETWORK, SSET_RARE, ALLOW_NONE, ALLOW_BASIC,
-          N_("Max seconds for network buffers to drain"),
-          N_("The server will wait for up to the value of this "
-             "parameter in seconds, for all client connection network "
-             "buffers to unblock. Zero means the server will not "
-             "wait at all."), NULL, NULL, NULL,
+          N_("Deprecated: max seconds for network buffers to drain"),
+          /* TRANS: The string between single quotes is a setting name and
+           * should not be translated. */
+          N_("This setting is deprecated and has no effect; it is only "
+             "kept so that scripts and saved games that set it still "
+             "work. The server no longer waits for client connection "
+             "network buffers to unblock, but queues the data instead, "
+             "up to the size given by the 'netbuffer' setting."),
+          NULL, netwait_callback, NULL,
           GAME_MIN_NETWAIT, GAME_MAX_NETWAIT, GAME_DEFAULT_NETWAIT)
 
   GEN_INT("pingtime", game.server.pingtime,
@@ -2918,6 +2950,44 @@ static struct setting settings[] = {
               "users are not required to wait for the save to finish."),
            NULL, NULL, GAME_DEFAULT_THREADED_SAVE)
 
+  GEN_BOOL("binary_save", game.server.binary_save,
+           SSET_META, SSET_INTERNAL, SSET_RARE, ALLOW_HACK, ALLOW_HACK,
+           N_("Whether to save games in binary form"),
+           N_("If this is turned on, games are saved in a binary form "
+              "that is much faster to write and to load than the text "
+              "form, but can't be read or edited by hand. Both forms "
+              "can always be loaded, and the 'compress' and "
+              "'compresstype' settings apply to both."),
+           NULL, NULL, GAME_DEFAULT_BINARY_SAVE)
+
+  GEN_BOOL("forked_save", game.server.forked_save,
+           SSET_META, SSET_INTERNAL, SSET_RARE, ALLOW_HACK, ALLOW_HACK,
+           N_("Whether to save from a copy of the server process"),
+           /* TRANS: The string between single quotes is a setting name and
+            * should not be translated. */
+           N_("If this is turned on, the whole save, not only writing "
+              "the file, takes place in a copy of the server process "
+              "that sees the game as it was when saving started. The "
+              "game goes on at once instead of waiting for the save. "
+              "This takes precedence over 'threaded_save'. It is not "
+              "available on all platforms; where it isn't, saving works "
+              "as if this was turned off."),
+           NULL, NULL, GAME_DEFAULT_FORKED_SAVE)
+
+  GEN_INT("citythreads", game.server.city_threads,
+          SSET_META, SSET_INTERNAL, SSET_RARE, ALLOW_HACK, ALLOW_HACK,
+          N_("Number of helper threads for refreshing cities"),
+          N_("When many cities need to be recalculated at once, for "
+             "example at turn change or when a technology is learned, "
+             "this many threads help the server to do it. The same "
+             "threads also help to draw map images and to load the map "
+             "data of saved games. Zero means that the server "
+             "does all of the work itself. The results are the same "
+             "in either case."),
+          NULL, NULL, NULL,
+          GAME_MIN_CITY_THREADS, GAME_MAX_CITY_THREADS,
+          GAME_DEFAULT_CITY_THREADS)
+
   GEN_INT("compress", game.server.save_compress_level,
           SSET_META, SSET_INTERNAL, SSET_RARE, ALLOW_HACK, ALLOW_HACK,
           N_("Savegame compression level"),
@@ -60,6 +60,8 @@
 
 /* common/aicore */
 #include "citymap.h"
+#include "path_finding.h"
+#include "pf_clusters.h"
 
 /* common */
 #include "achievements.h"
@@ -287,6 +289,9 @@ void srv_init(void)
 
   /* Initialize callbacks. */
   game.callbacks.unit_deallocate = identity_number_release;
+  game.callbacks.tile_changed = pf_clusters_tile_changed;
+  game.callbacks.unit_changed = pf_clusters_unit_changed;
+  game.callbacks.map_freed = pf_clusters_free;
 
   /* Initialize global mutexes */
   fc_init_mutex(&game.server.mutexes.city_list);
@@ -1109,9 +1114,7 @@ static void begin_turn(bool is_new_turn)
     /* We build scores at the beginning of every turn.  We have to
      * build them at the beginning so that the AI can use the data,
      * and we are sure to have it when we need it. */
-    players_iterate(pplayer) {
-      calc_civ_score(pplayer);
-    } players_iterate_end;
+    calc_civ_scores();
     log_civ_score_now();
 
     /* Retire useless barbarian units */
@@ -1174,6 +1177,9 @@ static void begin_phase(bool is_new_phase)
 {
   log_debug("Begin phase");
 
+  /* Turn change updated diplomatic states, borders and much more. */
+  pf_map_cache_invalidate();
+
   conn_list_do_buffer(game.est_connections);
 
   phase_players_iterate(pplayer) {
@@ -1728,6 +1734,8 @@ void server_quit(void)
   voting_free();
   adv_settlers_free();
   ai_timer_free();
+  game_helper_pool_free();
+  cityturn_free();
   if (game.server.phase_timer != NULL) {
     timer_destroy(game.server.phase_timer);
     game.server.phase_timer = NULL;
@@ -2947,9 +2955,7 @@ static void srv_prepare(void)
 static void srv_scores(void)
 {
   /* Recalculate the scores in case of a spaceship victory */
-  players_iterate(pplayer) {
-    calc_civ_score(pplayer);
-  } players_iterate_end;
+  calc_civ_scores();
 
   log_civ_score_now();
 
@@ -3307,6 +3313,10 @@ void server_game_free(void)
 {
   CALL_FUNC_EACH_AI(game_free);
 
+  /* Cached maps point to the tiles about to be freed, and the map size
+   * may change in the next game. */
+  pf_free_spare_memory();
+
   /* Free all the treaties that were left open when game finished. */
   free_treaties();
 
@@ -3331,6 +3341,8 @@ void server_game_free(void)
       adv_city_free(pcity);
     } city_list_iterate_end;
   } players_iterate_end;
+  vision_delta_masks_free();
+  send_tile_info_batch_free();
 
   /* Destroy all players; with must be separate as the player information is
    * needed above. This also sends the information to the clients. */
@@ -1524,6 +1524,9 @@ void transform_unit(struct unit *punit, struct unit_type *to_unit,
   }
 
   punit->utype = to_unit;
+  if (game.callbacks.unit_changed) {
+    (game.callbacks.unit_changed)(punit);
+  }
 
   /* New type may not have the same veteran system, and we may want to
    * knock some levels off. */
@@ -1596,6 +1599,8 @@ struct unit *create_unit_full(struct player *pplayer, struct tile *ptile,
   struct unit *punit = unit_virtual_create(pplayer, NULL, type, veteran_level);
   struct city *pcity;
 
+  pf_map_cache_invalidate();
+
   /* Register unit */
   punit->id = identity_number();
   idex_register_unit(&wld, punit);
@@ -1704,6 +1709,7 @@ static void server_remove_unit_full(struct unit *punit, bool transported,
 
   /* The unit is doomed. */
   punit->server.dying = TRUE;
+  pf_map_cache_invalidate();
 
 #ifdef FREECIV_DEBUG
   unit_list_iterate(ptile->units, pcargo) {
@@ -3012,6 +3018,7 @@ void unit_transport_load_send(struct unit *punit, struct unit *ptrans)
   fc_assert_ret(punit != NULL);
   fc_assert_ret(ptrans != NULL);
 
+  pf_map_cache_invalidate();
   unit_transport_load(punit, ptrans, FALSE);
 
   send_unit_info(NULL, punit);
@@ -3049,6 +3056,7 @@ void unit_transport_unload_send(struct unit *punit)
 
   fc_assert_ret(punit);
 
+  pf_map_cache_invalidate();
   ptrans = unit_transport_get(punit);
 
   fc_assert_ret(ptrans);
@@ -3544,7 +3552,7 @@ static struct unit_move_data *unit_move_data(struct unit *punit,
   /* Enhance vision if unit steps into a fortress */
   new_vision = vision_new(powner, pdesttile);
   punit->server.vision = new_vision;
-  vision_change_sight(new_vision, radius_sq);
+  vision_move_sight(new_vision, pdata->old_vision, radius_sq);
   ASSERT_VISION(new_vision);
 
   return pdata;
@@ -3604,6 +3612,8 @@ bool unit_move(struct unit *punit, struct tile *pdesttile, int move_cost,
   fc_assert_ret_val(punit != NULL, FALSE);
   fc_assert_ret_val(pdesttile != NULL, FALSE);
 
+  pf_map_cache_invalidate();
+
   pplayer = unit_owner(punit);
   saved_id = punit->id;
   psrctile = unit_tile(punit);
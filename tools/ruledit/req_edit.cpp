@@ -26,6 +26,8 @@
 #include "fcintl.h"
 
 // common
+#include "actions.h"
+#include "effects.h"
 #include "reqtext.h"
 #include "requirements.h"
 
@@ -36,6 +38,21 @@
 
 #include "req_edit.h"
 
+/**********************************************************************//**
+  iterate_effect_cache() callback compiling the requirements of the
+  effect again if they are the edited ones 'data'.
+**************************************************************************/
+static bool effect_reqs_edited(struct effect *peffect, void *data)
+{
+  if (&peffect->reqs != data) {
+    return TRUE;
+  }
+
+  effect_reqs_changed(peffect);
+
+  return FALSE;
+}
+
 /**********************************************************************//**
   Setup req_edit object
 **************************************************************************/
@@ -173,6 +190,24 @@ void req_edit::refresh()
   fill_active();
 }
 
+/**********************************************************************//**
+  The requirements were changed in place. Compile them again if they
+  belong to an effect or an action enabler, which keep them compiled.
+**************************************************************************/
+void req_edit::reqs_changed()
+{
+  if (!iterate_effect_cache(effect_reqs_edited, req_vector)) {
+    return;
+  }
+
+  action_enablers_iterate(enabler) {
+    if (&enabler->actor_reqs == req_vector
+        || &enabler->target_reqs == req_vector) {
+      action_enabler_reqs_changed(enabler);
+    }
+  } action_enablers_iterate_end;
+}
+
 /**********************************************************************//**
   User pushed close button
 **************************************************************************/
@@ -267,6 +302,7 @@ void req_edit::req_type_menu(QAction *action)
   if (selected != nullptr) {
     selected->source.kind = univ;
     universal_value_initial(&selected->source);
+    reqs_changed();
   }
 
   refresh();
@@ -282,6 +318,7 @@ void req_edit::req_range_menu(QAction *action)
 
   if (selected != nullptr) {
     selected->range = range;
+    reqs_changed();
   }
 
   refresh();
@@ -298,6 +335,7 @@ void req_edit::req_present_menu(QAction *action)
     } else {
       selected->present = TRUE;
     }
+    reqs_changed();
   }
 
   refresh();
@@ -310,6 +348,7 @@ void req_edit::univ_value_enum_menu(QAction *action)
 {
   if (selected != nullptr) {
     universal_value_from_str(&selected->source, action->text().toUtf8().data());
+    reqs_changed();
 
     refresh();
   }
@@ -323,6 +362,7 @@ void req_edit::univ_value_edit()
   if (selected != nullptr) {
     universal_value_from_str(&selected->source,
                              edit_value_nbr_field->text().toUtf8().data());
+    reqs_changed();
 
     refresh();
   }
@@ -339,6 +379,7 @@ void req_edit::add_now()
                             false, true, false, 0);
 
   requirement_vector_append(req_vector, new_req);
+  reqs_changed();
 
   refresh();
 }
@@ -354,6 +395,7 @@ void req_edit::delete_now()
     for (i = 0; i < requirement_vector_size(req_vector); i++) {
       if (requirement_vector_get(req_vector, i) == selected) {
         requirement_vector_remove(req_vector, i);
+        reqs_changed();
         break;
       }
     }
@@ -51,6 +51,8 @@ class req_edit : public QDialog
     QToolButton *edit_range_button;
     QToolButton *edit_present_button;
 
+    void reqs_changed();
+
   private slots:
     void select_req();
     void fill_active();
@@ -137,6 +137,67 @@ bool dbv_isset_any(const struct dbv *pdbv)
                        _BV_BYTES(pdbv->bits));
 }
 
+/***********************************************************************//**
+  Return the first set bit at or after 'from', or -1 if there is none.
+  Skips over unset bits a word at a time.
+***************************************************************************/
+int dbv_next_set(const struct dbv *pdbv, int from)
+{
+  int nbytes, byte;
+
+  fc_assert_ret_val(pdbv != NULL, -1);
+  fc_assert_ret_val(pdbv->vec != NULL, -1);
+
+  if (from < 0) {
+    from = 0;
+  }
+  if (from >= pdbv->bits) {
+    return -1;
+  }
+
+  nbytes = _BV_BYTES(pdbv->bits);
+  byte = _BV_BYTE_INDEX(from);
+
+  /* Rest of the first byte. */
+  if ((pdbv->vec[byte] >> (from & 0x7)) != 0) {
+    unsigned char rest = pdbv->vec[byte] >> (from & 0x7);
+
+    while (!(rest & 1)) {
+      rest >>= 1;
+      from++;
+    }
+
+    return from < pdbv->bits ? from : -1;
+  }
+  byte++;
+
+  while (byte < nbytes) {
+    if (byte + (int) sizeof(unsigned long) <= nbytes) {
+      unsigned long word;
+
+      memcpy(&word, pdbv->vec + byte, sizeof(word));
+      if (word == 0) {
+        byte += sizeof(word);
+        continue;
+      }
+    }
+    if (pdbv->vec[byte] != 0) {
+      int bit = byte * 8;
+      unsigned char rest = pdbv->vec[byte];
+
+      while (!(rest & 1)) {
+        rest >>= 1;
+        bit++;
+      }
+
+      return bit < pdbv->bits ? bit : -1;
+    }
+    byte++;
+  }
+
+  return -1;
+}
+
 /***********************************************************************//**
   Set the bit given by 'bit'.
 ***************************************************************************/
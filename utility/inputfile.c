@@ -26,6 +26,10 @@
   The data pointed to should not be modified.  The retuned pointer
   is valid _only_ until another inputfile is performed.  (So should
   be used immediately, or fc_strdup-ed etc.)
+
+  The whole file is read into one buffer when it is opened, and the
+  returned tokens point into that buffer: the character just after a
+  token is replaced by '\0' and put back at the next inputfile call.
   
   The tokens recognised are as follows:
   (Single quotes are delimiters used here, but are not part of the
@@ -90,15 +94,18 @@
 struct inputfile {
   unsigned int magic;		/* memory check */
   char *filename;		/* filename as passed to fopen */
-  fz_FILE *fp;			/* read from this */
+  char *buffer;			/* whole contents of the file */
+  char *buffer_end;		/* the '\0' at the end of buffer */
+  char *next_line;		/* start of the line after cur_line */
   bool at_eof;			/* flag for end-of-file */
-  struct astring cur_line;	/* data from current line */
+  char *cur_line;		/* current line, a slice of buffer */
+  int cur_line_len;		/* length of cur_line, 0 if none */
   int cur_line_pos;		/* position in current line */
   int line_num;			/* line number from file in cur_line */
-  struct astring token;		/* data returned to user */
-  struct astring partial;	/* used in accumulating multi-line strings;
-				   used only in get_token_value, but put
-				   here so it gets freed when file closed */
+  char *restore_at;		/* where the last token was ended... */
+  char restore_char;		/* ...and what was there before */
+  struct astring token;		/* data returned to user for strings
+                                   read from another file */
   datafilename_fn_t datafn;	/* function like datafilename(); use a
 				   function pointer just to keep this
 				   inputfile module "generic" */
@@ -156,6 +163,31 @@ static bool is_comment(int c)
   return (c == '#' || c == ';');
 }
 
+/*******************************************************************//**
+  Same as fc_isspace(), without a library call for every character.
+***********************************************************************/
+static inline bool inf_isspace(char c)
+{
+  return (' ' == c || ('\t' <= c && '\r' >= c));
+}
+
+/*******************************************************************//**
+  Same as fc_isdigit(), without a library call for every character.
+***********************************************************************/
+static inline bool inf_isdigit(char c)
+{
+  return ('0' <= c && '9' >= c);
+}
+
+/*******************************************************************//**
+  Same as fc_isalnum(), without a library call for every character.
+***********************************************************************/
+static inline bool inf_isalnum(char c)
+{
+  return (inf_isdigit(c)
+          || ('a' <= c && 'z' >= c) || ('A' <= c && 'Z' >= c));
+}
+
 /*******************************************************************//**
   Set values to zeros; should have free'd/closed everything before
   this if appropriate.
@@ -165,15 +197,16 @@ static void init_zeros(struct inputfile *inf)
   fc_assert_ret(NULL != inf);
   inf->magic = INF_MAGIC;
   inf->filename = NULL;
-  inf->fp = NULL;
+  inf->buffer = inf->buffer_end = inf->next_line = NULL;
   inf->datafn = NULL;
   inf->included_from = NULL;
-  inf->line_num = inf->cur_line_pos = 0;
+  inf->cur_line = NULL;
+  inf->line_num = inf->cur_line_len = inf->cur_line_pos = 0;
+  inf->restore_at = NULL;
+  inf->restore_char = '\0';
   inf->at_eof = inf->in_string = FALSE;
   inf->string_start_line = 0;
-  astr_init(&inf->cur_line);
   astr_init(&inf->token);
-  astr_init(&inf->partial);
 }
 
 /*******************************************************************//**
@@ -183,7 +216,7 @@ static bool inf_sanity_check(struct inputfile *inf)
 {
   fc_assert_ret_val(NULL != inf, FALSE);
   fc_assert_ret_val(INF_MAGIC == inf->magic, FALSE);
-  fc_assert_ret_val(NULL != inf->fp, FALSE);
+  fc_assert_ret_val(NULL != inf->buffer, FALSE);
   fc_assert_ret_val(0 <= inf->line_num, FALSE);
   fc_assert_ret_val(0 <= inf->cur_line_pos, FALSE);
   fc_assert_ret_val(FALSE == inf->at_eof
@@ -214,6 +247,89 @@ static const char *inf_filename(struct inputfile *inf)
   }
 }
 
+/*******************************************************************//**
+  Remove the '\r' of "\r\n" and "\n\r" line endings from the buffer,
+  in place. Returns the new length.
+***********************************************************************/
+static size_t strip_carriage_returns(char *buffer, size_t len)
+{
+  char *src, *dst, *end = buffer + len;
+  char prev;
+
+  src = memchr(buffer, '\r', len);
+  if (NULL == src) {
+    return len;
+  }
+
+  prev = (src == buffer ? '\n' : src[-1]);
+  for (dst = src; src < end; src++) {
+    char c = *src;
+
+    if ('\r' != c || ('\n' != prev && (src + 1 == end || '\n' != src[1]))) {
+      *dst++ = c;
+    }
+    prev = c;
+  }
+  *dst = '\0';
+
+  return dst - buffer;
+}
+
+/*******************************************************************//**
+  Take over the buffer, which holds 'len' bytes followed by a '\0', and
+  return an allocated, initialized structure reading from it. 'filename'
+  may be NULL.
+***********************************************************************/
+struct inputfile *inf_from_buffer(char *buffer, size_t len,
+                                  const char *filename,
+                                  datafilename_fn_t datafn)
+{
+  struct inputfile *inf;
+
+  fc_assert_ret_val(NULL != buffer, NULL);
+
+  inf = fc_malloc(sizeof(*inf));
+  init_zeros(inf);
+
+  len = strip_carriage_returns(buffer, len);
+  inf->filename = (NULL != filename ? fc_strdup(filename) : NULL);
+  inf->buffer = buffer;
+  inf->buffer_end = buffer + len;
+  inf->next_line = buffer;
+  inf->datafn = datafn;
+
+  log_debug("inputfile: opened \"%s\" ok", inf_filename(inf));
+  return inf;
+}
+
+/*******************************************************************//**
+  Read the whole stream and close it, and return an allocated,
+  initialized structure. Returns NULL if the stream could not be read.
+***********************************************************************/
+static struct inputfile *inf_read_stream(fz_FILE *stream,
+                                         const char *filename,
+                                         datafilename_fn_t datafn)
+{
+  char *buffer;
+  size_t len;
+
+  buffer = fz_fread_all(stream, &len);
+  if (NULL == buffer || 0 != fz_ferror(stream)) {
+    log_error("Error reading %s: %s",
+              NULL != filename ? filename : "(anonymous)",
+              fz_strerror(stream));
+    fz_fclose(stream);
+    free(buffer);
+    return NULL;
+  }
+  if (0 != fz_fclose(stream)) {
+    log_error("Error closing %s",
+              NULL != filename ? filename : "(anonymous)");
+  }
+
+  return inf_from_buffer(buffer, len, filename, datafn);
+}
+
 /*******************************************************************//**
   Open the file, and return an allocated, initialized structure.
   Returns NULL if the file could not be opened.
@@ -221,7 +337,6 @@ static const char *inf_filename(struct inputfile *inf)
 struct inputfile *inf_from_file(const char *filename,
                                 datafilename_fn_t datafn)
 {
-  struct inputfile *inf;
   fz_FILE *fp;
 
   fc_assert_ret_val(NULL != filename, NULL);
@@ -230,38 +345,25 @@ struct inputfile *inf_from_file(const char *filename,
   if (!fp) {
     return NULL;
   }
-  log_debug("inputfile: opened \"%s\" ok", filename);
-  inf = inf_from_stream(fp, datafn);
-  inf->filename = fc_strdup(filename);
-  return inf;
+  return inf_read_stream(fp, filename, datafn);
 }
 
 /*******************************************************************//**
-  Open the stream, and return an allocated, initialized structure.
-  Returns NULL if the file could not be opened.
+  Read the stream, which gets closed, and return an allocated,
+  initialized structure. Returns NULL if the stream could not be read.
 ***********************************************************************/
 struct inputfile *inf_from_stream(fz_FILE *stream, datafilename_fn_t datafn)
 {
-  struct inputfile *inf;
-
   fc_assert_ret_val(NULL != stream, NULL);
-  inf = fc_malloc(sizeof(*inf));
-  init_zeros(inf);
-
-  inf->filename = NULL;
-  inf->fp = stream;
-  inf->datafn = datafn;
-
-  log_debug("inputfile: opened \"%s\" ok", inf_filename(inf));
-  return inf;
+  return inf_read_stream(stream, NULL, datafn);
 }
 
 
 /*******************************************************************//**
-  Close the file and free associated memory, but don't recurse
-  included_from files, and don't free the actual memory where
-  the inf record is stored (ie, the memory where the users pointer
-  points to).  This is used when closing an included file.
+  Free associated memory, but don't recurse included_from files, and
+  don't free the actual memory where the inf record is stored (ie, the
+  memory where the users pointer points to).  This is used when closing
+  an included file.
 ***********************************************************************/
 static void inf_close_partial(struct inputfile *inf)
 {
@@ -269,22 +371,12 @@ static void inf_close_partial(struct inputfile *inf)
 
   log_debug("inputfile: sub-closing \"%s\"", inf_filename(inf));
 
-  if (fz_ferror(inf->fp) != 0) {
-    log_error("Error before closing %s: %s", inf_filename(inf),
-              fz_strerror(inf->fp));
-    fz_fclose(inf->fp);
-    inf->fp = NULL;
-  }
-  else if (fz_fclose(inf->fp) != 0) {
-    log_error("Error closing %s", inf_filename(inf));
-  }
+  free(inf->buffer);
   if (inf->filename) {
     free(inf->filename);
   }
   inf->filename = NULL;
-  astr_free(&inf->cur_line);
   astr_free(&inf->token);
-  astr_free(&inf->partial);
 
   /* assign zeros for safety if accidently re-use etc: */
   init_zeros(inf);
@@ -315,20 +407,39 @@ void inf_close(struct inputfile *inf)
 /*******************************************************************//**
   Return TRUE if have data for current line.
 ***********************************************************************/
-static bool have_line(struct inputfile *inf)
+static inline bool have_line(struct inputfile *inf)
 {
-  fc_assert_ret_val(inf_sanity_check(inf), FALSE);
-  return !astr_empty(&inf->cur_line);
+  return 0 < inf->cur_line_len;
 }
 
 /*******************************************************************//**
   Return TRUE if current pos is at end of current line.
 ***********************************************************************/
-static bool at_eol(struct inputfile *inf)
+static inline bool at_eol(struct inputfile *inf)
 {
-  fc_assert_ret_val(inf_sanity_check(inf), TRUE);
-  fc_assert_ret_val(inf->cur_line_pos <= astr_len(&inf->cur_line), TRUE);
-  return (inf->cur_line_pos >= astr_len(&inf->cur_line));
+  return (inf->cur_line_pos >= inf->cur_line_len);
+}
+
+/*******************************************************************//**
+  End the token that was found just before 'end', by putting a '\0'
+  there. The character is put back by inf_restore().
+***********************************************************************/
+static inline void inf_terminate(struct inputfile *inf, char *end)
+{
+  inf->restore_at = end;
+  inf->restore_char = *end;
+  *end = '\0';
+}
+
+/*******************************************************************//**
+  Undo inf_terminate() for the last token returned.
+***********************************************************************/
+static inline void inf_restore(struct inputfile *inf)
+{
+  if (NULL != inf->restore_at) {
+    *inf->restore_at = inf->restore_char;
+    inf->restore_at = NULL;
+  }
 }
 
 /*******************************************************************//**
@@ -360,12 +471,11 @@ static bool check_include(struct inputfile *inf)
   if (len == 0) {
     len = strlen(include_prefix);
   }
-  fc_assert_ret_val(inf_sanity_check(inf), FALSE);
-  if (inf->in_string || astr_len(&inf->cur_line) <= len
+  if (inf->in_string || inf->cur_line_len <= len
       || inf->cur_line_pos > 0) {
     return FALSE;
   }
-  if (strncmp(astr_str(&inf->cur_line), include_prefix, len) != 0) {
+  if (strncmp(inf->cur_line, include_prefix, len) != 0) {
     return FALSE;
   }
   /* from here, the include-line must be well formed */
@@ -373,8 +483,8 @@ static bool check_include(struct inputfile *inf)
 
   /* skip any whitespace: */
   inf->cur_line_pos = len;
-  c = astr_str(&inf->cur_line) + len;
-  while (*c != '\0' && fc_isspace(*c)){
+  c = inf->cur_line + len;
+  while (*c != '\0' && inf_isspace(*c)){
     c++;
   }
 
@@ -384,7 +494,7 @@ static bool check_include(struct inputfile *inf)
     return FALSE;
   }
   c++;
-  inf->cur_line_pos = c - astr_str(&inf->cur_line);
+  inf->cur_line_pos = c - inf->cur_line;
 
   bare_name_start = c;
   while (*c != '\0' && *c != '\"') c++;
@@ -398,17 +508,17 @@ static bool check_include(struct inputfile *inf)
   bare_name = fc_malloc(bare_name_len);
   strncpy(bare_name, bare_name_start, bare_name_len - 1);
   bare_name[bare_name_len - 1] = '\0';
-  inf->cur_line_pos = c - astr_str(&inf->cur_line);
+  inf->cur_line_pos = c - inf->cur_line;
 
   /* check rest of line is well-formed: */
-  while (*c != '\0' && fc_isspace(*c) && !is_comment(*c)) {
+  while (*c != '\0' && inf_isspace(*c) && !is_comment(*c)) {
     c++;
   }
   if (!(*c == '\0' || is_comment(*c))) {
     inf_log(inf, LOG_ERROR, "Junk after filename for '*include' line");
     return FALSE;
   }
-  inf->cur_line_pos = astr_len(&inf->cur_line) - 1;
+  inf->cur_line_pos = inf->cur_line_len - 1;
 
   full_name = inf->datafn(bare_name);
   if (!full_name) {
@@ -431,6 +541,10 @@ static bool check_include(struct inputfile *inf)
   }
 
   new_inf = inf_from_file(full_name, inf->datafn);
+  if (NULL == new_inf) {
+    log_error("Could not read included file \"%s\"", full_name);
+    return FALSE;
+  }
 
   /* Swap things around so that memory pointed to by inf (user pointer,
      and pointer in calling functions) contains the new inputfile,
@@ -445,78 +559,27 @@ static bool check_include(struct inputfile *inf)
 }
 
 /*******************************************************************//**
-  Read a new line into cur_line.
+  Make the next line of the buffer cur_line, replacing its newline
+  with '\0'.
   Increments line_num and cur_line_pos.
   Returns 0 if didn't read or other problem: treat as EOF.
-  Strips newline from input.
 ***********************************************************************/
 static bool read_a_line(struct inputfile *inf)
 {
-  struct astring *line;
-  char *ret;
-  int pos;
-
-  fc_assert_ret_val(inf_sanity_check(inf), FALSE);
+  char *line, *end;
 
   if (inf->at_eof) {
     return FALSE;
   }
 
-  /* abbreviation: */
-  line = &inf->cur_line;
-
-  /* minimum initial line length: */
-  astr_reserve(line, 80);
-  astr_clear(line);
-  pos = 0;
-
-  /* Read until we get a full line:
-   * At start of this loop, pos is index to trailing null
-   * (or first position) in line.
-   */
-  for (;;) {
-    ret = fz_fgets((char *) astr_str(line) + pos,
-                   astr_capacity(line) - pos, inf->fp);
-
-    if (!ret) {
-      /* fgets failed */
-      if (pos > 0) {
-        inf_log(inf, LOG_ERROR, _("End-of-file not in line of its own"));
-      }
-      inf->at_eof = TRUE;
-      if (inf->in_string) {
-        /* Note: Don't allow multi-line strings to cross "include"
-         * boundaries */
-        inf_log(inf, LOG_ERROR, "Multi-line string went to end-of-file");
-        return FALSE;
-      }
-      break;
-    }
-
-    /* Cope with \n\r line endings if not caught by library:
-     * strip off any leading \r */
-    if (0 == pos && 0 < astr_len(line) && astr_str(line)[0] == '\r') {
-      memmove((char *)astr_str(line), astr_str(line)+1, astr_len(line));
-    }
-
-    pos = astr_len(line);
+  line = inf->next_line;
+  end = memchr(line, '\n', inf->buffer_end - line);
 
-    if (0 < pos && astr_str(line)[pos - 1] == '\n') {
-      int end;
-      /* Cope with \r\n line endings if not caught by library:
-       * strip off any trailing \r */
-      if (1 < pos && astr_str(line)[pos - 2] == '\r') {
-        end = pos - 2;
-      } else {
-        end = pos - 1;
-      }
-      *((char *) astr_str(line) + end) = '\0';
-      break;
-    }
-    astr_reserve(line, pos * 2);
-  }
-
-  if (!inf->at_eof) {
+  if (NULL != end) {
+    *end = '\0';
+    inf->cur_line = line;
+    inf->cur_line_len = end - line;
+    inf->next_line = end + 1;
     inf->line_num++;
     inf->cur_line_pos = 0;
 
@@ -524,19 +587,35 @@ static bool read_a_line(struct inputfile *inf)
       return read_a_line(inf);
     }
     return TRUE;
-  } else {
-    astr_clear(line);
-    if (inf->included_from) {
-      /* Pop the include, and get next line from file above instead. */
-      struct inputfile *inc = inf->included_from;
-      inf_close_partial(inf);
-      *inf = *inc;    /* so the user pointer in still valid
-                       * (and inf pointers in calling functions) */
-      free(inc);
-      return read_a_line(inf);
-    }
+  }
+
+  if (line < inf->buffer_end) {
+    /* Point at the unterminated line for the message. */
+    inf->cur_line = line;
+    inf->cur_line_len = inf->buffer_end - line;
+    inf->cur_line_pos = 0;
+    inf_log(inf, LOG_ERROR, _("End-of-file not in line of its own"));
+  }
+  inf->at_eof = TRUE;
+  inf->next_line = inf->buffer_end;
+  if (inf->in_string) {
+    /* Note: Don't allow multi-line strings to cross "include"
+     * boundaries */
+    inf_log(inf, LOG_ERROR, "Multi-line string went to end-of-file");
     return FALSE;
   }
+
+  inf->cur_line_len = 0;
+  if (inf->included_from) {
+    /* Pop the include, and get next line from file above instead. */
+    struct inputfile *inc = inf->included_from;
+    inf_close_partial(inf);
+    *inf = *inc;    /* so the user pointer in still valid
+                     * (and inf pointers in calling functions) */
+    free(inc);
+    return read_a_line(inf);
+  }
+  return FALSE;
 }
 
 /*******************************************************************//**
@@ -564,9 +643,19 @@ char *inf_log_str(struct inputfile *inf, const char *message, ...)
                inf_filename(inf), inf->line_num, inf->cur_line_pos,
                (inf->at_eof ? ", EOF" : ""));
 
-  if (!astr_empty(&inf->cur_line)) {
+  if (have_line(inf)) {
+    /* Show the line as it is in the file, even if the last token is
+     * still '\0'-terminated. */
+    char *pending = inf->restore_at;
+
+    if (NULL != pending) {
+      *pending = inf->restore_char;
+    }
     cat_snprintf(str, sizeof(str), "\n  looking at: '%s'",
-                 astr_str(&inf->cur_line) + inf->cur_line_pos);
+                 inf->cur_line + inf->cur_line_pos);
+    if (NULL != pending) {
+      *pending = '\0';
+    }
   }
   if (inf->in_string) {
     cat_snprintf(str, sizeof(str),
@@ -596,6 +685,9 @@ const char *inf_token(struct inputfile *inf, enum inf_token_type type)
   name = tok_tab[type].name ? tok_tab[type].name : "(unnamed)";
   func = tok_tab[type].func;
 
+  /* The previous token is not valid any more. */
+  inf_restore(inf);
+
   if (!func) {
     log_error("token type %d (%s) not supported yet", type, name);
     c = NULL;
@@ -610,7 +702,7 @@ const char *inf_token(struct inputfile *inf, enum inf_token_type type)
     }
   }
   if (c && INF_DEBUG_FOUND) {
-    log_debug("inputfile: found %s '%s'", name, astr_str(&inf->token));
+    log_debug("inputfile: found %s '%s'", name, c);
   }
   return c;
 }
@@ -637,11 +729,9 @@ int inf_discard_tokens(struct inputfile *inf, enum inf_token_type type)
 ***********************************************************************/
 static const char *get_token_section_name(struct inputfile *inf)
 {
-  const char *c, *start;
-
-  fc_assert_ret_val(have_line(inf), NULL);
+  char *c, *start;
 
-  c = astr_str(&inf->cur_line) + inf->cur_line_pos;
+  c = inf->cur_line + inf->cur_line_pos;
   if (*c++ != '[') {
     return NULL;
   }
@@ -652,11 +742,9 @@ static const char *get_token_section_name(struct inputfile *inf)
   if (*c != ']') {
     return NULL;
   }
-  *((char *) c) = '\0'; /* Tricky. */
-  astr_set(&inf->token, "%s", start);
-  *((char *) c) = ']';  /* Revert. */
-  inf->cur_line_pos = c + 1 - astr_str(&inf->cur_line);
-  return astr_str(&inf->token);
+  inf_terminate(inf, c);
+  inf->cur_line_pos = c + 1 - inf->cur_line;
+  return start;
 }
 
 /*******************************************************************//**
@@ -665,23 +753,20 @@ static const char *get_token_section_name(struct inputfile *inf)
 ***********************************************************************/
 static const char *get_token_entry_name(struct inputfile *inf)
 {
-  const char *c, *start, *end;
-  char trailing;
+  char *c, *start, *end;
 
-  fc_assert_ret_val(have_line(inf), NULL);
-
-  c = astr_str(&inf->cur_line) + inf->cur_line_pos;
-  while (*c != '\0' && fc_isspace(*c)) {
+  c = inf->cur_line + inf->cur_line_pos;
+  while (*c != '\0' && inf_isspace(*c)) {
     c++;
   }
   if (*c == '\0') {
     return NULL;
   }
   start = c;
-  while (*c != '\0' && !fc_isspace(*c) && *c != '=' && !is_comment(*c)) {
+  while (*c != '\0' && !inf_isspace(*c) && *c != '=' && !is_comment(*c)) {
     c++;
   }
-  if (!(*c != '\0' && (fc_isspace(*c) || *c == '='))) {
+  if (!(*c != '\0' && (inf_isspace(*c) || *c == '='))) {
     return NULL;
   }
   end = c;
@@ -691,12 +776,9 @@ static const char *get_token_entry_name(struct inputfile *inf)
   if (*c != '=') {
     return NULL;
   }
-  trailing = *end;
-  *((char *) end) = '\0';       /* Tricky. */
-  astr_set(&inf->token, "%s", start);
-  *((char *) end) = trailing;   /* Revert. */
-  inf->cur_line_pos = c + 1 - astr_str(&inf->cur_line);
-  return astr_str(&inf->token);
+  inf_terminate(inf, end);
+  inf->cur_line_pos = c + 1 - inf->cur_line;
+  return start;
 }
 
 /*******************************************************************//**
@@ -707,11 +789,9 @@ static const char *get_token_eol(struct inputfile *inf)
 {
   const char *c;
 
-  fc_assert_ret_val(have_line(inf), NULL);
-
   if (!at_eol(inf)) {
-    c = astr_str(&inf->cur_line) + inf->cur_line_pos;
-    while (*c != '\0' && fc_isspace(*c)) {
+    c = inf->cur_line + inf->cur_line_pos;
+    while (*c != '\0' && inf_isspace(*c)) {
       c++;
     }
     if (*c != '\0' && !is_comment(*c)) {
@@ -720,11 +800,10 @@ static const char *get_token_eol(struct inputfile *inf)
   }
 
   /* finished with this line: say that we don't have it any more: */
-  astr_clear(&inf->cur_line);
+  inf->cur_line_len = 0;
   inf->cur_line_pos = 0;
 
-  astr_set(&inf->token, " ");
-  return astr_str(&inf->token);
+  return " ";
 }
 
 /*******************************************************************//**
@@ -734,20 +813,18 @@ static const char *get_token_eol(struct inputfile *inf)
 static const char *get_token_white_char(struct inputfile *inf,
                                         char target)
 {
-  const char *c;
-
-  fc_assert_ret_val(have_line(inf), NULL);
+  char *c;
 
-  c = astr_str(&inf->cur_line) + inf->cur_line_pos;
-  while (*c != '\0' && fc_isspace(*c)) {
+  c = inf->cur_line + inf->cur_line_pos;
+  while (*c != '\0' && inf_isspace(*c)) {
     c++;
   }
   if (*c != target) {
     return NULL;
   }
-  inf->cur_line_pos = c + 1 - astr_str(&inf->cur_line);
-  astr_set(&inf->token, "%c", target);
-  return astr_str(&inf->token);
+  inf_terminate(inf, c + 1);
+  inf->cur_line_pos = c + 1 - inf->cur_line;
+  return c;
 }
 
 /*******************************************************************//**
@@ -779,56 +856,45 @@ static const char *get_token_comma(struct inputfile *inf)
 ***********************************************************************/
 static const char *get_token_value(struct inputfile *inf)
 {
-  struct astring *partial;
-  const char *c, *start;
-  char trailing;
+  char *c, *start;
   bool has_i18n_marking = FALSE;
   char border_character = '\"';
 
-  fc_assert_ret_val(have_line(inf), NULL);
-
-  c = astr_str(&inf->cur_line) + inf->cur_line_pos;
-  while (*c != '\0' && fc_isspace(*c)) {
+  c = inf->cur_line + inf->cur_line_pos;
+  while (*c != '\0' && inf_isspace(*c)) {
     c++;
   }
   if (*c == '\0') {
     return NULL;
   }
 
-  if (*c == '-' || *c == '+' || fc_isdigit(*c)) {
+  if (*c == '-' || *c == '+' || inf_isdigit(*c)) {
     /* a number: */
     start = c++;
-    while (*c != '\0' && fc_isdigit(*c)) {
+    while (*c != '\0' && inf_isdigit(*c)) {
       c++;
     }
     if (*c == '.') {
       /* Float maybe */
       c++;
-      while (*c != '\0' && fc_isdigit(*c)) {
+      while (*c != '\0' && inf_isdigit(*c)) {
         c++;
       }
     }
     /* check that the trailing stuff is ok: */
-    if (!(*c == '\0' || *c == ',' || fc_isspace(*c) || is_comment(*c))) {
+    if (!(*c == '\0' || *c == ',' || inf_isspace(*c) || is_comment(*c))) {
       return NULL;
     }
-    /* If its a comma, we don't want to obliterate it permanently,
-     * so remember it: */
-    trailing = *c;
-    *((char *) c) = '\0';       /* Tricky. */
-
-    inf->cur_line_pos = c - astr_str(&inf->cur_line);
-    astr_set(&inf->token, "%s", start);
-
-    *((char *) c) = trailing;   /* Revert. */
-    return astr_str(&inf->token);
+    inf_terminate(inf, c);
+    inf->cur_line_pos = c - inf->cur_line;
+    return start;
   }
 
   /* allow gettext marker: */
   if (*c == '_' && *(c + 1) == '(') {
     has_i18n_marking = TRUE;
     c += 2;
-    while (*c != '\0' && fc_isspace(*c)) {
+    while (*c != '\0' && inf_isspace(*c)) {
       c++;
     }
     if (*c == '\0') {
@@ -841,8 +907,7 @@ static const char *get_token_value(struct inputfile *inf)
   if (border_character == '*') {
     const char *rfname;
     fz_FILE *fp;
-    bool eof;
-    int pos;
+    char *contents;
 
     c++;
 
@@ -855,50 +920,34 @@ static const char *get_token_value(struct inputfile *inf)
     }
     c++;
     /* check that the trailing stuff is ok: */
-    if (!(*c == '\0' || *c == ',' || fc_isspace(*c) || is_comment(*c))) {
+    if (!(*c == '\0' || *c == ',' || inf_isspace(*c) || is_comment(*c))) {
       return NULL;
     }
-    /* We don't want to obliterate ending '*' permanently,
-     * so remember it: */
-    trailing = *(c - 1);
-    *((char *) (c - 1)) = '\0';     /* Tricky. */
 
+    *(c - 1) = '\0';            /* Tricky. */
     rfname = fileinfoname(get_data_dirs(), start);
     if (rfname == NULL) {
       inf_log(inf, LOG_ERROR, 
               _("Cannot find stringfile \"%s\"."), start);
-      *((char *) c) = trailing; /* Revert. */
+      *(c - 1) = '*';           /* Revert. */
       return NULL;
     }
-    *((char *) c) = trailing; /* Revert. */
+    *(c - 1) = '*';             /* Revert. */
     fp = fz_from_file(rfname, "r", -1, 0);
     if (!fp) {
       inf_log(inf, LOG_ERROR,
               _("Cannot open stringfile \"%s\"."), rfname);
       return NULL;
     }
-    log_debug("Stringfile \"%s\" opened ok", start);
-    *((char *) (c - 1)) = trailing; /* Revert. */
-    astr_set(&inf->token, "*"); /* Mark as a string read from a file */
-
-    eof = FALSE;
-    pos = 1; /* Past 'filestring' marker */
-    while (!eof) {
-      char *ret;
-
-      ret = fz_fgets((char *) astr_str(&inf->token) + pos,
-                     astr_capacity(&inf->token) - pos, fp);
-      if (ret == NULL) {
-        eof = TRUE;
-      } else {
-        pos = astr_len(&inf->token);
-        astr_reserve(&inf->token, pos + 200);
-      }
-    }
-
+    log_debug("Stringfile \"%s\" opened ok", rfname);
+    contents = fz_fread_all(fp, NULL);
     fz_fclose(fp);
 
-    inf->cur_line_pos = c + 1 - astr_str(&inf->cur_line);
+    /* Mark as a string read from a file */
+    astr_set(&inf->token, "*%s", NULL != contents ? contents : "");
+    free(contents);
+
+    inf->cur_line_pos = c - inf->cur_line;
 
     return astr_str(&inf->token);
   } else if (border_character != '\"'
@@ -906,23 +955,16 @@ static const char *get_token_value(struct inputfile *inf)
       && border_character != '$') {
     /* A one-word string: maybe FALSE or TRUE. */
     start = c;
-    while (fc_isalnum(*c)) {
+    while (inf_isalnum(*c)) {
       c++;
     }
     /* check that the trailing stuff is ok: */
-    if (!(*c == '\0' || *c == ',' || fc_isspace(*c) || is_comment(*c))) {
+    if (!(*c == '\0' || *c == ',' || inf_isspace(*c) || is_comment(*c))) {
       return NULL;
     }
-    /* If its a comma, we don't want to obliterate it permanently,
-     * so remember it: */
-    trailing = *c;
-    *((char *) c) = '\0';       /* Tricky. */
-
-    inf->cur_line_pos = c - astr_str(&inf->cur_line);
-    astr_set(&inf->token, "%s", start);
-
-    *((char *) c) = trailing;   /* Revert. */
-    return astr_str(&inf->token);
+    inf_terminate(inf, c);
+    inf->cur_line_pos = c - inf->cur_line;
+    return start;
   }
 
   /* From here, we know we have a string, we just have to find the
@@ -934,20 +976,19 @@ static const char *get_token_value(struct inputfile *inf)
      not necessary: at that point we probably have a malformed
      string/file.)
 
-     As we read extra lines, the string value from previous
-     lines is placed in partial.
+     The extra lines follow the current one in the buffer, so putting
+     their newlines back makes the whole string one piece of it.
   */
 
   /* prepare for possibly multi-line string: */
   inf->string_start_line = inf->line_num;
   inf->in_string = TRUE;
 
-  partial = &inf->partial;      /* abbreviation */
-  astr_clear(partial);
-
   start = c++;                  /* start includes the initial \", to
                                  * distinguish from a number */
   for (;;) {
+    char *eol;
+
     while (*c != '\0' && *c != border_character) {
       /* skip over escaped chars, including backslash-doublequote,
        * and backslash-backslash: */
@@ -962,34 +1003,29 @@ static const char *get_token_value(struct inputfile *inf)
       break;
     }
 
-    astr_add(partial, "%s\n", start);
-
+    eol = inf->cur_line + inf->cur_line_len;
     if (!read_a_line(inf)) {
       /* shouldn't happen */
       inf_log(inf, LOG_ERROR, 
               "Bad return for multi-line string from read_a_line");
       return NULL;
     }
-    c = start = astr_str(&inf->cur_line);
+    *eol = '\n';
+    c = inf->cur_line;
   }
 
   /* found end of string */
-  trailing = *c;
-  *((char *) c) = '\0';         /* Tricky. */
-
-  inf->cur_line_pos = c + 1 - astr_str(&inf->cur_line);
-  astr_set(&inf->token, "%s%s", astr_str(partial), start);
-
-  *((char *) c) = trailing;     /* Revert. */
+  inf_terminate(inf, c);
+  inf->cur_line_pos = c + 1 - inf->cur_line;
 
   /* check gettext tag at end: */
   if (has_i18n_marking) {
-    if (*++c == ')') {
+    if (*(c + 1) == ')') {
       inf->cur_line_pos++;
     } else {
       inf_warn(inf, "Missing end of i18n string marking");
     }
   }
   inf->in_string = FALSE;
-  return astr_str(&inf->token);
+  return start;
 }
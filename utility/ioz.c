@@ -36,6 +36,7 @@
 #include "fc_prehdrs.h"
 
 #include <errno.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -110,6 +111,7 @@ struct xz_struct {
 
 static bool xz_outbuffer_to_file(fz_FILE *fp, lzma_action action);
 static void xz_action(fz_FILE *fp, lzma_action action);
+static int xz_refill(fz_FILE *fp);
 
 #endif /* FREECIV_HAVE_LIBLZMA */
 
@@ -576,7 +578,6 @@ char *fz_fgets(char *buffer, int size, fz_FILE *fp)
       int i, j;
 
       for (i = 0; i < size - 1; i += j) {
-        size_t len = 0;
         bool line_end;
 
         for (j = 0, line_end = FALSE; fp->u.xz.out_avail > 0
@@ -595,61 +596,17 @@ char *fz_fgets(char *buffer, int size, fz_FILE *fp)
           return buffer;
         }
 
-        if (fp->u.xz.hack_byte_used) {
-          size_t hblen = 0;
-
-          fp->u.xz.in_buf[0] = fp->u.xz.hack_byte;
-          len = fread(fp->u.xz.in_buf + 1, 1, PLAIN_FILE_BUF_SIZE - 1,
-                      fp->u.xz.plain);
-          len++;
-
-          if (len <= 1) {
-            hblen = fread(&fp->u.xz.hack_byte, 1, 1, fp->u.xz.plain);
-          }
-          if (hblen == 0) {
-            fp->u.xz.hack_byte_used = FALSE;
-          }
-        }
-        if (len == 0) {
-          if (fp->u.xz.error == LZMA_STREAM_END) {
-            if (i + j == 0) {
-              /* Plain file read complete, and there was nothing in xz buffers
-                 -> end-of-file. */
-              return NULL;
-            }
-            buffer[i + j] = '\0';
-            return buffer;
-          } else {
-            fp->u.xz.stream.next_out = fp->u.xz.out_buf;
-            fp->u.xz.stream.avail_out = PLAIN_FILE_BUF_SIZE;
-            xz_action(fp, LZMA_FINISH);
-            fp->u.xz.out_index = 0;
-            fp->u.xz.out_avail =
-              fp->u.xz.stream.total_out - fp->u.xz.total_read;
-            if (fp->u.xz.error != LZMA_OK
-                && fp->u.xz.error != LZMA_STREAM_END) {
-              return NULL;
-            }
-          }
-        } else {
-          lzma_action action;
-
-          fp->u.xz.stream.next_in = fp->u.xz.in_buf;
-          fp->u.xz.stream.avail_in = len;
-          fp->u.xz.stream.next_out = fp->u.xz.out_buf;
-          fp->u.xz.stream.avail_out = PLAIN_FILE_BUF_SIZE;
-          if (fp->u.xz.hack_byte_used) {
-            action = LZMA_RUN;
-          } else {
-            action = LZMA_FINISH;
-          }
-          xz_action(fp, action);
-          fp->u.xz.out_avail =
-            fp->u.xz.stream.total_out - fp->u.xz.total_read;
-          fp->u.xz.out_index = 0;
-          if (fp->u.xz.error != LZMA_OK && fp->u.xz.error != LZMA_STREAM_END) {
+        switch (xz_refill(fp)) {
+        case 0:
+          if (i + j == 0) {
+            /* Plain file read complete, and there was nothing in xz buffers
+               -> end-of-file. */
             return NULL;
           }
+          buffer[i + j] = '\0';
+          return buffer;
+        case -1:
+          return NULL;
         }
       }
 
@@ -769,6 +726,53 @@ static void xz_action(fz_FILE *fp, lzma_action action)
 
   fp->u.xz.error = lzma_code(&fp->u.xz.stream, action);
 }
+
+/************************************************************************//**
+  Decompress the next part of an xz file being read into the output
+  buffer. Only call when the output buffer is empty. Returns 1 if more
+  data may be available, 0 at end-of-file, or -1 on error.
+****************************************************************************/
+static int xz_refill(fz_FILE *fp)
+{
+  size_t len = 0;
+
+  if (fp->u.xz.hack_byte_used) {
+    size_t hblen = 0;
+
+    fp->u.xz.in_buf[0] = fp->u.xz.hack_byte;
+    len = fread(fp->u.xz.in_buf + 1, 1, PLAIN_FILE_BUF_SIZE - 1,
+                fp->u.xz.plain);
+    len++;
+
+    if (len <= 1) {
+      hblen = fread(&fp->u.xz.hack_byte, 1, 1, fp->u.xz.plain);
+    }
+    if (hblen == 0) {
+      fp->u.xz.hack_byte_used = FALSE;
+    }
+  }
+  if (len == 0) {
+    if (fp->u.xz.error == LZMA_STREAM_END) {
+      return 0;
+    }
+    fp->u.xz.stream.next_out = fp->u.xz.out_buf;
+    fp->u.xz.stream.avail_out = PLAIN_FILE_BUF_SIZE;
+    xz_action(fp, LZMA_FINISH);
+  } else {
+    fp->u.xz.stream.next_in = fp->u.xz.in_buf;
+    fp->u.xz.stream.avail_in = len;
+    fp->u.xz.stream.next_out = fp->u.xz.out_buf;
+    fp->u.xz.stream.avail_out = PLAIN_FILE_BUF_SIZE;
+    xz_action(fp, fp->u.xz.hack_byte_used ? LZMA_RUN : LZMA_FINISH);
+  }
+  fp->u.xz.out_index = 0;
+  fp->u.xz.out_avail = fp->u.xz.stream.total_out - fp->u.xz.total_read;
+  if (fp->u.xz.error != LZMA_OK && fp->u.xz.error != LZMA_STREAM_END) {
+    return -1;
+  }
+
+  return 1;
+}
 #endif /* FREECIV_HAVE_LIBLZMA */
 
 /************************************************************************//**
@@ -862,6 +866,187 @@ int fz_fprintf(fz_FILE *fp, const char *format, ...)
   return 0;
 }
 
+/************************************************************************//**
+  Read up to size bytes, like fread. Unlike fz_fgets(), this is safe for
+  binary data.
+  Returns the number of bytes read, which is less than size only at
+  end-of-file, or -1 on error.
+****************************************************************************/
+int fz_fread(void *buffer, int size, fz_FILE *fp)
+{
+  char *dest = buffer;
+
+  fc_assert_ret_val(NULL != fp, -1);
+
+  if (fp->memory) {
+    int len = MIN(size, fp->u.mem.size - fp->u.mem.pos);
+
+    memcpy(dest, fp->u.mem.buffer + fp->u.mem.pos, len);
+    fp->u.mem.pos += len;
+
+    return len;
+  }
+
+  switch (fz_method_validate(fp->method)) {
+#ifdef FREECIV_HAVE_LIBLZMA
+  case FZ_XZ:
+    {
+      int done = 0;
+
+      while (done < size) {
+        int len = MIN(size - done, fp->u.xz.out_avail);
+
+        if (len > 0) {
+          memcpy(dest + done, fp->u.xz.out_buf + fp->u.xz.out_index, len);
+          fp->u.xz.out_index += len;
+          fp->u.xz.out_avail -= len;
+          fp->u.xz.total_read += len;
+          done += len;
+          continue;
+        }
+
+        switch (xz_refill(fp)) {
+        case 0:
+          return done;
+        case -1:
+          return -1;
+        }
+      }
+
+      return done;
+    }
+#endif /* FREECIV_HAVE_LIBLZMA */
+#ifdef FREECIV_HAVE_LIBBZ2
+  case FZ_BZIP2:
+    {
+      int done = 0;
+
+      if (size > 0 && fp->u.bz2.firstbyte >= 0) {
+        dest[done++] = fp->u.bz2.firstbyte;
+        fp->u.bz2.firstbyte = -1;
+      }
+      if (done < size && !fp->u.bz2.eof) {
+        done += BZ2_bzRead(&fp->u.bz2.error, fp->u.bz2.file,
+                           dest + done, size - done);
+        if (fp->u.bz2.error == BZ_STREAM_END) {
+          /* EOF reached. Do not BZ2_bzRead() any more. */
+          fp->u.bz2.eof = TRUE;
+        } else if (fp->u.bz2.error != BZ_OK) {
+          return -1;
+        }
+      }
+
+      return done;
+    }
+#endif /* FREECIV_HAVE_LIBBZ2 */
+#ifdef FREECIV_HAVE_LIBZ
+  case FZ_ZLIB:
+    return gzread(fp->u.zlib, dest, size);
+#endif /* FREECIV_HAVE_LIBZ */
+  case FZ_PLAIN:
+    {
+      size_t len = fread(dest, 1, size, fp->u.plain);
+
+      return (len < (size_t) size && ferror(fp->u.plain)) ? -1 : (int) len;
+    }
+  }
+
+  /* Should never happen */
+  fc_assert_msg(FALSE, "Internal error in %s() (method = %d)",
+                __FUNCTION__, fp->method);
+  return -1;
+}
+
+/************************************************************************//**
+  Read everything that is left in the stream into one newly allocated
+  buffer, with a terminating '\0' that is not counted in *len.
+  Returns NULL on error.
+****************************************************************************/
+char *fz_fread_all(fz_FILE *fp, size_t *len)
+{
+  char *data = NULL;
+  size_t used = 0, size = 0;
+
+  fc_assert_ret_val(NULL != fp, NULL);
+
+  for (;;) {
+    int got;
+
+    if (used + 1 >= size) {
+      size = MAX(2 * size, 1 << 16);
+      data = fc_realloc(data, size);
+    }
+    got = fz_fread(data + used, MIN(size - used - 1, INT_MAX), fp);
+    if (got < 0) {
+      free(data);
+      return NULL;
+    }
+    if (got == 0) {
+      break;
+    }
+    used += got;
+  }
+
+  data[used] = '\0';
+  if (NULL != len) {
+    *len = used;
+  }
+
+  return data;
+}
+
+/************************************************************************//**
+  Write size bytes, like fwrite. Unlike fz_fprintf(), this is safe for
+  binary data and does not limit the length.
+  Returns the number of (uncompressed) bytes written, or 0 on error.
+****************************************************************************/
+int fz_fwrite(const void *buffer, int size, fz_FILE *fp)
+{
+  const char *src = buffer;
+
+  fc_assert_ret_val(NULL != fp, 0);
+  fc_assert_ret_val(!fp->memory, 0);
+
+  switch (fz_method_validate(fp->method)) {
+#ifdef FREECIV_HAVE_LIBLZMA
+  case FZ_XZ:
+    {
+      int done = 0;
+
+      while (done < size) {
+        int len = MIN(size - done, PLAIN_FILE_BUF_SIZE);
+
+        memcpy(fp->u.xz.in_buf, src + done, len);
+        fp->u.xz.stream.next_in = fp->u.xz.in_buf;
+        fp->u.xz.stream.avail_in = len;
+        if (!xz_outbuffer_to_file(fp, LZMA_RUN)) {
+          return 0;
+        }
+        done += len;
+      }
+
+      return done;
+    }
+#endif /* FREECIV_HAVE_LIBLZMA */
+#ifdef FREECIV_HAVE_LIBBZ2
+  case FZ_BZIP2:
+    BZ2_bzWrite(&fp->u.bz2.error, fp->u.bz2.file, (void *) src, size);
+    return fp->u.bz2.error != BZ_OK ? 0 : size;
+#endif /* FREECIV_HAVE_LIBBZ2 */
+#ifdef FREECIV_HAVE_LIBZ
+  case FZ_ZLIB:
+    return gzwrite(fp->u.zlib, src, (unsigned int) size);
+#endif /* FREECIV_HAVE_LIBZ */
+  case FZ_PLAIN:
+    return fwrite(src, 1, size, fp->u.plain) == (size_t) size ? size : 0;
+  }
+
+  /* Should never happen */
+  fc_assert_msg(FALSE, "Internal error in %s() (method = %d)",
+                __FUNCTION__, fp->method);
+  return 0;
+}
+
 /************************************************************************//**
   Return non-zero if there is an error status associated with
   this stream.  Check fz_strerror for details.
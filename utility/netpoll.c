@@ -0,0 +1,558 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/***********************************************************************
+  Socket readiness notification: epoll, poll() and select() backends.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include "fc_prehdrs.h"
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+/* utility */
+#include "log.h"
+#include "mem.h"
+#include "netintf.h"
+
+#include "netpoll.h"
+
+/* Smallest number of entries allocated at once. */
+#define POLLER_MIN_ENTRIES 16
+
+/* Sets of up to this many sockets are polled without allocating. */
+#define POLL_STACK_ENTRIES 8
+
+struct fc_poll_entry {
+  int sock;                     /* -1 when the entry is free */
+  int events;
+  void *data;
+#ifdef HAVE_SYS_EPOLL_H
+  /* epoll refuses regular files (e.g. stdin redirected from a script);
+   * like select() would, consider them always readable. */
+  bool always_ready;
+#endif /* HAVE_SYS_EPOLL_H */
+};
+
+struct fc_poller {
+  struct fc_poll_entry *entries;
+  int num_entries;              /* Allocated entries */
+  int *free_handles;            /* Stack of free entry indices */
+  int num_free;
+
+#ifdef HAVE_SYS_EPOLL_H
+  int epfd;                     /* -1 when not using epoll */
+  struct epoll_event *epevents;
+  int num_epevents;
+  int num_always_ready;
+#endif /* HAVE_SYS_EPOLL_H */
+
+  /* Backends other than epoll: one entry per handle. */
+  struct fc_pollsock *socks;
+#ifdef HAVE_POLL_H
+  struct pollfd *pfds;          /* Passed to poll(), as many as socks */
+#endif
+};
+
+/*********************************************************************//**
+  Create a new, empty poller.
+*************************************************************************/
+struct fc_poller *fc_poller_new(void)
+{
+  struct fc_poller *poller = fc_calloc(1, sizeof(*poller));
+
+#ifdef HAVE_SYS_EPOLL_H
+  poller->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (poller->epfd == -1) {
+    log_verbose("epoll_create1() failed (%s), falling back to %s.",
+                fc_strerror(fc_get_errno()),
+                fc_poller_backend(poller));
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+  return poller;
+}
+
+/*********************************************************************//**
+  Free the poller. Registered sockets are not closed.
+*************************************************************************/
+void fc_poller_destroy(struct fc_poller *poller)
+{
+#ifdef HAVE_SYS_EPOLL_H
+  if (poller->epfd != -1) {
+    close(poller->epfd);
+  }
+  free(poller->epevents);
+#endif /* HAVE_SYS_EPOLL_H */
+
+  free(poller->entries);
+  free(poller->free_handles);
+  free(poller->socks);
+#ifdef HAVE_POLL_H
+  free(poller->pfds);
+#endif
+  free(poller);
+}
+
+/*********************************************************************//**
+  Name of the backend in use, for log messages.
+*************************************************************************/
+const char *fc_poller_backend(const struct fc_poller *poller)
+{
+#ifdef HAVE_SYS_EPOLL_H
+  if (poller->epfd != -1) {
+    return "epoll";
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+#ifdef HAVE_POLL_H
+  return "poll";
+#else  /* HAVE_POLL_H */
+  return "select";
+#endif /* HAVE_POLL_H */
+}
+
+/*********************************************************************//**
+  Events to report for a socket in error or hung up. Like select() does,
+  report it ready for what was waited for, so that the following read or
+  write notices the problem and reports it properly.
+*************************************************************************/
+static inline int error_revents(int events)
+{
+  int revents = events & (FC_POLL_IN | FC_POLL_OUT);
+
+  return revents != 0 ? revents : FC_POLL_ERR;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/*********************************************************************//**
+  Translate FC_POLL_* flags to epoll flags.
+*************************************************************************/
+static uint32_t epoll_flags(int events)
+{
+  uint32_t flags = EPOLLPRI;
+
+  if (events & FC_POLL_IN) {
+    flags |= EPOLLIN;
+  }
+  if (events & FC_POLL_OUT) {
+    flags |= EPOLLOUT;
+  }
+
+  return flags;
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+/*********************************************************************//**
+  Register a socket, waiting for 'events' (FC_POLL_IN and/or FC_POLL_OUT;
+  errors are always reported). 'data' is returned along with the events
+  of the socket by fc_poller_wait().
+  Returns the handle of the socket in the poller, or -1 on failure.
+*************************************************************************/
+int fc_poller_add(struct fc_poller *poller, int sock, int events,
+                  void *data)
+{
+  struct fc_poll_entry *pentry;
+  int handle;
+
+  if (poller->num_free == 0) {
+    int old = poller->num_entries;
+    int i;
+
+    poller->num_entries = MAX(POLLER_MIN_ENTRIES, 2 * old);
+    poller->entries = fc_realloc(poller->entries,
+                                 poller->num_entries
+                                 * sizeof(*poller->entries));
+    poller->socks = fc_realloc(poller->socks,
+                               poller->num_entries * sizeof(*poller->socks));
+#ifdef HAVE_POLL_H
+    poller->pfds = fc_realloc(poller->pfds,
+                              poller->num_entries * sizeof(*poller->pfds));
+#endif
+    poller->free_handles = fc_realloc(poller->free_handles,
+                                      poller->num_entries
+                                      * sizeof(*poller->free_handles));
+    /* Push in reverse, so that low handles get used first. */
+    for (i = poller->num_entries - 1; i >= old; i--) {
+      poller->entries[i].sock = -1;
+      poller->socks[i].sock = -1;
+      poller->free_handles[poller->num_free++] = i;
+    }
+  }
+
+  handle = poller->free_handles[--poller->num_free];
+  pentry = poller->entries + handle;
+  pentry->sock = sock;
+  pentry->events = events;
+  pentry->data = data;
+
+#ifdef HAVE_SYS_EPOLL_H
+  pentry->always_ready = FALSE;
+  if (poller->epfd != -1) {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = epoll_flags(events);
+    ev.data.u32 = handle;
+    if (epoll_ctl(poller->epfd, EPOLL_CTL_ADD, sock, &ev) == -1) {
+      if (errno == EPERM) {
+        pentry->always_ready = TRUE;
+        poller->num_always_ready++;
+      } else {
+        log_error("epoll_ctl(ADD, %d) failed: %s", sock,
+                  fc_strerror(fc_get_errno()));
+        pentry->sock = -1;
+        poller->free_handles[poller->num_free++] = handle;
+        return -1;
+      }
+    }
+    return handle;
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+  poller->socks[handle].sock = sock;
+  poller->socks[handle].events = events;
+  poller->socks[handle].revents = 0;
+
+  return handle;
+}
+
+/*********************************************************************//**
+  Change the events a registered socket is waited for. Does nothing
+  if they are unchanged, so it is cheap to call before every wait.
+*************************************************************************/
+void fc_poller_set_events(struct fc_poller *poller, int handle, int events)
+{
+  struct fc_poll_entry *pentry;
+
+  fc_assert_ret(handle >= 0 && handle < poller->num_entries);
+  pentry = poller->entries + handle;
+  fc_assert_ret(pentry->sock != -1);
+
+  if (pentry->events == events) {
+    return;
+  }
+  pentry->events = events;
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (poller->epfd != -1) {
+    struct epoll_event ev;
+
+    if (pentry->always_ready) {
+      return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = epoll_flags(events);
+    ev.data.u32 = handle;
+    if (epoll_ctl(poller->epfd, EPOLL_CTL_MOD, pentry->sock, &ev) == -1) {
+      log_error("epoll_ctl(MOD, %d) failed: %s", pentry->sock,
+                fc_strerror(fc_get_errno()));
+    }
+    return;
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+  poller->socks[handle].events = events;
+}
+
+/*********************************************************************//**
+  Unregister a socket. Must be called before the socket gets closed.
+*************************************************************************/
+void fc_poller_remove(struct fc_poller *poller, int handle)
+{
+  struct fc_poll_entry *pentry;
+
+  fc_assert_ret(handle >= 0 && handle < poller->num_entries);
+  pentry = poller->entries + handle;
+  fc_assert_ret(pentry->sock != -1);
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (poller->epfd != -1) {
+    if (pentry->always_ready) {
+      poller->num_always_ready--;
+    } else if (epoll_ctl(poller->epfd, EPOLL_CTL_DEL, pentry->sock,
+                         NULL) == -1) {
+      log_error("epoll_ctl(DEL, %d) failed: %s", pentry->sock,
+                fc_strerror(fc_get_errno()));
+    }
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+  pentry->sock = -1;
+  pentry->data = NULL;
+  poller->socks[handle].sock = -1;
+  poller->free_handles[poller->num_free++] = handle;
+}
+
+#ifdef HAVE_POLL_H
+/*********************************************************************//**
+  fc_poll_sockets() with poll(), using 'pfds', of at least 'count'
+  entries, for poll()'s own array.
+*************************************************************************/
+static int poll_sockets(struct fc_pollsock *socks, int count, int timeout_ms,
+                        struct pollfd *pfds)
+{
+  int num = 0;
+  int n;
+  int i;
+
+  if (count <= 0) {
+    return 0;
+  }
+
+  for (i = 0; i < count; i++) {
+    pfds[i].fd = socks[i].sock;
+    pfds[i].events = POLLPRI;
+    if (socks[i].events & FC_POLL_IN) {
+      pfds[i].events |= POLLIN;
+    }
+    if (socks[i].events & FC_POLL_OUT) {
+      pfds[i].events |= POLLOUT;
+    }
+    pfds[i].revents = 0;
+  }
+
+  n = poll(pfds, count, timeout_ms);
+
+  for (i = 0; i < count; i++) {
+    short flags = n > 0 ? pfds[i].revents : 0;
+
+    socks[i].revents = 0;
+    if (flags & POLLIN) {
+      socks[i].revents |= FC_POLL_IN;
+    }
+    if (flags & POLLOUT) {
+      socks[i].revents |= FC_POLL_OUT;
+    }
+    if (flags & (POLLNVAL | POLLPRI)) {
+      socks[i].revents |= FC_POLL_ERR;
+    }
+    if (flags & (POLLERR | POLLHUP)) {
+      socks[i].revents |= error_revents(socks[i].events);
+    }
+    if (socks[i].revents != 0) {
+      num++;
+    }
+  }
+
+  return n < 0 ? -1 : num;
+}
+#endif /* HAVE_POLL_H */
+
+/*********************************************************************//**
+  Wait up to 'timeout_ms' milliseconds (negative for no limit) for
+  registered sockets to become ready. Up to 'max_ready' ready sockets
+  are stored to 'ready'; the others will be reported by the next call.
+  Returns the number of ready sockets stored, 0 on timeout and -1 on
+  error (including interruption by a signal).
+*************************************************************************/
+int fc_poller_wait(struct fc_poller *poller, int timeout_ms,
+                   struct fc_poll_event *ready, int max_ready)
+{
+  int num = 0;
+  int i;
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (poller->epfd != -1) {
+    int n;
+
+    if (poller->num_always_ready > 0) {
+      /* Rare case; only then we need to look at all the entries. */
+      for (i = 0; i < poller->num_entries && num < max_ready; i++) {
+        if (poller->entries[i].sock != -1
+            && poller->entries[i].always_ready
+            && (poller->entries[i].events & FC_POLL_IN)) {
+          ready[num].data = poller->entries[i].data;
+          ready[num].revents = FC_POLL_IN;
+          num++;
+        }
+      }
+      if (num >= max_ready) {
+        return num;
+      } else if (num > 0) {
+        timeout_ms = 0;
+      }
+    }
+
+    if (poller->num_epevents < max_ready) {
+      poller->num_epevents = max_ready;
+      poller->epevents = fc_realloc(poller->epevents,
+                                    max_ready * sizeof(*poller->epevents));
+    }
+
+    n = epoll_wait(poller->epfd, poller->epevents, max_ready - num,
+                   timeout_ms);
+    if (n < 0) {
+      return num > 0 ? num : -1;
+    }
+
+    for (i = 0; i < n; i++) {
+      uint32_t flags = poller->epevents[i].events;
+      struct fc_poll_entry *pentry
+        = poller->entries + poller->epevents[i].data.u32;
+      int revents = 0;
+
+      if (flags & EPOLLIN) {
+        revents |= FC_POLL_IN;
+      }
+      if (flags & EPOLLOUT) {
+        revents |= FC_POLL_OUT;
+      }
+      if (flags & EPOLLPRI) {
+        revents |= FC_POLL_ERR;
+      }
+      if (flags & (EPOLLERR | EPOLLHUP)) {
+        revents |= error_revents(pentry->events);
+      }
+
+      ready[num].data = pentry->data;
+      ready[num].revents = revents;
+      num++;
+    }
+
+    return num;
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+#ifdef HAVE_POLL_H
+  if (poll_sockets(poller->socks, poller->num_entries, timeout_ms,
+                   poller->pfds) < 0) {
+    return -1;
+  }
+#else  /* HAVE_POLL_H */
+  if (fc_poll_sockets(poller->socks, poller->num_entries, timeout_ms) < 0) {
+    return -1;
+  }
+#endif /* HAVE_POLL_H */
+
+  for (i = 0; i < poller->num_entries && num < max_ready; i++) {
+    if (poller->socks[i].sock != -1 && poller->socks[i].revents != 0) {
+      ready[num].data = poller->entries[i].data;
+      ready[num].revents = poller->socks[i].revents;
+      num++;
+    }
+  }
+
+  return num;
+}
+
+/*********************************************************************//**
+  Wait up to 'timeout_ms' milliseconds (negative for no limit) for any of
+  the given sockets to become ready, filling their 'revents'. Meant for
+  short-lived sets of sockets; use a poller for long-lived ones.
+  Returns the number of ready sockets, 0 on timeout and -1 on error.
+*************************************************************************/
+int fc_poll_sockets(struct fc_pollsock *socks, int count, int timeout_ms)
+{
+  int num = 0;
+
+#ifdef HAVE_POLL_H
+  struct pollfd stack_pfds[POLL_STACK_ENTRIES];
+  struct pollfd *pfds = stack_pfds;
+
+  if (count > POLL_STACK_ENTRIES) {
+    pfds = fc_malloc(count * sizeof(*pfds));
+  }
+  num = poll_sockets(socks, count, timeout_ms, pfds);
+  if (pfds != stack_pfds) {
+    free(pfds);
+  }
+
+  return num;
+#else  /* HAVE_POLL_H */
+  fd_set readfs, writefs, exceptfs;
+  fc_timeval tv;
+  int max_desc = -1;
+  int i;
+
+  FC_FD_ZERO(&readfs);
+  FC_FD_ZERO(&writefs);
+  FC_FD_ZERO(&exceptfs);
+
+  for (i = 0; i < count; i++) {
+    socks[i].revents = 0;
+    if (socks[i].sock < 0) {
+      continue;
+    }
+#ifndef FREECIV_HAVE_WINSOCK
+    if (socks[i].sock >= FD_SETSIZE) {
+      /* select() cannot watch it at all. */
+      socks[i].revents = FC_POLL_ERR;
+      num++;
+      continue;
+    }
+#endif /* FREECIV_HAVE_WINSOCK */
+    if (socks[i].events & FC_POLL_IN) {
+      FD_SET(socks[i].sock, &readfs);
+    }
+    if (socks[i].events & FC_POLL_OUT) {
+      FD_SET(socks[i].sock, &writefs);
+    }
+    FD_SET(socks[i].sock, &exceptfs);
+    max_desc = MAX(max_desc, socks[i].sock);
+  }
+
+  if (num > 0) {
+    return num;
+  }
+  if (max_desc == -1) {
+    return 0;
+  }
+
+  if (timeout_ms >= 0) {
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+  }
+  num = fc_select(max_desc + 1, &readfs, &writefs, &exceptfs,
+                  timeout_ms >= 0 ? &tv : NULL);
+  if (num <= 0) {
+    return num < 0 ? -1 : 0;
+  }
+
+  num = 0;
+
+  for (i = 0; i < count; i++) {
+    if (socks[i].sock < 0) {
+      continue;
+    }
+    if (FD_ISSET(socks[i].sock, &readfs)) {
+      socks[i].revents |= FC_POLL_IN;
+    }
+    if (FD_ISSET(socks[i].sock, &writefs)) {
+      socks[i].revents |= FC_POLL_OUT;
+    }
+    if (FD_ISSET(socks[i].sock, &exceptfs)) {
+      socks[i].revents |= FC_POLL_ERR;
+    }
+    if (socks[i].revents != 0) {
+      num++;
+    }
+  }
+
+  return num;
+#endif /* HAVE_POLL_H */
+}
@@ -0,0 +1,74 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifndef FC__NETPOLL_H
+#define FC__NETPOLL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* utility */
+#include "support.h"   /* bool type */
+
+/***********************************************************************
+  Socket readiness notification.
+
+  A poller holds a set of registered sockets.  Sockets are registered
+  once (e.g. when a connection is accepted) and removed when they get
+  closed, so the cost of waiting depends on the number of sockets that
+  are actually ready, not on the number of connection slots.  The best
+  backend available on the platform is used: epoll on Linux, poll()
+  elsewhere, select() as the last resort.
+***********************************************************************/
+
+/* As with select(), errors and hangups are reported as readiness for the
+ * events waited for; the following read or write then fails. */
+#define FC_POLL_IN   (1 << 0)   /* Readable */
+#define FC_POLL_OUT  (1 << 1)   /* Writable */
+#define FC_POLL_ERR  (1 << 2)   /* Exceptional condition (out-of-band data),
+                                 * or invalid socket */
+
+struct fc_poller;
+
+/* One ready socket, as returned by fc_poller_wait(). */
+struct fc_poll_event {
+  void *data;                   /* As given to fc_poller_add() */
+  int revents;                  /* FC_POLL_* flags */
+};
+
+/* One socket in a one-shot fc_poll_sockets() set. */
+struct fc_pollsock {
+  int sock;                     /* Negative to ignore the entry */
+  int events;                   /* FC_POLL_IN and/or FC_POLL_OUT */
+  int revents;                  /* Result, FC_POLL_* flags */
+};
+
+struct fc_poller *fc_poller_new(void);
+void fc_poller_destroy(struct fc_poller *poller);
+const char *fc_poller_backend(const struct fc_poller *poller);
+
+int fc_poller_add(struct fc_poller *poller, int sock, int events,
+                  void *data);
+void fc_poller_set_events(struct fc_poller *poller, int handle, int events);
+void fc_poller_remove(struct fc_poller *poller, int handle);
+int fc_poller_wait(struct fc_poller *poller, int timeout_ms,
+                   struct fc_poll_event *ready, int max_ready);
+
+int fc_poll_sockets(struct fc_pollsock *socks, int count, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif  /* FC__NETPOLL_H */
@@ -0,0 +1,701 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/**************************************************************************
+  Binary form of a section file, for savegames.
+
+  The file holds exactly what a section file holds in memory, so
+  loading one gives the same section file as loading the text form of
+  the same data; savegame code does not need to know which was used.
+  Nothing is quoted or escaped and no numbers are printed or parsed.
+  Long strings, like the per-row map layers of a savegame, are stored
+  as they are.
+
+  Layout:
+
+    "FCSECBIN"                    magic
+    byte    version               BINFILE_VERSION
+    block*                        one per section
+    byte    0                     end marker
+
+  block:
+    byte    kind                  BLOCK_SECTION, BLOCK_INCLUDE or
+                                  BLOCK_COMMENT
+    uint32  length                of the rest of the block, little endian
+    then for BLOCK_SECTION:
+      string  section name
+      varint  number of entries
+      entry*
+    or for the other kinds:
+      string  included file name, or the comment
+
+  entry:
+    byte    type | flags          enum entry_type, ENTRY_FLAG_*
+    byte    shared                length of the start of the name that
+                                  is the same as in the previous entry
+    string  rest of the name
+    value                         byte for bools, zigzag varint for ints,
+                                  IEEE single (little endian) for floats,
+                                  string for strings
+    string  comment               only with ENTRY_FLAG_COMMENT
+
+  string:
+    varint  length in bytes, then the bytes without terminator
+
+  Varints are unsigned LEB128. Entry names of a section mostly differ
+  only at the end (c0.id, c0.x, c0.y, ...), so storing just the changed
+  part keeps the file about as small as the tabular text form.
+
+  The block length lets a reader that wants only one section skip all
+  the others without looking at their entries.
+**************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <string.h>
+
+/* utility */
+#include "fcintl.h"
+#include "log.h"
+#include "mem.h"
+#include "registry.h"
+#include "section_file.h"
+#include "shared.h"
+
+#include "registry_bin.h"
+
+#define BINFILE_MAGIC "FCSECBIN"
+#define BINFILE_MAGIC_LEN 8
+#define BINFILE_VERSION 1
+
+enum binfile_block {
+  BLOCK_END = 0,
+  BLOCK_SECTION,
+  BLOCK_INCLUDE,
+  BLOCK_COMMENT
+};
+
+#define ENTRY_TYPE_MASK         0x0f
+#define ENTRY_FLAG_COMMENT      0x10
+#define ENTRY_FLAG_ESCAPED      0x20
+
+#define MAX_LEN_ENTRY_NAME      1024
+
+/* Growing output buffer for one block. */
+struct bin_out {
+  unsigned char *data;
+  size_t used;
+  size_t size;
+};
+
+/* Input, checked against its end. */
+struct bin_in {
+  const unsigned char *pos;
+  const unsigned char *end;
+  bool error;
+};
+
+/**********************************************************************//**
+  Make room for len more bytes in the output buffer.
+**************************************************************************/
+static unsigned char *bin_out_reserve(struct bin_out *out, size_t len)
+{
+  if (out->used + len > out->size) {
+    out->size = MAX(2 * out->size, out->used + len + 4096);
+    out->data = fc_realloc(out->data, out->size);
+  }
+
+  return out->data + out->used;
+}
+
+/**********************************************************************//**
+  Append an unsigned byte.
+**************************************************************************/
+static void bin_put_uint8(struct bin_out *out, int value)
+{
+  *bin_out_reserve(out, 1) = value;
+  out->used++;
+}
+
+/**********************************************************************//**
+  Append a 32 bit value, little endian.
+**************************************************************************/
+static void bin_put_uint32(struct bin_out *out, unsigned int value)
+{
+  unsigned char *p = bin_out_reserve(out, 4);
+
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  p[2] = (value >> 16) & 0xff;
+  p[3] = (value >> 24) & 0xff;
+  out->used += 4;
+}
+
+/**********************************************************************//**
+  Append an unsigned value as LEB128 varint.
+**************************************************************************/
+static void bin_put_varint(struct bin_out *out, unsigned int value)
+{
+  unsigned char *p = bin_out_reserve(out, 5);
+
+  while (value >= 0x80) {
+    *p++ = (value & 0x7f) | 0x80;
+    value >>= 7;
+    out->used++;
+  }
+  *p = value;
+  out->used++;
+}
+
+/**********************************************************************//**
+  Append len bytes of str, after their length.
+**************************************************************************/
+static void bin_put_bytes(struct bin_out *out, const char *str, size_t len)
+{
+  bin_put_varint(out, len);
+  memcpy(bin_out_reserve(out, len), str, len);
+  out->used += len;
+}
+
+/**********************************************************************//**
+  Append a length prefixed string.
+**************************************************************************/
+static void bin_put_string(struct bin_out *out, const char *str)
+{
+  bin_put_bytes(out, str, strlen(str));
+}
+
+/**********************************************************************//**
+  Append an entry name, sharing its start with the previous name of the
+  section. prev is updated to point to name.
+**************************************************************************/
+static void bin_put_name(struct bin_out *out, const char **prev,
+                         const char *name)
+{
+  size_t shared = 0;
+
+  if (NULL != *prev) {
+    while (shared < 255 && '\0' != name[shared]
+           && name[shared] == (*prev)[shared]) {
+      shared++;
+    }
+  }
+  bin_put_uint8(out, shared);
+  bin_put_string(out, name + shared);
+  *prev = name;
+}
+
+/**********************************************************************//**
+  Take an unsigned byte.
+**************************************************************************/
+static int bin_get_uint8(struct bin_in *in)
+{
+  if (in->end - in->pos < 1) {
+    in->error = TRUE;
+    return 0;
+  }
+
+  return *in->pos++;
+}
+
+/**********************************************************************//**
+  Take a little endian 32 bit value.
+**************************************************************************/
+static unsigned int bin_get_uint32(struct bin_in *in)
+{
+  unsigned int value;
+
+  if (in->end - in->pos < 4) {
+    in->error = TRUE;
+    return 0;
+  }
+
+  value = (unsigned int) in->pos[0]
+          | ((unsigned int) in->pos[1] << 8)
+          | ((unsigned int) in->pos[2] << 16)
+          | ((unsigned int) in->pos[3] << 24);
+  in->pos += 4;
+
+  return value;
+}
+
+/**********************************************************************//**
+  Take an LEB128 varint.
+**************************************************************************/
+static unsigned int bin_get_varint(struct bin_in *in)
+{
+  unsigned int value = 0;
+  int shift;
+
+  for (shift = 0; shift < 35; shift += 7) {
+    int byte;
+
+    if (in->pos >= in->end) {
+      break;
+    }
+    byte = *in->pos++;
+    value |= (unsigned int) (byte & 0x7f) << shift;
+    if (0 == (byte & 0x80)) {
+      return value;
+    }
+  }
+
+  in->error = TRUE;
+  return 0;
+}
+
+/**********************************************************************//**
+  Take a length prefixed string. Returns a malloced copy with
+  terminator, or NULL on error.
+**************************************************************************/
+static char *bin_get_string(struct bin_in *in)
+{
+  unsigned int len = bin_get_varint(in);
+  char *str;
+
+  if (in->error || (size_t) (in->end - in->pos) < len) {
+    in->error = TRUE;
+    return NULL;
+  }
+
+  str = fc_malloc(len + 1);
+  memcpy(str, in->pos, len);
+  str[len] = '\0';
+  in->pos += len;
+
+  return str;
+}
+
+/**********************************************************************//**
+  Take an entry name written by bin_put_name(). name holds the previous
+  name of the section on entry and gets the new one. Returns FALSE on
+  error.
+**************************************************************************/
+static bool bin_get_name(struct bin_in *in, char *name, size_t size)
+{
+  size_t shared = bin_get_uint8(in);
+  unsigned int len = bin_get_varint(in);
+
+  if (in->error || shared > strlen(name)
+      || (size_t) (in->end - in->pos) < len || shared + len >= size) {
+    in->error = TRUE;
+    return FALSE;
+  }
+
+  memcpy(name + shared, in->pos, len);
+  name[shared + len] = '\0';
+  in->pos += len;
+
+  return TRUE;
+}
+
+/**********************************************************************//**
+  Append one entry to the block. prev_name is the name of the entry
+  before it in the section, or NULL. Returns FALSE if the entry can't be
+  stored in binary form.
+**************************************************************************/
+static bool bin_put_entry(struct bin_out *out, const struct entry *pentry,
+                          const char **prev_name)
+{
+  enum entry_type type = entry_type(pentry);
+  const char *comment = entry_comment(pentry);
+  int flags = type;
+
+  if (NULL != comment) {
+    flags |= ENTRY_FLAG_COMMENT;
+  }
+
+  switch (type) {
+  case ENTRY_BOOL:
+    {
+      bool value;
+
+      entry_bool_get(pentry, &value);
+      bin_put_uint8(out, flags);
+      bin_put_name(out, prev_name, entry_name(pentry));
+      bin_put_uint8(out, value ? 1 : 0);
+    }
+    break;
+  case ENTRY_INT:
+    {
+      int value;
+
+      entry_int_get(pentry, &value);
+      bin_put_uint8(out, flags);
+      bin_put_name(out, prev_name, entry_name(pentry));
+      /* Zigzag, so small negative values stay short. */
+      bin_put_varint(out, ((unsigned int) value << 1)
+                          ^ (unsigned int) (value < 0 ? -1 : 0));
+    }
+    break;
+  case ENTRY_FLOAT:
+    {
+      float value;
+      unsigned int bits;
+
+      FC_STATIC_ASSERT(sizeof(float) == 4, float_not_32_bits);
+      entry_float_get(pentry, &value);
+      memcpy(&bits, &value, sizeof(bits));
+      bin_put_uint8(out, flags);
+      bin_put_name(out, prev_name, entry_name(pentry));
+      bin_put_uint32(out, bits);
+    }
+    break;
+  case ENTRY_STR:
+    {
+      const char *value;
+
+      entry_str_get(pentry, &value);
+      if (entry_str_escaped(pentry)) {
+        flags |= ENTRY_FLAG_ESCAPED;
+      }
+      bin_put_uint8(out, flags);
+      bin_put_name(out, prev_name, entry_name(pentry));
+      bin_put_string(out, value);
+    }
+    break;
+  case ENTRY_FILEREFERENCE:
+    /* Only used when writing rulesets. */
+    return FALSE;
+  }
+
+  if (NULL != comment) {
+    bin_put_string(out, comment);
+  }
+
+  return TRUE;
+}
+
+/**********************************************************************//**
+  Write the start of a binary section file.
+**************************************************************************/
+void binfile_write_head(fz_FILE *fs)
+{
+  unsigned char head[BINFILE_MAGIC_LEN + 1];
+
+  memcpy(head, BINFILE_MAGIC, BINFILE_MAGIC_LEN);
+  head[BINFILE_MAGIC_LEN] = BINFILE_VERSION;
+  fz_fwrite(head, sizeof(head), fs);
+}
+
+/**********************************************************************//**
+  Write one section as a block. Returns FALSE, with nothing written, if
+  the section has entries that can't be stored in binary form.
+**************************************************************************/
+bool binfile_write_section(const struct section *psection, fz_FILE *fs)
+{
+  const struct entry_list *entries = section_entries(psection);
+  struct bin_out out = { NULL, 0, 0 };
+  unsigned char block[5];
+  size_t length;
+
+  if (EST_NORMAL == psection->special) {
+    const char *prev_name = NULL;
+
+    block[0] = BLOCK_SECTION;
+    bin_put_string(&out, section_name(psection));
+    bin_put_varint(&out, entry_list_size(entries));
+    entry_list_iterate(entries, pentry) {
+      if (!bin_put_entry(&out, pentry, &prev_name)) {
+        SECFILE_LOG(psection->secfile, psection,
+                    "Entry \"%s\" can't be saved in binary form.",
+                    entry_name(pentry));
+        free(out.data);
+        return FALSE;
+      }
+    } entry_list_iterate_end;
+  } else {
+    /* Include and long comment sections hold one string entry. */
+    const char *value = "";
+
+    block[0] = (EST_INCLUDE == psection->special
+                ? BLOCK_INCLUDE : BLOCK_COMMENT);
+    if (0 < entry_list_size(entries)) {
+      entry_str_get(entry_list_get(entries, 0), &value);
+    }
+    bin_put_string(&out, value);
+  }
+
+  length = out.used;
+  block[1] = length & 0xff;
+  block[2] = (length >> 8) & 0xff;
+  block[3] = (length >> 16) & 0xff;
+  block[4] = (length >> 24) & 0xff;
+  fz_fwrite(block, sizeof(block), fs);
+  fz_fwrite(out.data, out.used, fs);
+  free(out.data);
+
+  return TRUE;
+}
+
+/**********************************************************************//**
+  Write the end marker of a binary section file.
+**************************************************************************/
+void binfile_write_tail(fz_FILE *fs)
+{
+  unsigned char end = BLOCK_END;
+
+  fz_fwrite(&end, 1, fs);
+}
+
+/**********************************************************************//**
+  Save the section file to disk in binary form. Compression works like
+  for secfile_save().
+**************************************************************************/
+bool binfile_save(const struct section_file *secfile, const char *filename,
+                  int compression_level, enum fz_method compression_method)
+{
+  char real_filename[1024];
+  fz_FILE *fs;
+  bool ok = TRUE;
+
+  SECFILE_RETURN_VAL_IF_FAIL(secfile, NULL, NULL != secfile, FALSE);
+
+  if (NULL == filename) {
+    filename = secfile->name;
+  }
+
+  interpret_tilde(real_filename, sizeof(real_filename), filename);
+  fs = fz_from_file(real_filename, "w",
+                    compression_method, compression_level);
+
+  if (!fs) {
+    SECFILE_LOG(secfile, NULL, _("Could not open %s for writing"),
+                real_filename);
+
+    return FALSE;
+  }
+
+  binfile_write_head(fs);
+  section_list_iterate(secfile->sections, psection) {
+    if (!binfile_write_section(psection, fs)) {
+      ok = FALSE;
+      break;
+    }
+  } section_list_iterate_end;
+  if (ok) {
+    binfile_write_tail(fs);
+  }
+
+  if (0 != fz_ferror(fs)) {
+    SECFILE_LOG(secfile, NULL, "Error before closing %s: %s",
+                real_filename, fz_strerror(fs));
+    fz_fclose(fs);
+    return FALSE;
+  }
+  if (0 != fz_fclose(fs)) {
+    SECFILE_LOG(secfile, NULL, "Error closing %s", real_filename);
+    return FALSE;
+  }
+
+  return ok;
+}
+
+/**********************************************************************//**
+  Returns TRUE iff the (decompressed) contents of a file start like a
+  binary section file.
+**************************************************************************/
+bool binfile_is_binary(const char *data, size_t len)
+{
+  return (len >= BINFILE_MAGIC_LEN
+          && 0 == memcmp(data, BINFILE_MAGIC, BINFILE_MAGIC_LEN));
+}
+
+/**********************************************************************//**
+  Read the entries of a section block into the section. Returns FALSE
+  on error.
+**************************************************************************/
+static bool bin_get_entries(struct bin_in *in, struct section *psection)
+{
+  unsigned int count = bin_get_varint(in);
+  unsigned int i;
+  char name[MAX_LEN_ENTRY_NAME];
+
+  name[0] = '\0';
+  for (i = 0; i < count && !in->error; i++) {
+    int flags = bin_get_uint8(in);
+    struct entry *pentry = NULL;
+
+    if (!bin_get_name(in, name, sizeof(name))) {
+      return FALSE;
+    }
+
+    switch (flags & ENTRY_TYPE_MASK) {
+    case ENTRY_BOOL:
+      pentry = section_entry_bool_new(psection, name,
+                                      0 != bin_get_uint8(in));
+      break;
+    case ENTRY_INT:
+      {
+        unsigned int zigzag = bin_get_varint(in);
+
+        pentry = section_entry_int_new(psection, name,
+                                       (int) ((zigzag >> 1)
+                                              ^ (0U - (zigzag & 1))));
+      }
+      break;
+    case ENTRY_FLOAT:
+      {
+        unsigned int bits = bin_get_uint32(in);
+        float value;
+
+        memcpy(&value, &bits, sizeof(value));
+        pentry = section_entry_float_new(psection, name, value);
+      }
+      break;
+    case ENTRY_STR:
+      {
+        char *value = bin_get_string(in);
+
+        if (NULL != value) {
+          pentry = section_entry_str_new(psection, name, value,
+                                         0 != (flags & ENTRY_FLAG_ESCAPED));
+          free(value);
+        }
+      }
+      break;
+    }
+
+    if (NULL == pentry) {
+      in->error = TRUE;
+      return FALSE;
+    }
+
+    if (flags & ENTRY_FLAG_COMMENT) {
+      char *comment = bin_get_string(in);
+
+      if (NULL == comment) {
+        return FALSE;
+      }
+      entry_set_comment(pentry, comment);
+      free(comment);
+    }
+  }
+
+  return !in->error;
+}
+
+/**********************************************************************//**
+  Create a section file from the decompressed contents of a binary file,
+  'used' bytes of 'buffer', which is freed. If section is not NULL, only
+  that section is read. filename is the name to give the section file.
+  Returns NULL on error.
+**************************************************************************/
+struct section_file *binfile_from_buffer(char *buffer, size_t used,
+                                         const char *filename,
+                                         const char *section,
+                                         bool allow_duplicates)
+{
+  struct section_file *secfile;
+  struct bin_in in;
+  unsigned char *data = (unsigned char *) buffer;
+  bool found = FALSE;
+
+  log_verbose("Reading binary registry from \"%s\"", filename);
+
+  in.pos = data;
+  in.end = data + used;
+  in.error = FALSE;
+
+  if (used < BINFILE_MAGIC_LEN + 1
+      || 0 != memcmp(data, BINFILE_MAGIC, BINFILE_MAGIC_LEN)
+      || BINFILE_VERSION != data[BINFILE_MAGIC_LEN]) {
+    log_error(_("%s is not a binary section file of a known version."),
+              filename);
+    free(data);
+    return NULL;
+  }
+  in.pos += BINFILE_MAGIC_LEN + 1;
+
+  secfile = secfile_new(TRUE);
+  secfile->name = (NULL != filename ? fc_strdup(filename) : NULL);
+
+  while (!in.error) {
+    int kind = bin_get_uint8(&in);
+    unsigned int length;
+    const unsigned char *block_end;
+
+    if (BLOCK_END == kind || in.error) {
+      break;
+    }
+
+    length = bin_get_uint32(&in);
+    if (in.error || (size_t) (in.end - in.pos) < length) {
+      in.error = TRUE;
+      break;
+    }
+    block_end = in.pos + length;
+
+    if (BLOCK_SECTION == kind) {
+      char *name = bin_get_string(&in);
+
+      if (NULL == name) {
+        break;
+      }
+      if (NULL != section && 0 != strcmp(name, section)) {
+        /* Not wanted. */
+        in.pos = block_end;
+      } else {
+        struct section *psection = secfile_section_new(secfile, name);
+
+        if (NULL == psection || !bin_get_entries(&in, psection)) {
+          in.error = TRUE;
+        }
+        found = TRUE;
+      }
+      free(name);
+    } else if (NULL != section) {
+      in.pos = block_end;
+    } else {
+      char *value = bin_get_string(&in);
+
+      if (NULL == value) {
+        break;
+      }
+      if (BLOCK_INCLUDE == kind) {
+        secfile_insert_include(secfile, value);
+      } else {
+        secfile_insert_long_comment(secfile, value);
+      }
+      free(value);
+    }
+
+    if (!in.error && in.pos != block_end) {
+      in.error = TRUE;
+    }
+    if (found && NULL != section) {
+      break;
+    }
+  }
+
+  free(data);
+
+  if (in.error) {
+    SECFILE_LOG(secfile, NULL, "Corrupt binary section file.");
+    secfile_destroy(secfile);
+    return NULL;
+  }
+  if (NULL != section && !found) {
+    secfile_destroy(secfile);
+    return NULL;
+  }
+
+  if (!secfile_build_entry_hash(secfile, allow_duplicates)) {
+    secfile_destroy(secfile);
+    return NULL;
+  }
+
+  return secfile;
+}
@@ -0,0 +1,44 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+#ifndef FC__REGISTRY_BIN_H
+#define FC__REGISTRY_BIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* utility */
+#include "ioz.h"
+#include "support.h"            /* bool type */
+
+struct section;
+struct section_file;
+
+bool binfile_save(const struct section_file *secfile, const char *filename,
+                  int compression_level, enum fz_method compression_method);
+
+void binfile_write_head(fz_FILE *fs);
+bool binfile_write_section(const struct section *psection, fz_FILE *fs);
+void binfile_write_tail(fz_FILE *fs);
+
+bool binfile_is_binary(const char *data, size_t len);
+struct section_file *binfile_from_buffer(char *buffer, size_t used,
+                                         const char *filename,
+                                         const char *section,
+                                         bool allow_duplicates);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif  /* FC__REGISTRY_BIN_H */
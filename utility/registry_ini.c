@@ -166,6 +166,7 @@
 #include "log.h"
 #include "mem.h"
 #include "registry.h"
+#include "registry_bin.h"
 #include "section_file.h"
 #include "shared.h"
 #include "support.h"
@@ -239,7 +240,13 @@ static bool is_secfile_entry_name_valid(const char *name)
   static const char *const allowed = "_.,-[]";
 
   while ('\0' != *name) {
-    if (!fc_isalnum(*name) && NULL == strchr(allowed, *name)) {
+    char c = *name;
+
+    /* Same as fc_isalnum(), without a library call for every character
+     * of every entry. */
+    if (!(('a' <= c && 'z' >= c) || ('A' <= c && 'Z' >= c)
+          || ('0' <= c && '9' >= c))
+        && NULL == strchr(allowed, c)) {
       return FALSE;
     }
     name++;
@@ -253,7 +260,9 @@ static bool is_secfile_entry_name_valid(const char *name)
 static bool secfile_hash_insert(struct section_file *secfile,
                                 struct entry *pentry)
 {
-  char buf[256];
+  const char *sname;
+  size_t slen, nlen;
+  char *path;
   struct entry *hentry;
 
   if (NULL == secfile->hash.entries) {
@@ -262,13 +271,21 @@ static bool secfile_hash_insert(struct section_file *secfile,
     return TRUE;
   }
 
-  entry_path(pentry, buf, sizeof(buf));
-  if (entry_hash_replace_full(secfile->hash.entries, buf, pentry,
+  /* Same as entry_path(), straight into the memory of the key. */
+  sname = section_name(entry_section(pentry));
+  slen = strlen(sname);
+  nlen = strlen(pentry->name);
+  path = secfile_alloc(secfile, slen + nlen + 2);
+  memcpy(path, sname, slen);
+  path[slen] = '.';
+  memcpy(path + slen + 1, pentry->name, nlen + 1);
+
+  if (entry_hash_replace_full(secfile->hash.entries, path, pentry,
                               NULL, &hentry)) {
     entry_use(hentry);
     if (!secfile->allow_duplicates) {
       SECFILE_LOG(secfile, entry_section(hentry),
-                  "Tried to insert same value twice: %s", buf);
+                  "Tried to insert same value twice: %s", path);
       return FALSE;
     }
   }
@@ -282,7 +299,7 @@ static bool secfile_hash_insert(struct section_file *secfile,
 static bool secfile_hash_delete(struct section_file *secfile,
                                 struct entry *pentry)
 {
-  char buf[256];
+  char buf[MAX_LEN_SECPATH];
 
   if (NULL == secfile->hash.entries) {
     /* Consider as success if this secfile doesn't have built the entries
@@ -294,6 +311,27 @@ static bool secfile_hash_delete(struct section_file *secfile,
   return entry_hash_remove(secfile->hash.entries, buf);
 }
 
+/**********************************************************************//**
+  Build the entry hash table of a section file that has been filled in
+  without one. Returns FALSE if duplicates were found but not allowed.
+**************************************************************************/
+bool secfile_build_entry_hash(struct section_file *secfile,
+                              bool allow_duplicates)
+{
+  secfile->allow_duplicates = allow_duplicates;
+  secfile->hash.entries = entry_hash_new_nentries(secfile->num_entries);
+
+  section_list_iterate(secfile->sections, hashing_section) {
+    entry_list_iterate(section_entries(hashing_section), pentry) {
+      if (!secfile_hash_insert(secfile, pentry)) {
+        return FALSE;
+      }
+    } entry_list_iterate_end;
+  } section_list_iterate_end;
+
+  return TRUE;
+}
+
 /**********************************************************************//**
   Base function to load a section file.  Note it closes the inputfile.
 **************************************************************************/
@@ -309,8 +347,8 @@ static struct section_file *secfile_from_input_file(struct inputfile *inf,
   int table_lineno = 0;         /* Row number in tabular, 0 top data row. */
   const char *tok;
   int i;
-  struct astring base_name = ASTRING_INIT;    /* for table or single entry */
-  struct astring field_name = ASTRING_INIT;
+  char base_name[MAX_LEN_SECPATH];    /* for table or single entry */
+  char field_name[MAX_LEN_SECPATH];
   struct astring_vector columns;    /* astrings for column headings */
   bool found_my_section = FALSE;
   bool error = FALSE;
@@ -402,6 +440,13 @@ static struct section_file *secfile_from_input_file(struct inputfile *inf,
       continue;
     }
     if (table_state) {
+      size_t row_len;
+
+      /* The start of the names is the same for the whole row. */
+      fc_snprintf(field_name, sizeof(field_name), "%s%d.",
+                  base_name, table_lineno);
+      row_len = strlen(field_name);
+
       i = -1;
       do {
         int num_columns = astring_vector_size(&columns);
@@ -416,14 +461,17 @@ static struct section_file *secfile_from_input_file(struct inputfile *inf,
         }
 
         if (i < num_columns) {
-          astr_set(&field_name, "%s%d.%s", astr_str(&base_name),
-                   table_lineno, astr_str(&columns.p[i]));
+          size_t len = MIN(astr_len(&columns.p[i]),
+                           sizeof(field_name) - row_len - 1);
+
+          memcpy(field_name + row_len, astr_str(&columns.p[i]), len);
+          field_name[row_len + len] = '\0';
         } else {
-          astr_set(&field_name, "%s%d.%s,%d", astr_str(&base_name),
-                   table_lineno, astr_str(&columns.p[num_columns - 1]),
-                   (int) (i - num_columns + 1));
+          fc_snprintf(field_name + row_len, sizeof(field_name) - row_len,
+                      "%s,%d", astr_str(&columns.p[num_columns - 1]),
+                      (int) (i - num_columns + 1));
         }
-        entry_from_inf_token(psection, astr_str(&field_name), tok, inf);
+        entry_from_inf_token(psection, field_name, tok, inf);
       } while (inf_token(inf, INF_TOK_COMMA));
 
       if (!inf_token(inf, INF_TOK_EOL)) {
@@ -444,7 +492,7 @@ static struct section_file *secfile_from_input_file(struct inputfile *inf,
     }
 
     /* need to store tok before next calls: */
-    astr_set(&base_name, "%s", tok);
+    fc_snprintf(base_name, sizeof(base_name), "%s", tok);
 
     inf_discard_tokens(inf, INF_TOK_EOL);       /* allow newlines */
 
@@ -502,10 +550,10 @@ static struct section_file *secfile_from_input_file(struct inputfile *inf,
         goto END;
       }
       if (i == 0) {
-        entry_from_inf_token(psection, astr_str(&base_name), tok, inf);
+        entry_from_inf_token(psection, base_name, tok, inf);
       } else {
-        astr_set(&field_name, "%s,%d", astr_str(&base_name), i);
-        entry_from_inf_token(psection, astr_str(&field_name), tok, inf);
+        fc_snprintf(field_name, sizeof(field_name), "%s,%d", base_name, i);
+        entry_from_inf_token(psection, field_name, tok, inf);
       }
     } while (inf_token(inf, INF_TOK_COMMA));
     if (!inf_token(inf, INF_TOK_EOL)) {
@@ -524,8 +572,6 @@ static struct section_file *secfile_from_input_file(struct inputfile *inf,
 
 END:
   inf_close(inf);
-  astr_free(&base_name);
-  astr_free(&field_name);
   for (i = 0; i < astring_vector_size(&columns); i++) {
     astr_free(&columns.p[i]);
   }
@@ -549,22 +595,8 @@ END:
     return secfile;
   }
 
-  if (!error) {
-    /* Build the entry hash table. */
-    secfile->allow_duplicates = allow_duplicates;
-    secfile->hash.entries = entry_hash_new_nentries(secfile->num_entries);
-
-    section_list_iterate(secfile->sections, hashing_section) {
-      entry_list_iterate(section_entries(hashing_section), pentry) {
-        if (!secfile_hash_insert(secfile, pentry)) {
-          error = TRUE;
-          break;
-        }
-      } entry_list_iterate_end;
-      if (error) {
-        break;
-      }
-    } section_list_iterate_end;
+  if (!error && !secfile_build_entry_hash(secfile, allow_duplicates)) {
+    error = TRUE;
   }
   if (error) {
     secfile_destroy(secfile);
@@ -583,9 +615,32 @@ struct section_file *secfile_load_section(const char *filename,
                                           bool allow_duplicates)
 {
   char real_filename[1024];
+  fz_FILE *fp;
+  char *data;
+  size_t len;
 
   interpret_tilde(real_filename, sizeof(real_filename), filename);
-  return secfile_from_input_file(inf_from_file(real_filename, datafilename),
+  fp = fz_from_file(real_filename, "r", -1, 0);
+  if (NULL == fp) {
+    return NULL;
+  }
+
+  /* Decompress the file once; the contents tell which format it is. */
+  data = fz_fread_all(fp, &len);
+  if (NULL == data || 0 != fz_ferror(fp)) {
+    log_error("Error reading %s: %s", real_filename, fz_strerror(fp));
+    fz_fclose(fp);
+    free(data);
+    return NULL;
+  }
+  fz_fclose(fp);
+
+  if (binfile_is_binary(data, len)) {
+    return binfile_from_buffer(data, len, filename, section,
+                               allow_duplicates);
+  }
+  return secfile_from_input_file(inf_from_buffer(data, len, real_filename,
+                                                 datafilename),
                                  filename, section, allow_duplicates);
 }
 
@@ -607,6 +662,209 @@ static bool is_legal_table_entry_name(char c, bool num)
   return (num ? fc_isalnum(c) : fc_isalpha(c)) || c == '_';
 }
 
+/**********************************************************************//**
+  Write one section in text form. filename is only used in messages.
+  See secfile_save() for the tabular format.
+**************************************************************************/
+static void section_to_file(const struct section *psection, fz_FILE *fs,
+                            const char *filename)
+{
+  char pentry_name[128];
+  const char *col_entry_name;
+  const struct entry_list_link *ent_iter, *save_iter, *col_iter;
+  struct entry *pentry, *col_pentry;
+  int i;
+
+  if (psection->special == EST_INCLUDE) {
+    for (ent_iter = entry_list_head(section_entries(psection));
+         ent_iter && (pentry = entry_list_link_data(ent_iter));
+         ent_iter = entry_list_link_next(ent_iter)) {
+
+      fc_assert(!strcmp(entry_name(pentry), "file"));
+
+      fz_fprintf(fs, "*include ");
+      entry_to_file(pentry, fs);
+      fz_fprintf(fs, "\n");
+    }
+  } else if (psection->special == EST_COMMENT) {
+    for (ent_iter = entry_list_head(section_entries(psection));
+         ent_iter && (pentry = entry_list_link_data(ent_iter));
+         ent_iter = entry_list_link_next(ent_iter)) {
+
+      fc_assert(!strcmp(entry_name(pentry), "comment"));
+
+      entry_to_file(pentry, fs);
+      fz_fprintf(fs, "\n");
+    }
+  } else {
+    fz_fprintf(fs, "\n[%s]\n", section_name(psection));
+
+    /* Following doesn't use entry_list_iterate() because we want to do
+     * tricky things with the iterators...
+     */
+    for (ent_iter = entry_list_head(section_entries(psection));
+         ent_iter && (pentry = entry_list_link_data(ent_iter));
+         ent_iter = entry_list_link_next(ent_iter)) {
+      const char *comment;
+
+      /* Tables: break out of this loop if this is a non-table
+       * entry (pentry and ent_iter unchanged) or after table (pentry
+       * and ent_iter suitably updated, pentry possibly NULL).
+       * After each table, loop again in case the next entry
+       * is another table.
+       */
+      for (;;) {
+        char *c, *first, base[64];
+        int offset, irow, icol, ncol;
+
+        /* Example: for first table name of "xyz0.blah":
+         *  first points to the original string pentry->name
+         *  base contains "xyz";
+         *  offset = 5 (so first+offset gives "blah")
+         *  note strlen(base) = offset - 2
+         */
+
+        if (!SAVE_TABLES) {
+          break;
+        }
+
+        sz_strlcpy(pentry_name, entry_name(pentry));
+        c = first = pentry_name;
+        if (*c == '\0' || !is_legal_table_entry_name(*c, FALSE)) {
+          break;
+        }
+        for (; *c != '\0' && is_legal_table_entry_name(*c, FALSE); c++) {
+          /* nothing */
+        }
+        if (0 != strncmp(c, "0.", 2)) {
+          break;
+        }
+        c += 2;
+        if (*c == '\0' || !is_legal_table_entry_name(*c, TRUE)) {
+          break;
+        }
+
+        offset = c - first;
+        first[offset - 2] = '\0';
+        sz_strlcpy(base, first);
+        first[offset - 2] = '0';
+        fz_fprintf(fs, "%s={", base);
+
+        /* Save an iterator at this first entry, which we can later use
+         * to repeatedly iterate over column names:
+         */
+        save_iter = ent_iter;
+
+        /* write the column names, and calculate ncol: */
+        ncol = 0;
+        col_iter = save_iter;
+        for (; (col_pentry = entry_list_link_data(col_iter));
+             col_iter = entry_list_link_next(col_iter)) {
+          col_entry_name = entry_name(col_pentry);
+          if (strncmp(col_entry_name, first, offset) != 0) {
+            break;
+          }
+          fz_fprintf(fs, "%s\"%s\"", (ncol == 0 ? "" : ","),
+                     col_entry_name + offset);
+          ncol++;
+        }
+        fz_fprintf(fs, "\n");
+
+        /* Iterate over rows and columns, incrementing ent_iter as we go,
+         * and writing values to the table.  Have a separate iterator
+         * to the column names to check they all match.
+         */
+        irow = icol = 0;
+        col_iter = save_iter;
+        for (;;) {
+          char expect[128];     /* pentry->name we're expecting */
+
+          pentry = entry_list_link_data(ent_iter);
+          col_pentry = entry_list_link_data(col_iter);
+
+          fc_snprintf(expect, sizeof(expect), "%s%d.%s",
+                      base, irow, entry_name(col_pentry) + offset);
+
+          /* break out of tabular if doesn't match: */
+          if ((!pentry) || (strcmp(entry_name(pentry), expect) != 0)) {
+            if (icol != 0) {
+              /* If the second or later row of a table is missing some
+               * entries that the first row had, we drop out of the tabular
+               * format.  This is inefficient so we print a warning message;
+               * the calling code probably needs to be fixed so that it can
+               * use the more efficient tabular format.
+               *
+               * FIXME: If the first row is missing some entries that the
+               * second or later row has, then we'll drop out of tabular
+               * format without an error message. */
+              bugreport_request("In file %s, there is no entry in the registry for\n"
+                                "%s.%s (or the entries are out of order). This means\n"
+                                "a less efficient non-tabular format will be used.\n"
+                                "To avoid this make sure all rows of a table are\n"
+                                "filled out with an entry for every column.",
+                                filename, section_name(psection), expect);
+              fz_fprintf(fs, "\n");
+            }
+            fz_fprintf(fs, "}\n");
+            break;
+          }
+
+          if (icol > 0) {
+            fz_fprintf(fs, ",");
+          }
+          entry_to_file(pentry, fs);
+
+          ent_iter = entry_list_link_next(ent_iter);
+          col_iter = entry_list_link_next(col_iter);
+
+          icol++;
+          if (icol == ncol) {
+            fz_fprintf(fs, "\n");
+            irow++;
+            icol = 0;
+            col_iter = save_iter;
+          }
+        }
+        if (!pentry) {
+          break;
+        }
+      }
+      if (!pentry) {
+        break;
+      }
+
+      /* Classic entry. */
+      col_entry_name = entry_name(pentry);
+      fz_fprintf(fs, "%s=", col_entry_name);
+      entry_to_file(pentry, fs);
+
+      /* Check for vector. */
+      for (i = 1;; i++) {
+        col_iter = entry_list_link_next(ent_iter);
+        col_pentry = entry_list_link_data(col_iter);
+        if (NULL == col_pentry) {
+          break;
+        }
+        fc_snprintf(pentry_name, sizeof(pentry_name),
+                    "%s,%d", col_entry_name, i);
+        if (0 != strcmp(pentry_name, entry_name(col_pentry))) {
+          break;
+        }
+        fz_fprintf(fs, ",");
+        entry_to_file(col_pentry, fs);
+        ent_iter = col_iter;
+      }
+
+      comment = entry_comment(pentry);
+      if (comment) {
+        fz_fprintf(fs, "  # %s\n", comment);
+      } else {
+        fz_fprintf(fs, "\n");
+      }
+    }
+  }
+}
+
 /**********************************************************************//**
   Save the previously filled in section_file to disk.
 
@@ -630,12 +888,7 @@ bool secfile_save(const struct section_file *secfile, const char *filename,
                   int compression_level, enum fz_method compression_method)
 {
   char real_filename[1024];
-  char pentry_name[128];
-  const char *col_entry_name;
   fz_FILE *fs;
-  const struct entry_list_link *ent_iter, *save_iter, *col_iter;
-  struct entry *pentry, *col_pentry;
-  int i;
 
   SECFILE_RETURN_VAL_IF_FAIL(secfile, NULL, NULL != secfile, FALSE);
 
@@ -654,208 +907,143 @@ bool secfile_save(const struct section_file *secfile, const char *filename,
   }
 
   section_list_iterate(secfile->sections, psection) {
-    if (psection->special == EST_INCLUDE) {
-      for (ent_iter = entry_list_head(section_entries(psection));
-           ent_iter && (pentry = entry_list_link_data(ent_iter));
-           ent_iter = entry_list_link_next(ent_iter)) {
-
-        fc_assert(!strcmp(entry_name(pentry), "file"));
-
-        fz_fprintf(fs, "*include ");
-        entry_to_file(pentry, fs);
-        fz_fprintf(fs, "\n");
-      }
-    } else if (psection->special == EST_COMMENT) {
-      for (ent_iter = entry_list_head(section_entries(psection));
-           ent_iter && (pentry = entry_list_link_data(ent_iter));
-           ent_iter = entry_list_link_next(ent_iter)) {
+    section_to_file(psection, fs, real_filename);
+  } section_list_iterate_end;
 
-        fc_assert(!strcmp(entry_name(pentry), "comment"));
+  if (0 != fz_ferror(fs)) {
+    SECFILE_LOG(secfile, NULL, "Error before closing %s: %s", 
+                real_filename, fz_strerror(fs));
+    fz_fclose(fs);
+    return FALSE;
+  }
+  if (0 != fz_fclose(fs)) {
+    SECFILE_LOG(secfile, NULL, "Error closing %s", real_filename);
+    return FALSE;
+  }
 
-        entry_to_file(pentry, fs);
-        fz_fprintf(fs, "\n");
-      }
-    } else {
-      fz_fprintf(fs, "\n[%s]\n", section_name(psection));
+  return TRUE;
+}
 
-      /* Following doesn't use entry_list_iterate() because we want to do
-       * tricky things with the iterators...
-       */
-      for (ent_iter = entry_list_head(section_entries(psection));
-           ent_iter && (pentry = entry_list_link_data(ent_iter));
-           ent_iter = entry_list_link_next(ent_iter)) {
-        const char *comment;
-
-        /* Tables: break out of this loop if this is a non-table
-         * entry (pentry and ent_iter unchanged) or after table (pentry
-         * and ent_iter suitably updated, pentry possibly NULL).
-         * After each table, loop again in case the next entry
-         * is another table.
-         */
-        for (;;) {
-          char *c, *first, base[64];
-          int offset, irow, icol, ncol;
+/**********************************************************************//**
+  Create a section file that is written to disk while it is filled in,
+  instead of all at once by secfile_save(). Each secfile_flush() writes
+  the sections created so far and frees their entries; adding entries
+  to a section after that is an error. Sections are written in the
+  order they were created, so the file is the same as secfile_save() or
+  binfile_save() would write for the complete section file.
 
-          /* Example: for first table name of "xyz0.blah":
-           *  first points to the original string pentry->name
-           *  base contains "xyz";
-           *  offset = 5 (so first+offset gives "blah")
-           *  note strlen(base) = offset - 2
-           */
+  Lookups only find entries not written yet. Finish the file with
+  secfile_stream_close() before secfile_destroy(). Returns NULL if the
+  file can't be opened.
+**************************************************************************/
+struct section_file *secfile_stream_new(const char *filename,
+                                        int compression_level,
+                                        enum fz_method compression_method,
+                                        bool binary)
+{
+  char real_filename[1024];
+  struct section_file *secfile;
 
-          if (!SAVE_TABLES) {
-            break;
-          }
+  interpret_tilde(real_filename, sizeof(real_filename), filename);
 
-          sz_strlcpy(pentry_name, entry_name(pentry));
-          c = first = pentry_name;
-          if (*c == '\0' || !is_legal_table_entry_name(*c, FALSE)) {
-            break;
-          }
-          for (; *c != '\0' && is_legal_table_entry_name(*c, FALSE); c++) {
-            /* nothing */
-          }
-          if (0 != strncmp(c, "0.", 2)) {
-            break;
-          }
-          c += 2;
-          if (*c == '\0' || !is_legal_table_entry_name(*c, TRUE)) {
-            break;
-          }
+  secfile = secfile_new(TRUE);
+  secfile->name = fc_strdup(real_filename);
+  secfile->stream.binary = binary;
+  secfile->stream.fp = fz_from_file(real_filename, "w",
+                                    compression_method, compression_level);
+
+  if (NULL == secfile->stream.fp) {
+    SECFILE_LOG(secfile, NULL, _("Could not open %s for writing"),
+                real_filename);
+    secfile_destroy(secfile);
 
-          offset = c - first;
-          first[offset - 2] = '\0';
-          sz_strlcpy(base, first);
-          first[offset - 2] = '0';
-          fz_fprintf(fs, "%s={", base);
-
-          /* Save an iterator at this first entry, which we can later use
-           * to repeatedly iterate over column names:
-           */
-          save_iter = ent_iter;
-
-          /* write the column names, and calculate ncol: */
-          ncol = 0;
-          col_iter = save_iter;
-          for (; (col_pentry = entry_list_link_data(col_iter));
-               col_iter = entry_list_link_next(col_iter)) {
-            col_entry_name = entry_name(col_pentry);
-            if (strncmp(col_entry_name, first, offset) != 0) {
-              break;
-            }
-            fz_fprintf(fs, "%s\"%s\"", (ncol == 0 ? "" : ","),
-                       col_entry_name + offset);
-            ncol++;
-          }
-          fz_fprintf(fs, "\n");
-
-          /* Iterate over rows and columns, incrementing ent_iter as we go,
-           * and writing values to the table.  Have a separate iterator
-           * to the column names to check they all match.
-           */
-          irow = icol = 0;
-          col_iter = save_iter;
-          for (;;) {
-            char expect[128];     /* pentry->name we're expecting */
-
-            pentry = entry_list_link_data(ent_iter);
-            col_pentry = entry_list_link_data(col_iter);
-
-            fc_snprintf(expect, sizeof(expect), "%s%d.%s",
-                        base, irow, entry_name(col_pentry) + offset);
-
-            /* break out of tabular if doesn't match: */
-            if ((!pentry) || (strcmp(entry_name(pentry), expect) != 0)) {
-              if (icol != 0) {
-                /* If the second or later row of a table is missing some
-                 * entries that the first row had, we drop out of the tabular
-                 * format.  This is inefficient so we print a warning message;
-                 * the calling code probably needs to be fixed so that it can
-                 * use the more efficient tabular format.
-                 *
-                 * FIXME: If the first row is missing some entries that the
-                 * second or later row has, then we'll drop out of tabular
-                 * format without an error message. */
-                bugreport_request("In file %s, there is no entry in the registry for\n"
-                                  "%s.%s (or the entries are out of order). This means\n"
-                                  "a less efficient non-tabular format will be used.\n"
-                                  "To avoid this make sure all rows of a table are\n"
-                                  "filled out with an entry for every column.",
-                                  real_filename, section_name(psection), expect);
-                fz_fprintf(fs, "\n");
-              }
-              fz_fprintf(fs, "}\n");
-              break;
-            }
+    return NULL;
+  }
 
-            if (icol > 0) {
-              fz_fprintf(fs, ",");
-            }
-            entry_to_file(pentry, fs);
+  if (binary) {
+    binfile_write_head(secfile->stream.fp);
+  }
 
-            ent_iter = entry_list_link_next(ent_iter);
-            col_iter = entry_list_link_next(col_iter);
+  return secfile;
+}
 
-            icol++;
-            if (icol == ncol) {
-              fz_fprintf(fs, "\n");
-              irow++;
-              icol = 0;
-              col_iter = save_iter;
-            }
-          }
-          if (!pentry) {
-            break;
-          }
-        }
-        if (!pentry) {
-          break;
-        }
+/**********************************************************************//**
+  Write all sections not yet written of a file from
+  secfile_stream_new(), and free their entries. Does nothing for other
+  section files. Returns FALSE if anything went wrong so far.
+**************************************************************************/
+bool secfile_flush(struct section_file *secfile)
+{
+  SECFILE_RETURN_VAL_IF_FAIL(secfile, NULL, NULL != secfile, FALSE);
 
-        /* Classic entry. */
-        col_entry_name = entry_name(pentry);
-        fz_fprintf(fs, "%s=", col_entry_name);
-        entry_to_file(pentry, fs);
+  if (NULL == secfile->stream.fp) {
+    return TRUE;
+  }
 
-        /* Check for vector. */
-        for (i = 1;; i++) {
-          col_iter = entry_list_link_next(ent_iter);
-          col_pentry = entry_list_link_data(col_iter);
-          if (NULL == col_pentry) {
-            break;
-          }
-          fc_snprintf(pentry_name, sizeof(pentry_name),
-                      "%s,%d", col_entry_name, i);
-          if (0 != strcmp(pentry_name, entry_name(col_pentry))) {
-            break;
-          }
-          fz_fprintf(fs, ",");
-          entry_to_file(col_pentry, fs);
-          ent_iter = col_iter;
-        }
+  section_list_iterate(secfile->sections, psection) {
+    if (psection->written) {
+      continue;
+    }
 
-        comment = entry_comment(pentry);
-        if (comment) {
-          fz_fprintf(fs, "  # %s\n", comment);
-        } else {
-          fz_fprintf(fs, "\n");
-        }
+    if (secfile->stream.binary) {
+      if (!binfile_write_section(psection, secfile->stream.fp)) {
+        secfile->stream.failed = TRUE;
       }
+    } else {
+      section_to_file(psection, secfile->stream.fp, secfile->name);
     }
+
+    /* Keep the empty section, so that it can't be created again. */
+    section_clear_all(psection);
+    psection->written = TRUE;
   } section_list_iterate_end;
 
+  /* No entries are left, so their memory can be reused. */
+  fc_assert(NULL == secfile->hash.entries);
+  secfile_free_entries_memory(secfile);
+
+  if (0 != fz_ferror(secfile->stream.fp)) {
+    SECFILE_LOG(secfile, NULL, "Error writing %s: %s",
+                secfile->name, fz_strerror(secfile->stream.fp));
+    secfile->stream.failed = TRUE;
+  }
+
+  return !secfile->stream.failed;
+}
+
+/**********************************************************************//**
+  Write the rest of a file from secfile_stream_new() and close it.
+  Returns TRUE if the whole file was written without errors.
+**************************************************************************/
+bool secfile_stream_close(struct section_file *secfile)
+{
+  fz_FILE *fs;
+  bool ok;
+
+  SECFILE_RETURN_VAL_IF_FAIL(secfile, NULL, NULL != secfile, FALSE);
+  SECFILE_RETURN_VAL_IF_FAIL(secfile, NULL, NULL != secfile->stream.fp,
+                             FALSE);
+
+  ok = secfile_flush(secfile);
+  fs = secfile->stream.fp;
+  secfile->stream.fp = NULL;
+
+  if (ok && secfile->stream.binary) {
+    binfile_write_tail(fs);
+  }
+
   if (0 != fz_ferror(fs)) {
-    SECFILE_LOG(secfile, NULL, "Error before closing %s: %s", 
-                real_filename, fz_strerror(fs));
+    SECFILE_LOG(secfile, NULL, "Error before closing %s: %s",
+                secfile->name, fz_strerror(fs));
     fz_fclose(fs);
     return FALSE;
   }
   if (0 != fz_fclose(fs)) {
-    SECFILE_LOG(secfile, NULL, "Error closing %s", real_filename);
+    SECFILE_LOG(secfile, NULL, "Error closing %s", secfile->name);
     return FALSE;
   }
 
-  return TRUE;
+  return ok;
 }
 
 /**********************************************************************//**
@@ -1715,10 +1903,16 @@ struct entry *secfile_entry_by_path(const struct section_file *secfile,
 
   SECFILE_RETURN_VAL_IF_FAIL(secfile, NULL, NULL != secfile, NULL);
 
-  sz_strlcpy(fullpath, path);
+  /* Paths are plain ASCII; a byte copy spares the utf-8 conversion of
+   * sz_strlcpy(), which serializes concurrent lookups on its buffers. */
+  len = strlen(path);
+  if (len >= sizeof(fullpath)) {
+    len = sizeof(fullpath) - 1;
+  }
+  memcpy(fullpath, path, len);
+  fullpath[len] = '\0';
 
   /* treat "sec.foo,0" as "sec.foo": */
-  len = strlen(fullpath);
   if (len > 2 && fullpath[len - 2] == ',' && fullpath[len - 1] == '0') {
     fullpath[len - 2] = '\0';
   }
@@ -2745,8 +2939,15 @@ int *secfile_lookup_enum_vec_data(const struct section_file *secfile,
 struct section *secfile_section_by_name(const struct section_file *secfile,
                                         const char *name)
 {
+  struct section *pfound;
+
   SECFILE_RETURN_VAL_IF_FAIL(secfile, NULL, NULL != secfile, NULL);
 
+  if (NULL != secfile->hash.sections) {
+    return (section_hash_lookup(secfile->hash.sections, name, &pfound)
+            ? pfound : NULL);
+  }
+
   section_list_iterate(secfile->sections, psection) {
     if (0 == strcmp(section_name(psection), name)) {
       return psection;
@@ -2848,6 +3049,7 @@ struct section *secfile_section_new(struct section_file *secfile,
   psection->special = EST_NORMAL;
   psection->name = fc_strdup(name);
   psection->entries = entry_list_new_full(entry_destroy);
+  psection->written = FALSE;
 
   /* Append to secfile. */
   psection->secfile = secfile;
@@ -3048,8 +3250,15 @@ static struct entry *entry_new(struct section *psection, const char *name)
     return NULL;
   }
 
-  pentry = fc_malloc(sizeof(struct entry));
-  pentry->name = fc_strdup(name);
+  if (psection->written) {
+    SECFILE_LOG(secfile, psection,
+                "Entry \"%s\" added after the section was written.", name);
+    secfile->stream.failed = TRUE;
+    return NULL;
+  }
+
+  pentry = secfile_alloc(secfile, sizeof(struct entry));
+  pentry->name = secfile_strdup(secfile, name);
   pentry->type = -1;    /* Invalid case. */
   pentry->used = 0;
   pentry->comment = NULL;
@@ -3124,7 +3333,8 @@ struct entry *section_entry_str_new(struct section *psection,
 
   if (NULL != pentry) {
     pentry->type = ENTRY_STR;
-    pentry->string.value = fc_strdup(NULL != value ? value : "");
+    pentry->string.value = secfile_strdup(psection->secfile,
+                                          NULL != value ? value : "");
     pentry->string.escaped = escaped;
     pentry->string.raw = FALSE;
     pentry->string.gt_marking = FALSE;
@@ -3143,14 +3353,16 @@ static struct entry *section_entry_filereference_new(struct section *psection,
 
   if (NULL != pentry) {
     pentry->type = ENTRY_FILEREFERENCE;
-    pentry->string.value = fc_strdup(NULL != value ? value : "");
+    pentry->string.value = secfile_strdup(psection->secfile,
+                                          NULL != value ? value : "");
   }
 
   return pentry;
 }
 
 /**********************************************************************//**
-  Entry structure destructor.
+  Entry structure destructor. The memory of the entry belongs to the
+  section file, and is freed with it.
 **************************************************************************/
 void entry_destroy(struct entry *pentry)
 {
@@ -3173,26 +3385,6 @@ void entry_destroy(struct entry *pentry)
       secfile_hash_delete(secfile, pentry);
     }
   }
-
-  /* Specific type free. */
-  switch (pentry->type) {
-  case ENTRY_BOOL:
-  case ENTRY_INT:
-  case ENTRY_FLOAT:
-    break;
-
-  case ENTRY_STR:
-  case ENTRY_FILEREFERENCE:
-    free(pentry->string.value);
-    break;
-  }
-
-  /* Common free. */
-  free(pentry->name);
-  if (NULL != pentry->comment) {
-    free(pentry->comment);
-  }
-  free(pentry);
 }
 
 /**********************************************************************//**
@@ -3269,8 +3461,7 @@ bool entry_set_name(struct entry *pentry, const char *name)
   secfile_hash_delete(secfile, pentry);
 
   /* Really rename the entry. */
-  free(pentry->name);
-  pentry->name = fc_strdup(name);
+  pentry->name = secfile_strdup(secfile, name);
 
   /* Insert into hash table the new path. */
   secfile_hash_insert(secfile, pentry);
@@ -3294,11 +3485,9 @@ void entry_set_comment(struct entry *pentry, const char *comment)
     return;
   }
 
-  if (NULL != pentry->comment) {
-    free(pentry->comment);
-  }
-
-  pentry->comment = (NULL != comment ? fc_strdup(comment) : NULL);
+  pentry->comment = (NULL != comment
+                     ? secfile_strdup(pentry->psection->secfile, comment)
+                     : NULL);
 }
 
 /**********************************************************************//**
@@ -3439,8 +3628,8 @@ bool entry_str_set(struct entry *pentry, const char *value)
   SECFILE_RETURN_VAL_IF_FAIL(pentry->psection->secfile, pentry->psection,
                              ENTRY_STR == pentry->type, FALSE);
 
-  free(pentry->string.value);
-  pentry->string.value = fc_strdup(NULL != value ? value : "");
+  pentry->string.value = secfile_strdup(pentry->psection->secfile,
+                                        NULL != value ? value : "");
   return TRUE;
 }
 
@@ -65,6 +65,12 @@ struct section_file *secfile_from_stream(fz_FILE *stream,
 
 bool secfile_save(const struct section_file *secfile, const char *filename,
                   int compression_level, enum fz_method compression_method);
+struct section_file *secfile_stream_new(const char *filename,
+                                        int compression_level,
+                                        enum fz_method compression_method,
+                                        bool binary);
+bool secfile_flush(struct section_file *secfile);
+bool secfile_stream_close(struct section_file *secfile);
 void secfile_check_unused(const struct section_file *secfile);
 const char *secfile_name(const struct section_file *secfile);
 
@@ -16,6 +16,7 @@
 #endif
 
 #include <stdarg.h>
+#include <string.h>
 
 /* utility */
 #include "mem.h"
@@ -30,6 +31,20 @@ static char error_buffer[MAX_LEN_ERRORBUF] = "\0";
 /* Debug function for every new entry. */
 #define DEBUG_ENTRIES(...) /* log_debug(__VA_ARGS__); */
 
+/* The entries of a section file, with their names and values, are cut
+ * out of big chunks of memory, which are only freed with the whole
+ * file. */
+struct secfile_chunk {
+  struct secfile_chunk *next;
+  size_t size;
+  size_t used;
+};
+
+#define SECFILE_CHUNK_SIZE (64 * 1024)
+#define SECFILE_ALIGN(size) (((size) + 7) & ~(size_t) 7)
+#define SECFILE_CHUNK_DATA(chunk) \
+  ((char *) (chunk) + SECFILE_ALIGN(sizeof(struct secfile_chunk)))
+
 /**********************************************************************//**
   Returns the last error which occurred in a string.  It never returns NULL.
 **************************************************************************/
@@ -86,9 +101,81 @@ struct section_file *secfile_new(bool allow_duplicates)
   /* Maybe allocated later. */
   secfile->hash.entries = NULL;
 
+  secfile->chunks = NULL;
+
+  secfile->stream.fp = NULL;
+  secfile->stream.binary = FALSE;
+  secfile->stream.failed = FALSE;
+
   return secfile;
 }
 
+/**********************************************************************//**
+  Allocate memory that lives as long as the section file, or until
+  secfile_free_entries_memory(). It is never freed on its own.
+**************************************************************************/
+void *secfile_alloc(struct section_file *secfile, size_t size)
+{
+  struct secfile_chunk *chunk = secfile->chunks;
+  void *mem;
+
+  size = SECFILE_ALIGN(size);
+
+  if (NULL == chunk || chunk->size - chunk->used < size) {
+    size_t chunk_size = MAX(size, SECFILE_CHUNK_SIZE);
+    struct secfile_chunk *pnew
+      = fc_malloc(SECFILE_ALIGN(sizeof(*pnew)) + chunk_size);
+
+    pnew->size = chunk_size;
+    pnew->used = 0;
+    if (NULL != chunk && SECFILE_CHUNK_SIZE < size) {
+      /* Keep filling the current chunk. */
+      pnew->next = chunk->next;
+      chunk->next = pnew;
+    } else {
+      pnew->next = chunk;
+      secfile->chunks = pnew;
+    }
+    chunk = pnew;
+  }
+
+  mem = SECFILE_CHUNK_DATA(chunk) + chunk->used;
+  chunk->used += size;
+
+  return mem;
+}
+
+/**********************************************************************//**
+  Copy a string into memory from secfile_alloc().
+**************************************************************************/
+char *secfile_strdup(struct section_file *secfile, const char *str)
+{
+  size_t size = strlen(str) + 1;
+
+  return memcpy(secfile_alloc(secfile, size), str, size);
+}
+
+/**********************************************************************//**
+  Free all memory from secfile_alloc(), keeping one chunk for reuse.
+  There must be no entries left.
+**************************************************************************/
+void secfile_free_entries_memory(struct section_file *secfile)
+{
+  struct secfile_chunk *chunk = secfile->chunks;
+
+  if (NULL == chunk) {
+    return;
+  }
+
+  while (NULL != chunk->next) {
+    struct secfile_chunk *next = chunk->next->next;
+
+    free(chunk->next);
+    chunk->next = next;
+  }
+  chunk->used = 0;
+}
+
 /**********************************************************************//**
   Free a section file.
 **************************************************************************/
@@ -109,6 +196,18 @@ void secfile_destroy(struct section_file *secfile)
 
   section_list_destroy(secfile->sections);
 
+  while (NULL != secfile->chunks) {
+    struct secfile_chunk *next = secfile->chunks->next;
+
+    free(secfile->chunks);
+    secfile->chunks = next;
+  }
+
+  if (NULL != secfile->stream.fp) {
+    /* Abandoned without secfile_stream_close(). */
+    fz_fclose(secfile->stream.fp);
+  }
+
   if (NULL != secfile->name) {
     free(secfile->name);
   }
@@ -22,6 +22,7 @@ extern "C" {
 #endif /* __cplusplus */
 
 /* utility */
+#include "ioz.h"
 #include "support.h"
 
 /* Section structure. */
@@ -30,6 +31,8 @@ struct section {
   enum entry_special_type special;
   char *name;                   /* Name of the section. */
   struct entry_list *entries;   /* The list of the children. */
+  bool written;                 /* Already streamed out, see
+                                 * secfile_flush(). */
 };
 
 /* The section file struct itself. */
@@ -48,8 +51,23 @@ struct section_file {
     struct section_hash *sections;
     struct entry_hash *entries;
   } hash;
+  /* Memory of the entries, see secfile_alloc(). */
+  struct secfile_chunk *chunks;
+  /* Only for files from secfile_stream_new(). */
+  struct {
+    fz_FILE *fp;
+    bool binary;
+    bool failed;
+  } stream;
 };
 
+void *secfile_alloc(struct section_file *secfile, size_t size);
+char *secfile_strdup(struct section_file *secfile, const char *str);
+void secfile_free_entries_memory(struct section_file *secfile);
+
+bool secfile_build_entry_hash(struct section_file *secfile,
+                              bool allow_duplicates);
+
 void secfile_log(const struct section_file *secfile,
                  const struct section *psection,
                  const char *file, const char *function, int line,
@@ -75,8 +93,9 @@ void secfile_log(const struct section_file *secfile,
 #define SPECHASH_IDATA_TYPE struct section *
 #include "spechash.h"
 
+/* The keys are allocated with secfile_alloc(). */
 #define SPECHASH_TAG entry
-#define SPECHASH_ASTR_KEY_TYPE
+#define SPECHASH_CSTR_KEY_TYPE
 #define SPECHASH_IDATA_TYPE struct entry *
 #include "spechash.h"
 
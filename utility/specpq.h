@@ -35,6 +35,7 @@
  *    void foo_pq_destroy(struct foo_pq *pq);
  *    void foo_pq_destroy_full(struct foo_pq *pq,
  *                             foo_pq_data_free_fn_t data_free);
+ *    void foo_pq_clear(struct foo_pq *pq);
  *    void foo_pq_insert(struct foo_pq *pq, data_t data,
  *                       priority_t priority);
  *    void foo_pq_replace(struct foo_pq *pq, data_t data,
@@ -141,6 +142,16 @@ SPECPQ_FOO(_pq_destroy_full)(SPECPQ_PQ *_pq,
   free(pq);
 }
 
+/****************************************************************************
+  Remove all items from the queue. The memory is kept for reuse.
+****************************************************************************/
+static inline void SPECPQ_FOO(_pq_clear)(SPECPQ_PQ *_pq)
+{
+  SPECPQ_PQ_ *pq = (SPECPQ_PQ_ *) _pq;
+
+  pq->size = 1;
+}
+
 /****************************************************************************
   Insert an item into the queue.
 ****************************************************************************/
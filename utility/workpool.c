@@ -0,0 +1,308 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+/* utility */
+#include "fcthread.h"
+#include "log.h"
+#include "mem.h"
+#include "support.h"
+
+#include "workpool.h"
+
+/* Share of the index range owned by one thread. Indices [next, end)
+ * are still to be done. Other threads may take the upper part. */
+struct workpool_share {
+  fc_mutex lock;
+  int next;
+  int end;
+};
+
+struct workpool_helper {
+  struct fc_workpool *pool;
+  int slot;
+  fc_thread thread;
+};
+
+struct fc_workpool {
+  int threads;                    /* Helper threads */
+  struct workpool_helper *helpers;
+  struct workpool_share *shares;  /* Slot 0 is the calling thread */
+
+  /* The fields below are protected by 'mutex'. */
+  fc_mutex mutex;
+  fc_thread_cond job_cond;        /* A new job, or quit */
+  fc_thread_cond done_cond;       /* Helpers are done with the job */
+  unsigned int generation;        /* Number of the current job */
+  int busy;                       /* Helpers still working on it */
+  bool quit;
+
+  fc_work_func func;
+  void *data;
+};
+
+/*******************************************************************//**
+  Take the next index from the share of the given slot. Returns -1 when
+  the share is empty.
+***********************************************************************/
+static int workpool_take(struct workpool_share *share)
+{
+  int idx = -1;
+
+  fc_allocate_mutex(&share->lock);
+  if (share->next < share->end) {
+    idx = share->next++;
+  }
+  fc_release_mutex(&share->lock);
+
+  return idx;
+}
+
+/*******************************************************************//**
+  Move half of the largest remaining share of another slot to the
+  share of the given slot. Returns FALSE when there is nothing left to
+  steal.
+***********************************************************************/
+static bool workpool_steal(struct fc_workpool *pool, int slot)
+{
+  for (;;) {
+    struct workpool_share *victim = NULL;
+    int most = 0;
+    int i;
+
+    for (i = 0; i <= pool->threads; i++) {
+      struct workpool_share *share = &pool->shares[i];
+      int left;
+
+      if (i == slot) {
+        continue;
+      }
+      fc_allocate_mutex(&share->lock);
+      left = share->end - share->next;
+      fc_release_mutex(&share->lock);
+      if (left > most) {
+        most = left;
+        victim = share;
+      }
+    }
+
+    if (victim == NULL) {
+      return FALSE;
+    }
+
+    fc_allocate_mutex(&victim->lock);
+    if (victim->next < victim->end) {
+      struct workpool_share *own = &pool->shares[slot];
+      int mid = victim->next + (victim->end - victim->next) / 2;
+      int end = victim->end;
+
+      victim->end = mid;
+      fc_release_mutex(&victim->lock);
+
+      fc_allocate_mutex(&own->lock);
+      own->next = mid;
+      own->end = end;
+      fc_release_mutex(&own->lock);
+
+      return TRUE;
+    }
+    /* Emptied while we looked at the others; look again. */
+    fc_release_mutex(&victim->lock);
+  }
+}
+
+/*******************************************************************//**
+  Process the current job as the thread of the given slot until no work
+  is left anywhere.
+***********************************************************************/
+static void workpool_work(struct fc_workpool *pool, int slot)
+{
+  do {
+    int idx;
+
+    while ((idx = workpool_take(&pool->shares[slot])) >= 0) {
+      pool->func(idx, pool->data);
+    }
+  } while (workpool_steal(pool, slot));
+}
+
+/*******************************************************************//**
+  Main function of a helper thread.
+***********************************************************************/
+static void workpool_helper_main(void *arg)
+{
+  struct workpool_helper *helper = (struct workpool_helper *) arg;
+  struct fc_workpool *pool = helper->pool;
+  unsigned int seen = 0;
+
+  fc_allocate_mutex(&pool->mutex);
+  for (;;) {
+    while (!pool->quit && pool->generation == seen) {
+      fc_thread_cond_wait(&pool->job_cond, &pool->mutex);
+    }
+    if (pool->quit) {
+      break;
+    }
+    seen = pool->generation;
+    fc_release_mutex(&pool->mutex);
+
+    workpool_work(pool, helper->slot);
+
+    fc_allocate_mutex(&pool->mutex);
+    if (--pool->busy == 0) {
+      fc_thread_cond_signal(&pool->done_cond);
+    }
+  }
+  fc_release_mutex(&pool->mutex);
+}
+
+/*******************************************************************//**
+  Wake up every helper thread. Caller holds the pool mutex.
+***********************************************************************/
+static void workpool_wake_helpers(struct fc_workpool *pool)
+{
+  int i;
+
+  /* There is no broadcast; a helper that got woken up does not wait
+   * again before it has seen the change, so each signal reaches a
+   * different one. */
+  for (i = 0; i < pool->threads; i++) {
+    fc_thread_cond_signal(&pool->job_cond);
+  }
+}
+
+/*******************************************************************//**
+  Create a pool with the given number of helper threads.
+***********************************************************************/
+struct fc_workpool *fc_workpool_new(int threads)
+{
+  struct fc_workpool *pool = fc_calloc(1, sizeof(*pool));
+  int i;
+
+  if (threads < 0 || !has_thread_cond_impl()) {
+    threads = 0;
+  }
+
+  fc_init_mutex(&pool->mutex);
+  fc_thread_cond_init(&pool->job_cond);
+  fc_thread_cond_init(&pool->done_cond);
+
+  if (threads > 0) {
+    pool->helpers = fc_calloc(threads, sizeof(*pool->helpers));
+  }
+  for (i = 0; i < threads; i++) {
+    struct workpool_helper *helper = &pool->helpers[i];
+
+    helper->pool = pool;
+    helper->slot = i + 1;
+    if (fc_thread_start(&helper->thread, workpool_helper_main, helper)
+        != 0) {
+      log_error("Could only start %d of %d worker threads.", i, threads);
+      break;
+    }
+    /* Only count threads that have been started. */
+    pool->threads = i + 1;
+  }
+
+  /* Helpers only look at the shares when they get a job, so these can
+   * be set up after starting them. */
+  pool->shares = fc_calloc(pool->threads + 1, sizeof(*pool->shares));
+  for (i = 0; i <= pool->threads; i++) {
+    fc_init_mutex(&pool->shares[i].lock);
+  }
+
+  return pool;
+}
+
+/*******************************************************************//**
+  Stop the helper threads and free the pool.
+***********************************************************************/
+void fc_workpool_destroy(struct fc_workpool *pool)
+{
+  int i;
+
+  fc_allocate_mutex(&pool->mutex);
+  pool->quit = TRUE;
+  workpool_wake_helpers(pool);
+  fc_release_mutex(&pool->mutex);
+
+  for (i = 0; i < pool->threads; i++) {
+    fc_thread_wait(&pool->helpers[i].thread);
+  }
+
+  fc_thread_cond_destroy(&pool->done_cond);
+  fc_thread_cond_destroy(&pool->job_cond);
+  fc_destroy_mutex(&pool->mutex);
+
+  for (i = 0; i <= pool->threads; i++) {
+    fc_destroy_mutex(&pool->shares[i].lock);
+  }
+
+  free(pool->shares);
+  free(pool->helpers);
+  free(pool);
+}
+
+/*******************************************************************//**
+  Return the number of helper threads actually running.
+***********************************************************************/
+int fc_workpool_threads(const struct fc_workpool *pool)
+{
+  return pool->threads;
+}
+
+/*******************************************************************//**
+  Call func(index, data) for every index in [0, count). Returns when
+  all calls are done.
+***********************************************************************/
+void fc_workpool_run(struct fc_workpool *pool, int count,
+                     fc_work_func func, void *data)
+{
+  int slots, i;
+
+  if (pool->threads == 0 || count < 2) {
+    for (i = 0; i < count; i++) {
+      func(i, data);
+    }
+    return;
+  }
+
+  slots = pool->threads + 1;
+
+  fc_allocate_mutex(&pool->mutex);
+  for (i = 0; i < slots; i++) {
+    struct workpool_share *share = &pool->shares[i];
+
+    fc_allocate_mutex(&share->lock);
+    share->next = (int) ((long) count * i / slots);
+    share->end = (int) ((long) count * (i + 1) / slots);
+    fc_release_mutex(&share->lock);
+  }
+  pool->func = func;
+  pool->data = data;
+  pool->busy = pool->threads;
+  pool->generation++;
+  workpool_wake_helpers(pool);
+  fc_release_mutex(&pool->mutex);
+
+  workpool_work(pool, 0);
+
+  fc_allocate_mutex(&pool->mutex);
+  while (pool->busy > 0) {
+    fc_thread_cond_wait(&pool->done_cond, &pool->mutex);
+  }
+  fc_release_mutex(&pool->mutex);
+}
@@ -0,0 +1,51 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifndef FC__WORKPOOL_H
+#define FC__WORKPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/***********************************************************************
+  Pool of helper threads for data parallel jobs.
+
+  fc_workpool_run() calls a function once for each index of a range and
+  returns when all calls have finished. The calling thread takes part
+  in the work. Each thread starts with an equal share of the range;
+  a thread that runs out of work steals half of what is left of the
+  largest remaining share, so uneven items still keep every thread
+  busy. The order in which the indices get processed is unspecified,
+  so the function must only write data owned by its own index.
+
+  Without condition variable support, or with zero helper threads,
+  the calls are made one after another by the calling thread.
+***********************************************************************/
+
+struct fc_workpool;
+
+typedef void (*fc_work_func)(int index, void *data);
+
+struct fc_workpool *fc_workpool_new(int threads);
+void fc_workpool_destroy(struct fc_workpool *pool);
+int fc_workpool_threads(const struct fc_workpool *pool);
+
+void fc_workpool_run(struct fc_workpool *pool, int count,
+                     fc_work_func func, void *data);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif  /* FC__WORKPOOL_H */